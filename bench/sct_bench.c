@@ -0,0 +1,299 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <readline/readline.h>
+#include "sct_core.h"
+#include "sct_core_internal.h"
+#include "sct_utils.h"
+#include "sct_commands.h"
+#include "sct_resolve.h"
+
+/*
+    sct_bench: micro-benchmarks of the Core's interactive hot paths.
+    Every case runs a number of samples; a sample repeats the case enough
+    times to take about SCT_BENCH_SAMPLE_NS. The result is printed to stdout
+    as JSON: per case mean ns/op with its standard deviation across samples,
+    the best sample, and ops/s.
+
+    Synthetic inputs: a long command line, SCT_BENCH_COMMANDS registered
+    commands, and a directory of SCT_BENCH_DIR_FILES files created in
+    a temporary location.
+
+    Usage: sct_bench [filter]   - run only cases whose names contain filter
+*/
+
+#define SCT_BENCH_SAMPLES 15
+#define SCT_BENCH_SAMPLE_NS 10000000ull   // 10 ms
+#define SCT_BENCH_COMMANDS 1000
+#define SCT_BENCH_DIR_FILES 5000
+#define SCT_BENCH_LONG_LINE_WORDS 400
+
+typedef void (*bench_fn_t)(void *ctx);
+
+typedef struct bench_case_ {
+    char *name;
+    bench_fn_t fn;
+    void *ctx;
+} bench_case_t;
+
+static bool g_first_result = true;
+
+#pragma region measurement
+//------------------------------------------------------------------------------
+//              measurement
+
+static uint64_t time_iterations(bench_case_t *bc, uint64_t iterations) {
+    uint64_t t0 = scu_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) bc->fn(bc->ctx);
+    return scu_now_ns() - t0;
+}
+
+// find iterations count making a sample last about SCT_BENCH_SAMPLE_NS
+static uint64_t calibrate(bench_case_t *bc) {
+    uint64_t iterations = 1;
+    while (true) {
+        uint64_t ns = time_iterations(bc, iterations);
+        if (ns >= SCT_BENCH_SAMPLE_NS / 10) {
+            double per_op = (double)ns / iterations;
+            uint64_t n = (uint64_t)(SCT_BENCH_SAMPLE_NS / per_op);
+            return n ? n : 1;
+        }
+        iterations *= 10;
+    }
+}
+
+static void run_case(bench_case_t *bc) {
+    uint64_t iterations = calibrate(bc);
+    double samples[SCT_BENCH_SAMPLES];
+    double sum = 0;
+    double best = 0;
+    for (int i = 0; i < SCT_BENCH_SAMPLES; i++) {
+        samples[i] = (double)time_iterations(bc, iterations) / iterations;
+        sum += samples[i];
+        if ((i == 0) || (samples[i] < best)) best = samples[i];
+    }
+    double mean = sum / SCT_BENCH_SAMPLES;
+    double var = 0;
+    for (int i = 0; i < SCT_BENCH_SAMPLES; i++)
+        var += (samples[i] - mean) * (samples[i] - mean);
+    var /= SCT_BENCH_SAMPLES - 1;
+
+    printf("%s    {\"name\": \"%s\", \"samples\": %d, "
+        "\"iterations\": %llu, \"ns_per_op\": %.2f, "
+        "\"ns_per_op_stddev\": %.2f, \"ns_per_op_min\": %.2f, "
+        "\"ops_per_sec\": %.0f}",
+        g_first_result ? "" : ",\n", bc->name, SCT_BENCH_SAMPLES,
+        (unsigned long long)iterations, mean, sqrt(var), best,
+        1e9 / mean);
+    g_first_result = false;
+    fflush(stdout);
+}
+#pragma endregion
+
+#pragma region fixtures
+//------------------------------------------------------------------------------
+//              fixtures
+
+static char g_dir[] = "/tmp/sct_bench_XXXXXX";
+static char *g_file = NULL;
+static char *g_long_line = NULL;
+
+static int noop_exec(sct_arg_t *args, int argc) {
+    return 0;
+}
+
+static void register_synthetic_commands(void) {
+    sct_arg_t args[2] = {
+        { SA_FILENAME, false, NULL },
+        { SA_TEXT, true, NULL }
+    };
+    for (int i = 0; i < SCT_BENCH_COMMANDS; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "bench_cmd_%04d", i);
+        sct_add_command(name, args, 2, noop_exec);
+    }
+}
+
+static bool create_directory_fixture(void) {
+    if (!mkdtemp(g_dir)) {
+        perror(g_dir);
+        return false;
+    }
+    for (int i = 0; i < SCT_BENCH_DIR_FILES; i++) {
+        char *fn = scu_sprintf("%s/file_%05d.log", g_dir, i);
+        int fd = open(fn, O_CREAT | O_WRONLY, 0644);
+        free(fn);
+        if (fd < 0) return false;
+        close(fd);
+    }
+    g_file = scu_sprintf("%s/file_00000.log", g_dir);
+    return true;
+}
+
+static void remove_directory_fixture(void) {
+    for (int i = 0; i < SCT_BENCH_DIR_FILES; i++) {
+        char *fn = scu_sprintf("%s/file_%05d.log", g_dir, i);
+        unlink(fn);
+        free(fn);
+    }
+    rmdir(g_dir);
+    free(g_file);
+}
+
+static void build_long_line(void) {
+    size_t sz = SCT_BENCH_LONG_LINE_WORDS * 24;
+    g_long_line = malloc(sz);
+    char *p = g_long_line;
+    p += sprintf(p, "grep");
+    for (int i = 0; i < SCT_BENCH_LONG_LINE_WORDS; i++) {
+        if (i % 4 == 3) p += sprintf(p, " \"quoted word %d\"", i);
+        else p += sprintf(p, "  word_%d", i);
+    }
+}
+#pragma endregion
+
+#pragma region cases
+//------------------------------------------------------------------------------
+//              cases
+
+static void bench_parse_words(void *ctx) {
+    parsed_words_t *words = parse_words(ctx, false);
+    purge_words(words);
+}
+
+static void bench_command_from_words(void *ctx) {
+    command_from_words(ctx);
+}
+
+static void bench_validate_arg(void *ctx) {
+    bool err_printed = false;
+    validate_arg(ctx, &err_printed);
+}
+
+static void bench_lookup(void *ctx) {
+    get_command_by_name(ctx);
+}
+
+static void bench_complete_command(void *ctx) {
+    char **matches = rl_completion_matches(ctx, command_names_provider);
+    if (matches) {
+        for (char **p = matches; *p; p++) free(*p);
+        free(matches);
+    }
+}
+
+static void bench_complete_filename(void *ctx) {
+    char **matches = rl_completion_matches(ctx,
+        rl_filename_completion_function);
+    if (matches) {
+        for (char **p = matches; *p; p++) free(*p);
+        free(matches);
+    }
+}
+
+static void bench_completion_kind(void *ctx) {
+    rl_line_buffer = ctx;
+    resolve_comletion_kind(strlen(ctx));
+}
+#pragma endregion
+
+int main(int argc, char **argv) {
+    char *filter = argc > 1 ? argv[1] : NULL;
+    if (!scu_initialize_utils() || !sct_initialize()
+        || !create_directory_fixture())
+    {
+        printf("Unexpected error.\n");
+        return 1;
+    }
+    sct_init_builtin_commands();
+    register_synthetic_commands();
+    build_long_line();
+
+    char *short_line = scu_sprintf("grep body %s", g_file);
+    parsed_words_t *short_words = parse_words(short_line, false);
+    parsed_words_t *long_words = parse_words(g_long_line, false);
+    char *file_prefix = scu_sprintf("%s/file_01", g_dir);
+    char *kind_line = scu_sprintf("cp %s ", g_file);
+
+    sct_arg_t arg_file = { SA_FILENAME, false, g_file };
+    sct_arg_t arg_new_file = { SA_NEW_FILENAME, false, g_file };
+    sct_arg_t arg_file_or_dir = { SA_FILE_OR_DIR_NAME, false, g_dir };
+    sct_arg_t arg_dir = { SA_DIRNAME, false, g_dir };
+    sct_arg_t arg_text = { SA_TEXT, false, "some text" };
+    // validation looks host names up: localhost comes from /etc/hosts
+    // and is cached before timing, numbers are not looked up at all
+    char *hosts[] = { "localhost" };
+    sct_resolve_names(hosts, 1);
+    sct_arg_t arg_inet = { SA_INETNAME, false, "localhost" };
+    sct_arg_t arg_inet_number = { SA_INETNAME, false, "192.0.2.1" };
+
+    bench_case_t cases[] = {
+        { "parse_words/short", bench_parse_words, short_line },
+        { "parse_words/long", bench_parse_words, g_long_line },
+        { "command_from_words/short", bench_command_from_words, short_words },
+        { "command_from_words/long", bench_command_from_words, long_words },
+        { "validate_arg/SA_FILENAME", bench_validate_arg, &arg_file },
+        { "validate_arg/SA_NEW_FILENAME", bench_validate_arg, &arg_new_file },
+        { "validate_arg/SA_FILE_OR_DIR_NAME", bench_validate_arg,
+            &arg_file_or_dir },
+        { "validate_arg/SA_DIRNAME", bench_validate_arg, &arg_dir },
+        { "validate_arg/SA_TEXT", bench_validate_arg, &arg_text },
+        { "validate_arg/SA_INETNAME", bench_validate_arg, &arg_inet },
+        { "validate_arg/SA_INETNAME_number", bench_validate_arg,
+            &arg_inet_number },
+        { "lookup/hit_first", bench_lookup, "bench_cmd_0000" },
+        { "lookup/hit_last", bench_lookup, "pwd" },
+        { "lookup/miss", bench_lookup, "no_such_command" },
+        { "completion/kind", bench_completion_kind, kind_line },
+        { "completion/commands_all", bench_complete_command, "" },
+        { "completion/commands_prefix", bench_complete_command, "bench_cmd_05" },
+        { "completion/filenames_prefix", bench_complete_filename, file_prefix },
+    };
+
+    printf("{\n  \"benchmark\": \"sct_bench\",\n"
+        "  \"synthetic_commands\": %d,\n  \"dir_files\": %d,\n"
+        "  \"results\": [\n", SCT_BENCH_COMMANDS, SCT_BENCH_DIR_FILES);
+    for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (!filter || strstr(cases[i].name, filter))
+            run_case(&cases[i]);
+    }
+    printf("\n  ]\n}\n");
+
+    rl_line_buffer = NULL;
+    purge_words(short_words);
+    purge_words(long_words);
+    free(short_line);
+    free(file_prefix);
+    free(kind_line);
+    free(g_long_line);
+    remove_directory_fixture();
+    sct_finalize();
+    sct_resolve_finalize();
+    scu_finalize_utils();
+    return 0;
+}
@@ -0,0 +1,38 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct sct_aho_ sct_aho_t;
+
+// sct_aho_build() makes an Aho-Corasick automaton finding any of the
+// strings, which must not contain '\n'. Empty strings are ignored.
+sct_aho_t *sct_aho_build(char **patterns, int count);
+void sct_aho_free(sct_aho_t *ac);
+// sct_aho_find_line() looks for the first line of data containing any
+// of the strings, like sct_regex_find_line(). The indexes of the strings
+// found in the line, each once, are left in *found, valid until the next
+// call.
+bool sct_aho_find_line(sct_aho_t *ac, char *data, size_t len,
+    size_t *line_start, size_t *line_end, int **found, int *found_count);
@@ -0,0 +1,48 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+// Streaming decompression of compressed files for grep, on a thread of
+// its own. zlib and libzstd are loaded on first use.
+typedef enum sct_decomp_format_ {
+    SCT_DECOMP_NONE,
+    SCT_DECOMP_GZIP,
+    SCT_DECOMP_ZSTD
+} sct_decomp_format_t;
+
+typedef struct sct_decomp_ sct_decomp_t;
+
+// the format of a file starting with data, by its magic bytes
+sct_decomp_format_t sct_decomp_detect(const char *data, size_t len);
+// sct_decomp_open() starts decompressing a file; NULL with the reason in
+// err if it cannot, e.g. for lack of the library.
+sct_decomp_t *sct_decomp_open(char *path, sct_decomp_format_t format,
+    char *err, size_t err_size);
+// sct_decomp_next() gives the next piece of the decompressed data, valid
+// until the next call; false at the end, or on an error.
+bool sct_decomp_next(sct_decomp_t *d, char **data, size_t *len);
+// the reason decompression stopped early, NULL if it did not
+const char *sct_decomp_error(sct_decomp_t *d);
+void sct_decomp_close(sct_decomp_t *d);
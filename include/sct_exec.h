@@ -0,0 +1,36 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+
+// sct_exec_argv() runs an external program given by a NULL terminated argv,
+// with no shell involved. argv[0] is looked up in PATH once and cached.
+// The child's stdout goes to out_fd (pass STDOUT_FILENO to share ours).
+// Returns the child's wait status like system() does, or -1 on failure.
+int sct_exec_argv(char *const argv[], int out_fd);
+// sct_exec_lines() runs a program like sct_exec_argv(), passing each line
+// of its stdout, with no '\n', to fn as soon as it is written.
+typedef void (*sct_exec_line_fn_t)(char *line, void *ctx);
+int sct_exec_lines(char *const argv[], sct_exec_line_fn_t fn, void *ctx);
+void sct_exec_flush_path_cache(void);
+void sct_exec_finalize(void);
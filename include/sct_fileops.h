@@ -0,0 +1,66 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+
+// Native file commands over the batched I/O layer (sct_io.h). Paths are
+// plain, i.e. with no quotes. Each returns the exit status the command
+// line tool of the same name would.
+
+// like 'ls -FClg': long listing without owners, kind indicators
+int sct_ls(char **paths, int count);
+// like 'grep': lines matching a basic regular expression
+int sct_grep(char *pattern, char **paths, int count);
+// drops grep's results kept for repeated searches
+void sct_grep_finalize(void);
+// like 'grep -F -f', lines prefixed with the strings they have:
+// [file:]string[,string...]:line
+int sct_fgrep(char *pattern_file, char **paths, int count);
+// like 'tail -F | grep': lines written to the files from now on, until
+// SIGINT; a file rotated is followed at its path
+int sct_grep_follow(char *pattern, char **paths, int count);
+// the steps of sct_grep_follow(), for a caller of its own to drive it:
+// sct_follow_start() opens the files at their ends, NULL on an error;
+// sct_follow_step() waits up to timeout ms (-1 for ever) for the files to
+// change and matches their new lines, false once SIGINT came or on an
+// error; sct_follow_end() closes them, returning follow's exit status
+typedef struct sct_follow_ sct_follow_t;
+sct_follow_t *sct_follow_start(char *pattern, char **paths, int count);
+bool sct_follow_step(sct_follow_t *f, int timeout);
+int sct_follow_end(sct_follow_t *f);
+// like 'cp': a file to a file, or files into a directory
+int sct_cp(char **srcs, int count, char *dst);
+// like 'rsync --inplace --no-whole-file' for a local file: the blocks of
+// dst differing from those of src are overwritten, nothing else is; with
+// durable, dst is synced to disk before returning
+int sct_sync(char *src, char *dst, bool durable);
+// like 'find <path> [predicates]', all predicates applying: -name <pattern>,
+// -type <f|d|l|p|s|c|b>, -size [+-]<n>[cwbkMG], -mtime [+-]<days>;
+// the paths are printed in no particular order
+int sct_find(char *path, char **predicates, int count);
+// like 'du -s': the disk usage of each path in KB, '.' if none
+int sct_du(char **paths, int count);
+// like 'fdupes -r': groups of files under dir with the same contents,
+// the largest first, a blank line after each; links to one inode and
+// empty files are left out
+int sct_dupes(char *dir);
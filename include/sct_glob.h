@@ -0,0 +1,39 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+// Kinds of entries a pattern may expand to.
+#define SCT_GLOB_FILES  0x01    // anything but directories
+#define SCT_GLOB_DIRS   0x02
+
+// true if s has any of the '*', '?', '[' wildcards
+bool sct_glob_has_magic(char *s);
+// matches one path component against a pattern component
+bool sct_glob_match(char *pattern, char *name);
+// sct_glob() expands pattern into a sorted array of *count paths, which
+// may be empty. Wildcards do not match a leading '.', '**' matches any
+// number of directories. Returns false on error only.
+bool sct_glob(char *pattern, int kinds, char ***paths, size_t *count);
+void sct_glob_free(char **paths, size_t count);
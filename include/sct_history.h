@@ -0,0 +1,46 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCT_HISTORY_DEFAULT_FN ".sctest_history"    // in $HOME
+
+// sct_history_open() maps the persistent history kept in fn (plain text,
+// one command line per line) and its indexes fn.idx and fn.tri, creating
+// them if needed, and binds Up/Down, C-p/C-n and C-r to it. Opening does
+// not depend on the history size; indexes are rebuilt only if they do not
+// match the text file, e.g. it was edited.
+bool sct_history_open(char *fn);
+void sct_history_close(void);
+// appends a command line; returns false if no history file is open
+bool sct_history_add(char *line);
+int64_t sct_history_count(void);
+// sct_history_entry() copies entry idx into buf, NUL terminated and
+// truncated to size; returns false for a bad idx
+bool sct_history_entry(int64_t idx, char *buf, size_t size);
+// sct_history_search() returns the newest entry older than entry before
+// containing q, or -1
+int64_t sct_history_search(char *q, int64_t before);
+// the default history file name, malloc'ed; NULL if $HOME is not set
+char *sct_history_default_path(void);
@@ -0,0 +1,42 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include "sct_regex.h"
+
+// Trigram index of a directory tree, kept in the file '.sctindex' at its
+// root, narrowing grep's candidate files.
+#define SCT_INDEX_NAME ".sctindex"
+
+// sct_index_build() indexes the regular files under dir, reading only
+// those changed since the last build. Returns the exit status.
+int sct_index_build(char *dir);
+// sct_index_filter() tells which of count files may have lines matching
+// re: keep[i] is cleared only for a file indexed unchanged without the
+// trigrams of any of the strings every match contains. The files are
+// stated by the caller, following links: st[i], or errno in errors[i].
+// Returns the count of files kept.
+size_t sct_index_filter(sct_regex_t *re, char **paths, struct stat *st,
+    int *errors, size_t count, bool *keep);
@@ -0,0 +1,78 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Batched file I/O for the file commands. io_uring is used where
+// the kernel allows it, plain system calls otherwise.
+typedef enum sct_io_backend_ {
+    SCT_IO_AUTO,
+    SCT_IO_URING,
+    SCT_IO_SYSCALLS
+} sct_io_backend_t;
+
+// Returns false if the requested backend is not available.
+bool sct_io_initialize(sct_io_backend_t backend);
+void sct_io_finalize(void);
+// name of the backend in use
+char *sct_io_backend_name(void);
+
+// A part of a file read by sct_io_next_chunk(). The data stays valid and
+// writable until the next call.
+typedef struct sct_io_chunk_ {
+    size_t index;       // of the file in paths[]
+    char *data;
+    size_t len;
+    off_t offset;
+    int error;          // errno of a failed open or read
+    bool last;          // the last chunk of the file; may be empty
+} sct_io_chunk_t;
+
+typedef struct sct_io_reader_ sct_io_reader_t;
+
+// sct_io_read_files() starts reading count files, opening and reading
+// ahead while the caller consumes earlier ones. Chunks come in order:
+// the files as given, each of them from its start.
+sct_io_reader_t *sct_io_read_files(char **paths, size_t count);
+// the same, each file read from starts[i] on; chunk offsets are the
+// files' offsets
+sct_io_reader_t *sct_io_read_files_at(char **paths, off_t *starts,
+    size_t count);
+bool sct_io_next_chunk(sct_io_reader_t *reader, sct_io_chunk_t *chunk);
+// sct_io_skip_file() passes over the rest of the file of the chunk just
+// returned: the next chunk is of the next file.
+void sct_io_skip_file(sct_io_reader_t *reader);
+void sct_io_reader_close(sct_io_reader_t *reader);
+
+// sct_io_stat_batch() stats count names relative to dirfd at once;
+// errors[i] gets 0 or errno. Symbolic links are followed if follow is set.
+void sct_io_stat_batch(int dirfd, char **names, size_t count, bool follow,
+    struct stat *st, int *errors);
+
+// sct_io_copy_file() copies the contents of a regular file src to dst,
+// creating dst with the mode of src if it does not exist. Returns 0 or
+// errno; EEXIST means src and dst are the same file.
+int sct_io_copy_file(char *src, char *dst);
@@ -0,0 +1,50 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "sct_metrics.h"
+
+// Allocation accounting. Built in with USE_MEMSTATS in CMakeLists.txt,
+// which interposes malloc() and friends; otherwise the calls below are
+// cheap no-ops and sct_memstats_print() says accounting is off.
+// Every allocation and free is attributed to the calling thread's current
+// context: a phase, and for SCT_PHASE_EXEC and SCT_PHASE_VALIDATE the
+// command's metrics slot. Outside of any context it counts as "other".
+// A thread working for a command, e.g. a pool worker, takes on the context
+// of the thread that started the work with sct_memstats_adopt().
+
+typedef uint32_t sct_memctx_t;
+
+// sct_memstats_enter() makes phase/slot the current context and returns
+// the previous one for sct_memstats_leave(). Entering SCT_PHASE_EXEC
+// counts a run of the command.
+sct_memctx_t sct_memstats_enter(sct_phase_t phase, int slot);
+void sct_memstats_leave(sct_memctx_t prev);
+// sct_memstats_current() is the calling thread's context, for another
+// thread to adopt; sct_memstats_adopt() makes it the current one without
+// counting a run and returns the previous one for sct_memstats_leave().
+sct_memctx_t sct_memstats_current(void);
+sct_memctx_t sct_memstats_adopt(sct_memctx_t ctx);
+bool sct_memstats_enabled(void);
+void sct_memstats_print(void);
@@ -0,0 +1,92 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hot path phases of a command line.
+typedef enum sct_phase_ {
+    SCT_PHASE_PARSE,        // parse_words() and command_from_words()
+    SCT_PHASE_VALIDATE,     // all validate_arg() calls of a line
+    SCT_PHASE_EXEC,         // exec_fn
+    SCT_PHASE_COMPLETE,     // one TAB completion attempt
+    SCT_PHASE_COUNT
+} sct_phase_t;
+
+// Log-linear latency histogram of nanosecond values, HDR-style: values
+// below 2^SCT_HIST_SUB_BITS have exact buckets, every higher power of two
+// range is split into 2^SCT_HIST_SUB_BITS equal buckets.
+#define SCT_HIST_SUB_BITS 3
+#define SCT_HIST_MAGNITUDES 48      // up to 2^48 ns, about 78 hours
+#define SCT_HIST_BUCKETS \
+    ((SCT_HIST_MAGNITUDES - SCT_HIST_SUB_BITS + 1) << SCT_HIST_SUB_BITS)
+
+#define SCT_METRICS_MAX_COMMANDS 128    // further commands share the last slot
+#define SCT_METRICS_NAME_LEN 32
+
+// The metrics live in a POSIX shared memory segment named
+// "/sctest.<pid>", so an external scraper of the same user can shm_open()
+// and read it while sctest runs. The layout below is what it maps; every counter is
+// a 64-bit value updated with relaxed atomic operations.
+#define SCT_METRICS_SHM_PREFIX "/sctest."
+#define SCT_METRICS_MAGIC 0x53435453u   // "SCTS"
+#define SCT_METRICS_VERSION 1
+
+typedef struct sct_histogram_ {
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[SCT_HIST_BUCKETS];
+} sct_histogram_t;
+
+typedef struct sct_command_metrics_ {
+    char name[SCT_METRICS_NAME_LEN];
+    _Atomic uint64_t runs;
+    _Atomic uint64_t failures;      // exec_fn returned nonzero
+    _Atomic uint64_t rejected;      // arguments failed validation
+    sct_histogram_t exec;
+} sct_command_metrics_t;
+
+typedef struct sct_metrics_shm_ {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hist_sub_bits;
+    uint32_t hist_buckets;
+    uint32_t max_commands;
+    _Atomic uint32_t command_count;
+    uint64_t pid;
+    sct_histogram_t phases[SCT_PHASE_COUNT];
+    sct_command_metrics_t commands[SCT_METRICS_MAX_COMMANDS];
+} sct_metrics_shm_t;
+
+bool sct_metrics_initialize(void);
+void sct_metrics_finalize(void);
+int sct_metrics_register_command(char *name);
+void sct_metrics_record_phase(sct_phase_t phase, int slot, uint64_t ns);
+void sct_metrics_record_run(int slot, int retval);
+void sct_metrics_record_rejected(int slot);
+int sct_metrics_command_count(void);
+char *sct_metrics_command_name(int slot);
+uint64_t sct_histogram_percentile(sct_histogram_t *h, double p);
+void sct_metrics_print(void);
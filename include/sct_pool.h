@@ -0,0 +1,48 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+// Worker pool for recursive jobs, e.g. directory walks: a task may push
+// further tasks, and sct_pool_run() returns once all of them are done.
+typedef struct sct_pool_ sct_pool_t;
+
+// Processes one task on worker number worker (0 .. workers - 1).
+typedef void (*sct_pool_fn_t)(sct_pool_t *pool, void *task, int worker,
+    void *ctx);
+
+// number of workers to use by default: online CPUs, capped
+int sct_pool_default_workers(void);
+// sct_pool_run() runs fn over the initial tasks and everything they push,
+// on workers threads, the calling thread being one of them; name is
+// the name of the job's spans in the trace.
+bool sct_pool_run(char *name, int workers, sct_pool_fn_t fn, void *ctx,
+    void **tasks, size_t count);
+// sct_pool_push() queues a task; only valid from within fn
+void sct_pool_push(sct_pool_t *pool, void *task);
+// sct_pool_start() starts the threads of workers workers ahead of a job,
+// e.g. for a profiler to find them
+void sct_pool_start(int workers);
+// joins the worker threads; must precede sct_trace_stop()
+void sct_pool_finalize(void);
@@ -0,0 +1,42 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+
+typedef struct sct_profile_summary_ {
+    const char *method;     // "perf_event" or "SIGPROF"
+    long samples;           // samples written
+    long dropped;           // samples lost to full buffers
+    long threads;           // perf_event: threads sampled
+    long missed;            // perf_event: threads running but not sampled
+} sct_profile_summary_t;
+
+// sct_profile_start() starts sampling on-CPU user stacks every millisecond
+// of the whole process: with perf_event_open(), of every thread running at
+// the start, so pool workers had better be started first; or, where perf
+// events are not allowed, with a SIGPROF interval timer.
+bool sct_profile_start(void);
+// sct_profile_stop() stops sampling and writes collected stacks to fn in
+// folded format ("root;...;leaf count" lines, the input of flamegraph.pl,
+// speedscope or inferno).
+bool sct_profile_stop(char *fn, sct_profile_summary_t *summary);
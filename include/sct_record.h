@@ -0,0 +1,93 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Structured output of the built-in commands ('--output'): each result is
+// a typed record rather than a line of text, for programs to read.
+//
+// json: one JSON object per line, its "type" first, e.g.
+//     {"type":"match","file":"a.c","line":3,"offset":52,"text":"x"}
+// Strings are UTF-8; a byte not part of a valid sequence is written as
+// the code point of its value, e.g. "\u00ff", which loses the byte: such
+// a string, e.g. a file name, is followed by its bytes in base64 under
+// the key with "_b64" appended, e.g. "file_b64":"Zm9v/w==". A list of
+// strings is, as a list, if any of them is not valid.
+//
+// binary: records of little-endian fields, each record being
+//     u32 length of the rest, u8 type length, type,
+//     then fields: u8 kind, u8 key length, key, value
+// with values by kind:
+//     1 integer   i64
+//     2 real      f64
+//     3 string    u32 length, bytes
+//     4 boolean   u8
+//     5 strings   u32 count, then as many strings
+typedef enum sct_output_ {
+    SCT_OUTPUT_TEXT,
+    SCT_OUTPUT_JSON,
+    SCT_OUTPUT_BINARY
+} sct_output_t;
+
+enum {
+    SCT_RECORD_INT = 1,
+    SCT_RECORD_REAL,
+    SCT_RECORD_STRING,
+    SCT_RECORD_BOOL,
+    SCT_RECORD_STRINGS
+};
+
+typedef struct sct_record_ {
+    char *data;
+    size_t len;
+    size_t capacity;
+    bool failed;
+} sct_record_t;
+
+// sct_record_start() makes records the standard output of the session:
+// what is written to file descriptor 1, other than records, goes to
+// stderr from then on. Nothing changes for SCT_OUTPUT_TEXT.
+bool sct_record_start(sct_output_t mode);
+// sct_record_set_output() writes records to out, e.g. for tests
+void sct_record_set_output(sct_output_t mode, FILE *out);
+// true if commands are to write records rather than text
+bool sct_records(void);
+void sct_record_flush(void);
+void sct_record_finish(void);
+
+// A record is built field by field, then written by sct_record_end(),
+// and the same sct_record_t, zeroed at first, reused for the next one.
+void sct_record_begin(sct_record_t *r, const char *type);
+void sct_record_int(sct_record_t *r, const char *key, int64_t value);
+void sct_record_real(sct_record_t *r, const char *key, double value);
+void sct_record_bool(sct_record_t *r, const char *key, bool value);
+void sct_record_str(sct_record_t *r, const char *key, const char *s);
+void sct_record_strn(sct_record_t *r, const char *key, const char *s,
+    size_t len);
+void sct_record_strs(sct_record_t *r, const char *key, char **strs,
+    int count);
+void sct_record_end(sct_record_t *r);
+void sct_record_free(sct_record_t *r);
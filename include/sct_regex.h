@@ -0,0 +1,48 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct sct_regex_ sct_regex_t;
+
+// Compiled patterns kept for reuse, least recently used ones dropped first.
+#define SCT_REGEX_CACHE_SIZE 512
+
+// sct_regex_get() returns the compiled POSIX basic regular expression,
+// from the cache if it was used before. On failure returns NULL with
+// the error message in err. Each sct_regex_get() needs sct_regex_put().
+sct_regex_t *sct_regex_get(char *pattern, char *err, size_t err_size);
+void sct_regex_put(sct_regex_t *re);
+// sct_regex_find_line() looks for the first line of data matching re.
+// Lines are separated by '\n', the last one may lack it. Returns the
+// offsets of the line's start and end, the latter excluding the '\n'.
+bool sct_regex_find_line(sct_regex_t *re, char *data, size_t len,
+    size_t *line_start, size_t *line_end);
+// false if the pattern is beyond the DFA and is matched by regexec()
+bool sct_regex_uses_dfa(sct_regex_t *re);
+// sct_regex_literal() gives the i-th of the strings every match of re
+// contains one of, not NUL terminated; false past the last one. Patterns
+// with no such strings known have none.
+bool sct_regex_literal(sct_regex_t *re, int i, const char **s, size_t *len);
+void sct_regex_finalize(void);
@@ -0,0 +1,49 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Checksums of files, e.g. to verify copies: the hashes of a file's
+// chunks, computed in parallel, hashed again into the file's sum.
+typedef enum sct_sum_kind_ {
+    SCT_SUM_XXH3,           // fast, non-cryptographic
+    SCT_SUM_SHA256
+} sct_sum_kind_t;
+
+#define SCT_SHA256_SIZE 32
+
+// XXH3, 64-bit, with no seed
+uint64_t sct_xxh3(const void *data, size_t len);
+void sct_sha256(const void *data, size_t len, uint8_t digest[SCT_SHA256_SIZE]);
+// sct_sum() prints the sums of files, as 'sum  path' lines. Returns the
+// exit status.
+int sct_sum(char **paths, int count, sct_sum_kind_t kind);
+// sct_sum_files() computes the sums of files, as sct_sum() prints them,
+// into sums, of 8 or SCT_SHA256_SIZE bytes each: errors[i] is 0, an
+// errno, or SCT_SUM_CHANGED for a file which shrunk while read. Returns
+// false for lack of memory.
+#define SCT_SUM_CHANGED (-1)
+bool sct_sum_files(char **paths, size_t count, sct_sum_kind_t kind,
+    uint8_t *sums, int *errors);
@@ -1,39 +1,58 @@
-// The MIT License (MIT)
-//
-//  Copyright (c) 2024 Maxim Kryukov
-//
-//  Permission is hereby granted, free of charge, to any person obtaining a copy 
-//  of this software and associated documentation files (the “Software”), 
-//  to deal in the Software without restriction, including without limitation 
-//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
-//  and/or sell copies of the Software, and to permit persons to whom the 
-//  Software is furnished to do so, subject to the following conditions:
-//
-//  The above copyright notice and this permission notice shall be included 
-//  in all copies or substantial portions of the Software.
-//
-//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
-//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
-//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
-//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
-//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
-//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
-//  DEALINGS IN THE SOFTWARE.
-
-#pragma once
-
-#include <stdbool.h>
-
-bool scu_initialize_utils(void);
-void scu_finalize_utils(void);
-
-bool scu_file_exists(char *fn, bool *err_printed);
-bool scu_validate_filename(char *s);
-bool scu_file_or_dir_exists(char *fn, bool *err_printed);
-bool scu_directory_exists(char *fn, bool *err_printed);
-bool scu_validate_hostname_or_ip(char *s);
-bool scu_is_empty_str(char *s);
-char *scu_strdup(char *s);
-char *scu_strndup(char *s, size_t n);
-char *scu_sprintf(char *fmt, ...);
-char *scu_dequote(char *s);
\ No newline at end of file
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+bool scu_initialize_utils(void);
+void scu_finalize_utils(void);
+
+bool scu_file_exists(char *fn, bool *err_printed);
+bool scu_validate_filename(char *s);
+bool scu_file_or_dir_exists(char *fn, bool *err_printed);
+bool scu_directory_exists(char *fn, bool *err_printed);
+bool scu_validate_hostname_or_ip(char *s);
+
+// Character classes of a string, SCU_CLASS_* bits. A string is in a class
+// if all of its characters are valid for that kind of name; an empty
+// string is in none.
+#define SCU_CLASS_HOSTNAME  0x01    // letters, digits, '-', '_', '.'
+#define SCU_CLASS_IP4       0x02    // digits, '.'
+#define SCU_CLASS_IP6       0x04    // hex digits, ':'
+#define SCU_CLASS_FILENAME  0x08    // anything but '<', '>', '|', '&'
+unsigned scu_classify(char *s, size_t len);
+// classifies count NUL terminated strings at once into classes[]
+void scu_classify_bulk(char **strs, size_t count, unsigned *classes);
+bool scu_is_empty_str(char *s);
+char *scu_strdup(char *s);
+char *scu_strndup(char *s, size_t n);
+char *scu_sprintf(char *fmt, ...);
+char *scu_dequote(char *s);
+uint64_t scu_now_ns(void);
+void scu_sort_u64(uint64_t *values, size_t n);
+uint64_t scu_percentile_u64(uint64_t *sorted, size_t n, double p);
+// pthread_create() with every signal but SIGPROF blocked in the new thread
+int scu_thread_create(pthread_t *thread, void *(*fn)(void *), void *arg);
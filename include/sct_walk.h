@@ -0,0 +1,52 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include <stdbool.h>
+#include <sys/stat.h>
+
+// Parallel walk of directory trees on the worker pool (sct_pool.h),
+// without following symbolic links.
+#define SCT_WALK_STAT   0x01    // stat every entry, not only when needed
+
+typedef struct sct_walk_entry_ {
+    char *path;         // the root, then '/' separated names
+    char *name;         // the last of them, within path
+    int root;           // index of the root the entry is under
+    int depth;          // 0 for a root
+    unsigned char type; // DT_REG, DT_DIR, ...
+    struct stat *st;    // NULL if not stated
+    int error;          // errno if the entry could not be read
+} sct_walk_entry_t;
+
+// Called for every entry on worker number worker, concurrently; the
+// entry is only valid during the call. A directory which cannot be read
+// comes once more, with error set.
+typedef void (*sct_walk_fn_t)(const sct_walk_entry_t *e, int worker,
+    void *ctx);
+
+// sct_walk() calls fn for the roots and everything under them, on workers
+// threads. Roots are always stated, other entries when flags has
+// SCT_WALK_STAT or their type is not known otherwise. Returns false on
+// lack of memory, the walk being incomplete.
+bool sct_walk(char **roots, int count, int flags, int workers,
+    sct_walk_fn_t fn, void *ctx);
@@ -0,0 +1,6 @@
+add_executable(sct_bench
+    bench/sct_bench.c
+    ${SCT_CORE_SOURCES}
+)
+target_include_directories(sct_bench PRIVATE src "${PROJECT_BINARY_DIR}")
+target_link_libraries(sct_bench rt m ${CMAKE_DL_LIBS} anl readline pthread)
@@ -1,5 +1,45 @@
-add_executable(test_sctest
-    test/test_sctest.c
-    test/test_sct_utils.c 
-    src/sct_utils.c
-)
\ No newline at end of file
+add_executable(test_sctest
+    test/test_sctest.c
+    test/test_sct_utils.c 
+    test/test_sct_glob.c
+    test/test_sct_io.c
+    test/test_sct_regex.c
+    test/test_sct_aho.c
+    test/test_sct_index.c
+    test/test_sct_decomp.c
+    test/test_sct_resolve.c
+    test/test_sct_sum.c
+    test/test_sct_walk.c
+    test/test_sct_record.c
+    test/test_sct_history.c
+    test/test_sct_fileops.c
+    test/test_sct_plugins.c
+    src/sct_utils.c
+    src/sct_core.c
+    src/sct_fileops.c
+    src/sct_glob.c
+    src/sct_history.c
+    src/sct_io.c
+    src/sct_memstats.c
+    src/sct_metrics.c
+    src/sct_plugins.c
+    src/sct_pool.c
+    src/sct_record.c
+    src/sct_regex.c
+    src/sct_aho.c
+    src/sct_index.c
+    src/sct_decomp.c
+    src/sct_resolve.c
+    src/sct_session.c
+    src/sct_sum.c
+    src/sct_trace.c
+    src/sct_walk.c
+)
+# the core's internals are tested too, as sct_bench uses them
+target_include_directories(test_sctest PRIVATE src)
+target_link_libraries(test_sctest rt m ${CMAKE_DL_LIBS} anl readline pthread)
+# the plugin tests load the example plugin
+add_dependencies(test_sctest sct_example_dl_plugin)
+
+enable_testing()
+add_test(NAME test_sctest COMMAND test_sctest)
@@ -0,0 +1,351 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "sct_aho.h"
+
+/*
+    Multi-string search for fgrep.
+    The strings are put in a trie, and failure links make it an
+    Aho-Corasick automaton finding all of them in one pass over the data.
+    Bytes no string has share one class, and always lead to the root.
+    A small automaton is turned into a DFA: a dense table of states by
+    byte classes, one lookup per byte. A big one stays packed: states are
+    numbered breadth first, so the shallow ones most bytes go through are
+    close together, their transitions are sorted in one contiguous array,
+    and failure links are followed while searching. The root, where most
+    of the bytes are looked up, has a dense row.
+*/
+
+#define SCT_AHO_DENSE_MEMORY (256 * 1024)   // the most a DFA table takes
+#define SCT_AHO_LINEAR_SEARCH 8             // transitions searched linearly
+#define SCT_AHO_OUTPUT 0x80000000u          // DFA: a string ends in the state
+
+typedef struct ac_state_ {
+    uint32_t fail;
+    uint32_t first;     // of the transitions
+    int32_t pattern;    // the string ending here, or -1
+    int32_t dict;       // the next state on the failure chain with a string
+    uint16_t count;     // of the transitions
+    bool output;        // a string ends here or on the failure chain
+} ac_state_t;
+
+struct sct_aho_ {
+    int pattern_count;
+    uint32_t state_count;
+    ac_state_t *states;
+    uint8_t *keys;      // transitions: bytes, sorted per state
+    uint32_t *targets;
+    uint32_t root[256];
+    uint8_t classes[256];
+    uint32_t class_count;
+    // DFA rows by premultiplied state numbers, with SCT_AHO_OUTPUT, or NULL
+    uint32_t *dfa;
+
+    int *found;
+    uint32_t *seen;     // per string: the line it was last found in
+    uint32_t line;
+};
+
+#pragma region construction
+//------------------------------------------------------------------------------
+//              construction
+
+typedef struct trie_node_ {
+    int first_child;
+    int next_sibling;
+    int pattern;
+    uint8_t byte;
+} trie_node_t;
+
+typedef struct trie_ {
+    trie_node_t *nodes;
+    int count;
+    int capacity;
+} trie_t;
+
+static int trie_child(trie_t *t, int node, uint8_t c, bool add) {
+    int *link = &t->nodes[node].first_child;
+    while ((*link >= 0) && (t->nodes[*link].byte != c))
+        link = &t->nodes[*link].next_sibling;
+    if ((*link >= 0) || !add) return *link;
+
+    if (t->count == t->capacity) {
+        int capacity = t->capacity * 2;
+        trie_node_t *nodes = realloc(t->nodes, capacity * sizeof(*nodes));
+        if (!nodes) return -1;
+        t->nodes = nodes;
+        t->capacity = capacity;
+        // the link pointed into the old array
+        return trie_child(t, node, c, add);
+    }
+    trie_node_t *n = &t->nodes[t->count];
+    n->first_child = -1;
+    n->next_sibling = -1;
+    n->pattern = -1;
+    n->byte = c;
+    *link = t->count;
+    return t->count++;
+}
+
+static bool trie_build(trie_t *t, char **patterns, int count) {
+    t->capacity = 1024;
+    t->count = 1;
+    t->nodes = malloc(t->capacity * sizeof(trie_node_t));
+    if (!t->nodes) return false;
+    t->nodes[0].first_child = -1;
+    t->nodes[0].next_sibling = -1;
+    t->nodes[0].pattern = -1;
+    for (int i = 0; i < count; i++) {
+        int node = 0;
+        for (unsigned char *p = (unsigned char *)patterns[i]; *p; p++) {
+            node = trie_child(t, node, *p, true);
+            if (node < 0) return false;
+        }
+        // of equal strings, the first is reported
+        if (node && (t->nodes[node].pattern < 0))
+            t->nodes[node].pattern = i;
+    }
+    return true;
+}
+
+static int compare_bytes(const void *a, const void *b) {
+    return (int)((const trie_node_t *)a)->byte
+        - (int)((const trie_node_t *)b)->byte;
+}
+
+// pack() numbers the trie nodes breadth first, laying out the sorted
+// transitions of every state contiguously
+static bool pack(sct_aho_t *ac, trie_t *t) {
+    int *queue = malloc(t->count * sizeof(int));
+    trie_node_t *children = malloc(256 * sizeof(trie_node_t));
+    ac->states = calloc(t->count, sizeof(ac_state_t));
+    ac->keys = malloc(t->count);
+    ac->targets = malloc(t->count * sizeof(uint32_t));
+    bool succeeded = queue && children && ac->states && ac->keys
+        && ac->targets;
+
+    uint32_t tail = 1;
+    uint32_t transitions = 0;
+    queue[0] = 0;
+    for (uint32_t id = 0; succeeded && (id < tail); id++) {
+        trie_node_t *node = &t->nodes[queue[id]];
+        int n = 0;
+        for (int c = node->first_child; c >= 0; c = t->nodes[c].next_sibling) {
+            children[n] = t->nodes[c];
+            // keep the trie index of the child
+            children[n++].first_child = c;
+        }
+        qsort(children, n, sizeof(*children), compare_bytes);
+        ac_state_t *st = &ac->states[id];
+        st->pattern = node->pattern;
+        st->first = transitions;
+        st->count = (uint16_t)n;
+        for (int i = 0; i < n; i++) {
+            ac->keys[transitions] = children[i].byte;
+            ac->targets[transitions++] = tail;
+            queue[tail++] = children[i].first_child;
+        }
+    }
+    ac->state_count = tail;
+    free(children);
+    free(queue);
+    return succeeded;
+}
+
+static uint32_t transition(sct_aho_t *ac, ac_state_t *st, uint8_t c) {
+    const uint8_t *keys = ac->keys + st->first;
+    if (st->count <= SCT_AHO_LINEAR_SEARCH) {
+        for (int i = 0; i < st->count; i++)
+            if (keys[i] == c) return ac->targets[st->first + i];
+        return 0;
+    }
+    int low = 0;
+    int high = st->count - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (keys[mid] == c) return ac->targets[st->first + mid];
+        if (keys[mid] < c) low = mid + 1;
+        else high = mid - 1;
+    }
+    return 0;
+}
+
+static uint32_t next_state(sct_aho_t *ac, uint32_t s, uint8_t c) {
+    if (ac->classes[c] == 0) return 0;
+    for (;;) {
+        if (s == 0) return ac->root[c];
+        ac_state_t *st = &ac->states[s];
+        uint32_t t = transition(ac, st, c);
+        if (t) return t;
+        s = st->fail;
+    }
+}
+
+// set_links() sets failure links in breadth first order, every state's
+// failure being shallower than the state itself
+static void set_links(sct_aho_t *ac) {
+    ac_state_t *root = &ac->states[0];
+    for (int i = 0; i < root->count; i++)
+        ac->root[ac->keys[root->first + i]] = ac->targets[root->first + i];
+    root->dict = -1;
+    for (uint32_t s = 0; s < ac->state_count; s++) {
+        ac_state_t *st = &ac->states[s];
+        for (int i = 0; i < st->count; i++) {
+            ac_state_t *child = &ac->states[ac->targets[st->first + i]];
+            child->fail = s ? next_state(ac, st->fail,
+                ac->keys[st->first + i]) : 0;
+            ac_state_t *fail = &ac->states[child->fail];
+            child->dict = fail->pattern >= 0 ? (int32_t)child->fail
+                : fail->dict;
+            child->output = (child->pattern >= 0) || (child->dict >= 0);
+        }
+    }
+}
+
+static void make_classes(sct_aho_t *ac) {
+    ac->class_count = 1;
+    for (uint32_t i = 1; i < ac->state_count; i++) {
+        uint8_t c = ac->keys[i - 1];
+        if (!ac->classes[c]) ac->classes[c] = (uint8_t)ac->class_count++;
+    }
+}
+
+static bool make_dfa(sct_aho_t *ac) {
+    uint32_t cc = ac->class_count;
+    if ((uint64_t)ac->state_count * cc * sizeof(uint32_t)
+        > SCT_AHO_DENSE_MEMORY) return true;
+    ac->dfa = malloc(ac->state_count * cc * sizeof(uint32_t));
+    if (!ac->dfa) return false;
+    uint8_t rep[256];
+    for (int c = 0; c < 256; c++) rep[ac->classes[c]] = (uint8_t)c;
+    // rows of failure states are complete before they are needed
+    for (uint32_t s = 0; s < ac->state_count; s++) {
+        ac_state_t *st = &ac->states[s];
+        for (uint32_t k = 0; k < cc; k++) {
+            uint32_t t = k ? transition(ac, st, rep[k]) : 0;
+            if (!t && s && k)
+                t = (ac->dfa[st->fail * cc + k] & ~SCT_AHO_OUTPUT) / cc;
+            ac->dfa[s * cc + k] = t * cc
+                | (ac->states[t].output ? SCT_AHO_OUTPUT : 0);
+        }
+    }
+    return true;
+}
+#pragma endregion
+
+#pragma region public aho-corasick routines
+//------------------------------------------------------------------------------
+//              public aho-corasick routines
+
+sct_aho_t *sct_aho_build(char **patterns, int count) {
+    sct_aho_t *ac = calloc(1, sizeof(*ac));
+    if (!ac) return NULL;
+    trie_t t;
+    memset(&t, 0, sizeof(t));
+    ac->pattern_count = count;
+    bool succeeded = trie_build(&t, patterns, count) && pack(ac, &t);
+    free(t.nodes);
+    if (succeeded) {
+        make_classes(ac);
+        set_links(ac);
+        ac->found = malloc((count + 1) * sizeof(int));
+        ac->seen = calloc(count + 1, sizeof(uint32_t));
+        succeeded = ac->found && ac->seen && make_dfa(ac);
+    }
+    if (!succeeded) {
+        sct_aho_free(ac);
+        return NULL;
+    }
+    return ac;
+}
+
+void sct_aho_free(sct_aho_t *ac) {
+    if (!ac) return;
+    free(ac->states);
+    free(ac->keys);
+    free(ac->targets);
+    free(ac->dfa);
+    free(ac->found);
+    free(ac->seen);
+    free(ac);
+}
+
+// collect() adds the strings ending in state s to the line's ones
+static void collect(sct_aho_t *ac, uint32_t s, int *count) {
+    int32_t d = ac->states[s].pattern >= 0 ? (int32_t)s : ac->states[s].dict;
+    for (; d >= 0; d = ac->states[d].dict) {
+        int pattern = ac->states[d].pattern;
+        if (ac->seen[pattern] == ac->line) continue;
+        ac->seen[pattern] = ac->line;
+        ac->found[(*count)++] = pattern;
+    }
+}
+
+bool sct_aho_find_line(sct_aho_t *ac, char *data, size_t len,
+    size_t *line_start, size_t *line_end, int **found, int *found_count)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + len;
+    uint32_t cc = ac->class_count;
+    uint32_t s = 0;     // premultiplied by cc for the DFA
+    if (ac->dfa) {
+        while ((p < end) && !(s & SCT_AHO_OUTPUT))
+            s = ac->dfa[(s & ~SCT_AHO_OUTPUT) + ac->classes[*p++]];
+        if (!(s & SCT_AHO_OUTPUT)) return false;
+        s = (s & ~SCT_AHO_OUTPUT) / cc;
+    }
+    else {
+        while ((p < end) && !ac->states[s].output) {
+            // most bytes at the root lead nowhere
+            while ((s == 0) && (p < end) && !ac->root[*p]) p++;
+            if (p < end) s = next_state(ac, s, *p++);
+        }
+        if (!ac->states[s].output) return false;
+    }
+
+    // the line of the string found, and the others in it
+    const unsigned char *hit = p - 1;
+    const unsigned char *line = memrchr(data, '\n', hit - (unsigned char *)data);
+    const unsigned char *eol = memchr(hit, '\n', end - hit);
+    if (!eol) eol = end;
+    if (++ac->line == 0) {
+        memset(ac->seen, 0, ac->pattern_count * sizeof(uint32_t));
+        ac->line = 1;
+    }
+    int count = 0;
+    collect(ac, s, &count);
+    while (p < eol) {
+        s = next_state(ac, s, *p++);
+        if (ac->states[s].output) collect(ac, s, &count);
+    }
+    *line_start = line ? line + 1 - (unsigned char *)data : 0;
+    *line_end = eol - (unsigned char *)data;
+    *found = ac->found;
+    *found_count = count;
+    return true;
+}
+#pragma endregion
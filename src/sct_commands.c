@@ -1,108 +1,446 @@
-// The MIT License (MIT)
-//
-//  Copyright (c) 2024 Maxim Kryukov
-//
-//  Permission is hereby granted, free of charge, to any person obtaining a copy 
-//  of this software and associated documentation files (the “Software”), 
-//  to deal in the Software without restriction, including without limitation 
-//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
-//  and/or sell copies of the Software, and to permit persons to whom the 
-//  Software is furnished to do so, subject to the following conditions:
-//
-//  The above copyright notice and this permission notice shall be included 
-//  in all copies or substantial portions of the Software.
-//
-//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
-//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
-//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
-//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
-//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
-//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
-//  DEALINGS IN THE SOFTWARE.
-
-#include <stdio.h>
-#include <unistd.h>
-#include "sct_commands.h"
-#include "sct_core.h"
-#include "sct_utils.h"
-
-static int ls_exec(sct_arg_t *args, int argc) {
-    char *execcmd;
-    if (scu_is_empty_str(args->value))
-        execcmd = scu_sprintf("ls -FClg");
-    else execcmd = scu_sprintf("ls -FClg %s", args->value);
-
-    int retval = system(execcmd);
-    free(execcmd);
-    return retval;
-}
-
-static int pwd_exec(sct_arg_t *args, int argc) {
-    char *s = getcwd(NULL, 0);
-    if (!s)
-    {
-        perror ("Error getting current directory\n");
-        return 1;
-    }
-    printf ("Current directory is %s\n", s);
-    free(s);
-    return 0; 
-}
-
-static int cd_exec(sct_arg_t *args, int argc) {
-    if (chdir(args->value) == -1)
-    {
-      perror(args->value);
-      return 1;
-    }
-    pwd_exec(NULL, 0);
-    return 0;
-}
-
-static int grep_exec(sct_arg_t *args, int argc) {
-    char *execcmd = scu_sprintf("grep %s %s", args->value, args[1].value);
-
-    int retval = system(execcmd);
-    free(execcmd);
-    return retval;
-}
-
-static int ping_exec(sct_arg_t *args, int argc) {
-    char *execcmd = scu_sprintf("ping -c 4 -s 64 %s", args->value);
-
-    int retval = system(execcmd);
-    free(execcmd);
-    return retval;
-}
-
-static int cp_exec(sct_arg_t *args, int argc) {
-    char *execcmd = scu_sprintf("cp %s %s", args->value, args[1].value);
-    int retval = system(execcmd);
-    free(execcmd);
-    return retval;
-}
-
-
-void sct_init_builtin_commands(void) {
-    sct_arg_t args[2] = {   SA_FILE_OR_DIR_NAME, true, NULL };
-    sct_add_command("ls", args, 1, ls_exec);
-
-    args[0].kind = SA_DIRNAME;
-    args[0].optional = false;
-    sct_add_command("cd", args, 1, cd_exec);
-
-    sct_add_command("pwd", NULL, 0, pwd_exec);
-
-    args[0].kind = SA_TEXT;
-    args[1].kind = SA_FILENAME;
-    args[1].optional = false;
-    args[1].value = NULL;
-    sct_add_command("grep", args, 2, grep_exec);
-
-    args[0].kind = SA_INETNAME;
-    sct_add_command("ping", args, 1, ping_exec);
-
-    args[0].kind = SA_FILENAME;
-    args[1].kind = SA_NEW_FILENAME;
-    sct_add_command("cp", args, 2, cp_exec);
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include "sct_commands.h"
+#include "sct_core.h"
+#include "sct_utils.h"
+#include "sct_exec.h"
+#include "sct_fileops.h"
+#include "sct_index.h"
+#include "sct_metrics.h"
+#include "sct_memstats.h"
+#include "sct_pool.h"
+#include "sct_profile.h"
+#include "sct_record.h"
+#include "sct_resolve.h"
+#include "sct_sum.h"
+
+// the file commands get their paths as plain strings, so surrounding quotes
+// the shell would have removed are removed here
+static char **dequote_values(sct_arg_t *arg) {
+    char **values = calloc(arg->value_count + 1, sizeof(*values));
+    for (int i = 0; values && (i < arg->value_count); i++) {
+        values[i] = scu_dequote(arg->values[i]);
+        if (!values[i]) values[i] = calloc(1, 1);
+    }
+    return values;
+}
+
+static void free_values(char **values, int count) {
+    for (int i = 0; values && (i < count); i++) free(values[i]);
+    free(values);
+}
+
+static int ls_exec(sct_arg_t *args, int argc) {
+    char **paths = dequote_values(args);
+    int retval = paths ? sct_ls(paths, args->value_count) : 2;
+    free_values(paths, args->value_count);
+    return retval;
+}
+
+static int pwd_exec(sct_arg_t *args, int argc) {
+    char *s = getcwd(NULL, 0);
+    if (!s)
+    {
+        perror ("Error getting current directory\n");
+        return 1;
+    }
+    printf ("Current directory is %s\n", s);
+    free(s);
+    return 0; 
+}
+
+static int cd_exec(sct_arg_t *args, int argc) {
+    if (chdir(args->value) == -1)
+    {
+      perror(args->value);
+      return 1;
+    }
+    pwd_exec(NULL, 0);
+    return 0;
+}
+
+static int grep_exec(sct_arg_t *args, int argc) {
+    char *pattern = scu_dequote(args->value);
+    char **paths = dequote_values(&args[1]);
+    int retval = paths ? sct_grep(pattern ? pattern : "", paths,
+        args[1].value_count) : 2;
+    free_values(paths, args[1].value_count);
+    free(pattern);
+    return retval;
+}
+
+static int fgrep_exec(sct_arg_t *args, int argc) {
+    char *pattern_file = scu_dequote(args->value);
+    char **paths = dequote_values(&args[1]);
+    int retval = paths && pattern_file ? sct_fgrep(pattern_file, paths,
+        args[1].value_count) : 2;
+    free_values(paths, args[1].value_count);
+    free(pattern_file);
+    return retval;
+}
+
+static int follow_exec(sct_arg_t *args, int argc) {
+    char *pattern = scu_dequote(args->value);
+    char **paths = dequote_values(&args[1]);
+    int retval = paths ? sct_grep_follow(pattern ? pattern : "", paths,
+        args[1].value_count) : 2;
+    free_values(paths, args[1].value_count);
+    free(pattern);
+    return retval;
+}
+
+static int index_exec(sct_arg_t *args, int argc) {
+    char *dir = scu_dequote(args->value);
+    int retval = dir ? sct_index_build(dir) : 2;
+    free(dir);
+    return retval;
+}
+
+typedef struct ping_probes_ {
+    char *host;
+    sct_record_t record;
+} ping_probes_t;
+
+// ping_line() writes a record for each reply ping prints, e.g.
+// "72 bytes from 10.0.0.1: icmp_seq=1 ttl=64 time=0.045 ms"; its other
+// lines go to stderr. Lost probes show as gaps in icmp_seq.
+static void ping_line(char *line, void *ctx) {
+    ping_probes_t *p = ctx;
+    // IPv6 addresses have colons of their own
+    char *from = strstr(line, " bytes from ");
+    char *seq_at = from ? strstr(from, ": icmp_seq=") : NULL;
+    int seq, ttl;
+    double rtt;
+    if (!seq_at || (sscanf(seq_at, ": icmp_seq=%d ttl=%d time=%lf", &seq,
+        &ttl, &rtt) != 3)) {
+        fprintf(stderr, "%s\n", line);
+        return;
+    }
+    from += strlen(" bytes from ");
+    sct_record_t *r = &p->record;
+    sct_record_begin(r, "probe");
+    sct_record_str(r, "host", p->host);
+    sct_record_strn(r, "address", from, seq_at - from);
+    sct_record_int(r, "seq", seq);
+    sct_record_int(r, "ttl", ttl);
+    sct_record_int(r, "bytes", atoi(line));
+    sct_record_real(r, "rtt_ms", rtt);
+    sct_record_end(r);
+    sct_record_flush();
+}
+
+// ping gets the address resolved when the command was validated, not
+// to look the name up again
+static int ping_exec(sct_arg_t *args, int argc) {
+    char address[INET6_ADDRSTRLEN];
+    if (sct_resolve_lookup(args->value, address, sizeof(address)) != 0)
+        snprintf(address, sizeof(address), "%s", args->value);
+    char *argv[] = { "ping", "-c", "4", "-s", "64", address, NULL };
+    if (!sct_records()) return sct_exec_argv(argv, STDOUT_FILENO);
+    ping_probes_t probes = { .host = args->value };
+    int status = sct_exec_lines(argv, ping_line, &probes);
+    sct_record_free(&probes.record);
+    return status;
+}
+
+static int resolve_exec(sct_arg_t *args, int argc) {
+    for (int i = 0; i < args->value_count; i++) {
+        // resolved together when the command was validated
+        char address[INET6_ADDRSTRLEN];
+        int error = sct_resolve_lookup(args->values[i], address,
+            sizeof(address));
+        printf("%s: %s\n", args->values[i],
+            error ? gai_strerror(error) : address);
+    }
+    return 0;
+}
+
+static int cp_exec(sct_arg_t *args, int argc) {
+    char *dst = scu_dequote(args[1].value);
+    char **srcs = dequote_values(args);
+    int retval = srcs && dst ? sct_cp(srcs, args->value_count, dst) : 1;
+    free_values(srcs, args->value_count);
+    free(dst);
+    return retval;
+}
+
+static int sync_exec(sct_arg_t *args, int argc) {
+    char *src = scu_dequote(args[0].value);
+    char *dst = scu_dequote(args[1].value);
+    int retval = src && dst ? sct_sync(src, dst, false) : 1;
+    free(src);
+    free(dst);
+    return retval;
+}
+
+static int fsync_exec(sct_arg_t *args, int argc) {
+    char *src = scu_dequote(args[0].value);
+    char *dst = scu_dequote(args[1].value);
+    int retval = src && dst ? sct_sync(src, dst, true) : 1;
+    free(src);
+    free(dst);
+    return retval;
+}
+
+static int find_exec(sct_arg_t *args, int argc) {
+    char *path = scu_dequote(args[0].value);
+    char **predicates = dequote_values(&args[1]);
+    int retval = path && predicates ? sct_find(path, predicates,
+        args[1].value_count) : 1;
+    free_values(predicates, args[1].value_count);
+    free(path);
+    return retval;
+}
+
+static int du_exec(sct_arg_t *args, int argc) {
+    char **paths = dequote_values(args);
+    int retval = paths ? sct_du(paths, args->value_count) : 1;
+    free_values(paths, args->value_count);
+    return retval;
+}
+
+static int dupes_exec(sct_arg_t *args, int argc) {
+    char *dir = scu_dequote(args[0].value);
+    int retval = dir ? sct_dupes(dir) : 1;
+    free(dir);
+    return retval;
+}
+
+static int sum_exec(sct_arg_t *args, int argc) {
+    char **paths = dequote_values(args);
+    int retval = paths ? sct_sum(paths, args->value_count, SCT_SUM_XXH3) : 1;
+    free_values(paths, args->value_count);
+    return retval;
+}
+
+static int sum256_exec(sct_arg_t *args, int argc) {
+    char **paths = dequote_values(args);
+    int retval = paths ? sct_sum(paths, args->value_count, SCT_SUM_SHA256)
+        : 1;
+    free_values(paths, args->value_count);
+    return retval;
+}
+
+static int stats_exec(sct_arg_t *args, int argc) {
+    sct_metrics_print();
+    return 0;
+}
+
+static int memstats_exec(sct_arg_t *args, int argc) {
+    sct_memstats_print();
+    return 0;
+}
+
+#define SCT_BENCH_MAX_ITERATIONS 1000000
+#define SCT_BENCH_MAX_WARMUP 100
+
+static uint64_t timeval_ns(struct timeval *tv) {
+    return (uint64_t)tv->tv_sec * 1000000000ull + tv->tv_usec * 1000ull;
+}
+
+// rusage of the process and of the programs it ran and waited for
+static void get_rusage(struct rusage *self, struct rusage *children) {
+    getrusage(RUSAGE_SELF, self);
+    getrusage(RUSAGE_CHILDREN, children);
+}
+
+static long rusage_delta(struct rusage *s0, struct rusage *c0,
+    struct rusage *s1, struct rusage *c1, size_t offset)
+{
+    #define RU_FIELD(ru) (*(long *)((char *)(ru) + offset))
+    return RU_FIELD(s1) - RU_FIELD(s0) + RU_FIELD(c1) - RU_FIELD(c0);
+    #undef RU_FIELD
+}
+
+static uint64_t cpu_delta(struct timeval *s0, struct timeval *c0,
+    struct timeval *s1, struct timeval *c1)
+{
+    return timeval_ns(s1) - timeval_ns(s0) + timeval_ns(c1) - timeval_ns(c0);
+}
+
+// bench_exec() runs the command following 'bench N' N times after a short
+// warmup. The command's output is discarded while it runs.
+static int bench_exec(sct_arg_t *args, int argc, sct_invocation_t *inv) {
+    char *end;
+    long n = strtol(args->value, &end, 10);
+    if ((*end != 0) || (n < 1) || (n > SCT_BENCH_MAX_ITERATIONS)) {
+        printf("Iterations count must be 1..%d.\n", SCT_BENCH_MAX_ITERATIONS);
+        return 1;
+    }
+    uint64_t *samples = malloc(n * sizeof(*samples));
+    if (!samples) {
+        printf("Out of memory.\n");
+        return 1;
+    }
+    long warmup = n / 10 < SCT_BENCH_MAX_WARMUP ? n / 10 : SCT_BENCH_MAX_WARMUP;
+
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if ((saved_stdout == -1) || (null_fd == -1)) {
+        perror("bench");
+        if (saved_stdout != -1) close(saved_stdout);
+        if (null_fd != -1) close(null_fd);
+        free(samples);
+        return 1;
+    }
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    for (long i = 0; i < warmup; i++) sct_invoke(inv);
+
+    long failures = 0;
+    struct rusage self0, children0, self1, children1;
+    get_rusage(&self0, &children0);
+    uint64_t t0 = scu_now_ns();
+    for (long i = 0; i < n; i++) {
+        uint64_t t = scu_now_ns();
+        if (sct_invoke(inv) != 0) failures++;
+        samples[i] = scu_now_ns() - t;
+    }
+    uint64_t total = scu_now_ns() - t0;
+    get_rusage(&self1, &children1);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    scu_sort_u64(samples, n);
+    uint64_t user = cpu_delta(&self0.ru_utime, &children0.ru_utime,
+        &self1.ru_utime, &children1.ru_utime);
+    uint64_t sys = cpu_delta(&self0.ru_stime, &children0.ru_stime,
+        &self1.ru_stime, &children1.ru_stime);
+    #define RU_DELTA(field) rusage_delta(&self0, &children0, &self1, \
+        &children1, offsetof(struct rusage, field))
+
+    printf("%s: %ld iterations (%ld warmup), %ld failed, %.3f ms total, "
+        "%.1f ops/s\n", sct_invocation_name(inv), n, warmup, failures,
+        total / 1e6, n / (total / 1e9));
+    printf("wall, us:  min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f  "
+        "mean %.1f\n", samples[0] / 1e3,
+        scu_percentile_u64(samples, n, 50) / 1e3,
+        scu_percentile_u64(samples, n, 90) / 1e3,
+        scu_percentile_u64(samples, n, 99) / 1e3,
+        samples[n - 1] / 1e3, (double)total / n / 1e3);
+    printf("cpu, us/op:  user %.1f  sys %.1f\n", user / 1e3 / n,
+        sys / 1e3 / n);
+    printf("context switches:  voluntary %ld  involuntary %ld\n",
+        RU_DELTA(ru_nvcsw), RU_DELTA(ru_nivcsw));
+    printf("page faults:  minor %ld  major %ld\n",
+        RU_DELTA(ru_minflt), RU_DELTA(ru_majflt));
+    #undef RU_DELTA
+    free(samples);
+    return 0;
+}
+
+// profile_exec() samples the stacks of the command following 'profile'
+// and writes them as folded stacks, ready for a flame graph
+static int profile_exec(sct_arg_t *args, int argc, sct_invocation_t *inv) {
+    static int profile_seq = 0;
+    char *fn = scu_sprintf("profile-%s-%d.folded", sct_invocation_name(inv),
+        ++profile_seq);
+    // the workers are sampled if running when sampling starts
+    sct_pool_start(sct_pool_default_workers());
+    if (!fn || !sct_profile_start()) {
+        free(fn);
+        return 1;
+    }
+    int retval = sct_invoke(inv);
+    fflush(stdout);
+    sct_profile_summary_t summary;
+    if (sct_profile_stop(fn, &summary)) {
+        if (summary.threads)
+            printf("Profile (%s, %ld threads): ", summary.method,
+                summary.threads);
+        else printf("Profile (%s): ", summary.method);
+        printf("%ld samples, %ld dropped, written to %s\n", summary.samples,
+            summary.dropped, fn);
+        if (summary.missed)
+            printf("Warning: %ld threads not sampled.\n", summary.missed);
+    }
+    free(fn);
+    return retval;
+}
+
+void sct_init_builtin_commands(void) {
+    sct_arg_t args[2] = {   SA_FILE_OR_DIR_NAME, true, NULL, true };
+    sct_add_command("ls", args, 1, ls_exec);
+    sct_add_command("du", args, 1, du_exec);
+    args[0].variadic = false;
+
+    args[0].kind = SA_DIRNAME;
+    args[0].optional = false;
+    sct_add_command("cd", args, 1, cd_exec);
+    sct_add_command("index", args, 1, index_exec);
+    sct_add_command("dupes", args, 1, dupes_exec);
+    args[0].kind = SA_FILE_OR_DIR_NAME;
+    args[1].kind = SA_TEXT;
+    args[1].optional = true;
+    args[1].variadic = true;
+    sct_add_command("find", args, 2, find_exec);
+    args[1].optional = false;
+
+    sct_add_command("pwd", NULL, 0, pwd_exec);
+    sct_add_command("stats", NULL, 0, stats_exec);
+    sct_add_command("memstats", NULL, 0, memstats_exec);
+
+    args[0].kind = SA_TEXT;
+    args[0].optional = false;
+    sct_add_prefix("bench", args, 1, bench_exec);
+    sct_add_prefix("profile", NULL, 0, profile_exec);
+
+    args[0].kind = SA_TEXT;
+    args[1].kind = SA_FILENAME;
+    args[1].optional = false;
+    args[1].value = NULL;
+    args[1].variadic = true;
+    sct_add_command("grep", args, 2, grep_exec);
+    sct_add_command("follow", args, 2, follow_exec);
+    args[0].kind = SA_FILENAME;
+    sct_add_command("fgrep", args, 2, fgrep_exec);
+    args[1].variadic = false;
+
+    args[0].kind = SA_INETNAME;
+    sct_add_command("ping", args, 1, ping_exec);
+    args[0].variadic = true;
+    sct_add_command("resolve", args, 1, resolve_exec);
+
+    args[0].kind = SA_FILENAME;
+    args[0].variadic = true;
+    sct_add_command("sum", args, 1, sum_exec);
+    sct_add_command("sum256", args, 1, sum256_exec);
+    args[1].kind = SA_NEW_FILENAME;
+    sct_add_command("cp", args, 2, cp_exec);
+    args[0].variadic = false;
+    sct_add_command("sync", args, 2, sync_exec);
+    sct_add_command("fsync", args, 2, fsync_exec);
 }
\ No newline at end of file
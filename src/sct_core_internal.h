@@ -0,0 +1,78 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#pragma once
+#include "sct_core.h"
+
+// SCT Core internals shared with the Core's own tooling (e.g. sct_bench).
+// Not a part of the plugin interface.
+
+typedef struct sct_command_ {
+    struct sct_command_ *next;
+    char *name;
+    sct_exec_cb_t exec_fn;
+    // lazy commands have no exec_fn until resolve_fn supplies it on first use
+    sct_resolve_cb_t resolve_fn;
+    void *resolve_ctx;
+    // a prefix runs the command following its own arguments on the line
+    sct_prefix_cb_t prefix_fn;
+    sct_arg_t args[SCT_MAX_ARGS];
+    int argc;
+    int metrics_slot;
+} sct_command_t;
+
+#define SCT_MAX_PREFIXES 4
+
+// a link of the prefixes chain; the last link is the command itself
+struct sct_invocation_ {
+    struct sct_command_ *command;
+    struct sct_invocation_ *next;
+};
+
+typedef enum complete_kind_ {
+    CK_FILENAME,
+    CK_COMMAND_NAME,
+    CK_NONE           
+} complete_kind_t;
+
+// A word here is any string of chars inclosed in quotes or not, breaked by
+// a whitespace or EOL.
+typedef struct arg_word_ {
+    struct arg_word_ *next;
+    int index;
+    char *text;
+    int start;
+    int end;
+} arg_word_t;
+
+typedef struct parsed_words_ {
+    arg_word_t *words;
+    int word_count;
+} parsed_words_t;
+
+parsed_words_t *parse_words(char *line, bool ignore_parse_errors);
+void purge_words(parsed_words_t *words);
+sct_command_t *get_command_by_name(char *name);
+sct_command_t *command_from_words(parsed_words_t *words);
+bool validate_arg(sct_arg_t *arg, bool *err_printed);
+complete_kind_t resolve_comletion_kind(int start);
+char *command_names_provider(const char *text, int state);
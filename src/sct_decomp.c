@@ -0,0 +1,420 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include "sct_decomp.h"
+#include "sct_memstats.h"
+#include "sct_utils.h"
+
+/*
+    Compressed files for grep.
+    A thread reads the file and decompresses it into a ring of buffers
+    the matcher takes in turn, so that matching a buffer overlaps with
+    decompressing the next ones, and memory stays bounded whatever the
+    size of the data. The consumer holds one buffer at a time; the
+    producer waits when all the others are full.
+    gzip (all members of a multi-member file) goes through zlib's inflate,
+    zstd (all frames) through ZSTD_decompressStream(). Both libraries are
+    dlopen'ed the first time a file needs them, so sctest neither builds
+    nor runs against them; only the few functions used are declared here,
+    all of them part of the libraries' stable ABIs.
+*/
+
+#define SCT_DECOMP_BUFFERS 4
+#define SCT_DECOMP_BUFFER_SIZE (256 * 1024)
+#define SCT_DECOMP_INPUT_SIZE (128 * 1024)
+
+#pragma region libraries
+//------------------------------------------------------------------------------
+//              libraries
+
+// zlib.h's z_stream
+typedef struct zlib_stream_ {
+    const unsigned char *next_in;
+    unsigned avail_in;
+    unsigned long total_in;
+    unsigned char *next_out;
+    unsigned avail_out;
+    unsigned long total_out;
+    const char *msg;
+    void *state;
+    void *zalloc;
+    void *zfree;
+    void *opaque;
+    int data_type;
+    unsigned long adler;
+    unsigned long reserved;
+} zlib_stream_t;
+
+#define ZLIB_OK 0
+#define ZLIB_STREAM_END 1
+#define ZLIB_BUF_ERROR (-5)
+#define ZLIB_NO_FLUSH 0
+#define ZLIB_GZIP_WINDOW (15 + 16)
+
+typedef struct zlib_api_ {
+    void *handle;
+    int (*inflateInit2_)(zlib_stream_t *, int, const char *, int);
+    int (*inflate)(zlib_stream_t *, int);
+    int (*inflateReset)(zlib_stream_t *);
+    int (*inflateEnd)(zlib_stream_t *);
+} zlib_api_t;
+
+// zstd.h's buffers
+typedef struct zstd_in_ {
+    const void *src;
+    size_t size;
+    size_t pos;
+} zstd_in_t;
+
+typedef struct zstd_out_ {
+    void *dst;
+    size_t size;
+    size_t pos;
+} zstd_out_t;
+
+typedef struct zstd_api_ {
+    void *handle;
+    void *(*createDStream)(void);
+    size_t (*freeDStream)(void *);
+    size_t (*initDStream)(void *);
+    size_t (*decompressStream)(void *, zstd_out_t *, zstd_in_t *);
+    unsigned (*isError)(size_t);
+    const char *(*getErrorName)(size_t);
+} zstd_api_t;
+
+// loaded on the main thread, before the first decompressing thread starts
+static zlib_api_t g_zlib = { NULL };
+static zstd_api_t g_zstd = { NULL };
+static bool g_zlib_tried = false;
+static bool g_zstd_tried = false;
+
+static void *load_symbol(void *handle, char *name, bool *failed) {
+    void *p = dlsym(handle, name);
+    if (!p) *failed = true;
+    return p;
+}
+
+static bool load_zlib(void) {
+    if (g_zlib_tried) return g_zlib.handle != NULL;
+    g_zlib_tried = true;
+    void *h = dlopen("libz.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (!h) return false;
+    bool failed = false;
+    g_zlib.inflateInit2_ = load_symbol(h, "inflateInit2_", &failed);
+    g_zlib.inflate = load_symbol(h, "inflate", &failed);
+    g_zlib.inflateReset = load_symbol(h, "inflateReset", &failed);
+    g_zlib.inflateEnd = load_symbol(h, "inflateEnd", &failed);
+    if (failed) dlclose(h);
+    else g_zlib.handle = h;
+    return !failed;
+}
+
+static bool load_zstd(void) {
+    if (g_zstd_tried) return g_zstd.handle != NULL;
+    g_zstd_tried = true;
+    void *h = dlopen("libzstd.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (!h) return false;
+    bool failed = false;
+    g_zstd.createDStream = load_symbol(h, "ZSTD_createDStream", &failed);
+    g_zstd.freeDStream = load_symbol(h, "ZSTD_freeDStream", &failed);
+    g_zstd.initDStream = load_symbol(h, "ZSTD_initDStream", &failed);
+    g_zstd.decompressStream = load_symbol(h, "ZSTD_decompressStream",
+        &failed);
+    g_zstd.isError = load_symbol(h, "ZSTD_isError", &failed);
+    g_zstd.getErrorName = load_symbol(h, "ZSTD_getErrorName", &failed);
+    if (failed) dlclose(h);
+    else g_zstd.handle = h;
+    return !failed;
+}
+#pragma endregion
+
+#pragma region buffers
+//------------------------------------------------------------------------------
+//              buffers
+
+struct sct_decomp_ {
+    int fd;
+    sct_decomp_format_t format;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    // buffer k % SCT_DECOMP_BUFFERS is the k-th filled
+    char *buffers[SCT_DECOMP_BUFFERS];
+    size_t lens[SCT_DECOMP_BUFFERS];
+    uint64_t produced;
+    uint64_t consumed;
+    bool held;          // the consumer has buffer consumed
+    bool finished;      // nothing more will be produced
+    bool stop;          // the consumer is gone
+    char error[128];
+    sct_memctx_t memctx;    // the opener's, for the producer's allocations
+    // the producer's
+    char *input;
+    char *out;          // the buffer being filled
+    size_t out_len;
+};
+
+// next_output() waits for a free buffer to fill; false if the consumer
+// is gone
+static bool next_output(sct_decomp_t *d) {
+    pthread_mutex_lock(&d->lock);
+    while (!d->stop && (d->produced - d->consumed == SCT_DECOMP_BUFFERS))
+        pthread_cond_wait(&d->cond, &d->lock);
+    bool stop = d->stop;
+    pthread_mutex_unlock(&d->lock);
+    d->out = d->buffers[d->produced % SCT_DECOMP_BUFFERS];
+    d->out_len = 0;
+    return !stop;
+}
+
+// publish() hands the buffer filled over to the consumer
+static void publish(sct_decomp_t *d) {
+    pthread_mutex_lock(&d->lock);
+    d->lens[d->produced % SCT_DECOMP_BUFFERS] = d->out_len;
+    d->produced++;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    d->out = NULL;
+}
+
+// room() makes sure there is a buffer with space to fill
+static bool room(sct_decomp_t *d) {
+    if (d->out && (d->out_len == SCT_DECOMP_BUFFER_SIZE)) publish(d);
+    return d->out || next_output(d);
+}
+
+// read_input() reads the next piece of the file; 0 at its end, -1 on
+// an error
+static ssize_t read_input(sct_decomp_t *d) {
+    ssize_t n;
+    do n = read(d->fd, d->input, SCT_DECOMP_INPUT_SIZE);
+    while ((n < 0) && (errno == EINTR));
+    if (n < 0) snprintf(d->error, sizeof(d->error), "%s", strerror(errno));
+    return n;
+}
+#pragma endregion
+
+#pragma region decompressors
+//------------------------------------------------------------------------------
+//              decompressors
+
+static void gunzip(sct_decomp_t *d) {
+    zlib_stream_t z;
+    memset(&z, 0, sizeof(z));
+    // any zlib 1.x accepts the version
+    if (g_zlib.inflateInit2_(&z, ZLIB_GZIP_WINDOW, "1.2.0", sizeof(z))
+        != ZLIB_OK) {
+        snprintf(d->error, sizeof(d->error), "out of memory");
+        return;
+    }
+    bool in_member = false;     // a member started and not ended
+    ssize_t n;
+    while (!*d->error && ((n = read_input(d)) > 0)) {
+        z.next_in = (unsigned char *)d->input;
+        z.avail_in = n;
+        while (z.avail_in) {
+            if (!room(d)) break;
+            z.next_out = (unsigned char *)d->out + d->out_len;
+            z.avail_out = SCT_DECOMP_BUFFER_SIZE - d->out_len;
+            unsigned avail_out = z.avail_out;
+            int ret = g_zlib.inflate(&z, ZLIB_NO_FLUSH);
+            d->out_len += avail_out - z.avail_out;
+            in_member = true;
+            if (ret == ZLIB_STREAM_END) {
+                // another member may follow
+                g_zlib.inflateReset(&z);
+                in_member = false;
+            }
+            else if ((ret != ZLIB_OK) && (ret != ZLIB_BUF_ERROR)) {
+                snprintf(d->error, sizeof(d->error), "%s",
+                    z.msg ? z.msg : "invalid compressed data");
+                break;
+            }
+        }
+        if (d->stop) break;
+    }
+    if (!*d->error && in_member && !d->stop)
+        snprintf(d->error, sizeof(d->error), "unexpected end of file");
+    g_zlib.inflateEnd(&z);
+}
+
+static void unzstd(sct_decomp_t *d) {
+    void *z = g_zstd.createDStream();
+    if (!z || g_zstd.isError(g_zstd.initDStream(z))) {
+        snprintf(d->error, sizeof(d->error), "out of memory");
+        if (z) g_zstd.freeDStream(z);
+        return;
+    }
+    size_t ret = 0;     // 0 once a frame is complete
+    ssize_t n;
+    while (!*d->error && ((n = read_input(d)) > 0)) {
+        zstd_in_t in = { d->input, (size_t)n, 0 };
+        while (in.pos < in.size) {
+            if (!room(d)) break;
+            zstd_out_t out = { d->out, SCT_DECOMP_BUFFER_SIZE, d->out_len };
+            ret = g_zstd.decompressStream(z, &out, &in);
+            d->out_len = out.pos;
+            if (g_zstd.isError(ret)) {
+                snprintf(d->error, sizeof(d->error), "%s",
+                    g_zstd.getErrorName(ret));
+                break;
+            }
+        }
+        if (d->stop) break;
+    }
+    // what the decoder still holds of a complete frame
+    while (!*d->error && !d->stop && ret && (n == 0)) {
+        if (!room(d)) break;
+        zstd_in_t in = { d->input, 0, 0 };
+        zstd_out_t out = { d->out, SCT_DECOMP_BUFFER_SIZE, d->out_len };
+        size_t before = out.pos;
+        ret = g_zstd.decompressStream(z, &out, &in);
+        d->out_len = out.pos;
+        if (g_zstd.isError(ret)) {
+            snprintf(d->error, sizeof(d->error), "%s",
+                g_zstd.getErrorName(ret));
+        }
+        else if (ret && (out.pos == before)) {
+            snprintf(d->error, sizeof(d->error), "unexpected end of file");
+        }
+    }
+    g_zstd.freeDStream(z);
+}
+
+static void *decompress(void *arg) {
+    sct_decomp_t *d = arg;
+    sct_memstats_adopt(d->memctx);
+    if (d->format == SCT_DECOMP_GZIP) gunzip(d);
+    else unzstd(d);
+    if (d->out && d->out_len && !d->stop) publish(d);
+    pthread_mutex_lock(&d->lock);
+    d->finished = true;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+#pragma endregion
+
+#pragma region public decomp routines
+//------------------------------------------------------------------------------
+//              public decomp routines
+
+sct_decomp_format_t sct_decomp_detect(const char *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    if ((len >= 3) && (p[0] == 0x1f) && (p[1] == 0x8b) && (p[2] == 8))
+        return SCT_DECOMP_GZIP;
+    if ((len >= 4) && (p[0] == 0x28) && (p[1] == 0xb5) && (p[2] == 0x2f)
+        && (p[3] == 0xfd)) return SCT_DECOMP_ZSTD;
+    return SCT_DECOMP_NONE;
+}
+
+sct_decomp_t *sct_decomp_open(char *path, sct_decomp_format_t format,
+    char *err, size_t err_size)
+{
+    bool loaded = format == SCT_DECOMP_GZIP ? load_zlib() : load_zstd();
+    if (!loaded) {
+        snprintf(err, err_size, "%s compressed, %s not available",
+            format == SCT_DECOMP_GZIP ? "gzip" : "zstd",
+            format == SCT_DECOMP_GZIP ? "libz.so.1" : "libzstd.so.1");
+        return NULL;
+    }
+    sct_decomp_t *d = calloc(1, sizeof(*d));
+    if (!d) {
+        snprintf(err, err_size, "out of memory");
+        return NULL;
+    }
+    d->format = format;
+    d->memctx = sct_memstats_current();
+    d->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (d->fd == -1) {
+        snprintf(err, err_size, "%s", strerror(errno));
+        free(d);
+        return NULL;
+    }
+    bool allocated = (d->input = malloc(SCT_DECOMP_INPUT_SIZE)) != NULL;
+    for (int i = 0; allocated && (i < SCT_DECOMP_BUFFERS); i++)
+        allocated = (d->buffers[i] = malloc(SCT_DECOMP_BUFFER_SIZE)) != NULL;
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->cond, NULL);
+    if (!allocated || scu_thread_create(&d->thread, decompress, d)) {
+        snprintf(err, err_size, "%s", allocated ? "cannot start a thread"
+            : "out of memory");
+        d->finished = true;
+        sct_decomp_close(d);
+        return NULL;
+    }
+    return d;
+}
+
+bool sct_decomp_next(sct_decomp_t *d, char **data, size_t *len) {
+    pthread_mutex_lock(&d->lock);
+    if (d->held) {
+        d->consumed++;
+        d->held = false;
+        pthread_cond_broadcast(&d->cond);
+    }
+    while (!d->finished && (d->produced == d->consumed))
+        pthread_cond_wait(&d->cond, &d->lock);
+    bool available = d->produced > d->consumed;
+    if (available) {
+        *data = d->buffers[d->consumed % SCT_DECOMP_BUFFERS];
+        *len = d->lens[d->consumed % SCT_DECOMP_BUFFERS];
+        d->held = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return available;
+}
+
+const char *sct_decomp_error(sct_decomp_t *d) {
+    // set before finished, and read after
+    pthread_mutex_lock(&d->lock);
+    bool finished = d->finished;
+    pthread_mutex_unlock(&d->lock);
+    return finished && *d->error ? d->error : NULL;
+}
+
+void sct_decomp_close(sct_decomp_t *d) {
+    if (!d) return;
+    pthread_mutex_lock(&d->lock);
+    bool started = !d->finished || d->thread;
+    d->stop = true;
+    pthread_cond_broadcast(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    if (started && d->thread) pthread_join(d->thread, NULL);
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->cond);
+    for (int i = 0; i < SCT_DECOMP_BUFFERS; i++) free(d->buffers[i]);
+    free(d->input);
+    close(d->fd);
+    free(d);
+}
+#pragma endregion
@@ -0,0 +1,46 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include "sct_core.h"
+
+/*
+    Demonstrates a runtime plugin. It is built as a shared object next to
+    a manifest (see src/sct_example_dl_plugin.manifest) and placed into
+    the plugin directory. SCTest registers the 'hello' command from the
+    manifest and loads this object only when 'hello' is first run.
+*/
+
+static int g_greetings = 0;
+
+int hello_plugin_init(void) {
+    g_greetings = 0;
+    return 0;
+}
+
+int hello_exec(sct_arg_t *args, int argc) {
+    g_greetings++;
+    if (args->value)
+        printf("Hello, %s! (greeting #%d)\n", args->value, g_greetings);
+    else printf("Hello! (greeting #%d)\n", g_greetings);
+    return 0;
+}
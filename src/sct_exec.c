@@ -0,0 +1,277 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "sct_exec.h"
+#include "sct_utils.h"
+
+/*
+    External program launcher.
+    Commands wrapping external tools used to call system(), which starts
+    /bin/sh to parse a command string and search PATH on every call.
+    Here a program is started straight from a prebuilt argv with
+    posix_spawn() (glibc implements it with vfork semantics, so no page
+    tables are copied), and its full path is taken from a small cache
+    that is flushed whenever PATH changes.
+*/
+
+extern char **environ;
+
+#define SCT_PATH_CACHE_SIZE 64   // must be a power of 2
+
+typedef struct path_entry_ {
+    struct path_entry_ *next;
+    char *name;
+    char *path;
+} path_entry_t;
+
+static path_entry_t *g_path_cache[SCT_PATH_CACHE_SIZE];
+static char *g_cached_path_env = NULL;
+
+#pragma region PATH cache
+//------------------------------------------------------------------------------
+//              PATH cache
+
+static unsigned hash_name(char *s) {
+    unsigned h = 5381;
+    while (*s) h = h * 33 + (unsigned char)*s++;
+    return h & (SCT_PATH_CACHE_SIZE - 1);
+}
+
+void sct_exec_flush_path_cache(void) {
+    for (int i = 0; i < SCT_PATH_CACHE_SIZE; i++) {
+        while (g_path_cache[i]) {
+            path_entry_t *e = g_path_cache[i];
+            g_path_cache[i] = e->next;
+            free(e->name);
+            free(e->path);
+            free(e);
+        }
+    }
+    free(g_cached_path_env);
+    g_cached_path_env = NULL;
+}
+
+// search_path() walks PATH the way execvp() does
+static char *search_path(char *name, char *path_env) {
+    char *p = path_env;
+    while (p) {
+        char *sep = strchr(p, ':');
+        size_t len = sep ? (size_t)(sep - p) : strlen(p);
+        char *candidate = len ? scu_sprintf("%.*s/%s", (int)len, p, name)
+            : scu_sprintf("./%s", name);
+        if (candidate && (access(candidate, X_OK) == 0)) return candidate;
+        free(candidate);
+        p = sep ? sep + 1 : NULL;
+    }
+    return NULL;
+}
+
+static char *resolve_program(char *name) {
+    if (strchr(name, '/')) return name;
+
+    char *path_env = getenv("PATH");
+    if (!path_env) path_env = "/bin:/usr/bin";
+    if (!g_cached_path_env || (strcmp(g_cached_path_env, path_env) != 0)) {
+        sct_exec_flush_path_cache();
+        g_cached_path_env = scu_strdup(path_env);
+    }
+
+    unsigned h = hash_name(name);
+    for (path_entry_t *e = g_path_cache[h]; e; e = e->next)
+        if (strcmp(e->name, name) == 0) return e->path;
+
+    char *path = search_path(name, path_env);
+    if (!path) return NULL;
+    path_entry_t *e = malloc(sizeof(*e));
+    if (!e) {
+        free(path);
+        return NULL;
+    }
+    e->name = scu_strdup(name);
+    e->path = path;
+    e->next = g_path_cache[h];
+    g_path_cache[h] = e;
+    return path;
+}
+
+// drops a stale entry, e.g. the program was removed after being cached
+static void forget_program(char *name) {
+    path_entry_t **pe = &g_path_cache[hash_name(name)];
+    while (*pe) {
+        if (strcmp((*pe)->name, name) == 0) {
+            path_entry_t *e = *pe;
+            *pe = e->next;
+            free(e->name);
+            free(e->path);
+            free(e);
+            return;
+        }
+        pe = &(*pe)->next;
+    }
+}
+#pragma endregion
+
+#pragma region spawning
+//------------------------------------------------------------------------------
+//              spawning
+
+static int spawn_program(char *path, char *const argv[], int out_fd,
+    pid_t *pid)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+
+    if (out_fd != STDOUT_FILENO)
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+
+    // like system(), the child gets default SIGINT/SIGQUIT handling
+    // while we ignore them until it exits
+    sigset_t def;
+    sigemptyset(&def);
+    sigaddset(&def, SIGINT);
+    sigaddset(&def, SIGQUIT);
+    posix_spawnattr_setsigdefault(&attr, &def);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    int err = posix_spawn(pid, path, &actions, &attr, argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return err;
+}
+
+// start_program() spawns a program, looking it up again if it was
+// removed from where it was cached
+static int start_program(char *const argv[], int out_fd, pid_t *pid) {
+    char *path = resolve_program(argv[0]);
+    int err = path ? spawn_program(path, argv, out_fd, pid) : ENOENT;
+    if ((err == ENOENT) && path && (path != argv[0])) {
+        forget_program(argv[0]);
+        path = resolve_program(argv[0]);
+        err = path ? spawn_program(path, argv, out_fd, pid) : ENOENT;
+    }
+    if (err) printf("%s: %s\n", argv[0], strerror(err));
+    return err;
+}
+
+static int wait_program(pid_t pid) {
+    int status = -1;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) return -1;
+    }
+    return status;
+}
+
+// read_lines() passes what is read from fd to fn, line by line, until
+// the end of the file
+static void read_lines(int fd, sct_exec_line_fn_t fn, void *ctx) {
+    size_t capacity = 4096;
+    char *buffer = malloc(capacity);
+    size_t len = 0;
+    while (buffer) {
+        if (len == capacity) {
+            char *p = realloc(buffer, capacity * 2);
+            if (!p) break;
+            buffer = p;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, buffer + len, capacity - len);
+        if ((n < 0) && (errno == EINTR)) continue;
+        if (n <= 0) break;
+        len += n;
+        char *line = buffer;
+        char *eol;
+        while ((eol = memchr(line, '\n', buffer + len - line))) {
+            *eol = 0;
+            fn(line, ctx);
+            line = eol + 1;
+        }
+        len -= line - buffer;
+        memmove(buffer, line, len);
+    }
+    if (buffer && len && (len < capacity)) {
+        buffer[len] = 0;
+        fn(buffer, ctx);
+    }
+    free(buffer);
+}
+
+// exec_program() runs a program, its output going to out_fd, or line by
+// line to fn if out_fd is -1
+static int exec_program(char *const argv[], int out_fd,
+    sct_exec_line_fn_t fn, void *ctx)
+{
+    if (!argv || !argv[0]) return -1;
+
+    // anything we printed must precede the child's output
+    fflush(stdout);
+
+    int pipe_fds[2] = { -1, -1 };
+    if ((out_fd < 0) && (pipe2(pipe_fds, O_CLOEXEC) != 0)) {
+        printf("%s: %s\n", argv[0], strerror(errno));
+        return -1;
+    }
+
+    struct sigaction ign, old_int, old_quit;
+    memset(&ign, 0, sizeof(ign));
+    ign.sa_handler = SIG_IGN;
+    sigaction(SIGINT, &ign, &old_int);
+    sigaction(SIGQUIT, &ign, &old_quit);
+
+    pid_t pid;
+    int err = start_program(argv, out_fd < 0 ? pipe_fds[1] : out_fd, &pid);
+    if (out_fd < 0) {
+        close(pipe_fds[1]);
+        if (!err) read_lines(pipe_fds[0], fn, ctx);
+        close(pipe_fds[0]);
+    }
+    int status = err ? -1 : wait_program(pid);
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGQUIT, &old_quit, NULL);
+    return status;
+}
+
+int sct_exec_argv(char *const argv[], int out_fd) {
+    return exec_program(argv, out_fd, NULL, NULL);
+}
+
+int sct_exec_lines(char *const argv[], sct_exec_line_fn_t fn, void *ctx) {
+    return exec_program(argv, -1, fn, ctx);
+}
+
+void sct_exec_finalize(void) {
+    sct_exec_flush_path_cache();
+}
+#pragma endregion
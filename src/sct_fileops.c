@@ -0,0 +1,2111 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <grp.h>
+#include <pthread.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include "sct_fileops.h"
+#include "sct_aho.h"
+#include "sct_decomp.h"
+#include "sct_index.h"
+#include "sct_io.h"
+#include "sct_pool.h"
+#include "sct_record.h"
+#include "sct_walk.h"
+#include "sct_regex.h"
+#include "sct_sum.h"
+#include "sct_utils.h"
+
+/*
+    Native file commands.
+    ls, grep and cp used to start the system tools, one process per command
+    issuing one system call at a time. Here all of their file access goes
+    through the batched I/O layer: ls stats a whole directory in one batch,
+    grep reads its files through a reader opening and reading ahead of the
+    matcher, which takes whole chunks of lines at a time, and cp keeps all I/O buffers busy with reads and writes.
+    The output follows the tools': 'ls -FClg' listing, grep's 'file:line'
+    when several files are searched, and their exit statuses.
+    fgrep looks for many fixed strings at once with an Aho-Corasick
+    automaton (sct_aho.h) and tells which of them each line has.
+    Files compressed with gzip or zstd, told by their first bytes, are
+    searched decompressed, a thread decompressing ahead of the matcher
+    (sct_decomp.h).
+    follow keeps files open and matches the lines appended to them as
+    inotify reports each write, blocking in poll() in between.
+    With '--output', ls and the greps write records instead of their text
+    (sct_record.h); the results grep keeps are text, so the files are
+    read again then.
+*/
+
+#define SCT_LS_SIX_MONTHS (365 * 24 * 3600 / 2)
+
+#pragma region ls
+//------------------------------------------------------------------------------
+//              ls
+
+typedef struct ls_entry_ {
+    char *name;
+    struct stat st;
+    char *link;         // target of a symbolic link
+    mode_t link_mode;   // of the target, 0 if it is missing
+} ls_entry_t;
+
+typedef struct group_name_ {
+    struct group_name_ *next;
+    gid_t gid;
+    char *name;
+} group_name_t;
+
+static char *group_name(group_name_t **cache, gid_t gid) {
+    for (group_name_t *g = *cache; g; g = g->next)
+        if (g->gid == gid) return g->name;
+    group_name_t *g = malloc(sizeof(*g));
+    if (!g) return "?";
+    struct group *gr = getgrgid(gid);
+    g->gid = gid;
+    g->name = gr ? scu_strdup(gr->gr_name) : scu_sprintf("%u", (unsigned)gid);
+    g->next = *cache;
+    *cache = g;
+    return g->name ? g->name : "?";
+}
+
+static void purge_group_names(group_name_t *cache) {
+    while (cache) {
+        group_name_t *g = cache;
+        cache = g->next;
+        free(g->name);
+        free(g);
+    }
+}
+
+static void format_mode(mode_t mode, char *s) {
+    s[0] = S_ISDIR(mode) ? 'd' : S_ISLNK(mode) ? 'l' : S_ISCHR(mode) ? 'c'
+        : S_ISBLK(mode) ? 'b' : S_ISFIFO(mode) ? 'p' : S_ISSOCK(mode) ? 's'
+        : '-';
+    char *rwx = "rwxrwxrwx";
+    for (int i = 0; i < 9; i++)
+        s[i + 1] = (mode & (0400 >> i)) ? rwx[i] : '-';
+    if (mode & S_ISUID) s[3] = (mode & S_IXUSR) ? 's' : 'S';
+    if (mode & S_ISGID) s[6] = (mode & S_IXGRP) ? 's' : 'S';
+    if (mode & S_ISVTX) s[9] = (mode & S_IXOTH) ? 't' : 'T';
+    s[10] = 0;
+}
+
+static void format_size(struct stat *st, char *s, size_t sz) {
+    if (S_ISCHR(st->st_mode) || S_ISBLK(st->st_mode))
+        snprintf(s, sz, "%u, %u", major(st->st_rdev), minor(st->st_rdev));
+    else snprintf(s, sz, "%lld", (long long)st->st_size);
+}
+
+static void format_time(time_t t, time_t now, char *s, size_t sz) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    bool recent = (t <= now) && (now - t < SCT_LS_SIX_MONTHS);
+    strftime(s, sz, recent ? "%b %e %H:%M" : "%b %e  %Y", &tm);
+}
+
+static int64_t stat_mtime_ns(struct stat *st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static char indicator(mode_t mode) {
+    if (S_ISDIR(mode)) return '/';
+    if (S_ISFIFO(mode)) return '|';
+    if (S_ISSOCK(mode)) return '=';
+    if (S_ISREG(mode) && (mode & (S_IXUSR | S_IXGRP | S_IXOTH))) return '*';
+    return 0;
+}
+
+static int digits(unsigned long long v) {
+    int n = 1;
+    while (v >= 10) {
+        v /= 10;
+        n++;
+    }
+    return n;
+}
+
+typedef struct ls_widths_ {
+    int nlink;
+    int group;
+    int size;
+} ls_widths_t;
+
+static void measure_entries(ls_entry_t *entries, size_t count,
+    group_name_t **groups, ls_widths_t *w)
+{
+    char size[48];
+    for (size_t i = 0; i < count; i++) {
+        struct stat *st = &entries[i].st;
+        int n = digits(st->st_nlink);
+        if (n > w->nlink) w->nlink = n;
+        n = strlen(group_name(groups, st->st_gid));
+        if (n > w->group) w->group = n;
+        format_size(st, size, sizeof(size));
+        n = strlen(size);
+        if (n > w->size) w->size = n;
+    }
+}
+
+static char *type_name(mode_t mode) {
+    return S_ISDIR(mode) ? "dir" : S_ISLNK(mode) ? "link" : S_ISCHR(mode)
+        ? "char" : S_ISBLK(mode) ? "block" : S_ISFIFO(mode) ? "fifo"
+        : S_ISSOCK(mode) ? "socket" : "file";
+}
+
+// record_entries() writes entries as records, dir being the directory
+// listed, NULL for those given as arguments
+static void record_entries(ls_entry_t *entries, size_t count, char *dir,
+    group_name_t **groups)
+{
+    sct_record_t r = { 0 };
+    for (size_t i = 0; i < count; i++) {
+        ls_entry_t *e = &entries[i];
+        sct_record_begin(&r, "entry");
+        if (dir) sct_record_str(&r, "dir", dir);
+        sct_record_str(&r, "name", e->name);
+        sct_record_str(&r, "kind", type_name(e->st.st_mode));
+        sct_record_int(&r, "mode", e->st.st_mode & 07777);
+        sct_record_int(&r, "nlink", e->st.st_nlink);
+        sct_record_str(&r, "group", group_name(groups, e->st.st_gid));
+        sct_record_int(&r, "size", e->st.st_size);
+        sct_record_int(&r, "mtime_ns", stat_mtime_ns(&e->st));
+        if (e->link) sct_record_str(&r, "target", e->link);
+        sct_record_end(&r);
+    }
+    sct_record_free(&r);
+}
+
+static void print_entries(ls_entry_t *entries, size_t count,
+    group_name_t **groups, ls_widths_t *w)
+{
+    time_t now = time(NULL);
+    for (size_t i = 0; i < count; i++) {
+        ls_entry_t *e = &entries[i];
+        char mode[11];
+        char size[48];
+        char mtime[32];
+        format_mode(e->st.st_mode, mode);
+        format_size(&e->st, size, sizeof(size));
+        format_time(e->st.st_mtim.tv_sec, now, mtime, sizeof(mtime));
+        printf("%s %*llu %-*s %*s %s %s", mode, w->nlink,
+            (unsigned long long)e->st.st_nlink, w->group,
+            group_name(groups, e->st.st_gid), w->size, size, mtime, e->name);
+        mode_t kind = e->link ? e->link_mode : e->st.st_mode;
+        if (e->link) printf(" -> %s", e->link);
+        if (indicator(kind)) putchar(indicator(kind));
+        putchar('\n');
+    }
+}
+
+static char *read_link(int dirfd, ls_entry_t *e) {
+    size_t sz = e->st.st_size > 0 ? e->st.st_size + 1 : 256;
+    char *target = malloc(sz);
+    if (!target) return NULL;
+    ssize_t n = readlinkat(dirfd, e->name, target, sz - 1);
+    if (n < 0) {
+        free(target);
+        return NULL;
+    }
+    target[n] = 0;
+    struct stat st;
+    e->link_mode = fstatat(dirfd, e->name, &st, 0) == 0 ? st.st_mode : 0;
+    return target;
+}
+
+static int cmp_entries(const void *a, const void *b) {
+    return strcmp(((ls_entry_t *)a)->name, ((ls_entry_t *)b)->name);
+}
+
+static int cmp_names(const void *a, const void *b) {
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+static void purge_entries(ls_entry_t *entries, size_t count) {
+    for (size_t i = 0; i < count; i++) free(entries[i].link);
+    free(entries);
+}
+
+static char **read_names(DIR *dir, size_t *count) {
+    char **names = NULL;
+    size_t capacity = 0;
+    *count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (entry->d_name[0] == '.') continue;
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char **p = realloc(names, capacity * sizeof(*p));
+            if (!p) break;
+            names = p;
+        }
+        names[(*count)++] = scu_strdup(entry->d_name);
+    }
+    return names;
+}
+
+// list_dir() prints a directory's contents, all of it stated in one batch
+static int list_dir(char *path, bool header, bool *first,
+    group_name_t **groups)
+{
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "ls: cannot open directory '%s': %s\n", path,
+            strerror(errno));
+        return 2;
+    }
+    size_t count;
+    char **names = read_names(dir, &count);
+    qsort(names, count, sizeof(char *), cmp_names);
+    ls_entry_t *entries = calloc(count ? count : 1, sizeof(*entries));
+    struct stat *st = malloc((count ? count : 1) * sizeof(*st));
+    int *errors = malloc((count ? count : 1) * sizeof(*errors));
+    int retval = 0;
+    size_t listed = 0;
+    if (entries && st && errors) {
+        sct_io_stat_batch(dirfd(dir), names, count, false, st, errors);
+        unsigned long long blocks = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (errors[i]) continue;    // removed since readdir()
+            ls_entry_t *e = &entries[listed++];
+            e->name = names[i];
+            e->st = st[i];
+            if (S_ISLNK(st[i].st_mode)) e->link = read_link(dirfd(dir), e);
+            blocks += (st[i].st_blocks + 1) / 2;
+        }
+        if (sct_records()) record_entries(entries, listed, path, groups);
+        else {
+            if (header) printf("%s%s:\n", *first ? "" : "\n", path);
+            printf("total %llu\n", blocks);
+            ls_widths_t widths = { 0 };
+            measure_entries(entries, listed, groups, &widths);
+            print_entries(entries, listed, groups, &widths);
+        }
+        *first = false;
+    }
+    else retval = 2;
+    purge_entries(entries, listed);
+    free(st);
+    free(errors);
+    for (size_t i = 0; i < count; i++) free(names[i]);
+    free(names);
+    closedir(dir);
+    return retval;
+}
+
+int sct_ls(char **paths, int count) {
+    char *dot = ".";
+    if (count == 0) {
+        paths = &dot;
+        count = 1;
+    }
+    ls_entry_t *files = calloc(count, sizeof(*files));
+    ls_entry_t *dirs = calloc(count, sizeof(*dirs));
+    struct stat *st = malloc(count * sizeof(*st));
+    int *errors = malloc(count * sizeof(*errors));
+    if (!files || !dirs || !st || !errors) {
+        free(files);
+        free(dirs);
+        free(st);
+        free(errors);
+        return 2;
+    }
+
+    // arguments are listed themselves, unless they are directories
+    int retval = 0;
+    size_t file_count = 0;
+    size_t dir_count = 0;
+    sct_io_stat_batch(AT_FDCWD, paths, count, false, st, errors);
+    for (int i = 0; i < count; i++) {
+        if (errors[i]) {
+            fprintf(stderr, "ls: cannot access '%s': %s\n", paths[i],
+                strerror(errors[i]));
+            retval = 2;
+            continue;
+        }
+        ls_entry_t *e = S_ISDIR(st[i].st_mode) ? &dirs[dir_count++]
+            : &files[file_count++];
+        e->name = paths[i];
+        e->st = st[i];
+        if (S_ISLNK(st[i].st_mode)) e->link = read_link(AT_FDCWD, e);
+    }
+    qsort(files, file_count, sizeof(*files), cmp_entries);
+    qsort(dirs, dir_count, sizeof(*dirs), cmp_entries);
+
+    // columns of the files listed are as wide as if directories were listed
+    group_name_t *groups = NULL;
+    ls_widths_t widths = { 0 };
+    measure_entries(files, file_count, &groups, &widths);
+    measure_entries(dirs, dir_count, &groups, &widths);
+    bool first = true;
+    if (file_count && sct_records())
+        record_entries(files, file_count, NULL, &groups);
+    else if (file_count) print_entries(files, file_count, &groups, &widths);
+    if (file_count) first = false;
+    bool headers = (count > 1) || retval;
+    for (size_t i = 0; i < dir_count; i++) {
+        int r = list_dir(dirs[i].name, headers, &first, &groups);
+        if (r) retval = r;
+    }
+    fflush(stdout);
+    sct_record_flush();
+
+    purge_group_names(groups);
+    purge_entries(files, file_count);
+    purge_entries(dirs, dir_count);
+    free(st);
+    free(errors);
+    return retval;
+}
+#pragma endregion
+
+#pragma region grep results cache
+//------------------------------------------------------------------------------
+//              grep results cache
+
+// The lines a search printed per file and pattern, and how far the file
+// was searched: a file searched again unchanged is not read, and one
+// appended to is read from its last complete line searched on.
+
+#define SCT_GREP_MEMO_BUDGET (32 << 20)     // bytes of results kept
+#define SCT_GREP_MEMO_ENTRY_MAX (SCT_GREP_MEMO_BUDGET / 8)
+#define SCT_GREP_MEMO_BUCKETS 4096          // a power of 2
+#define SCT_GREP_MEMO_TAIL 64               // bytes compared for an append
+#define SCT_GREP_MEMO_RACY_NS 1000000000LL  // mtime this close to a search
+
+typedef struct grep_memo_ {
+    struct grep_memo_ *hash_next;
+    struct grep_memo_ *lru_prev;
+    struct grep_memo_ *lru_next;
+    uint32_t hash;
+    dev_t dev;
+    ino_t ino;
+    int flags;
+    char *pattern;
+    // the file as searched
+    off_t size;
+    int64_t mtime_ns;
+    int64_t searched_ns;    // when it was stated for the search
+    char tail[SCT_GREP_MEMO_TAIL];  // its last bytes
+    int tail_len;
+    off_t scanned;          // the end of its last complete line
+    bool binary;
+    bool matched;
+    // of the lines before scanned, a search resumed starts from
+    bool complete_matched;
+    off_t complete_nul_at;  // its first NUL byte, -1 if none
+    bool compressed;        // searched decompressed, never resumed
+    // the lines matching, each ended by '\n'; complete_len bytes of them
+    // from the lines before scanned
+    char *output;
+    size_t output_len;
+    size_t output_capacity;
+    size_t complete_len;
+    size_t accounted;       // in g_memo_bytes
+    bool busy;              // in use by the search running
+    bool failed;            // the results being gathered are incomplete
+} grep_memo_t;
+
+static grep_memo_t *g_memo[SCT_GREP_MEMO_BUCKETS];
+static grep_memo_t *g_memo_head = NULL;
+static grep_memo_t *g_memo_tail = NULL;
+static size_t g_memo_bytes = 0;
+
+static uint32_t memo_hash(dev_t dev, ino_t ino, char *pattern, int flags) {
+    uint32_t h = 2166136261u;
+    uint64_t id[3] = { dev, ino, (uint64_t)flags };
+    for (size_t i = 0; i < sizeof(id); i++)
+        h = (h ^ ((unsigned char *)id)[i]) * 16777619u;
+    for (; *pattern; pattern++) h = (h ^ (unsigned char)*pattern) * 16777619u;
+    return h;
+}
+
+static void memo_lru_unlink(grep_memo_t *m) {
+    if (m->lru_prev) m->lru_prev->lru_next = m->lru_next;
+    else g_memo_head = m->lru_next;
+    if (m->lru_next) m->lru_next->lru_prev = m->lru_prev;
+    else g_memo_tail = m->lru_prev;
+    m->lru_prev = m->lru_next = NULL;
+}
+
+static void memo_lru_push_front(grep_memo_t *m) {
+    m->lru_next = g_memo_head;
+    if (g_memo_head) g_memo_head->lru_prev = m;
+    else g_memo_tail = m;
+    g_memo_head = m;
+}
+
+static void memo_remove(grep_memo_t *m) {
+    grep_memo_t **p = &g_memo[m->hash & (SCT_GREP_MEMO_BUCKETS - 1)];
+    while (*p != m) p = &(*p)->hash_next;
+    *p = m->hash_next;
+    memo_lru_unlink(m);
+    g_memo_bytes -= m->accounted;
+    free(m->pattern);
+    free(m->output);
+    free(m);
+}
+
+// drops the least recently used results not in use
+static void memo_trim(void) {
+    grep_memo_t *m = g_memo_tail;
+    while (m && (g_memo_bytes > SCT_GREP_MEMO_BUDGET)) {
+        grep_memo_t *prev = m->lru_prev;
+        if (!m->busy) memo_remove(m);
+        m = prev;
+    }
+}
+
+// appended() tells if a file has only grown since its results were kept:
+// the bytes it ended with are still there
+static bool appended(grep_memo_t *m, char *path, struct stat *st) {
+    if (st->st_size <= m->size) return false;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+    char tail[SCT_GREP_MEMO_TAIL];
+    bool same = pread(fd, tail, m->tail_len, m->size - m->tail_len)
+        == m->tail_len;
+    close(fd);
+    return same && (memcmp(tail, m->tail, m->tail_len) == 0);
+}
+
+// memo_get() takes the results for a file, NULL if none can be kept.
+// *start gets -1 if they are complete, or where to read the file from,
+// the results being those of the lines before.
+static grep_memo_t *memo_get(char *path, struct stat *st, char *pattern,
+    int flags, off_t *start)
+{
+    *start = 0;
+    uint32_t hash = memo_hash(st->st_dev, st->st_ino, pattern, flags);
+    grep_memo_t **bucket = &g_memo[hash & (SCT_GREP_MEMO_BUCKETS - 1)];
+    grep_memo_t *m = *bucket;
+    while (m && ((m->hash != hash) || (m->dev != st->st_dev)
+        || (m->ino != st->st_ino) || (m->flags != flags)
+        || strcmp(m->pattern, pattern))) m = m->hash_next;
+    // a file given twice
+    if (m && m->busy) return NULL;
+    int64_t mtime = stat_mtime_ns(st);
+    if (m) {
+        memo_lru_unlink(m);
+        if ((m->size == st->st_size) && (m->mtime_ns == mtime)
+            && (mtime + SCT_GREP_MEMO_RACY_NS < m->searched_ns)) *start = -1;
+        else if (!m->compressed && appended(m, path, st)) {
+            *start = m->scanned;
+            m->output_len = m->complete_len;
+        }
+        else {
+            m->scanned = 0;
+            m->tail_len = 0;
+            m->binary = m->matched = m->complete_matched = false;
+            m->complete_nul_at = -1;
+            m->output_len = m->complete_len = 0;
+        }
+    }
+    else {
+        m = calloc(1, sizeof(*m));
+        if (m) m->pattern = scu_strdup(pattern);
+        if (!m || !m->pattern) {
+            free(m);
+            return NULL;
+        }
+        m->hash = hash;
+        m->dev = st->st_dev;
+        m->ino = st->st_ino;
+        m->flags = flags;
+        m->complete_nul_at = -1;
+        m->hash_next = *bucket;
+        *bucket = m;
+    }
+    memo_lru_push_front(m);
+    m->busy = true;
+    m->failed = false;
+    return m;
+}
+
+// memo_record() adds a matching line to the results
+static void memo_record(grep_memo_t *m, char *line, size_t len) {
+    if (m->failed) return;
+    if (m->output_len + len + 1 > m->output_capacity) {
+        size_t capacity = (m->output_len + len + 1) * 2;
+        char *p = capacity <= SCT_GREP_MEMO_ENTRY_MAX
+            ? realloc(m->output, capacity) : NULL;
+        if (!p) {
+            m->failed = true;
+            return;
+        }
+        m->output = p;
+        m->output_capacity = capacity;
+    }
+    memcpy(m->output + m->output_len, line, len);
+    m->output[m->output_len + len] = '\n';
+    m->output_len += len + 1;
+}
+
+// memo_release() is done with results; complete ones are kept
+static void memo_release(grep_memo_t *m, bool complete) {
+    if (!m) return;
+    m->busy = false;
+    if (!complete || m->failed) {
+        memo_remove(m);
+        return;
+    }
+    size_t size = sizeof(*m) + strlen(m->pattern) + 1 + m->output_capacity;
+    g_memo_bytes += size - m->accounted;
+    m->accounted = size;
+    memo_trim();
+}
+
+void sct_grep_finalize(void) {
+    while (g_memo_head) memo_remove(g_memo_head);
+}
+#pragma endregion
+
+#pragma region grep
+//------------------------------------------------------------------------------
+//              grep
+
+typedef struct grep_file_ {
+    char *path;
+    struct stat st;     // if memo
+    grep_memo_t *memo;  // its results kept, NULL if not
+    off_t start;        // read from here, -1 if not read: the results are kept
+} grep_file_t;
+
+typedef struct grep_state_ {
+    char *name;         // of the command, for messages
+    sct_regex_t *re;    // grep
+    sct_aho_t *ac;      // or fgrep
+    char **patterns;    // fgrep's strings
+    int *found;         // indexes of those in the line found
+    int found_count;
+    grep_file_t *files;
+    size_t current;     // the file being searched
+    bool prefix;        // several files: lines are prefixed with file names
+    bool matched;       // any line in any file
+    bool file_matched;  // any line in the current file
+    bool binary;        // the current file has NUL bytes
+    bool first_chunk;   // the next one is the first read of the file
+    off_t nul_at;       // the first NUL byte read, -1 if none
+    bool done;          // nothing more to look for in the current file
+    bool compressed;    // the current file is searched decompressed
+    char *carry;        // a line continuing into the next chunk
+    size_t carry_len;
+    size_t carry_capacity;
+    // for the results of the current file to be kept
+    grep_memo_t *memo;
+    off_t scanned;      // the end of the last complete line searched
+    off_t end;          // of the data read
+    char tail[SCT_GREP_MEMO_TAIL];  // the last bytes read
+    int tail_len;
+    // matches written as records, NULL for text
+    sct_record_t *record;
+    int64_t line;       // the number of the line at scanned, 0 if unknown
+} grep_state_t;
+
+// find_line() finds the first line of data matching, and with fgrep
+// the strings in it
+static bool find_line(grep_state_t *g, char *data, size_t len,
+    size_t *start, size_t *end)
+{
+    if (g->re) return sct_regex_find_line(g->re, data, len, start, end);
+    return sct_aho_find_line(g->ac, data, len, start, end, &g->found,
+        &g->found_count);
+}
+
+static void print_binary(grep_state_t *g, char *path) {
+    if (!g->record) {
+        printf("%s: %s: binary file matches\n", g->name, path);
+        return;
+    }
+    sct_record_begin(g->record, "binary");
+    sct_record_str(g->record, "file", path);
+    sct_record_end(g->record);
+}
+
+static int64_t count_lines(char *data, char *end) {
+    int64_t count = 0;
+    while ((data < end) && (data = memchr(data, '\n', end - data))) {
+        count++;
+        data++;
+    }
+    return count;
+}
+
+static void record_match(grep_state_t *g, char *path, char *line,
+    size_t len, off_t offset)
+{
+    sct_record_t *r = g->record;
+    sct_record_begin(r, "match");
+    sct_record_str(r, "file", path);
+    if (g->line) sct_record_int(r, "line", g->line);
+    sct_record_int(r, "offset", offset);
+    sct_record_strn(r, "text", line, len);
+    if (g->ac) {
+        char *found[g->found_count ? g->found_count : 1];
+        for (int i = 0; i < g->found_count; i++)
+            found[i] = g->patterns[g->found[i]];
+        sct_record_strs(r, "strings", found, g->found_count);
+    }
+    sct_record_end(r);
+}
+
+// print_output() prints kept results, lines ended by '\n'
+static void print_output(grep_state_t *g, char *path, char *output,
+    size_t len)
+{
+    if (!len) return;
+    if (!g->prefix) {
+        fwrite(output, 1, len, stdout);
+        return;
+    }
+    char *end = output + len;
+    while (output < end) {
+        char *eol = memchr(output, '\n', end - output);
+        printf("%s:", path);
+        fwrite(output, 1, eol + 1 - output, stdout);
+        output = eol + 1;
+    }
+}
+
+// grep_lines() prints the lines of data matching, lines being separated
+// by '\n', the last one possibly without it; data is at offset in the file
+static void grep_lines(grep_state_t *g, char *data, size_t len,
+    off_t offset)
+{
+    char *path = g->files[g->current].path;
+    char *base = data;
+    char *counted = data;   // lines are counted up to here
+    size_t start, end;
+    while (!g->done && find_line(g, data, len, &start, &end)) {
+        g->matched = g->file_matched = true;
+        if (g->binary) {
+            print_binary(g, path);
+            g->done = true;
+            return;
+        }
+        if (g->record) {
+            if (g->line) g->line += count_lines(counted, data + start);
+            counted = data + start;
+            record_match(g, path, data + start, end - start,
+                offset + (data + start - base));
+            if (end >= len) break;
+            data += end + 1;
+            len -= end + 1;
+            continue;
+        }
+        if (g->prefix) printf("%s:", path);
+        for (int i = 0; g->ac && (i < g->found_count); i++) {
+            if (i) putchar(',');
+            fputs(g->patterns[g->found[i]], stdout);
+        }
+        if (g->ac) putchar(':');
+        fwrite(data + start, 1, end - start, stdout);
+        putchar('\n');
+        if (g->memo) memo_record(g->memo, data + start, end - start);
+        if (end >= len) break;
+        data += end + 1;
+        len -= end + 1;
+    }
+    if (g->line) g->line += count_lines(counted, data + len);
+}
+
+static bool carry_append(grep_state_t *g, char *data, size_t len) {
+    if (g->carry_len + len > g->carry_capacity) {
+        size_t capacity = (g->carry_len + len) * 2;
+        char *p = realloc(g->carry, capacity);
+        if (!p) return false;
+        g->carry = p;
+        g->carry_capacity = capacity;
+    }
+    memcpy(g->carry + g->carry_len, data, len);
+    g->carry_len += len;
+    return true;
+}
+
+// keeps the last bytes read, to tell an append next time
+static void update_tail(grep_state_t *g, char *data, size_t len) {
+    if (len >= SCT_GREP_MEMO_TAIL) {
+        memcpy(g->tail, data + len - SCT_GREP_MEMO_TAIL, SCT_GREP_MEMO_TAIL);
+        g->tail_len = SCT_GREP_MEMO_TAIL;
+        return;
+    }
+    int keep = g->tail_len + (int)len > SCT_GREP_MEMO_TAIL
+        ? SCT_GREP_MEMO_TAIL - (int)len : g->tail_len;
+    memmove(g->tail, g->tail + g->tail_len - keep, keep);
+    memcpy(g->tail + keep, data, len);
+    g->tail_len = keep + (int)len;
+}
+
+// grep_chunk() matches the complete lines of a chunk, keeping its last
+// line, if incomplete, for the next one
+static void grep_chunk(grep_state_t *g, sct_io_chunk_t *chunk) {
+    // the first chunk read tells a binary file, that of a resumed search
+    // adding to what the lines before tell
+    char *nul = g->first_chunk && chunk->len
+        ? memchr(chunk->data, 0, chunk->len) : NULL;
+    if (nul && (g->nul_at < 0)) {
+        g->binary = true;
+        g->nul_at = chunk->offset + (nul - chunk->data);
+    }
+    g->first_chunk = false;
+    char *p = chunk->data;
+    char *end = p + chunk->len;
+    if (g->memo) {
+        update_tail(g, p, chunk->len);
+        g->end = chunk->offset + chunk->len;
+    }
+    if (!g->done && g->carry_len && (p < end)) {
+        char *eol = memchr(p, '\n', end - p);
+        if (!eol) eol = end;
+        if (!carry_append(g, p, eol - p)) g->done = true;
+        else if (eol < end) {
+            grep_lines(g, g->carry, g->carry_len, g->scanned);
+            // less its '\n'
+            if (g->line) g->line++;
+            g->carry_len = 0;
+            g->scanned = chunk->offset + (eol + 1 - chunk->data);
+        }
+        p = eol < end ? eol + 1 : end;
+    }
+    if (!g->done && (p < end)) {
+        char *last = memrchr(p, '\n', end - p);
+        if (last) {
+            grep_lines(g, p, last + 1 - p, chunk->offset + (p - chunk->data));
+            p = last + 1;
+            g->scanned = chunk->offset + (p - chunk->data);
+        }
+        if (!g->done && (p < end) && !carry_append(g, p, end - p)) {
+            g->done = true;
+            // lines were left unsearched
+            if (g->memo) g->memo->failed = true;
+        }
+    }
+    // what an unterminated last line adds is not resumed from
+    if (chunk->last && g->memo) {
+        grep_memo_t *m = g->memo;
+        m->complete_len = m->output_len;
+        m->complete_matched = g->file_matched;
+        m->complete_nul_at = (g->nul_at >= 0) && (g->nul_at < g->scanned)
+            ? g->nul_at : -1;
+    }
+    if (chunk->last && !g->done && g->carry_len)
+        grep_lines(g, g->carry, g->carry_len, g->scanned);
+}
+
+// replay() prints the results kept for a file not read
+static void replay(grep_state_t *g, grep_file_t *f) {
+    if (f->start >= 0) return;
+    grep_memo_t *m = f->memo;
+    g->matched |= m->matched;
+    if (m->binary && m->matched) print_binary(g, f->path);
+    else print_output(g, f->path, m->output, m->output_len);
+    memo_release(m, true);
+    f->memo = NULL;
+}
+
+// start_file() prepares for reading a file, from where its results end
+static void start_file(grep_state_t *g, size_t index) {
+    grep_file_t *f = &g->files[index];
+    g->current = index;
+    g->done = false;
+    g->carry_len = 0;
+    g->file_matched = false;
+    g->binary = false;
+    g->first_chunk = true;
+    g->nul_at = -1;
+    g->compressed = false;
+    g->memo = f->memo;
+    g->scanned = g->end = f->start;
+    g->tail_len = 0;
+    g->line = g->record && (f->start == 0);
+    grep_memo_t *m = f->memo;
+    if (!m || (f->start == 0)) return;
+    g->nul_at = m->complete_nul_at;
+    g->binary = g->nul_at >= 0;
+    g->file_matched = m->complete_matched;
+    g->matched |= m->complete_matched;
+    if (g->binary && g->file_matched) {
+        print_binary(g, f->path);
+        g->done = true;
+    }
+    else print_output(g, f->path, m->output, m->complete_len);
+    memcpy(g->tail, m->tail, m->tail_len);
+    g->tail_len = m->tail_len;
+}
+
+// finish_file() keeps the results of a file read through, unchanged meanwhile
+static void finish_file(grep_state_t *g, int error, int64_t searched_ns) {
+    grep_file_t *f = &g->files[g->current];
+    grep_memo_t *m = f->memo;
+    if (!m) return;
+    // offsets in decompressed data are not the file's
+    bool complete = !error && (g->compressed || (g->end == f->st.st_size));
+    if (complete) {
+        m->size = f->st.st_size;
+        m->mtime_ns = stat_mtime_ns(&f->st);
+        m->searched_ns = searched_ns;
+        memcpy(m->tail, g->tail, g->tail_len);
+        m->tail_len = g->tail_len;
+        m->scanned = g->scanned;
+        m->binary = g->binary;
+        m->matched = g->file_matched;
+        m->compressed = g->compressed;
+    }
+    memo_release(m, complete);
+    f->memo = g->memo = NULL;
+}
+
+// grep_compressed() matches the lines of a compressed file as they are
+// decompressed; false on an error, once the lines before it are matched
+static bool grep_compressed(grep_state_t *g, char *path,
+    sct_decomp_format_t format)
+{
+    char msg[128];
+    sct_decomp_t *d = sct_decomp_open(path, format, msg, sizeof(msg));
+    if (!d) {
+        fprintf(stderr, "%s: %s: %s\n", g->name, path, msg);
+        return false;
+    }
+    g->compressed = true;
+    sct_io_chunk_t chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    while (!g->done && sct_decomp_next(d, &chunk.data, &chunk.len)) {
+        grep_chunk(g, &chunk);
+        chunk.offset += chunk.len;
+    }
+    // the last line, if unterminated
+    char empty = 0;
+    chunk.data = &empty;
+    chunk.len = 0;
+    chunk.last = true;
+    grep_chunk(g, &chunk);
+    const char *error = sct_decomp_error(d);
+    if (error) fprintf(stderr, "%s: %s: %s\n", g->name, path, error);
+    sct_decomp_close(d);
+    return !error;
+}
+
+// grep_files() matches the lines of the files, read or kept, printing
+// them in order; false on a read error
+static bool grep_files(grep_state_t *g, grep_file_t *files, size_t count,
+    int64_t searched_ns)
+{
+    g->files = files;
+    char **paths = malloc((count ? count : 1) * sizeof(char *));
+    off_t *starts = malloc((count ? count : 1) * sizeof(off_t));
+    size_t *ids = malloc((count ? count : 1) * sizeof(size_t));
+    size_t read_count = 0;
+    for (size_t i = 0; paths && starts && ids && (i < count); i++) {
+        if (files[i].start < 0) continue;
+        paths[read_count] = files[i].path;
+        starts[read_count] = files[i].start;
+        ids[read_count++] = i;
+    }
+    bool failed = false;
+    sct_io_reader_t *reader = paths && starts && ids
+        ? sct_io_read_files_at(paths, starts, read_count) : NULL;
+    size_t next = 0;    // the first file not printed yet
+    sct_io_chunk_t chunk;
+    while (reader && sct_io_next_chunk(reader, &chunk)) {
+        size_t i = ids[chunk.index];
+        if (next <= i) {
+            while (next < i) replay(g, &files[next++]);
+            next = i + 1;
+            start_file(g, i);
+        }
+        int error = chunk.error;
+        sct_decomp_format_t format = !error && (chunk.offset == 0)
+            ? sct_decomp_detect(chunk.data, chunk.len) : SCT_DECOMP_NONE;
+        if (error) {
+            fprintf(stderr, "%s: %s: %s\n", g->name, files[i].path,
+                strerror(error));
+            failed = true;
+        }
+        else if (format != SCT_DECOMP_NONE) {
+            // decompressed from a file of its own: the reader passes it over
+            if (!chunk.last) sct_io_skip_file(reader);
+            chunk.last = true;
+            if (!grep_compressed(g, files[i].path, format)) {
+                error = EIO;
+                failed = true;
+            }
+        }
+        else grep_chunk(g, &chunk);
+        if (chunk.last) finish_file(g, error, searched_ns);
+    }
+    sct_io_reader_close(reader);
+    if (reader) while (next < count) replay(g, &files[next++]);
+    // results not printed
+    for (size_t i = 0; i < count; i++) memo_release(files[i].memo, false);
+    fflush(stdout);
+    sct_record_flush();
+    free(paths);
+    free(starts);
+    free(ids);
+    free(g->carry);
+    return reader && !failed;
+}
+
+int sct_grep(char *pattern, char **paths, int count) {
+    grep_state_t g;
+    memset(&g, 0, sizeof(g));
+    g.name = "grep";
+    sct_record_t record = { 0 };
+    if (sct_records()) g.record = &record;
+    char msg[128];
+    g.re = sct_regex_get(pattern, msg, sizeof(msg));
+    if (!g.re) {
+        fprintf(stderr, "grep: %s\n", msg);
+        return 2;
+    }
+    g.prefix = count > 1;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t searched_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    struct stat *st = malloc((count ? count : 1) * sizeof(*st));
+    int *errors = malloc((count ? count : 1) * sizeof(*errors));
+    bool *keep = malloc((count ? count : 1) * sizeof(bool));
+    grep_file_t *files = calloc(count ? count : 1, sizeof(*files));
+    size_t kept = 0;
+    if (st && errors && keep && files) {
+        sct_io_stat_batch(AT_FDCWD, paths, count, true, st, errors);
+        // files an index tells have no match are not read, and neither
+        // are those searched before unchanged
+        sct_index_filter(g.re, paths, st, errors, count, keep);
+        for (int i = 0; i < count; i++) {
+            if (!keep[i]) continue;
+            grep_file_t *f = &files[kept++];
+            f->path = paths[i];
+            // grep has no options, hence no flags; the results kept are
+            // text
+            if (!errors[i] && S_ISREG(st[i].st_mode) && !g.record) {
+                f->st = st[i];
+                f->memo = memo_get(paths[i], &st[i], pattern, 0, &f->start);
+            }
+        }
+    }
+    bool succeeded = st && errors && keep && files
+        && grep_files(&g, files, kept, searched_ns);
+    free(st);
+    free(errors);
+    free(keep);
+    free(files);
+    sct_record_free(&record);
+    sct_regex_put(g.re);
+    if (!succeeded) return 2;
+    return g.matched ? 0 : 1;
+}
+
+// read_patterns() reads fgrep's strings, one per line, empty lines aside
+static char **read_patterns(char *path, int *count) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    char **patterns = NULL;
+    int capacity = 0;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    bool failed = false;
+    *count = 0;
+    while (!failed && ((len = getline(&line, &size, f)) >= 0)) {
+        if (len && (line[len - 1] == '\n')) line[--len] = 0;
+        if (len && (line[len - 1] == '\r')) line[--len] = 0;
+        if (!len) continue;
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char **p = realloc(patterns, capacity * sizeof(char *));
+            if (!p) {
+                failed = true;
+                break;
+            }
+            patterns = p;
+        }
+        patterns[*count] = malloc(len + 1);
+        if (!patterns[*count]) failed = true;
+        else memcpy(patterns[(*count)++], line, len + 1);
+    }
+    if (ferror(f)) failed = true;
+    free(line);
+    fclose(f);
+    if (failed) {
+        for (int i = 0; i < *count; i++) free(patterns[i]);
+        free(patterns);
+        if (!errno) errno = ENOMEM;
+        return NULL;
+    }
+    // an empty pattern list still is a list
+    return patterns ? patterns : calloc(1, sizeof(char *));
+}
+
+int sct_fgrep(char *pattern_file, char **paths, int count) {
+    grep_state_t g;
+    memset(&g, 0, sizeof(g));
+    g.name = "fgrep";
+    sct_record_t record = { 0 };
+    if (sct_records()) g.record = &record;
+    int pattern_count;
+    errno = 0;
+    g.patterns = read_patterns(pattern_file, &pattern_count);
+    if (!g.patterns) {
+        fprintf(stderr, "fgrep: %s: %s\n", pattern_file, strerror(errno));
+        return 2;
+    }
+    g.ac = pattern_count ? sct_aho_build(g.patterns, pattern_count) : NULL;
+    bool succeeded = false;
+    if (!pattern_count) fprintf(stderr, "fgrep: %s: no strings\n", pattern_file);
+    else if (!g.ac) fprintf(stderr, "fgrep: out of memory\n");
+    else {
+        g.prefix = count > 1;
+        grep_file_t *files = calloc(count ? count : 1, sizeof(*files));
+        for (int i = 0; files && (i < count); i++) files[i].path = paths[i];
+        succeeded = files && grep_files(&g, files, count, 0);
+        free(files);
+    }
+    sct_aho_free(g.ac);
+    for (int i = 0; i < pattern_count; i++) free(g.patterns[i]);
+    free(g.patterns);
+    sct_record_free(&record);
+    if (!succeeded) return 2;
+    return g.matched ? 0 : 1;
+}
+#pragma endregion
+
+#pragma region follow
+//------------------------------------------------------------------------------
+//              follow
+
+// Like 'tail -F | grep': the lines written to the files from now on are
+// matched as soon as inotify reports the writes, until SIGINT. Each file
+// is matched by a grep state of its own, keeping its unterminated last
+// line. A file replaced at its path, as log rotation does, is followed
+// on at the new one once the old one is read through; a truncated one is
+// read again from its start.
+
+#define SCT_FOLLOW_BUFFER_SIZE (256 * 1024)
+
+typedef struct follow_file_ {
+    char *path;
+    char *base;         // the name watched for in its directory
+    int fd;
+    dev_t dev;
+    ino_t ino;
+    int wd;             // watch of the file
+    int dir_wd;         // of its directory, for the file to be replaced
+    off_t offset;       // read up to
+    bool modified;      // by the events read
+    bool replaced;
+    grep_state_t g;
+    grep_file_t f;
+} follow_file_t;
+
+// the end of the last complete line, not to match a line being written
+static off_t last_line_end(int fd, off_t size, char *buffer) {
+    off_t start = size > SCT_FOLLOW_BUFFER_SIZE
+        ? size - SCT_FOLLOW_BUFFER_SIZE : 0;
+    ssize_t n = pread(fd, buffer, size - start, start);
+    char *eol = n > 0 ? memrchr(buffer, '\n', n) : NULL;
+    return eol ? start + (eol + 1 - buffer) : size;
+}
+
+static void follow_reset(follow_file_t *ff) {
+    ff->offset = ff->g.scanned = 0;
+    ff->g.carry_len = 0;
+    ff->g.done = false;
+    ff->g.binary = false;
+}
+
+// follow_read() matches the lines appended since the last read
+static void follow_read(follow_file_t *ff, char *buffer) {
+    struct stat st;
+    if ((fstat(ff->fd, &st) == 0) && (st.st_size < ff->offset)) {
+        fprintf(stderr, "follow: %s: file truncated\n", ff->path);
+        follow_reset(ff);
+    }
+    sct_io_chunk_t chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    for (;;) {
+        ssize_t n = pread(ff->fd, buffer, SCT_FOLLOW_BUFFER_SIZE, ff->offset);
+        if ((n < 0) && (errno == EINTR)) continue;
+        if (n < 0) fprintf(stderr, "follow: %s: %s\n", ff->path,
+            strerror(errno));
+        if (n <= 0) break;
+        chunk.data = buffer;
+        chunk.len = n;
+        chunk.offset = ff->offset;
+        grep_chunk(&ff->g, &chunk);
+        ff->offset += n;
+    }
+}
+
+// follow_open() follows the file at the path, if there is one other than
+// the one followed, once the lines left in that one are matched
+static void follow_open(int ifd, follow_file_t *ff, char *buffer) {
+    struct stat st;
+    if ((stat(ff->path, &st) != 0) || !S_ISREG(st.st_mode)) return;
+    if ((ff->fd >= 0) && (st.st_dev == ff->dev) && (st.st_ino == ff->ino))
+        return;
+    int fd = open(ff->path, O_RDONLY | O_CLOEXEC);
+    if ((fd == -1) || (fstat(fd, &st) != 0)) {
+        if (fd != -1) close(fd);
+        return;
+    }
+    bool first = ff->fd < 0;
+    if (!first) {
+        follow_read(ff, buffer);
+        // its unterminated last line is complete now
+        char empty = 0;
+        sct_io_chunk_t chunk = { 0, &empty, 0, ff->offset, 0, true };
+        grep_chunk(&ff->g, &chunk);
+        close(ff->fd);
+        inotify_rm_watch(ifd, ff->wd);
+        fprintf(stderr, "follow: %s: file replaced, following the new one\n",
+            ff->path);
+    }
+    ff->fd = fd;
+    ff->dev = st.st_dev;
+    ff->ino = st.st_ino;
+    follow_reset(ff);
+    if (first) ff->offset = ff->g.scanned = last_line_end(fd, st.st_size,
+        buffer);
+    // a change between open() and here comes with a replacement event
+    ff->wd = inotify_add_watch(ifd, ff->path, IN_MODIFY);
+    if (!first) follow_read(ff, buffer);
+}
+
+// follow_events() notes which files the events are about
+static void follow_events(char *events, ssize_t len, follow_file_t *files,
+    int count)
+{
+    const struct inotify_event *e;
+    for (char *p = events; p < events + len; p += sizeof(*e) + e->len) {
+        e = (const struct inotify_event *)p;
+        for (int i = 0; i < count; i++) {
+            follow_file_t *ff = &files[i];
+            // lost events may be about any file
+            if (e->mask & IN_Q_OVERFLOW) ff->modified = ff->replaced = true;
+            else if (e->wd == ff->wd) ff->modified = true;
+            else if ((e->wd == ff->dir_wd) && e->len
+                && (strcmp(e->name, ff->base) == 0)) ff->replaced = true;
+        }
+    }
+}
+
+struct sct_follow_ {
+    follow_file_t *files;
+    int count;
+    int ifd;            // inotify
+    int sfd;            // signalfd of SIGINT
+    char *buffer;
+    sct_regex_t *re;
+    sct_record_t record;
+    sigset_t old_mask;
+    bool failed;
+};
+
+sct_follow_t *sct_follow_start(char *pattern, char **paths, int count) {
+    char msg[128];
+    sct_regex_t *re = sct_regex_get(pattern, msg, sizeof(msg));
+    if (!re) {
+        fprintf(stderr, "follow: %s\n", msg);
+        return NULL;
+    }
+    sct_follow_t *f = calloc(1, sizeof(*f));
+    if (!f) {
+        perror("follow");
+        sct_regex_put(re);
+        return NULL;
+    }
+    f->re = re;
+    f->count = count;
+    f->files = calloc(count ? count : 1, sizeof(*f->files));
+    f->buffer = malloc(SCT_FOLLOW_BUFFER_SIZE);
+    f->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // SIGINT is taken from a descriptor rather than ending sctest; the
+    // helper threads block it (scu_thread_create()), so it comes here
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &mask, &f->old_mask);
+    f->sfd = signalfd(-1, &mask, SFD_CLOEXEC);
+    bool succeeded = f->files && f->buffer && (f->ifd != -1)
+        && (f->sfd != -1);
+    if (!succeeded) perror("follow");
+    for (int i = 0; f->files && (i < count); i++)
+        f->files[i].fd = f->files[i].wd = f->files[i].dir_wd = -1;
+    for (int i = 0; succeeded && (i < count); i++) {
+        follow_file_t *ff = &f->files[i];
+        ff->path = paths[i];
+        ff->f.path = paths[i];
+        // lines are not numbered, the files being read from their ends
+        ff->g.name = "follow";
+        ff->g.re = re;
+        ff->g.files = &ff->f;
+        ff->g.prefix = count > 1;
+        if (sct_records()) ff->g.record = &f->record;
+        errno = 0;
+        char *slash = strrchr(paths[i], '/');
+        ff->base = slash ? slash + 1 : paths[i];
+        char *dir = slash ? scu_strndup(paths[i],
+            slash == paths[i] ? 1 : slash - paths[i]) : scu_strdup(".");
+        if (dir) ff->dir_wd = inotify_add_watch(f->ifd, dir,
+            IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+        free(dir);
+        follow_open(f->ifd, ff, f->buffer);
+        if ((ff->fd == -1) || (ff->wd == -1) || (ff->dir_wd == -1)) {
+            fprintf(stderr, "follow: %s: %s\n", paths[i],
+                errno ? strerror(errno) : "not a regular file");
+            succeeded = false;
+        }
+    }
+    if (!succeeded) {
+        f->failed = true;
+        sct_follow_end(f);
+        return NULL;
+    }
+    return f;
+}
+
+bool sct_follow_step(sct_follow_t *f, int timeout) {
+    struct pollfd fds[2] = { { f->ifd, POLLIN, 0 }, { f->sfd, POLLIN, 0 } };
+    if (poll(fds, 2, timeout) == -1) {
+        if (errno == EINTR) return true;
+        perror("follow");
+        f->failed = true;
+        return false;
+    }
+    // SIGINT ends it
+    if (fds[1].revents) {
+        struct signalfd_siginfo si;
+        if (read(f->sfd, &si, sizeof(si)) < 0) {}
+        return false;
+    }
+    char events[16 * 1024]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(f->ifd, events, sizeof(events))) > 0)
+        follow_events(events, n, f->files, f->count);
+    for (int i = 0; i < f->count; i++) {
+        follow_file_t *ff = &f->files[i];
+        if (ff->replaced) follow_open(f->ifd, ff, f->buffer);
+        if (ff->modified) follow_read(ff, f->buffer);
+        ff->modified = ff->replaced = false;
+    }
+    fflush(stdout);
+    sct_record_flush();
+    return true;
+}
+
+int sct_follow_end(sct_follow_t *f) {
+    bool matched = false;
+    for (int i = 0; f->files && (i < f->count); i++) {
+        matched |= f->files[i].g.matched;
+        if (f->files[i].fd >= 0) close(f->files[i].fd);
+        free(f->files[i].g.carry);
+    }
+    fflush(stdout);
+    sct_record_flush();
+    sct_record_free(&f->record);
+    if (f->sfd != -1) close(f->sfd);
+    pthread_sigmask(SIG_SETMASK, &f->old_mask, NULL);
+    if (f->ifd != -1) close(f->ifd);
+    free(f->buffer);
+    free(f->files);
+    sct_regex_put(f->re);
+    int retval = f->failed ? 2 : matched ? 0 : 1;
+    free(f);
+    return retval;
+}
+
+int sct_grep_follow(char *pattern, char **paths, int count) {
+    sct_follow_t *f = sct_follow_start(pattern, paths, count);
+    if (!f) return 2;
+    while (sct_follow_step(f, -1)) {}
+    return sct_follow_end(f);
+}
+#pragma endregion
+
+#pragma region cp
+//------------------------------------------------------------------------------
+//              cp
+
+int sct_cp(char **srcs, int count, char *dst) {
+    struct stat st;
+    bool into_dir = (stat(dst, &st) == 0) && S_ISDIR(st.st_mode);
+    if ((count > 1) && !into_dir) {
+        fprintf(stderr, "cp: target '%s' is not a directory\n", dst);
+        return 1;
+    }
+
+    int retval = 0;
+    for (int i = 0; i < count; i++) {
+        char *target = dst;
+        if (into_dir) {
+            char *name = strrchr(srcs[i], '/');
+            target = scu_sprintf("%s/%s", dst, name ? name + 1 : srcs[i]);
+            if (!target) return 1;
+        }
+        int err = sct_io_copy_file(srcs[i], target);
+        switch (err)
+        {
+            case 0: break;
+            case EEXIST:
+            {
+                fprintf(stderr, "cp: '%s' and '%s' are the same file\n",
+                    srcs[i], target);
+                break;
+            }
+            case EISDIR:
+            {
+                fprintf(stderr, "cp: -r not specified; omitting directory "
+                    "'%s'\n", srcs[i]);
+                break;
+            }
+            default:
+            {
+                fprintf(stderr, "cp: cannot copy '%s' to '%s': %s\n",
+                    srcs[i], target, strerror(err));
+                break;
+            }
+        }
+        if (err) retval = 1;
+        if (target != dst) free(target);
+    }
+    return retval;
+}
+#pragma endregion
+
+#pragma region sync
+//------------------------------------------------------------------------------
+//              sync
+
+// Blocks are compared by the range, a pool task each: SCT_SYNC_RANGE
+// bytes of both files are read, and the SCT_SYNC_BLOCK blocks differing
+// are written to the destination, runs of them at once.
+#define SCT_SYNC_BLOCK (64 * 1024)
+#define SCT_SYNC_RANGE (1024 * 1024)
+
+typedef struct sync_job_ {
+    int src_fd;
+    int dst_fd;
+    off_t size;
+    char **buffers;         // two ranges per worker
+    size_t blocks_written;
+    int error;              // errno, set by any worker
+    bool read_error;        // error is the source's
+    bool changed;           // source shrunk while compared
+} sync_job_t;
+
+// read_range() reads up to len bytes at offset, the count read or -1
+static ssize_t read_range(int fd, char *buffer, size_t len, off_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buffer + done, len - done, offset + done);
+        if ((n < 0) && (errno == EINTR)) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += n;
+    }
+    return done;
+}
+
+static bool write_run(sync_job_t *job, char *data, size_t len, off_t offset) {
+    while (len) {
+        ssize_t n = pwrite(job->dst_fd, data, len, offset);
+        if ((n < 0) && (errno == EINTR)) continue;
+        if (n < 0) {
+            __atomic_store_n(&job->error, errno, __ATOMIC_RELAXED);
+            return false;
+        }
+        data += n;
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void sync_task(sct_pool_t *pool, void *arg, int worker, void *ctx) {
+    sync_job_t *job = ctx;
+    if (__atomic_load_n(&job->error, __ATOMIC_RELAXED)
+        || __atomic_load_n(&job->changed, __ATOMIC_RELAXED)) return;
+    off_t offset = (off_t)(uintptr_t)arg * SCT_SYNC_RANGE;
+    size_t len = job->size - offset < SCT_SYNC_RANGE ? job->size - offset
+        : SCT_SYNC_RANGE;
+    char *src = job->buffers[2 * worker];
+    char *dst = job->buffers[2 * worker + 1];
+    ssize_t src_len = read_range(job->src_fd, src, len, offset);
+    if (src_len < 0) {
+        __atomic_store_n(&job->read_error, true, __ATOMIC_RELAXED);
+        __atomic_store_n(&job->error, errno, __ATOMIC_RELAXED);
+        return;
+    }
+    if ((size_t)src_len < len) {
+        __atomic_store_n(&job->changed, true, __ATOMIC_RELAXED);
+        return;
+    }
+    // the destination was sized as the source: a short read only happens
+    // if something else truncates it meanwhile, and then the rest differs
+    ssize_t dst_len = read_range(job->dst_fd, dst, len, offset);
+    if (dst_len < 0) {
+        __atomic_store_n(&job->error, errno, __ATOMIC_RELAXED);
+        return;
+    }
+    size_t written = 0;
+    size_t run = 0;         // start of the differing blocks pending
+    bool in_run = false;
+    for (size_t at = 0; at < len; at += SCT_SYNC_BLOCK) {
+        size_t n = len - at < SCT_SYNC_BLOCK ? len - at : SCT_SYNC_BLOCK;
+        bool differs = (at + n > (size_t)dst_len)
+            || (memcmp(src + at, dst + at, n) != 0);
+        if (differs) {
+            if (!in_run) run = at;
+            in_run = true;
+            written++;
+        }
+        else if (in_run) {
+            if (!write_run(job, src + run, at - run, offset + run)) return;
+            in_run = false;
+        }
+    }
+    if (in_run && !write_run(job, src + run, len - run, offset + run)) return;
+    __atomic_add_fetch(&job->blocks_written, written, __ATOMIC_RELAXED);
+}
+
+// sync_target() opens the destination as for writing in place, sized as
+// the source; an errno, EEXIST if both are the same file
+static int sync_target(int src_fd, struct stat *src_st, char *dst,
+    int *dst_fd)
+{
+    struct stat dst_st;
+    if ((stat(dst, &dst_st) == 0) && (dst_st.st_dev == src_st->st_dev)
+        && (dst_st.st_ino == src_st->st_ino)) return EEXIST;
+    *dst_fd = open(dst, O_RDWR | O_CREAT | O_CLOEXEC, src_st->st_mode & 0777);
+    if (*dst_fd < 0) return errno;
+    // a new or grown destination reads as zeros past its old end: zero
+    // blocks of the source are left as holes there
+    if (ftruncate(*dst_fd, src_st->st_size) != 0) return errno;
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(*dst_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return 0;
+}
+
+static int sync_file(char *src, char *dst, bool durable) {
+    char *name = durable ? "fsync" : "sync";
+    sync_job_t job = { .src_fd = open(src, O_RDONLY | O_CLOEXEC),
+        .dst_fd = -1 };
+    struct stat st;
+    int err = 0;
+    bool dst_error = false;     // opening the destination failed
+    if ((job.src_fd < 0) || (fstat(job.src_fd, &st) != 0)) {
+        fprintf(stderr, "%s: cannot open '%s': %s\n", name, src,
+            strerror(errno));
+        if (job.src_fd >= 0) close(job.src_fd);
+        return 1;
+    }
+    if (S_ISDIR(st.st_mode)) err = EISDIR;
+    else if (!S_ISREG(st.st_mode)) err = EINVAL;
+    else dst_error = (err = sync_target(job.src_fd, &st, dst,
+        &job.dst_fd)) != 0;
+    job.size = st.st_size;
+
+    int workers = sct_pool_default_workers();
+    size_t task_count = (job.size + SCT_SYNC_RANGE - 1) / SCT_SYNC_RANGE;
+    void **tasks = NULL;
+    if (!err && task_count) {
+        tasks = malloc(task_count * sizeof(void *));
+        job.buffers = calloc(2 * workers, sizeof(char *));
+        if (!tasks || !job.buffers) err = ENOMEM;
+        for (int i = 0; !err && (i < 2 * workers); i++)
+            if (!(job.buffers[i] = malloc(SCT_SYNC_RANGE))) err = ENOMEM;
+    }
+    if (!err && task_count) {
+        // the pool takes the last task first: the ranges are listed
+        // backwards for the files to be read forwards
+        for (size_t i = 0; i < task_count; i++)
+            tasks[task_count - 1 - i] = (void *)(uintptr_t)i;
+        if (!sct_pool_run("sync", workers, sync_task, &job, tasks,
+            task_count)) err = ENOMEM;
+        else if (job.changed) err = EAGAIN;
+        else err = job.error;
+    }
+    if (!err && durable && (fsync(job.dst_fd) != 0)) err = errno;
+
+    switch (err)
+    {
+        case 0:
+        {
+            size_t blocks = (job.size + SCT_SYNC_BLOCK - 1) / SCT_SYNC_BLOCK;
+            printf("%s: %zu of %zu blocks written\n", dst, job.blocks_written,
+                blocks);
+            break;
+        }
+        case EEXIST:
+        {
+            fprintf(stderr, "%s: '%s' and '%s' are the same file\n", name,
+                src, dst);
+            break;
+        }
+        case EISDIR:
+        {
+            if (dst_error) fprintf(stderr,
+                "%s: cannot overwrite directory '%s'\n", name, dst);
+            else fprintf(stderr, "%s: omitting directory '%s'\n", name, src);
+            break;
+        }
+        case EAGAIN:
+        {
+            fprintf(stderr, "%s: %s: file changed while read\n", name, src);
+            break;
+        }
+        default:
+        {
+            if (job.read_error) fprintf(stderr,
+                "%s: error reading '%s': %s\n", name, src, strerror(err));
+            else fprintf(stderr, "%s: cannot sync '%s' to '%s': %s\n", name,
+                src, dst, strerror(err));
+            break;
+        }
+    }
+    if (job.buffers)
+        for (int i = 0; i < 2 * workers; i++) free(job.buffers[i]);
+    free(job.buffers);
+    free(tasks);
+    close(job.src_fd);
+    if ((job.dst_fd >= 0) && (close(job.dst_fd) != 0) && !err) {
+        fprintf(stderr, "%s: %s: %s\n", name, dst, strerror(errno));
+        err = errno;
+    }
+    return err ? 1 : 0;
+}
+
+int sct_sync(char *src, char *dst, bool durable) {
+    struct stat st;
+    if ((stat(dst, &st) != 0) || !S_ISDIR(st.st_mode))
+        return sync_file(src, dst, durable);
+    char *name = strrchr(src, '/');
+    char *target = scu_sprintf("%s/%s", dst, name ? name + 1 : src);
+    if (!target) return 1;
+    int retval = sync_file(src, target, durable);
+    free(target);
+    return retval;
+}
+#pragma endregion
+
+#pragma region find
+//------------------------------------------------------------------------------
+//              find
+
+#define SCT_FIND_FLUSH (64 * 1024)
+
+typedef struct find_output_ {
+    char *data;
+    size_t len;
+    size_t capacity;
+} find_output_t;
+
+// A numeric test, as find has them: +n for more than n, -n for less.
+typedef struct find_number_ {
+    bool set;
+    int sign;
+    long long value;
+} find_number_t;
+
+typedef struct find_job_ {
+    char *name;             // -name pattern
+    char type;              // -type letter
+    find_number_t size;     // -size, in units of size_unit
+    long long size_unit;
+    find_number_t mtime;    // -mtime, in days
+    time_t now;
+    find_output_t *outputs; // per worker
+    int error;
+} find_job_t;
+
+static bool parse_number(char *s, find_number_t *n, char *units,
+    long long *unit)
+{
+    n->sign = (*s == '+') ? 1 : (*s == '-') ? -1 : 0;
+    if (n->sign) s++;
+    char *end;
+    errno = 0;
+    n->value = strtoll(s, &end, 10);
+    if ((end == s) || errno || (n->value < 0)) return false;
+    if (unit) {
+        // find's suffixes; blocks of 512 bytes by default
+        static const long long sizes[] = { 1, 2, 512, 1024, 1024 * 1024,
+            1024 * 1024 * 1024 };
+        char *u = *end ? strchr(units, *end) : NULL;
+        if (*end && (!u || end[1])) return false;
+        *unit = u ? sizes[u - units] : 512;
+    }
+    else if (*end) return false;
+    n->set = true;
+    return true;
+}
+
+static bool compare_number(find_number_t *n, long long v) {
+    if (n->sign > 0) return v > n->value;
+    if (n->sign < 0) return v < n->value;
+    return v == n->value;
+}
+
+static bool parse_predicates(find_job_t *job, char **args, int count) {
+    for (int i = 0; i < count; i += 2) {
+        char *p = args[i];
+        char *v = i + 1 < count ? args[i + 1] : NULL;
+        bool known = (strcmp(p, "-name") == 0) || (strcmp(p, "-type") == 0)
+            || (strcmp(p, "-size") == 0) || (strcmp(p, "-mtime") == 0);
+        if (!known) {
+            fprintf(stderr, "find: unknown predicate '%s'\n", p);
+            return false;
+        }
+        if (!v) {
+            fprintf(stderr, "find: missing argument to '%s'\n", p);
+            return false;
+        }
+        bool valid = true;
+        if (strcmp(p, "-name") == 0) job->name = v;
+        else if (strcmp(p, "-type") == 0) {
+            valid = v[0] && !v[1] && strchr("fdlpscb", v[0]);
+            job->type = v[0];
+        }
+        else if (strcmp(p, "-size") == 0)
+            valid = parse_number(v, &job->size, "cwbkMG", &job->size_unit);
+        else valid = parse_number(v, &job->mtime, NULL, NULL);
+        if (!valid) {
+            fprintf(stderr, "find: invalid argument '%s' to '%s'\n", v, p);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool find_matches(find_job_t *job, const sct_walk_entry_t *e) {
+    static const char types[] = { ['f'] = DT_REG, ['d'] = DT_DIR,
+        ['l'] = DT_LNK, ['p'] = DT_FIFO, ['s'] = DT_SOCK, ['c'] = DT_CHR,
+        ['b'] = DT_BLK };
+    if (job->type && (e->type != types[(unsigned char)job->type]))
+        return false;
+    if (job->name && (fnmatch(job->name, e->name, 0) != 0)) return false;
+    if (job->size.set) {
+        // find rounds the size up to its unit
+        long long units = (e->st->st_size + job->size_unit - 1)
+            / job->size_unit;
+        if (!compare_number(&job->size, units)) return false;
+    }
+    if (job->mtime.set) {
+        long long days = (job->now - e->st->st_mtime) / (24 * 60 * 60);
+        if (!compare_number(&job->mtime, days)) return false;
+    }
+    return true;
+}
+
+static void find_flush(find_output_t *out) {
+    if (!out->len) return;
+    fwrite(out->data, 1, out->len, stdout);
+    out->len = 0;
+}
+
+static void find_entry(const sct_walk_entry_t *e, int worker, void *ctx) {
+    find_job_t *job = ctx;
+    if (e->error) {
+        fprintf(stderr, "find: '%s': %s\n", e->path, strerror(e->error));
+        __atomic_store_n(&job->error, e->error, __ATOMIC_RELAXED);
+        return;
+    }
+    if (!find_matches(job, e)) return;
+    // the matches of a worker are written in blocks, each by one fwrite
+    find_output_t *out = &job->outputs[worker];
+    size_t len = strlen(e->path) + 1;
+    if (out->len + len > out->capacity) {
+        size_t capacity = out->capacity ? out->capacity : SCT_FIND_FLUSH;
+        while (capacity < out->len + len) capacity *= 2;
+        char *data = realloc(out->data, capacity);
+        if (!data) {
+            __atomic_store_n(&job->error, ENOMEM, __ATOMIC_RELAXED);
+            return;
+        }
+        out->data = data;
+        out->capacity = capacity;
+    }
+    memcpy(out->data + out->len, e->path, len - 1);
+    out->data[out->len + len - 1] = '\n';
+    out->len += len;
+    if (out->len >= SCT_FIND_FLUSH) find_flush(out);
+}
+
+int sct_find(char *path, char **predicates, int count) {
+    find_job_t job = { .now = time(NULL) };
+    if (!parse_predicates(&job, predicates, count)) return 1;
+    int workers = sct_pool_default_workers();
+    job.outputs = calloc(workers, sizeof(*job.outputs));
+    if (!job.outputs) {
+        fprintf(stderr, "find: %s\n", strerror(ENOMEM));
+        return 1;
+    }
+    int flags = job.size.set || job.mtime.set ? SCT_WALK_STAT : 0;
+    if (!sct_walk(&path, 1, flags, workers, find_entry, &job))
+        job.error = ENOMEM;
+    for (int i = 0; i < workers; i++) {
+        find_flush(&job.outputs[i]);
+        free(job.outputs[i].data);
+    }
+    fflush(stdout);
+    free(job.outputs);
+    if (job.error == ENOMEM) fprintf(stderr, "find: %s\n", strerror(ENOMEM));
+    return job.error ? 1 : 0;
+}
+#pragma endregion
+
+#pragma region du
+//------------------------------------------------------------------------------
+//              du
+
+// Files with several links are counted once: their device and inode are
+// kept in an open addressing set.
+typedef struct du_inode_ {
+    dev_t dev;
+    ino_t ino;
+} du_inode_t;
+
+typedef struct du_job_ {
+    int count;
+    uint64_t *blocks;       // per worker and root, of 512 bytes
+    pthread_mutex_t lock;   // the set
+    du_inode_t *inodes;
+    size_t inode_count;
+    size_t inode_capacity;  // a power of 2
+    int error;
+} du_job_t;
+
+static size_t inode_slot(du_inode_t *set, size_t capacity, dev_t dev,
+    ino_t ino)
+{
+    size_t i = ((uint64_t)ino * 0x9e3779b97f4a7c15ull ^ dev) & (capacity - 1);
+    while ((set[i].ino || set[i].dev) && ((set[i].ino != ino)
+        || (set[i].dev != dev))) i = (i + 1) & (capacity - 1);
+    return i;
+}
+
+// first_link() tells whether an inode is seen for the first time
+static bool first_link(du_job_t *job, struct stat *st) {
+    pthread_mutex_lock(&job->lock);
+    if (2 * (job->inode_count + 1) > job->inode_capacity) {
+        size_t capacity = job->inode_capacity ? job->inode_capacity * 2 : 1024;
+        du_inode_t *set = calloc(capacity, sizeof(*set));
+        if (!set) {
+            pthread_mutex_unlock(&job->lock);
+            __atomic_store_n(&job->error, ENOMEM, __ATOMIC_RELAXED);
+            return true;
+        }
+        for (size_t i = 0; i < job->inode_capacity; i++) {
+            du_inode_t *n = &job->inodes[i];
+            if (n->ino || n->dev)
+                set[inode_slot(set, capacity, n->dev, n->ino)] = *n;
+        }
+        free(job->inodes);
+        job->inodes = set;
+        job->inode_capacity = capacity;
+    }
+    size_t i = inode_slot(job->inodes, job->inode_capacity, st->st_dev,
+        st->st_ino);
+    bool first = !job->inodes[i].ino && !job->inodes[i].dev;
+    if (first) {
+        job->inodes[i] = (du_inode_t){ st->st_dev, st->st_ino };
+        job->inode_count++;
+    }
+    pthread_mutex_unlock(&job->lock);
+    return first;
+}
+
+static void du_entry(const sct_walk_entry_t *e, int worker, void *ctx) {
+    du_job_t *job = ctx;
+    if (e->error) {
+        fprintf(stderr, "du: cannot read '%s': %s\n", e->path,
+            strerror(e->error));
+        __atomic_store_n(&job->error, e->error, __ATOMIC_RELAXED);
+        return;
+    }
+    if ((e->st->st_nlink > 1) && !S_ISDIR(e->st->st_mode)
+        && !first_link(job, e->st)) return;
+    job->blocks[worker * job->count + e->root] += e->st->st_blocks;
+}
+
+int sct_du(char **paths, int count) {
+    char *dot = ".";
+    if (!count) {
+        paths = &dot;
+        count = 1;
+    }
+    int workers = sct_pool_default_workers();
+    du_job_t job = { .count = count,
+        .blocks = calloc((size_t)workers * count, sizeof(uint64_t)) };
+    pthread_mutex_init(&job.lock, NULL);
+    if (!job.blocks || !sct_walk(paths, count, SCT_WALK_STAT, workers,
+        du_entry, &job)) job.error = ENOMEM;
+    if (job.error == ENOMEM) fprintf(stderr, "du: %s\n", strerror(ENOMEM));
+    for (int i = 0; job.blocks && (i < count); i++) {
+        uint64_t blocks = 0;
+        for (int w = 0; w < workers; w++) blocks += job.blocks[w * count + i];
+        printf("%llu\t%s\n", (unsigned long long)(blocks + 1) / 2, paths[i]);
+    }
+    pthread_mutex_destroy(&job.lock);
+    free(job.inodes);
+    free(job.blocks);
+    return job.error ? 1 : 0;
+}
+#pragma endregion
+
+#pragma region dupes
+//------------------------------------------------------------------------------
+//              dupes
+
+// Files are told apart in stages, each only for those still alike: by
+// size, by a hash of their first and last SCT_DUPES_EDGE bytes, then by
+// their sum (sct_sum.h), which reads them whole.
+#define SCT_DUPES_EDGE 4096
+#define SCT_DUPES_BATCH 256     // files open at once to sum them
+
+typedef struct dupe_file_ {
+    char *path;
+    off_t size;
+    dev_t dev;
+    ino_t ino;
+    uint64_t hash;          // of the edges, then of the whole file
+    int error;
+} dupe_file_t;
+
+typedef struct dupe_list_ {
+    dupe_file_t *files;
+    size_t count;
+    size_t capacity;
+    bool failed;            // out of memory
+    bool unreadable;        // a directory or file could not be read
+} dupe_list_t;
+
+static void dupes_entry(const sct_walk_entry_t *e, int worker, void *ctx) {
+    dupe_list_t *l = &((dupe_list_t *)ctx)[worker];
+    if (e->error) {
+        fprintf(stderr, "dupes: cannot read '%s': %s\n", e->path,
+            strerror(e->error));
+        l->unreadable = true;
+        return;
+    }
+    if ((e->type != DT_REG) || !e->st->st_size) return;
+    if (l->count == l->capacity) {
+        size_t capacity = l->capacity ? l->capacity * 2 : 256;
+        dupe_file_t *files = realloc(l->files, capacity * sizeof(*files));
+        if (!files) {
+            l->failed = true;
+            return;
+        }
+        l->files = files;
+        l->capacity = capacity;
+    }
+    dupe_file_t *f = &l->files[l->count];
+    *f = (dupe_file_t){ scu_strdup(e->path), e->st->st_size, e->st->st_dev,
+        e->st->st_ino, 0, 0 };
+    if (f->path) l->count++;
+    else l->failed = true;
+}
+
+// by size, then inode, links to an inode ordered by path
+static int cmp_inodes(const void *a, const void *b) {
+    const dupe_file_t *x = a, *y = b;
+    if (x->size != y->size) return x->size < y->size ? -1 : 1;
+    if (x->dev != y->dev) return x->dev < y->dev ? -1 : 1;
+    if (x->ino != y->ino) return x->ino < y->ino ? -1 : 1;
+    return strcmp(x->path, y->path);
+}
+
+static int cmp_hashes(const void *a, const void *b) {
+    const dupe_file_t *x = *(dupe_file_t **)a, *y = *(dupe_file_t **)b;
+    if (x->size != y->size) return x->size < y->size ? -1 : 1;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return strcmp(x->path, y->path);
+}
+
+static bool same_hash(dupe_file_t *x, dupe_file_t *y) {
+    return (x->size == y->size) && (x->hash == y->hash);
+}
+
+static void edges_task(sct_pool_t *pool, void *task, int worker, void *ctx) {
+    dupe_file_t *f = task;
+    char buffer[2 * SCT_DUPES_EDGE];
+    int fd = open(f->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        f->error = errno;
+        return;
+    }
+    size_t head = f->size < SCT_DUPES_EDGE ? f->size : SCT_DUPES_EDGE;
+    size_t tail = f->size - head < SCT_DUPES_EDGE ? f->size - head
+        : SCT_DUPES_EDGE;
+    ssize_t n = pread(fd, buffer, head, 0);
+    ssize_t m = tail ? pread(fd, buffer + head, tail, f->size - tail) : 0;
+    if ((n < 0) || (m < 0)) f->error = errno;
+    else if (((size_t)n < head) || ((size_t)m < tail)) f->error = EAGAIN;
+    else f->hash = sct_xxh3(buffer, head + tail);
+    close(fd);
+}
+
+// keep_alike() drops the files with errors, then those with no other of
+// the same size and hash, from a list sorted so
+static size_t keep_alike(dupe_file_t **list, size_t count) {
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++)
+        if (!list[i]->error) list[n++] = list[i];
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ) {
+        size_t j = i + 1;
+        while ((j < n) && same_hash(list[i], list[j])) j++;
+        for (size_t k = i; (j - i > 1) && (k < j); k++) list[kept++] = list[k];
+        i = j;
+    }
+    return kept;
+}
+
+// sum_whole() sets the hash of every file larger than its edges to its sum
+static bool sum_whole(dupe_file_t **list, size_t count) {
+    char *paths[SCT_DUPES_BATCH];
+    dupe_file_t *files[SCT_DUPES_BATCH];
+    uint64_t sums[SCT_DUPES_BATCH];
+    int errors[SCT_DUPES_BATCH];
+    size_t n = 0;
+    for (size_t i = 0; i <= count; i++) {
+        if ((i < count) && (list[i]->size > 2 * SCT_DUPES_EDGE)) {
+            files[n] = list[i];
+            paths[n++] = list[i]->path;
+        }
+        if (!n || ((n < SCT_DUPES_BATCH) && (i < count))) continue;
+        if (!sct_sum_files(paths, n, SCT_SUM_XXH3, (uint8_t *)sums, errors))
+            return false;
+        for (size_t k = 0; k < n; k++) {
+            files[k]->hash = sums[k];
+            files[k]->error = errors[k] == SCT_SUM_CHANGED ? EAGAIN
+                : errors[k];
+        }
+        n = 0;
+    }
+    return true;
+}
+
+static int cmp_groups(const void *a, const void *b) {
+    const dupe_file_t *x = *(dupe_file_t **)a, *y = *(dupe_file_t **)b;
+    if (x->size != y->size) return x->size > y->size ? -1 : 1;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return strcmp(x->path, y->path);
+}
+
+static void print_groups(dupe_file_t **list, size_t count) {
+    // the largest first, as they waste the most
+    qsort(list, count, sizeof(*list), cmp_groups);
+    for (size_t i = 0; i < count; i++) {
+        printf("%s\n", list[i]->path);
+        if ((i + 1 == count) || !same_hash(list[i], list[i + 1]))
+            printf("\n");
+    }
+    fflush(stdout);
+}
+
+int sct_dupes(char *dir) {
+    int workers = sct_pool_default_workers();
+    dupe_list_t *lists = calloc(workers, sizeof(*lists));
+    bool succeeded = lists
+        && sct_walk(&dir, 1, SCT_WALK_STAT, workers, dupes_entry, lists);
+    size_t total = 0;
+    bool unreadable = false;
+    for (int w = 0; lists && (w < workers); w++) {
+        total += lists[w].count;
+        if (lists[w].failed) succeeded = false;
+        unreadable |= lists[w].unreadable;
+    }
+    dupe_file_t *files = succeeded ? malloc((total ? total : 1)
+        * sizeof(*files)) : NULL;
+    dupe_file_t **list = files ? malloc((total ? total : 1)
+        * sizeof(*list)) : NULL;
+    succeeded = succeeded && list;
+    size_t count = 0;
+    for (int w = 0; lists && (w < workers); w++) {
+        if (succeeded)
+            memcpy(files + count, lists[w].files,
+                lists[w].count * sizeof(*files));
+        else for (size_t i = 0; i < lists[w].count; i++)
+            free(lists[w].files[i].path);
+        count += lists[w].count;
+        free(lists[w].files);
+    }
+    free(lists);
+    if (!succeeded) count = 0;
+
+    // one file of each inode, the others being links to it; then sizes
+    qsort(files, count, sizeof(*files), cmp_inodes);
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        bool link = (n > 0) && (list[n - 1]->dev == files[i].dev)
+            && (list[n - 1]->ino == files[i].ino);
+        if (!link) list[n++] = &files[i];
+    }
+    n = keep_alike(list, n);
+
+    // the edges of files of the same size, in parallel
+    if (n && !sct_pool_run("dupes", workers, edges_task, NULL,
+        (void **)list, n)) succeeded = false;
+    qsort(list, n, sizeof(*list), cmp_hashes);
+    n = keep_alike(list, n);
+    // files no larger than their edges are hashed whole already
+    if (succeeded && !sum_whole(list, n)) succeeded = false;
+    qsort(list, n, sizeof(*list), cmp_hashes);
+    n = keep_alike(list, n);
+    if (succeeded) print_groups(list, n);
+
+    // the groups found are printed even if some files could not be read
+    int retval = succeeded && !unreadable ? 0 : 1;
+    if (!succeeded) fprintf(stderr, "dupes: %s\n", strerror(ENOMEM));
+    for (size_t i = 0; i < count; i++) {
+        if (files[i].error) {
+            fprintf(stderr, "dupes: %s: %s\n", files[i].path,
+                files[i].error == EAGAIN ? "file changed while read"
+                : strerror(files[i].error));
+            retval = 1;
+        }
+        free(files[i].path);
+    }
+    free(list);
+    free(files);
+    return retval;
+}
+#pragma endregion
@@ -0,0 +1,383 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "sct_glob.h"
+#include "sct_pool.h"
+#include "sct_utils.h"
+
+/*
+    Native glob expansion of command arguments.
+    A pattern is split into '/' separated components. Literal components
+    are appended to the path without reading any directory; a component
+    with wildcards reads one directory; '**' reads a whole subtree,
+    without following symbolic links. Every directory to read is a task
+    of a worker pool job, so subtrees are read in parallel.
+    The kind of a matched entry comes from readdir()'s d_type, a stat()
+    is done only when the file system does not report it or for
+    a symbolic link.
+    Every worker collects matches into its own array; the arrays are
+    merged and sorted when the job is done.
+*/
+
+typedef struct glob_task_ {
+    int component;      // index of the component to match next
+    char path[];        // matched so far, "" or ending with '/'
+} glob_task_t;
+
+typedef struct glob_results_ {
+    char **paths;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} glob_results_t;
+
+typedef struct glob_job_ {
+    char **components;
+    int component_count;
+    int kinds;
+    glob_results_t *results;    // one per worker
+} glob_job_t;
+
+#pragma region matching
+//------------------------------------------------------------------------------
+//              matching
+
+bool sct_glob_has_magic(char *s) {
+    return strpbrk(s, "*?[") != NULL;
+}
+
+// match_class() matches c against a '[...]' class at p, returning
+// the length of the class, or 0 if it is not terminated
+static size_t match_class(char *p, char c, bool *matched) {
+    char *q = p + 1;
+    bool negate = (*q == '!') || (*q == '^');
+    if (negate) q++;
+    *matched = false;
+    // ']' right after the opening bracket is a member
+    bool first = true;
+    while (*q && ((*q != ']') || first)) {
+        char lo = *q;
+        char hi = lo;
+        if ((q[1] == '-') && q[2] && (q[2] != ']')) {
+            hi = q[2];
+            q += 2;
+        }
+        if ((c >= lo) && (c <= hi)) *matched = true;
+        q++;
+        first = false;
+    }
+    if (*q != ']') return 0;
+    if (negate) *matched = !*matched;
+    return q - p + 1;
+}
+
+bool sct_glob_match(char *pattern, char *name) {
+    if ((*name == '.') && (*pattern != '.')) return false;
+    char *p = pattern;
+    char *s = name;
+    char *star_p = NULL;    // pattern past the last '*'
+    char *star_s = NULL;    // name position that '*' is tried to end at
+    while (*s) {
+        size_t len = 0;
+        bool matched = false;
+        switch (*p)
+        {
+            case '*':
+            {
+                star_p = ++p;
+                star_s = s;
+                continue;
+            }
+            case '?':
+            {
+                matched = true;
+                len = 1;
+                break;
+            }
+            case '[':
+            {
+                len = match_class(p, *s, &matched);
+                if (len) break;
+                // not terminated: a literal '['
+                len = 1;
+                matched = *s == '[';
+                break;
+            }
+            default:
+            {
+                len = 1;
+                matched = *p && (*p == *s);
+                break;
+            }
+        }
+        if (matched) {
+            p += len;
+            s++;
+        }
+        else if (star_p) {
+            // let the last '*' take one more char
+            p = star_p;
+            s = ++star_s;
+        }
+        else return false;
+    }
+    while (*p == '*') p++;
+    return *p == 0;
+}
+#pragma endregion
+
+#pragma region directory reading
+//------------------------------------------------------------------------------
+//              directory reading
+
+static glob_task_t *new_task(char *path, char *name, int component) {
+    size_t path_len = strlen(path);
+    size_t name_len = name ? strlen(name) : 0;
+    glob_task_t *task = malloc(sizeof(*task) + path_len + name_len + 2);
+    if (!task) return NULL;
+    task->component = component;
+    memcpy(task->path, path, path_len);
+    if (name) {
+        memcpy(task->path + path_len, name, name_len);
+        task->path[path_len + name_len] = '/';
+        path_len += name_len + 1;
+    }
+    task->path[path_len] = 0;
+    return task;
+}
+
+static void add_result(glob_results_t *r, char *path, char *name) {
+    if (r->count == r->capacity) {
+        size_t capacity = r->capacity ? r->capacity * 2 : 64;
+        char **paths = realloc(r->paths, capacity * sizeof(*paths));
+        if (!paths) {
+            r->failed = true;
+            return;
+        }
+        r->paths = paths;
+        r->capacity = capacity;
+    }
+    char *s = scu_sprintf("%s%s", path, name);
+    if (s) r->paths[r->count++] = s;
+    else r->failed = true;
+}
+
+static void push_task(sct_pool_t *pool, glob_results_t *r, char *path,
+    char *name, int component)
+{
+    glob_task_t *task = new_task(path, name, component);
+    if (task) sct_pool_push(pool, task);
+    else r->failed = true;
+}
+
+// entry_kind() returns SCT_GLOB_DIRS or SCT_GLOB_FILES for an entry,
+// following symbolic links, or 0 if it is gone
+static int entry_kind(char *path, char *name, unsigned char d_type) {
+    if ((d_type != DT_UNKNOWN) && (d_type != DT_LNK))
+        return d_type == DT_DIR ? SCT_GLOB_DIRS : SCT_GLOB_FILES;
+    char *fn = scu_sprintf("%s%s", *path ? path : "./", name);
+    struct stat finfo;
+    int kind = 0;
+    if (fn && (stat(fn, &finfo) == 0))
+        kind = S_ISDIR(finfo.st_mode) ? SCT_GLOB_DIRS : SCT_GLOB_FILES;
+    free(fn);
+    return kind;
+}
+
+// is_real_dir() tells whether '**' may descend into an entry
+static bool is_real_dir(char *path, char *name, unsigned char d_type) {
+    if (d_type != DT_UNKNOWN) return d_type == DT_DIR;
+    char *fn = scu_sprintf("%s%s", *path ? path : "./", name);
+    struct stat finfo;
+    bool result = fn && (lstat(fn, &finfo) == 0) && S_ISDIR(finfo.st_mode);
+    free(fn);
+    return result;
+}
+
+// a literal component just extends the path, as long as it exists
+static void expand_literal(sct_pool_t *pool, glob_job_t *job,
+    glob_results_t *r, glob_task_t *task)
+{
+    char *name = job->components[task->component];
+    char *fn = scu_sprintf("%s%s", task->path, name);
+    struct stat finfo;
+    if (!fn || (stat(fn, &finfo) != 0)) {
+        free(fn);
+        return;
+    }
+    free(fn);
+    int kind = S_ISDIR(finfo.st_mode) ? SCT_GLOB_DIRS : SCT_GLOB_FILES;
+    if (task->component == job->component_count - 1) {
+        if (kind & job->kinds) add_result(r, task->path, name);
+    }
+    else if (kind == SCT_GLOB_DIRS)
+        push_task(pool, r, task->path, name, task->component + 1);
+}
+
+static void expand_dir(sct_pool_t *pool, glob_job_t *job, glob_results_t *r,
+    glob_task_t *task)
+{
+    char *pattern = job->components[task->component];
+    bool globstar = strcmp(pattern, "**") == 0;
+    bool last = task->component == job->component_count - 1;
+    // '**' followed by more components matches no directories, too
+    if (globstar && !last)
+        push_task(pool, r, task->path, NULL, task->component + 1);
+
+    DIR *dir = opendir(*task->path ? task->path : ".");
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        char *name = entry->d_name;
+        if ((strcmp(name, ".") == 0) || (strcmp(name, "..") == 0)) continue;
+        if (globstar) {
+            if (*name == '.') continue;
+            if (last) {
+                int kind = entry_kind(task->path, name, entry->d_type);
+                if (kind & job->kinds) add_result(r, task->path, name);
+            }
+            if (is_real_dir(task->path, name, entry->d_type))
+                push_task(pool, r, task->path, name, task->component);
+        }
+        else if (sct_glob_match(pattern, name)) {
+            int kind = entry_kind(task->path, name, entry->d_type);
+            if (last) {
+                if (kind & job->kinds) add_result(r, task->path, name);
+            }
+            else if (kind == SCT_GLOB_DIRS)
+                push_task(pool, r, task->path, name, task->component + 1);
+        }
+    }
+    closedir(dir);
+}
+
+static void glob_task(sct_pool_t *pool, void *p, int worker, void *ctx) {
+    glob_job_t *job = ctx;
+    glob_task_t *task = p;
+    glob_results_t *r = &job->results[worker];
+    char *component = job->components[task->component];
+    if (sct_glob_has_magic(component)) expand_dir(pool, job, r, task);
+    else expand_literal(pool, job, r, task);
+    free(task);
+}
+#pragma endregion
+
+#pragma region public glob routines
+//------------------------------------------------------------------------------
+//              public glob routines
+
+static int cmp_paths(const void *a, const void *b) {
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+// split_components() splits a copy of pattern at '/', dropping empty
+// components; a leading '/' goes to *root
+static char **split_components(char *pattern, char **copy, int *count,
+    bool *root)
+{
+    *copy = scu_strdup(pattern);
+    char **components = malloc((strlen(pattern) / 2 + 1) * sizeof(char *));
+    if (!*copy || !components) {
+        free(*copy);
+        free(components);
+        return NULL;
+    }
+    *root = *pattern == '/';
+    *count = 0;
+    char *save = NULL;
+    for (char *c = strtok_r(*copy, "/", &save); c;
+        c = strtok_r(NULL, "/", &save)) components[(*count)++] = c;
+    return components;
+}
+
+bool sct_glob(char *pattern, int kinds, char ***paths, size_t *count) {
+    *paths = NULL;
+    *count = 0;
+    char *copy;
+    bool root;
+    glob_job_t job = { NULL, 0, kinds, NULL };
+    job.components = split_components(pattern, &copy, &job.component_count,
+        &root);
+    if (!job.components) return false;
+    // a trailing '/' asks for directories
+    if (pattern[strlen(pattern) - 1] == '/') job.kinds &= SCT_GLOB_DIRS;
+
+    int workers = sct_pool_default_workers();
+    job.results = calloc(workers, sizeof(*job.results));
+    glob_task_t *task = new_task(root ? "/" : "", NULL, 0);
+    bool result = job.results && task;
+    if (result && job.component_count && job.kinds) {
+        result = sct_pool_run("glob", workers, glob_task, &job,
+            (void **)&task, 1);
+        task = NULL;
+    }
+    free(task);
+
+    // merge the workers' results
+    size_t total = 0;
+    for (int i = 0; job.results && (i < workers); i++) {
+        total += job.results[i].count;
+        if (job.results[i].failed) result = false;
+    }
+    char **merged = result && total ? malloc(total * sizeof(char *)) : NULL;
+    if (total && !merged) result = false;
+    for (int i = 0; job.results && (i < workers); i++) {
+        glob_results_t *r = &job.results[i];
+        for (size_t j = 0; j < r->count; j++) {
+            if (merged) merged[(*count)++] = r->paths[j];
+            else free(r->paths[j]);
+        }
+        free(r->paths);
+    }
+    free(job.results);
+    free(job.components);
+    free(copy);
+    if (!result) {
+        sct_glob_free(merged, *count);
+        *count = 0;
+        return false;
+    }
+
+    // several '**' may reach a path more than once
+    qsort(merged, *count, sizeof(char *), cmp_paths);
+    size_t unique = 0;
+    for (size_t i = 0; i < *count; i++) {
+        if (unique && (strcmp(merged[unique - 1], merged[i]) == 0))
+            free(merged[i]);
+        else merged[unique++] = merged[i];
+    }
+    *count = unique;
+    *paths = merged;
+    return true;
+}
+
+void sct_glob_free(char **paths, size_t count) {
+    if (!paths) return;
+    for (size_t i = 0; i < count; i++) free(paths[i]);
+    free(paths);
+}
+#pragma endregion
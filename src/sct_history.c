@@ -0,0 +1,541 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <readline/readline.h>
+#include "sct_history.h"
+#include "sct_utils.h"
+
+/*
+    Persistent command history.
+    Three append-only files, all accessed through mmap:
+      fn      - the history itself, one command line per line, so it stays
+                readable and editable with any tool;
+      fn.idx  - u64 offset of every entry in fn, so entry i is found
+                without reading the entries before it;
+      fn.tri  - trigram index for reverse search: a header with entry
+                count, committed text size and a table of hash buckets,
+                followed by chunks of entry ids. Each bucket is a list of
+                chunks linked from the newest one, ids ascending within
+                a chunk, so walking a bucket yields entries newest first.
+    Opening maps the files and checks the header against the file sizes,
+    so startup costs the same for ten entries or ten million. A query
+    of three or more characters is looked up in the bucket of its rarest
+    trigram and every candidate is verified; shorter queries scan back
+    from the newest entry. Appends are serialized by flock() on fn, so
+    several sctest instances may share one history.
+*/
+
+#define SCT_HISTORY_MAGIC 0x53435448u       // "SCTH"
+#define SCT_HISTORY_VERSION 1
+#define SCT_HISTORY_BUCKETS 65536           // a power of 2
+#define SCT_HISTORY_CHUNK_IDS 14
+#define SCT_HISTORY_TRI_GROW (1u << 20)
+#define SCT_HISTORY_MAX_LINE 4096
+#define SCT_HISTORY_MAX_QUERY 255
+
+typedef struct tri_bucket_ {
+    uint64_t head;      // offset of the newest chunk, 0 if none
+    uint64_t count;     // ids in the bucket
+} tri_bucket_t;
+
+typedef struct tri_header_ {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entry_count;
+    uint64_t text_size;     // bytes of fn covered by the indexes
+    uint64_t used;          // bytes of fn.tri in use
+    tri_bucket_t buckets[SCT_HISTORY_BUCKETS];
+} tri_header_t;
+
+typedef struct tri_chunk_ {
+    uint64_t prev;          // offset of the previous chunk, 0 if none
+    uint32_t count;
+    uint32_t ids[SCT_HISTORY_CHUNK_IDS];
+} tri_chunk_t;
+
+typedef struct mapping_ {
+    int fd;
+    char *base;
+    size_t len;
+    int prot;
+} mapping_t;
+
+typedef struct history_ {
+    bool open;
+    mapping_t text;
+    mapping_t idx;
+    mapping_t tri;
+    // Up/Down navigation: the entry shown, or -1 while editing a new line
+    int64_t nav;
+    char *nav_saved_line;
+} history_t;
+
+static history_t g_history = { false };
+
+#pragma region mappings
+//------------------------------------------------------------------------------
+//              mappings
+
+// makes at least len bytes of m's file accessible at m->base; mapped
+// length is rounded up, only the file's existing bytes are ever touched
+static bool ensure_mapped(mapping_t *m, size_t len) {
+    if (len <= m->len) return true;
+    size_t new_len = (len + len / 2 + 4095) & ~(size_t)4095;
+    if (m->base) munmap(m->base, m->len);
+    m->base = mmap(NULL, new_len, m->prot, MAP_SHARED, m->fd, 0);
+    if (m->base == MAP_FAILED) {
+        m->base = NULL;
+        m->len = 0;
+        return false;
+    }
+    m->len = new_len;
+    return true;
+}
+
+static void unmap(mapping_t *m) {
+    if (m->base) munmap(m->base, m->len);
+    if (m->fd != -1) close(m->fd);
+    m->base = NULL;
+    m->len = 0;
+    m->fd = -1;
+}
+
+static bool open_mapping(mapping_t *m, char *fn, int prot) {
+    m->fd = open(fn, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    m->base = NULL;
+    m->len = 0;
+    m->prot = prot;
+    if (m->fd == -1) perror(fn);
+    return m->fd != -1;
+}
+
+static off_t file_size(mapping_t *m) {
+    struct stat st;
+    return fstat(m->fd, &st) == 0 ? st.st_size : 0;
+}
+
+static tri_header_t *header(void) {
+    return (tri_header_t *)g_history.tri.base;
+}
+
+// a chunk of fn.tri, mapped
+static tri_chunk_t *chunk_at(uint64_t offset) {
+    if (!ensure_mapped(&g_history.tri, offset + sizeof(tri_chunk_t)))
+        return NULL;
+    return (tri_chunk_t *)(g_history.tri.base + offset);
+}
+#pragma endregion
+
+#pragma region trigram index
+//------------------------------------------------------------------------------
+//              trigram index
+
+static unsigned trigram_bucket(const char *p) {
+    uint32_t t = ((uint32_t)(unsigned char)p[0] << 16)
+        | ((uint32_t)(unsigned char)p[1] << 8) | (unsigned char)p[2];
+    return (t * 2654435761u) >> 16 & (SCT_HISTORY_BUCKETS - 1);
+}
+
+static uint64_t new_chunk(uint64_t prev) {
+    tri_header_t *h = header();
+    uint64_t offset = h->used;
+    uint64_t needed = offset + sizeof(tri_chunk_t);
+    if (needed > (uint64_t)file_size(&g_history.tri)) {
+        if (ftruncate(g_history.tri.fd, needed + SCT_HISTORY_TRI_GROW) == -1)
+            return 0;
+    }
+    tri_chunk_t *c = chunk_at(offset);
+    if (!c) return 0;
+    c->prev = prev;
+    c->count = 0;
+    header()->used = needed;    // the mapping may have moved
+    return offset;
+}
+
+static void index_entry(uint32_t id, const char *s, size_t len) {
+    // chunk_at() may move the mapping, so buckets are addressed by index
+    for (size_t i = 0; i + 3 <= len; i++) {
+        unsigned bucket = trigram_bucket(s + i);
+        uint64_t head = header()->buckets[bucket].head;
+        tri_chunk_t *c = head ? chunk_at(head) : NULL;
+        // an entry is listed once per bucket
+        if (c && c->count && (c->ids[c->count - 1] == id)) continue;
+        if (!c || (c->count == SCT_HISTORY_CHUNK_IDS)) {
+            head = new_chunk(head);
+            if (!head) return;
+            header()->buckets[bucket].head = head;
+            c = chunk_at(head);
+        }
+        c->ids[c->count++] = id;
+        header()->buckets[bucket].count++;
+    }
+}
+
+static bool init_tri_file(void) {
+    if ((ftruncate(g_history.tri.fd, 0) == -1)
+        || (ftruncate(g_history.tri.fd, sizeof(tri_header_t)
+            + SCT_HISTORY_TRI_GROW) == -1)
+        || !ensure_mapped(&g_history.tri, sizeof(tri_header_t)))
+        return false;
+    tri_header_t *h = header();
+    memset(h, 0, sizeof(*h));
+    h->magic = SCT_HISTORY_MAGIC;
+    h->version = SCT_HISTORY_VERSION;
+    h->used = sizeof(*h);
+    return true;
+}
+
+// rebuild_indexes() indexes fn from scratch: the only operation whose
+// cost depends on the history size, needed when fn was changed by hand.
+// A last line left without '\n', e.g. by an editor, is ended, for the
+// indexes to cover all of fn and be valid on the next start.
+static bool rebuild_indexes(void) {
+    if ((ftruncate(g_history.idx.fd, 0) == -1) || !init_tri_file())
+        return false;
+    off_t size = file_size(&g_history.text);
+    if (size && !ensure_mapped(&g_history.text, size)) return false;
+    if (size && (g_history.text.base[size - 1] != '\n')) {
+        if (pwrite(g_history.text.fd, "\n", 1, size) != 1) return false;
+        size++;
+        if (!ensure_mapped(&g_history.text, size)) return false;
+    }
+
+    uint64_t id = 0;
+    off_t start = 0;
+    while (start < size) {
+        char *eol = memchr(g_history.text.base + start, '\n', size - start);
+        uint64_t offset = start;
+        if (pwrite(g_history.idx.fd, &offset, sizeof(offset),
+            id * sizeof(offset)) != sizeof(offset)) return false;
+        size_t len = eol - (g_history.text.base + start);
+        index_entry((uint32_t)id, g_history.text.base + start, len);
+        id++;
+        start += len + 1;
+    }
+    header()->entry_count = id;
+    header()->text_size = start;
+    return true;
+}
+
+static bool indexes_valid(void) {
+    if ((size_t)file_size(&g_history.tri) < sizeof(tri_header_t)) return false;
+    if (!ensure_mapped(&g_history.tri, sizeof(tri_header_t))) return false;
+    tri_header_t *h = header();
+    return (h->magic == SCT_HISTORY_MAGIC)
+        && (h->version == SCT_HISTORY_VERSION)
+        && (h->text_size == (uint64_t)file_size(&g_history.text))
+        && (h->entry_count * sizeof(uint64_t)
+            == (uint64_t)file_size(&g_history.idx));
+}
+#pragma endregion
+
+#pragma region entries
+//------------------------------------------------------------------------------
+//              entries
+
+int64_t sct_history_count(void) {
+    return g_history.open ? (int64_t)header()->entry_count : 0;
+}
+
+// points to entry idx in the mapped text, not NUL terminated
+static char *entry_text(int64_t idx, size_t *len) {
+    tri_header_t *h = header();
+    if ((idx < 0) || ((uint64_t)idx >= h->entry_count)) return NULL;
+    uint64_t count = h->entry_count;
+    uint64_t text_size = h->text_size;
+    size_t idx_needed = (idx + 2 <= count ? idx + 2 : idx + 1)
+        * sizeof(uint64_t);
+    if (!ensure_mapped(&g_history.idx, idx_needed)
+        || !ensure_mapped(&g_history.text, text_size)) return NULL;
+    uint64_t *offsets = (uint64_t *)g_history.idx.base;
+    uint64_t end = (uint64_t)idx + 1 < count ? offsets[idx + 1] : text_size;
+    *len = end - offsets[idx] - 1;
+    return g_history.text.base + offsets[idx];
+}
+
+bool sct_history_entry(int64_t idx, char *buf, size_t size) {
+    size_t len;
+    char *s = g_history.open ? entry_text(idx, &len) : NULL;
+    if (!s || !size) return false;
+    if (len >= size) len = size - 1;
+    memcpy(buf, s, len);
+    buf[len] = 0;
+    return true;
+}
+
+static bool entry_contains(int64_t idx, char *q, size_t qlen) {
+    size_t len;
+    char *s = entry_text(idx, &len);
+    return s && memmem(s, len, q, qlen);
+}
+
+int64_t sct_history_search(char *q, int64_t before) {
+    if (!g_history.open || !q) return -1;
+    size_t qlen = strlen(q);
+    int64_t count = sct_history_count();
+    if (before > count) before = count;
+
+    if (qlen < 3) {
+        for (int64_t i = before - 1; i >= 0; i--)
+            if (entry_contains(i, q, qlen)) return i;
+        return -1;
+    }
+
+    // candidates come from the rarest trigram of the query
+    tri_bucket_t *rarest = NULL;
+    for (size_t i = 0; i + 3 <= qlen; i++) {
+        tri_bucket_t *b = &header()->buckets[trigram_bucket(q + i)];
+        if (!rarest || (b->count < rarest->count)) rarest = b;
+    }
+    uint64_t offset = rarest->head;
+    while (offset) {
+        tri_chunk_t *c = chunk_at(offset);
+        if (!c) break;
+        for (int k = (int)c->count - 1; k >= 0; k--) {
+            int64_t id = c->ids[k];
+            if ((id < before) && entry_contains(id, q, qlen)) return id;
+        }
+        offset = c->prev;
+    }
+    return -1;
+}
+
+bool sct_history_add(char *line) {
+    if (!g_history.open) return false;
+    g_history.nav = -1;
+    size_t len = strlen(line);
+    if ((len == 0) || (len > SCT_HISTORY_MAX_LINE) || memchr(line, '\n', len))
+        return true;
+
+    flock(g_history.text.fd, LOCK_EX);
+    // another instance may have appended and grown fn.tri meanwhile
+    ensure_mapped(&g_history.tri, header()->used);
+    tri_header_t *h = header();
+    int64_t count = h->entry_count;
+    size_t last_len;
+    char *last = entry_text(count - 1, &last_len);
+    if (!last || (last_len != len) || (memcmp(last, line, len) != 0)) {
+        uint64_t offset = h->text_size;
+        // what is past the indexes was left by an append that did not
+        // commit, and would be left behind a shorter line
+        if (((uint64_t)file_size(&g_history.text) > offset)
+            && (ftruncate(g_history.text.fd, offset) == -1)) {}
+        if (((uint64_t)file_size(&g_history.idx) > count * sizeof(offset))
+            && (ftruncate(g_history.idx.fd, count * sizeof(offset)) == -1)) {}
+        char *text = scu_sprintf("%s\n", line);
+        bool written = text
+            && (pwrite(g_history.text.fd, text, len + 1, offset)
+                == (ssize_t)(len + 1))
+            && (pwrite(g_history.idx.fd, &offset, sizeof(offset),
+                count * sizeof(offset)) == sizeof(offset));
+        free(text);
+        if (written) {
+            index_entry((uint32_t)count, line, len);
+            // committed last: a crash before this leaves the indexes
+            // mismatching fn, and they are rebuilt on the next start
+            h = header();
+            h->text_size = offset + len + 1;
+            h->entry_count = count + 1;
+        }
+    }
+    flock(g_history.text.fd, LOCK_UN);
+    return true;
+}
+#pragma endregion
+
+#pragma region readline bindings
+//------------------------------------------------------------------------------
+//              readline bindings
+
+static void show_entry(int64_t idx) {
+    char buf[SCT_HISTORY_MAX_LINE + 1];
+    if (!sct_history_entry(idx, buf, sizeof(buf))) return;
+    rl_replace_line(buf, 0);
+    rl_point = rl_end;
+}
+
+static int history_prev(int count, int key) {
+    int64_t n = sct_history_count();
+    if (g_history.nav == -1) {
+        if (n == 0) {
+            rl_ding();
+            return 0;
+        }
+        free(g_history.nav_saved_line);
+        g_history.nav_saved_line = scu_strdup(rl_line_buffer);
+        g_history.nav = n;
+    }
+    if (g_history.nav == 0) {
+        rl_ding();
+        return 0;
+    }
+    show_entry(--g_history.nav);
+    return 0;
+}
+
+static int history_next(int count, int key) {
+    if (g_history.nav == -1) {
+        rl_ding();
+        return 0;
+    }
+    if (++g_history.nav < sct_history_count()) show_entry(g_history.nav);
+    else {
+        g_history.nav = -1;
+        rl_replace_line(g_history.nav_saved_line
+            ? g_history.nav_saved_line : "", 0);
+        rl_point = rl_end;
+    }
+    return 0;
+}
+
+// history_isearch() is an incremental reverse search in the persistent
+// history, modelled after readline's C-r: typing refines the query,
+// C-r finds the next older match, Enter runs the match, C-g restores
+// the line, and any other key keeps the match for editing.
+static int history_isearch(int count, int key) {
+    char query[SCT_HISTORY_MAX_QUERY + 1] = "";
+    size_t qlen = 0;
+    char *saved_line = scu_strdup(rl_line_buffer);
+    int saved_point = rl_point;
+    int64_t match = -1;
+    bool failed = false;
+
+    while (true) {
+        rl_message("(%sreverse-i-search)`%s': ", failed ? "failed " : "",
+            query);
+        int c = rl_read_key();
+        int64_t from = -1;
+        if (c == CTRL('R')) {
+            if (match >= 0) from = match;
+            else if (qlen) from = sct_history_count();
+        }
+        else if ((c == RUBOUT) || (c == CTRL('H'))) {
+            if (qlen) query[--qlen] = 0;
+            if (qlen) from = sct_history_count();
+            else {
+                match = -1;
+                failed = false;
+            }
+        }
+        else if ((c >= ' ') && (c < RUBOUT)) {
+            if (qlen < SCT_HISTORY_MAX_QUERY) {
+                query[qlen++] = (char)c;
+                query[qlen] = 0;
+            }
+            // the shown match may still contain the longer query
+            from = match >= 0 ? match + 1 : sct_history_count();
+        }
+        else {
+            rl_clear_message();
+            if (c == CTRL('G')) {
+                rl_replace_line(saved_line ? saved_line : "", 0);
+                rl_point = saved_point;
+            }
+            else if ((c == '\r') || (c == '\n')) rl_newline(1, c);
+            else rl_execute_next(c);
+            break;
+        }
+
+        if (from >= 0) {
+            int64_t m = sct_history_search(query, from);
+            failed = m < 0;
+            if (!failed) {
+                match = m;
+                show_entry(match);
+                char *hit = strstr(rl_line_buffer, query);
+                if (hit) rl_point = (int)(hit - rl_line_buffer);
+            }
+        }
+    }
+    free(saved_line);
+    return 0;
+}
+
+static void bind_keys(void) {
+    // readline binds the arrow keys when it initializes, so it goes first
+    rl_initialize();
+    rl_bind_keyseq("\033[A", history_prev);
+    rl_bind_keyseq("\033OA", history_prev);
+    rl_bind_keyseq("\033[B", history_next);
+    rl_bind_keyseq("\033OB", history_next);
+    rl_bind_key(CTRL('P'), history_prev);
+    rl_bind_key(CTRL('N'), history_next);
+    rl_bind_key(CTRL('R'), history_isearch);
+}
+#pragma endregion
+
+#pragma region public history routines
+//------------------------------------------------------------------------------
+//              public history routines
+
+char *sct_history_default_path(void) {
+    char *home = getenv("HOME");
+    return home ? scu_sprintf("%s/%s", home, SCT_HISTORY_DEFAULT_FN) : NULL;
+}
+
+bool sct_history_open(char *fn) {
+    char *idx_fn = scu_sprintf("%s.idx", fn);
+    char *tri_fn = scu_sprintf("%s.tri", fn);
+    g_history.text.fd = g_history.idx.fd = g_history.tri.fd = -1;
+    bool ok = idx_fn && tri_fn
+        && open_mapping(&g_history.text, fn, PROT_READ)
+        && open_mapping(&g_history.idx, idx_fn, PROT_READ)
+        && open_mapping(&g_history.tri, tri_fn, PROT_READ | PROT_WRITE);
+    free(idx_fn);
+    free(tri_fn);
+
+    if (ok) {
+        flock(g_history.text.fd, LOCK_EX);
+        ok = indexes_valid() || rebuild_indexes();
+        flock(g_history.text.fd, LOCK_UN);
+        if (!ok) printf("%s: can not index the history.\n", fn);
+    }
+    if (!ok) {
+        unmap(&g_history.text);
+        unmap(&g_history.idx);
+        unmap(&g_history.tri);
+        return false;
+    }
+    g_history.open = true;
+    g_history.nav = -1;
+    bind_keys();
+    return true;
+}
+
+void sct_history_close(void) {
+    if (!g_history.open) return;
+    unmap(&g_history.text);
+    unmap(&g_history.idx);
+    unmap(&g_history.tri);
+    free(g_history.nav_saved_line);
+    memset(&g_history, 0, sizeof(g_history));
+}
+#pragma endregion
@@ -0,0 +1,849 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sct_index.h"
+#include "sct_decomp.h"
+#include "sct_io.h"
+#include "sct_utils.h"
+
+/*
+    Trigram index for grep.
+    'index <dir>' writes dir/.sctindex, mapped read only when searching:
+      header    - counts, and the time the build started;
+      files     - size, mtime and name of every regular file, sorted by
+                  name, the name relative to dir;
+      trigrams  - every trigram found, sorted, with its posting list:
+                  the ids of the files having it, ascending;
+      postings  - the lists, one after another;
+      names     - NUL terminated.
+    A build walks the tree stating a directory at a time in one batch,
+    reads only files whose size or mtime changed and takes the trigrams
+    of the others from the previous index. The new index is written to
+    a temporary file renamed over the old one, so searches running meanwhile
+    keep the one they mapped.
+    grep stats its files in one batch, and here finds the index nearest above each
+    file's directory and drops the files indexed unchanged which have none
+    of the strings every match contains: a string's trigrams all have to
+    be in a file's posting lists. Files not indexed, changed since, or too
+    close in time to the build to be trusted are searched as usual.
+*/
+
+#define SCT_INDEX_MAGIC 0x49544353u         // "SCTI"
+#define SCT_INDEX_VERSION 1
+#define SCT_INDEX_TRIGRAMS (1u << 24)
+#define SCT_INDEX_RACY_NS 1000000000LL      // mtime this close to a build
+#define SCT_INDEX_DIR_BUCKETS 4096          // a power of 2
+#define SCT_INDEX_MAX_STRING 64             // longer ones are not looked up
+
+typedef struct index_header_ {
+    uint32_t magic;
+    uint32_t version;
+    int64_t built_ns;       // when the walk started
+    uint64_t file_count;
+    uint64_t trigram_count;
+    uint64_t posting_count;
+    uint64_t names_size;
+} index_header_t;
+
+typedef struct index_file_ {
+    uint64_t size;
+    int64_t mtime_ns;
+    uint64_t name;          // offset in names
+} index_file_t;
+
+typedef struct index_trigram_ {
+    uint32_t trigram;
+    uint32_t count;         // of the files having it
+    uint64_t first;         // of its postings
+} index_trigram_t;
+
+typedef struct index_map_ {
+    struct index_map_ *next;
+    char *root;             // absolute
+    char *base;
+    size_t len;
+    index_header_t *header;
+    index_file_t *files;
+    index_trigram_t *trigrams;
+    uint32_t *postings;
+    char *names;
+    bool *candidates;       // files which may match, per search
+} index_map_t;
+
+#pragma region index file
+//------------------------------------------------------------------------------
+//              index file
+
+static int64_t mtime_ns(struct stat *st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static void unmap_index(index_map_t *m) {
+    if (!m) return;
+    if (m->base) munmap(m->base, m->len);
+    free(m->candidates);
+    free(m->root);
+    free(m);
+}
+
+// map_index() maps the index of root, NULL if there is none or it is
+// damaged
+static index_map_t *map_index(char *root) {
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", root, SCT_INDEX_NAME)
+        >= (int)sizeof(path)) return NULL;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return NULL;
+    struct stat st;
+    index_map_t *m = calloc(1, sizeof(*m));
+    if (m && (fstat(fd, &st) == 0)
+        && ((size_t)st.st_size >= sizeof(index_header_t))) {
+        m->base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (m->base == MAP_FAILED) m->base = NULL;
+        else m->len = st.st_size;
+    }
+    close(fd);
+    if (!m || !m->base) {
+        unmap_index(m);
+        return NULL;
+    }
+    index_header_t *h = (index_header_t *)m->base;
+    // the counts are bounded before they are added up
+    if ((h->file_count > m->len) || (h->trigram_count > m->len)
+        || (h->posting_count > m->len) || (h->names_size > m->len)) {
+        unmap_index(m);
+        return NULL;
+    }
+    uint64_t size = sizeof(*h) + h->file_count * sizeof(index_file_t)
+        + h->trigram_count * sizeof(index_trigram_t)
+        + h->posting_count * sizeof(uint32_t) + h->names_size;
+    if ((h->magic != SCT_INDEX_MAGIC) || (h->version != SCT_INDEX_VERSION)
+        || (h->file_count > UINT32_MAX) || (size != m->len)) {
+        unmap_index(m);
+        return NULL;
+    }
+    m->header = h;
+    m->files = (index_file_t *)(h + 1);
+    m->trigrams = (index_trigram_t *)(m->files + h->file_count);
+    m->postings = (uint32_t *)(m->trigrams + h->trigram_count);
+    m->names = (char *)(m->postings + h->posting_count);
+    // entries are checked as they are used, so that a search touches
+    // only the pages it needs
+    if (h->names_size && m->names[h->names_size - 1]) {
+        unmap_index(m);
+        return NULL;
+    }
+    m->root = scu_strdup(root);
+    if (!m->root) {
+        unmap_index(m);
+        return NULL;
+    }
+    return m;
+}
+
+// the id of the file named name, or -1
+static int64_t find_file(index_map_t *m, const char *name) {
+    int64_t lo = 0;
+    int64_t hi = (int64_t)m->header->file_count - 1;
+    while (lo <= hi) {
+        int64_t mid = (lo + hi) / 2;
+        if (m->files[mid].name >= m->header->names_size) return -1;
+        int c = strcmp(m->names + m->files[mid].name, name);
+        if (c == 0) return mid;
+        if (c < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+// the postings of a trigram lie within the index
+static bool postings_valid(index_map_t *m, index_trigram_t *t) {
+    uint64_t postings = m->header->posting_count;
+    return (t->first <= postings) && (t->count <= postings - t->first);
+}
+
+static index_trigram_t *find_trigram(index_map_t *m, uint32_t trigram) {
+    index_trigram_t *t = m->trigrams;
+    size_t lo = 0;
+    size_t hi = m->header->trigram_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (t[mid].trigram < trigram) lo = mid + 1;
+        else hi = mid;
+    }
+    if ((lo == m->header->trigram_count) || (t[lo].trigram != trigram))
+        return NULL;
+    return postings_valid(m, &t[lo]) ? &t[lo] : NULL;
+}
+
+// an index entry describes the file as it is only if neither changed
+// since, nor could have changed unnoticed within the same mtime
+static bool entry_trusted(index_map_t *m, int64_t id, uint64_t size,
+    int64_t mtime)
+{
+    index_file_t *f = &m->files[id];
+    return (f->size == size) && (f->mtime_ns == mtime)
+        && (f->mtime_ns + SCT_INDEX_RACY_NS < m->header->built_ns);
+}
+#pragma endregion
+
+#pragma region build
+//------------------------------------------------------------------------------
+//              build
+
+typedef struct build_file_ {
+    char *name;             // relative to the root
+    uint64_t size;
+    int64_t mtime_ns;
+    uint32_t *trigrams;     // sorted
+    size_t count;
+    bool read;              // to be read, not taken from the old index
+    bool failed;            // unreadable or compressed: left out of the
+                            // index, grep reading it whatever the pattern
+} build_file_t;
+
+typedef struct build_ {
+    char *root;
+    build_file_t *files;
+    size_t count;
+    size_t capacity;
+    // trigrams of the file being read
+    uint64_t *bits;
+    uint32_t *list;
+    size_t list_count;
+    size_t list_capacity;
+    uint32_t last;          // the last two bytes read
+    int seen;               // bytes of the file read, up to 2
+} build_t;
+
+static bool add_file(build_t *b, char *dir, char *name, struct stat *st) {
+    if (b->count == b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 1024;
+        build_file_t *p = realloc(b->files, capacity * sizeof(*p));
+        if (!p) return false;
+        b->files = p;
+        b->capacity = capacity;
+    }
+    build_file_t *f = &b->files[b->count];
+    memset(f, 0, sizeof(*f));
+    if (asprintf(&f->name, "%s%s%s", dir, *dir ? "/" : "", name) == -1)
+        return false;
+    f->size = st->st_size;
+    f->mtime_ns = mtime_ns(st);
+    b->count++;
+    return true;
+}
+
+// walk_dir() adds the regular files of a directory, relative to the
+// root, stating all entries at once; subdirectories go on the stack.
+// Names starting with '.' are skipped, the index itself among them.
+static bool walk_dir(build_t *b, char *dir, char ***stack, size_t *depth,
+    size_t *stack_capacity)
+{
+    int fd = openat(AT_FDCWD, b->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if ((fd != -1) && *dir) {
+        int sub = openat(fd, dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        close(fd);
+        fd = sub;
+    }
+    DIR *d = fd != -1 ? fdopendir(fd) : NULL;
+    if (!d) {
+        fprintf(stderr, "index: %s/%s: %s\n", b->root, dir, strerror(errno));
+        if (fd != -1) close(fd);
+        return true;
+    }
+    char **names = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    bool succeeded = true;
+    struct dirent *entry;
+    while ((entry = readdir(d))) {
+        if (entry->d_name[0] == '.') continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char **p = realloc(names, capacity * sizeof(*p));
+            if (!p) {
+                succeeded = false;
+                break;
+            }
+            names = p;
+        }
+        if (!(names[count] = scu_strdup(entry->d_name))) {
+            succeeded = false;
+            break;
+        }
+        count++;
+    }
+    struct stat *st = malloc((count ? count : 1) * sizeof(*st));
+    int *errors = malloc((count ? count : 1) * sizeof(*errors));
+    if (!st || !errors) succeeded = false;
+    if (succeeded) sct_io_stat_batch(dirfd(d), names, count, false, st, errors);
+    for (size_t i = 0; succeeded && (i < count); i++) {
+        if (errors[i]) continue;    // removed since readdir()
+        if (S_ISREG(st[i].st_mode))
+            succeeded = add_file(b, dir, names[i], &st[i]);
+        else if (S_ISDIR(st[i].st_mode)) {
+            if (*depth == *stack_capacity) {
+                size_t n = *stack_capacity ? *stack_capacity * 2 : 64;
+                char **p = realloc(*stack, n * sizeof(*p));
+                if (!p) {
+                    succeeded = false;
+                    break;
+                }
+                *stack = p;
+                *stack_capacity = n;
+            }
+            char *sub;
+            if (asprintf(&sub, "%s%s%s", dir, *dir ? "/" : "", names[i]) == -1)
+                succeeded = false;
+            else (*stack)[(*depth)++] = sub;
+        }
+    }
+    free(st);
+    free(errors);
+    for (size_t i = 0; i < count; i++) free(names[i]);
+    free(names);
+    closedir(d);
+    return succeeded;
+}
+
+static bool walk(build_t *b) {
+    char **stack = NULL;
+    size_t depth = 0;
+    size_t capacity = 0;
+    bool succeeded = walk_dir(b, "", &stack, &depth, &capacity);
+    while (depth) {
+        char *dir = stack[--depth];
+        if (succeeded) succeeded = walk_dir(b, dir, &stack, &depth, &capacity);
+        free(dir);
+    }
+    free(stack);
+    return succeeded;
+}
+
+static int cmp_files(const void *a, const void *b) {
+    return strcmp(((build_file_t *)a)->name, ((build_file_t *)b)->name);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(uint32_t *)a;
+    uint32_t y = *(uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// reuse_old() takes the trigrams of the files unchanged since the old
+// index, inverting its posting lists; the others are marked to be read,
+// and all of them if a posting list is damaged
+static bool reuse_old(build_t *b, index_map_t *old) {
+    int64_t *new_ids = NULL;
+    size_t reused = 0;
+    if (old) new_ids = malloc((old->header->file_count + 1) * sizeof(int64_t));
+    for (uint64_t i = 0; new_ids && (i < old->header->file_count); i++)
+        new_ids[i] = -1;
+    for (size_t i = 0; i < b->count; i++) {
+        build_file_t *f = &b->files[i];
+        int64_t id = new_ids ? find_file(old, f->name) : -1;
+        f->read = (id < 0) || !entry_trusted(old, id, f->size, f->mtime_ns);
+        if (!f->read) {
+            new_ids[id] = i;
+            reused++;
+        }
+    }
+    bool succeeded = true;
+    bool damaged = false;
+    if (reused) {
+        // trigrams come in order, so each file's list is sorted
+        for (uint64_t t = 0; !damaged && (t < old->header->trigram_count);
+            t++) {
+            index_trigram_t *tri = &old->trigrams[t];
+            damaged = (tri->trigram >= SCT_INDEX_TRIGRAMS)
+                || !postings_valid(old, tri);
+            for (uint32_t k = 0; !damaged && (k < tri->count); k++) {
+                uint32_t posting = old->postings[tri->first + k];
+                damaged = posting >= old->header->file_count;
+                int64_t id = damaged ? -1 : new_ids[posting];
+                if (id >= 0) b->files[id].count++;
+            }
+        }
+    }
+    if (damaged) {
+        for (size_t i = 0; i < b->count; i++) {
+            b->files[i].read = true;
+            b->files[i].count = 0;
+        }
+        reused = 0;
+    }
+    if (reused) {
+        for (size_t i = 0; succeeded && (i < b->count); i++) {
+            build_file_t *f = &b->files[i];
+            if (f->read || !f->count) continue;
+            f->trigrams = malloc(f->count * sizeof(uint32_t));
+            if (!f->trigrams) succeeded = false;
+            f->count = 0;
+        }
+        // the lists were checked by the count
+        for (uint64_t t = 0; succeeded && (t < old->header->trigram_count);
+            t++) {
+            index_trigram_t *tri = &old->trigrams[t];
+            for (uint32_t k = 0; k < tri->count; k++) {
+                int64_t id = new_ids[old->postings[tri->first + k]];
+                if (id < 0) continue;
+                build_file_t *f = &b->files[id];
+                f->trigrams[f->count++] = tri->trigram;
+            }
+        }
+    }
+    free(new_ids);
+    return succeeded;
+}
+
+// collect() notes the trigrams of a piece of the file being read
+static bool collect(build_t *b, const unsigned char *p, size_t len) {
+    uint32_t t = b->last;
+    size_t i = 0;
+    for (; (i < len) && (b->seen < 2); i++, b->seen++) t = (t << 8) | p[i];
+    for (; i < len; i++) {
+        t = ((t << 8) | p[i]) & (SCT_INDEX_TRIGRAMS - 1);
+        uint64_t bit = 1ull << (t & 63);
+        if (b->bits[t >> 6] & bit) continue;
+        b->bits[t >> 6] |= bit;
+        if (b->list_count == b->list_capacity) {
+            size_t capacity = b->list_capacity ? b->list_capacity * 2 : 4096;
+            uint32_t *l = realloc(b->list, capacity * sizeof(uint32_t));
+            if (!l) return false;
+            b->list = l;
+            b->list_capacity = capacity;
+        }
+        b->list[b->list_count++] = t;
+    }
+    b->last = t;
+    return true;
+}
+
+static void reset_collector(build_t *b) {
+    for (size_t i = 0; i < b->list_count; i++)
+        b->bits[b->list[i] >> 6] &= ~(1ull << (b->list[i] & 63));
+    b->list_count = 0;
+    b->last = 0;
+    b->seen = 0;
+}
+
+// finish_file() hands the trigrams collected over to the file
+static bool finish_file(build_t *b, build_file_t *f) {
+    qsort(b->list, b->list_count, sizeof(uint32_t), cmp_u32);
+    f->count = b->list_count;
+    f->trigrams = malloc((f->count ? f->count : 1) * sizeof(uint32_t));
+    if (f->trigrams) memcpy(f->trigrams, b->list, f->count * sizeof(uint32_t));
+    reset_collector(b);
+    return f->trigrams != NULL;
+}
+
+// read_changed() reads the files marked, all of them queued at once
+static bool read_changed(build_t *b, size_t *read_count) {
+    size_t count = 0;
+    for (size_t i = 0; i < b->count; i++) count += b->files[i].read;
+    *read_count = count;
+    if (!count) return true;
+    char **paths = calloc(count, sizeof(char *));
+    size_t *ids = malloc(count * sizeof(size_t));
+    b->bits = calloc(SCT_INDEX_TRIGRAMS / 64, sizeof(uint64_t));
+    bool succeeded = paths && ids && b->bits;
+    for (size_t i = 0, k = 0; succeeded && (i < b->count); i++) {
+        if (!b->files[i].read) continue;
+        ids[k] = i;
+        if (asprintf(&paths[k++], "%s/%s", b->root, b->files[i].name) == -1) {
+            paths[k - 1] = NULL;
+            succeeded = false;
+        }
+    }
+    sct_io_reader_t *reader = succeeded ? sct_io_read_files(paths, count)
+        : NULL;
+    if (!reader) succeeded = false;
+    sct_io_chunk_t chunk;
+    while (reader && sct_io_next_chunk(reader, &chunk)) {
+        build_file_t *f = &b->files[ids[chunk.index]];
+        if (chunk.error) {
+            fprintf(stderr, "index: %s: %s\n", paths[chunk.index],
+                strerror(chunk.error));
+            // what was read of it is dropped
+            if (!f->failed && b->bits) reset_collector(b);
+            f->failed = true;
+        }
+        if (f->failed || !succeeded) continue;
+        // the trigrams of compressed data tell nothing of its lines
+        if ((chunk.offset == 0) && sct_decomp_detect(chunk.data, chunk.len)) {
+            if (!chunk.last) sct_io_skip_file(reader);
+            f->failed = true;
+            continue;
+        }
+        if (!collect(b, (unsigned char *)chunk.data, chunk.len)) {
+            succeeded = false;
+            continue;
+        }
+        if (chunk.last && !finish_file(b, f)) succeeded = false;
+    }
+    sct_io_reader_close(reader);
+    for (size_t i = 0; paths && (i < count); i++) free(paths[i]);
+    free(paths);
+    free(ids);
+    free(b->bits);
+    b->bits = NULL;
+    return succeeded;
+}
+
+// write_index() lays the index out in a temporary file mapped for
+// writing, then renames it over the old one
+static bool write_index(build_t *b, int64_t built_ns, uint64_t *trigram_count,
+    uint64_t *size)
+{
+    uint32_t *counts = calloc(SCT_INDEX_TRIGRAMS, sizeof(uint32_t));
+    if (!counts) return false;
+    uint64_t file_count = 0;
+    uint64_t posting_count = 0;
+    uint64_t names_size = 0;
+    for (size_t i = 0; i < b->count; i++) {
+        build_file_t *f = &b->files[i];
+        if (f->failed) continue;
+        file_count++;
+        names_size += strlen(f->name) + 1;
+        posting_count += f->count;
+        for (size_t k = 0; k < f->count; k++) counts[f->trigrams[k]]++;
+    }
+    *trigram_count = 0;
+    for (uint32_t t = 0; t < SCT_INDEX_TRIGRAMS; t++)
+        *trigram_count += counts[t] != 0;
+    *size = sizeof(index_header_t) + file_count * sizeof(index_file_t)
+        + *trigram_count * sizeof(index_trigram_t)
+        + posting_count * sizeof(uint32_t) + names_size;
+
+    char path[PATH_MAX];
+    char tmp[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", b->root, SCT_INDEX_NAME);
+    snprintf(tmp, sizeof(tmp), "%s/%s.tmp", b->root, SCT_INDEX_NAME);
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    char *base = MAP_FAILED;
+    if ((fd != -1) && (ftruncate(fd, *size) == 0))
+        base = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd != -1) close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "index: %s: %s\n", tmp, strerror(errno));
+        free(counts);
+        if (fd != -1) unlink(tmp);
+        return false;
+    }
+
+    index_header_t *h = (index_header_t *)base;
+    h->magic = SCT_INDEX_MAGIC;
+    h->version = SCT_INDEX_VERSION;
+    h->built_ns = built_ns;
+    h->file_count = file_count;
+    h->trigram_count = *trigram_count;
+    h->posting_count = posting_count;
+    h->names_size = names_size;
+    index_file_t *files = (index_file_t *)(h + 1);
+    index_trigram_t *trigrams = (index_trigram_t *)(files + file_count);
+    uint32_t *postings = (uint32_t *)(trigrams + *trigram_count);
+    char *names = (char *)(postings + posting_count);
+
+    // counts become the next free posting of each trigram
+    uint64_t first = 0;
+    for (uint32_t t = 0, k = 0; t < SCT_INDEX_TRIGRAMS; t++) {
+        if (!counts[t]) continue;
+        trigrams[k].trigram = t;
+        trigrams[k].count = counts[t];
+        trigrams[k++].first = first;
+        first += counts[t];
+        counts[t] = first - trigrams[k - 1].count;
+    }
+    uint64_t name = 0;
+    uint32_t id = 0;
+    for (size_t i = 0; i < b->count; i++) {
+        build_file_t *f = &b->files[i];
+        if (f->failed) continue;
+        files[id].size = f->size;
+        files[id].mtime_ns = f->mtime_ns;
+        files[id].name = name;
+        size_t len = strlen(f->name) + 1;
+        memcpy(names + name, f->name, len);
+        name += len;
+        for (size_t k = 0; k < f->count; k++)
+            postings[counts[f->trigrams[k]]++] = id;
+        id++;
+    }
+    free(counts);
+    bool succeeded = munmap(base, *size) == 0;
+    if (succeeded && (rename(tmp, path) == -1)) {
+        fprintf(stderr, "index: %s: %s\n", path, strerror(errno));
+        succeeded = false;
+    }
+    if (!succeeded) unlink(tmp);
+    return succeeded;
+}
+
+int sct_index_build(char *dir) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t built_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    build_t b;
+    memset(&b, 0, sizeof(b));
+    b.root = realpath(dir, NULL);
+    if (!b.root) {
+        fprintf(stderr, "index: %s: %s\n", dir, strerror(errno));
+        return 2;
+    }
+    index_map_t *old = map_index(b.root);
+    size_t read_count = 0;
+    uint64_t trigram_count = 0;
+    uint64_t size = 0;
+    bool succeeded = walk(&b);
+    if (succeeded) {
+        qsort(b.files, b.count, sizeof(*b.files), cmp_files);
+        succeeded = reuse_old(&b, old);
+    }
+    unmap_index(old);
+    if (succeeded) succeeded = read_changed(&b, &read_count);
+    // the other errors are reported where they happen
+    if (!succeeded) fprintf(stderr, "index: out of memory\n");
+    else succeeded = write_index(&b, built_ns, &trigram_count, &size);
+    if (succeeded)
+        printf("%zu files, %zu read, %llu trigrams, %llu KB\n", b.count,
+            read_count, (unsigned long long)trigram_count,
+            (unsigned long long)(size + 1023) / 1024);
+    for (size_t i = 0; i < b.count; i++) {
+        free(b.files[i].name);
+        free(b.files[i].trigrams);
+    }
+    free(b.files);
+    free(b.list);
+    free(b.root);
+    return succeeded ? 0 : 2;
+}
+#pragma endregion
+
+#pragma region search
+//------------------------------------------------------------------------------
+//              search
+
+// Directories seen by a search: a directory as given for a file maps
+// to its absolute path, an absolute one to the index nearest above.
+typedef struct dir_entry_ {
+    struct dir_entry_ *next;
+    char *key;
+    index_map_t *index;     // NULL if none
+    char *rel;              // the directory relative to the index root
+} dir_entry_t;
+
+typedef struct search_ {
+    dir_entry_t *given[SCT_INDEX_DIR_BUCKETS];
+    dir_entry_t *dirs[SCT_INDEX_DIR_BUCKETS];
+    index_map_t *maps;
+    sct_regex_t *re;
+} search_t;
+
+static dir_entry_t **dir_slot(dir_entry_t **table, const char *key) {
+    uint32_t h = 2166136261u;
+    for (const char *p = key; *p; p++) h = (h ^ (unsigned char)*p) * 16777619u;
+    dir_entry_t **slot = &table[h & (SCT_INDEX_DIR_BUCKETS - 1)];
+    while (*slot && strcmp((*slot)->key, key)) slot = &(*slot)->next;
+    return slot;
+}
+
+static dir_entry_t *new_dir(dir_entry_t **slot, const char *key) {
+    dir_entry_t *e = calloc(1, sizeof(*e));
+    if (e) e->key = scu_strdup((char *)key);
+    if (e && !e->key) {
+        free(e);
+        e = NULL;
+    }
+    *slot = e;
+    return e;
+}
+
+// the index covering an absolute directory, looked up and mapped once
+// for every directory above it
+static dir_entry_t *find_index(search_t *s, const char *abs) {
+    dir_entry_t **slot = dir_slot(s->dirs, abs);
+    if (*slot) return *slot;
+    dir_entry_t *e = new_dir(slot, abs);
+    if (!e) return NULL;
+    e->index = map_index(e->key);
+    if (e->index) {
+        e->index->next = s->maps;
+        s->maps = e->index;
+        e->rel = e->key + strlen(e->key);
+        return e;
+    }
+    char *slash = strrchr(e->key, '/');
+    if (!slash || (slash == e->key && !e->key[1])) return e;
+    char parent[PATH_MAX];
+    size_t len = slash == e->key ? 1 : (size_t)(slash - e->key);
+    memcpy(parent, e->key, len);
+    parent[len] = 0;
+    dir_entry_t *up = find_index(s, parent);
+    if (up && up->index) {
+        e->index = up->index;
+        size_t root_len = strlen(up->index->root);
+        e->rel = e->key + root_len + (root_len > 1);
+    }
+    return e;
+}
+
+// the index entry of a directory as given for a file
+static dir_entry_t *file_dir(search_t *s, char *path) {
+    char dir[PATH_MAX];
+    char *slash = strrchr(path, '/');
+    size_t len = slash ? (slash == path ? 1 : (size_t)(slash - path)) : 1;
+    if (len >= sizeof(dir)) return NULL;
+    memcpy(dir, slash ? path : ".", len);
+    dir[len] = 0;
+    dir_entry_t **slot = dir_slot(s->given, dir);
+    if (*slot) return *slot;
+    dir_entry_t *e = new_dir(slot, dir);
+    char *abs = e ? realpath(dir, NULL) : NULL;
+    dir_entry_t *found = abs ? find_index(s, abs) : NULL;
+    if (found) {
+        e->index = found->index;
+        e->rel = found->rel;
+    }
+    free(abs);
+    return e;
+}
+
+// is_in() looks for id in a posting list
+static bool is_in(uint32_t *list, uint32_t count, uint32_t id) {
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (list[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < count) && (list[lo] == id);
+}
+
+// mark_candidates() marks the files having all trigrams of a string
+static void mark_candidates(index_map_t *m, const unsigned char *s,
+    size_t len)
+{
+    index_trigram_t *tris[SCT_INDEX_MAX_STRING];
+    int count = 0;
+    if (len < 3) return;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        uint32_t t = (uint32_t)s[i] << 16 | (uint32_t)s[i + 1] << 8 | s[i + 2];
+        index_trigram_t *tri = find_trigram(m, t);
+        if (!tri) return;
+        tris[count++] = tri;
+    }
+    // the shortest list is walked, the others searched
+    int shortest = 0;
+    for (int i = 1; i < count; i++)
+        if (tris[i]->count < tris[shortest]->count) shortest = i;
+    uint32_t *list = m->postings + tris[shortest]->first;
+    for (uint32_t k = 0; k < tris[shortest]->count; k++) {
+        bool all = list[k] < m->header->file_count;
+        for (int i = 0; all && (i < count); i++)
+            all = (i == shortest) || is_in(m->postings + tris[i]->first,
+                tris[i]->count, list[k]);
+        if (all) m->candidates[list[k]] = true;
+    }
+}
+
+static bool prepare_candidates(search_t *s, index_map_t *m) {
+    if (m->candidates) return true;
+    m->candidates = calloc(m->header->file_count + 1, sizeof(bool));
+    if (!m->candidates) return false;
+    const char *literal;
+    size_t len;
+    for (int i = 0; sct_regex_literal(s->re, i, &literal, &len); i++)
+        mark_candidates(m, (const unsigned char *)literal, len);
+    return true;
+}
+
+static void purge_dirs(dir_entry_t *e) {
+    while (e) {
+        dir_entry_t *next = e->next;
+        free(e->key);
+        free(e);
+        e = next;
+    }
+}
+
+size_t sct_index_filter(sct_regex_t *re, char **paths, struct stat *st,
+    int *errors, size_t count, bool *keep)
+{
+    for (size_t i = 0; i < count; i++) keep[i] = true;
+    // every string has to be long enough for a trigram
+    const char *literal;
+    size_t len;
+    int literals = 0;
+    for (; sct_regex_literal(re, literals, &literal, &len); literals++)
+        if ((len < 3) || (len > SCT_INDEX_MAX_STRING)) return count;
+    if (!literals || !count) return count;
+
+    search_t *s = calloc(1, sizeof(*s));
+    size_t kept = count;
+    if (s) {
+        s->re = re;
+        for (size_t i = 0; i < count; i++) {
+            if (errors[i] || !S_ISREG(st[i].st_mode)) continue;
+            dir_entry_t *d = file_dir(s, paths[i]);
+            if (!d || !d->index || !prepare_candidates(s, d->index)) continue;
+            char *base = strrchr(paths[i], '/');
+            base = base ? base + 1 : paths[i];
+            char name[PATH_MAX];
+            if (snprintf(name, sizeof(name), "%s%s%s", d->rel,
+                *d->rel ? "/" : "", base) >= (int)sizeof(name)) continue;
+            int64_t id = find_file(d->index, name);
+            if ((id >= 0) && entry_trusted(d->index, id, st[i].st_size,
+                mtime_ns(&st[i]))
+                && !d->index->candidates[id]) {
+                keep[i] = false;
+                kept--;
+            }
+        }
+    }
+    for (int i = 0; s && (i < SCT_INDEX_DIR_BUCKETS); i++) {
+        purge_dirs(s->given[i]);
+        purge_dirs(s->dirs[i]);
+    }
+    while (s && s->maps) {
+        index_map_t *m = s->maps;
+        s->maps = m->next;
+        unmap_index(m);
+    }
+    free(s);
+    return kept;
+}
+#pragma endregion
@@ -0,0 +1,1013 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "sct_io.h"
+#include "sct_utils.h"
+
+/*
+    Batched file I/O for the file commands.
+    The io_uring backend sets a ring up through the raw system calls and
+    registers a fixed set of data buffers with it once, so the kernel does
+    not map user pages per request. Opens and statx calls of many files are
+    queued at once and reads run ahead of the consumer into every free
+    buffer, so a single io_uring_enter() call serves a whole batch and the
+    device sees a deep queue even for small files.
+    The ring belongs to the thread that initialized the layer and serves
+    one operation at a time; other threads, nested operations, and systems
+    without io_uring (old kernels, seccomp filters) get the same routines
+    on plain system calls.
+*/
+
+#define SCT_IO_RING_ENTRIES 64
+#define SCT_IO_BUFFERS 16
+#define SCT_IO_BUFFER_SIZE (128 * 1024)
+#define SCT_IO_OPEN_AHEAD 32        // files opened ahead of the one consumed
+#define SCT_IO_STAT_WINDOW 64       // statx requests in flight
+
+// user_data of a request: its kind in the high byte, an index below
+#define UD_OPEN     1ull
+#define UD_STATX    2ull
+#define UD_READ     3ull
+#define UD_WRITE    4ull
+#define UD_CLOSE    5ull
+#define UD_NOP      6ull    // an entry taken but not used, left cleared
+#define UD(kind, index) (((kind) << 56) | (uint64_t)(index))
+#define UD_KIND(ud) ((ud) >> 56)
+#define UD_INDEX(ud) ((size_t)((ud) & ((1ull << 56) - 1)))
+
+typedef struct ring_ {
+    int fd;
+    unsigned entries;
+    unsigned cq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    size_t sq_map_len;
+    void *cq_map;
+    size_t cq_map_len;
+    size_t sqes_len;
+    unsigned local_tail;    // prepared entries are published on submit
+    unsigned to_submit;
+    unsigned in_flight;     // prepared or submitted, not completed yet
+} ring_t;
+
+typedef struct io_state_ {
+    sct_io_backend_t backend;
+    ring_t ring;
+    char *buffers;          // SCT_IO_BUFFERS of SCT_IO_BUFFER_SIZE
+    bool fixed;             // the buffers are registered
+    pthread_t owner;
+    bool busy;              // touched by the owner thread only
+} io_state_t;
+
+static io_state_t g_io = { SCT_IO_SYSCALLS, { -1 } };
+
+#pragma region ring
+//------------------------------------------------------------------------------
+//              ring
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned wait_nr,
+    unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, wait_nr, flags,
+        NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg,
+    unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void *map_ring(int fd, size_t len, off_t offset) {
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, offset);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static void ring_teardown(ring_t *r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_len);
+    if (r->cq_map && (r->cq_map != r->sq_map)) munmap(r->cq_map, r->cq_map_len);
+    if (r->sq_map) munmap(r->sq_map, r->sq_map_len);
+    if (r->fd >= 0) close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+static bool ring_setup(ring_t *r, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+    r->fd = sys_io_uring_setup(entries, &p);
+    if (r->fd < 0) return false;
+
+    r->entries = p.sq_entries;
+    r->cq_entries = p.cq_entries;
+    r->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_len = p.cq_off.cqes
+        + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_map = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_map) {
+        if (r->cq_map_len > r->sq_map_len) r->sq_map_len = r->cq_map_len;
+        r->cq_map_len = r->sq_map_len;
+    }
+    r->sq_map = map_ring(r->fd, r->sq_map_len, IORING_OFF_SQ_RING);
+    r->cq_map = single_map ? r->sq_map
+        : map_ring(r->fd, r->cq_map_len, IORING_OFF_CQ_RING);
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = map_ring(r->fd, r->sqes_len, IORING_OFF_SQES);
+    if (!r->sq_map || !r->cq_map || !r->sqes) {
+        ring_teardown(r);
+        return false;
+    }
+
+    char *sq = r->sq_map;
+    char *cq = r->cq_map;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    // entries are always taken in order, so the indirection is identity
+    unsigned *array = (unsigned *)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) array[i] = i;
+    r->local_tail = *r->sq_tail;
+    return true;
+}
+
+// ring_submit() hands the prepared entries to the kernel and waits for
+// wait_nr completions
+static bool ring_submit(ring_t *r, unsigned wait_nr) {
+    __atomic_store_n(r->sq_tail, r->local_tail, __ATOMIC_RELEASE);
+    do {
+        int n = sys_io_uring_enter(r->fd, r->to_submit, wait_nr,
+            wait_nr ? IORING_ENTER_GETEVENTS : 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        r->to_submit -= n;
+    } while (r->to_submit);
+    return true;
+}
+
+// ring_sqe() returns a cleared entry to fill, or NULL if the completion
+// queue could not take one more result or the ring could not be submitted
+// to: callers fall back to syscalls, or fail
+static struct io_uring_sqe *ring_sqe(ring_t *r) {
+    if (r->in_flight >= r->cq_entries) return NULL;
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if ((r->local_tail - head >= r->entries) && !ring_submit(r, 0))
+        return NULL;
+    struct io_uring_sqe *sqe = &r->sqes[r->local_tail & *r->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    r->local_tail++;
+    r->to_submit++;
+    r->in_flight++;
+    return sqe;
+}
+
+// ring_reap() takes a completion, waiting for one if wait is set
+static bool ring_reap(ring_t *r, struct io_uring_cqe *cqe, bool wait) {
+    while (true) {
+        unsigned head = *r->cq_head;
+        if (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+            *cqe = r->cqes[head & *r->cq_mask];
+            __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+            r->in_flight--;
+            return true;
+        }
+        if (!wait || !r->in_flight || !ring_submit(r, 1)) return false;
+    }
+}
+
+static void prep_openat(struct io_uring_sqe *sqe, char *path, int flags,
+    mode_t mode, uint64_t ud)
+{
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uintptr_t)path;
+    sqe->len = mode;
+    sqe->open_flags = flags | O_CLOEXEC;
+    sqe->user_data = ud;
+}
+
+static void prep_statx(struct io_uring_sqe *sqe, int dirfd, char *path,
+    int flags, struct statx *stx, uint64_t ud)
+{
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = dirfd;
+    sqe->addr = (uintptr_t)path;
+    sqe->len = STATX_BASIC_STATS;
+    sqe->off = (uintptr_t)stx;
+    sqe->statx_flags = flags;
+    sqe->user_data = ud;
+}
+
+// prep_rw() reads or writes len bytes of buffer number buffer, from its
+// byte skip on
+static void prep_rw(struct io_uring_sqe *sqe, bool write, int fd, int buffer,
+    size_t skip, size_t len, off_t offset, uint64_t ud)
+{
+    if (g_io.fixed) {
+        sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->buf_index = buffer;
+    }
+    else sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)(g_io.buffers
+        + (size_t)buffer * SCT_IO_BUFFER_SIZE + skip);
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = ud;
+}
+
+// close_fd() closes asynchronously when the ring has room
+static void close_fd(int fd) {
+    struct io_uring_sqe *sqe = ring_sqe(&g_io.ring);
+    if (!sqe) {
+        close(fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = UD(UD_CLOSE, 0);
+}
+
+static void stat_from_statx(struct stat *st, struct statx *stx) {
+    memset(st, 0, sizeof(*st));
+    st->st_dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+    st->st_ino = stx->stx_ino;
+    st->st_mode = stx->stx_mode;
+    st->st_nlink = stx->stx_nlink;
+    st->st_uid = stx->stx_uid;
+    st->st_gid = stx->stx_gid;
+    st->st_rdev = makedev(stx->stx_rdev_major, stx->stx_rdev_minor);
+    st->st_size = stx->stx_size;
+    st->st_blksize = stx->stx_blksize;
+    st->st_blocks = stx->stx_blocks;
+    st->st_atim.tv_sec = stx->stx_atime.tv_sec;
+    st->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+    st->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+    st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+    st->st_ctim.tv_sec = stx->stx_ctime.tv_sec;
+    st->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+
+// take_ring() reserves the ring for an operation of the calling thread
+static bool take_ring(void) {
+    if ((g_io.backend != SCT_IO_URING)
+        || !pthread_equal(pthread_self(), g_io.owner) || g_io.busy)
+        return false;
+    g_io.busy = true;
+    return true;
+}
+
+static void release_ring(void) {
+    g_io.busy = false;
+}
+#pragma endregion
+
+#pragma region reader
+//------------------------------------------------------------------------------
+//              reader
+
+typedef struct reader_file_ {
+    int fd;
+    int error;
+    int pending;        // open and statx requests in flight
+    bool opened;
+    bool tail;          // size unknown: read to EOF one call at a time
+    off_t size;
+    off_t start;        // reading starts here
+    off_t scheduled;    // reads are submitted up to here
+    struct statx stx;
+} reader_file_t;
+
+typedef struct reader_slot_ {
+    size_t file;        // SIZE_MAX if the buffer is free
+    off_t offset;
+    size_t len;
+    int result;
+    bool done;
+} reader_slot_t;
+
+struct sct_io_reader_ {
+    char **paths;
+    size_t count;
+    reader_file_t *files;
+    bool uring;
+    size_t open_next;   // next file to open
+    size_t read_next;   // next file to read ahead
+    size_t cur;         // file being consumed
+    off_t cur_offset;
+    size_t returned;    // file of the last chunk returned
+    int held;           // slot handed to the consumer, -1 if none
+    char *buffer;       // for reads done one call at a time
+    reader_slot_t slots[SCT_IO_BUFFERS];
+};
+
+static char *slot_data(int slot) {
+    return g_io.buffers + (size_t)slot * SCT_IO_BUFFER_SIZE;
+}
+
+// meta_done() decides how a file is read once it is open and known
+static void meta_done(sct_io_reader_t *r, reader_file_t *f) {
+    if (!f->error) {
+        if (S_ISDIR(f->stx.stx_mode)) f->error = EISDIR;
+        f->size = f->stx.stx_size;
+        // e.g. /proc files report no size
+        f->tail = !S_ISREG(f->stx.stx_mode) || (f->size == 0);
+    }
+    if (f->error && (f->fd >= 0)) {
+        close(f->fd);
+        f->fd = -1;
+    }
+}
+
+// open_file() opens and stats a file with plain syscalls
+static void open_file(sct_io_reader_t *r, reader_file_t *f, char *path) {
+    f->opened = true;
+    f->fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (f->fd < 0) f->error = errno;
+    else if (fstat(f->fd, &st) != 0) f->error = errno;
+    else {
+        f->stx.stx_mode = st.st_mode;
+        f->stx.stx_size = st.st_size;
+    }
+    meta_done(r, f);
+}
+
+static void issue_opens(sct_io_reader_t *r) {
+    while ((r->open_next < r->count)
+        && (r->open_next < r->cur + SCT_IO_OPEN_AHEAD)
+        && (g_io.ring.in_flight + 2 <= g_io.ring.cq_entries))
+    {
+        size_t i = r->open_next++;
+        reader_file_t *f = &r->files[i];
+        struct io_uring_sqe *open_sqe = ring_sqe(&g_io.ring);
+        struct io_uring_sqe *statx_sqe = open_sqe ? ring_sqe(&g_io.ring)
+            : NULL;
+        if (!statx_sqe) {
+            // the ring could not be submitted to: this file is opened
+            // here, the next ones on the next call
+            if (open_sqe) open_sqe->user_data = UD(UD_NOP, i);
+            open_file(r, f, r->paths[i]);
+            return;
+        }
+        prep_openat(open_sqe, r->paths[i], O_RDONLY, 0, UD(UD_OPEN, i));
+        prep_statx(statx_sqe, AT_FDCWD, r->paths[i], 0, &f->stx,
+            UD(UD_STATX, i));
+        f->pending = 2;
+        f->opened = true;
+    }
+}
+
+static int free_slot(sct_io_reader_t *r) {
+    for (int i = 0; i < SCT_IO_BUFFERS; i++)
+        if (r->slots[i].file == SIZE_MAX) return i;
+    return -1;
+}
+
+static void issue_reads(sct_io_reader_t *r) {
+    if (r->read_next < r->cur) r->read_next = r->cur;
+    while (r->read_next < r->count) {
+        reader_file_t *f = &r->files[r->read_next];
+        if (!f->opened || f->pending) break;
+        if (f->error || f->tail || (f->scheduled >= f->size)) {
+            r->read_next++;
+            continue;
+        }
+        int slot = free_slot(r);
+        if (slot < 0) break;
+        struct io_uring_sqe *sqe = ring_sqe(&g_io.ring);
+        if (!sqe) break;
+        size_t len = f->size - f->scheduled;
+        if (len > SCT_IO_BUFFER_SIZE) len = SCT_IO_BUFFER_SIZE;
+        prep_rw(sqe, false, f->fd, slot, 0, len, f->scheduled,
+            UD(UD_READ, slot));
+        r->slots[slot] = (reader_slot_t){ r->read_next, f->scheduled, len };
+        f->scheduled += len;
+    }
+}
+
+// a buffer is stale if its data will never be consumed
+static bool slot_stale(sct_io_reader_t *r, int i) {
+    reader_slot_t *s = &r->slots[i];
+    if ((s->file == SIZE_MAX) || !s->done || (i == r->held)) return false;
+    if (s->file < r->cur) return true;
+    return (s->file == r->cur) && (s->offset >= r->files[r->cur].size);
+}
+
+static void free_stale_slots(sct_io_reader_t *r) {
+    for (int i = 0; i < SCT_IO_BUFFERS; i++)
+        if (slot_stale(r, i)) r->slots[i].file = SIZE_MAX;
+}
+
+static void handle_completion(sct_io_reader_t *r, struct io_uring_cqe *cqe) {
+    size_t i = UD_INDEX(cqe->user_data);
+    switch (UD_KIND(cqe->user_data))
+    {
+        case UD_OPEN:
+        case UD_STATX:
+        {
+            reader_file_t *f = &r->files[i];
+            if (cqe->res < 0) {
+                if (!f->error) f->error = -cqe->res;
+            }
+            else if (UD_KIND(cqe->user_data) == UD_OPEN) f->fd = cqe->res;
+            if (--f->pending == 0) meta_done(r, f);
+            break;
+        }
+        case UD_READ:
+        {
+            r->slots[i].result = cqe->res;
+            r->slots[i].done = true;
+            free_stale_slots(r);
+            break;
+        }
+        default: break;
+    }
+}
+
+static bool wait_completion(sct_io_reader_t *r) {
+    struct io_uring_cqe cqe;
+    if (!ring_reap(&g_io.ring, &cqe, true)) return false;
+    handle_completion(r, &cqe);
+    // take whatever else is there without another system call
+    while (ring_reap(&g_io.ring, &cqe, false)) handle_completion(r, &cqe);
+    return true;
+}
+
+static void finish_file(sct_io_reader_t *r) {
+    reader_file_t *f = &r->files[r->cur];
+    if (f->fd >= 0) {
+        if (r->uring) {
+            // reads of the file must reach the kernel before its close
+            ring_submit(&g_io.ring, 0);
+            close_fd(f->fd);
+        }
+        else close(f->fd);
+        f->fd = -1;
+    }
+    r->cur++;
+    r->cur_offset = r->cur < r->count ? r->files[r->cur].start : 0;
+    if (r->uring) free_stale_slots(r);
+}
+
+static void set_chunk(sct_io_chunk_t *chunk, sct_io_reader_t *r, char *data,
+    size_t len, int error, bool last)
+{
+    chunk->index = r->returned = r->cur;
+    chunk->data = data;
+    chunk->len = len;
+    chunk->offset = r->cur_offset;
+    chunk->error = error;
+    chunk->last = last;
+    r->cur_offset += len;
+}
+
+// read_tail() reads files of unknown size, one call at a time
+static bool read_tail(sct_io_reader_t *r, reader_file_t *f,
+    sct_io_chunk_t *chunk)
+{
+    ssize_t n;
+    do n = pread(f->fd, r->buffer, SCT_IO_BUFFER_SIZE, r->cur_offset);
+    while ((n < 0) && (errno == EINTR));
+    if (n < 0) set_chunk(chunk, r, NULL, 0, errno, true);
+    else set_chunk(chunk, r, r->buffer, n, 0, n == 0);
+    if (chunk->last) finish_file(r);
+    return true;
+}
+
+// read_here() reads the next chunk of a file with a syscall
+static bool read_here(sct_io_reader_t *r, reader_file_t *f,
+    sct_io_chunk_t *chunk)
+{
+    bool tail = f->tail;
+    read_tail(r, f, chunk);
+    // the size is known, no need to read its end
+    if (!tail && !chunk->last
+        && (chunk->offset + (off_t)chunk->len >= f->size))
+    {
+        chunk->last = true;
+        finish_file(r);
+    }
+    return true;
+}
+
+static bool next_chunk_uring(sct_io_reader_t *r, sct_io_chunk_t *chunk) {
+    while (r->cur < r->count) {
+        issue_opens(r);
+        issue_reads(r);
+        reader_file_t *f = &r->files[r->cur];
+        if (f->pending) {
+            if (!wait_completion(r)) return false;
+            continue;
+        }
+        if (f->error || (r->cur_offset >= f->size && !f->tail)) {
+            set_chunk(chunk, r, NULL, 0, f->error, true);
+            finish_file(r);
+            return true;
+        }
+        if (f->tail) return read_tail(r, f, chunk);
+
+        int slot = -1;
+        for (int i = 0; (slot < 0) && (i < SCT_IO_BUFFERS); i++) {
+            if ((r->slots[i].file == r->cur)
+                && (r->slots[i].offset == r->cur_offset)) slot = i;
+        }
+        if ((slot < 0) && (f->scheduled <= r->cur_offset)) {
+            // the ring took no read of it
+            off_t offset = r->cur_offset;
+            read_here(r, f, chunk);
+            f->scheduled = offset + chunk->len;
+            return true;
+        }
+        if ((slot < 0) || !r->slots[slot].done) {
+            if (!wait_completion(r)) return false;
+            continue;
+        }
+
+        reader_slot_t *s = &r->slots[slot];
+        r->held = slot;
+        if (s->result < 0) {
+            f->error = -s->result;
+            set_chunk(chunk, r, NULL, 0, f->error, true);
+        }
+        else {
+            // a short read means the file has shrunk since statx
+            if ((size_t)s->result < s->len) f->size = s->offset + s->result;
+            set_chunk(chunk, r, slot_data(slot), s->result, 0,
+                s->offset + s->result >= f->size);
+        }
+        if (chunk->last) finish_file(r);
+        return true;
+    }
+    return false;
+}
+
+static bool next_chunk_syscalls(sct_io_reader_t *r, sct_io_chunk_t *chunk) {
+    if (r->cur >= r->count) return false;
+    reader_file_t *f = &r->files[r->cur];
+    if (!f->opened) open_file(r, f, r->paths[r->cur]);
+    if (f->error) {
+        set_chunk(chunk, r, NULL, 0, f->error, true);
+        finish_file(r);
+        return true;
+    }
+    if (f->tail || (r->cur_offset < f->size)) return read_here(r, f, chunk);
+    set_chunk(chunk, r, NULL, 0, 0, true);
+    finish_file(r);
+    return true;
+}
+
+sct_io_reader_t *sct_io_read_files(char **paths, size_t count) {
+    return sct_io_read_files_at(paths, NULL, count);
+}
+
+sct_io_reader_t *sct_io_read_files_at(char **paths, off_t *starts,
+    size_t count)
+{
+    sct_io_reader_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->files = calloc(count ? count : 1, sizeof(*r->files));
+    r->buffer = malloc(SCT_IO_BUFFER_SIZE);
+    if (!r->files || !r->buffer) {
+        free(r->files);
+        free(r->buffer);
+        free(r);
+        return NULL;
+    }
+    r->paths = paths;
+    r->count = count;
+    r->held = -1;
+    r->returned = SIZE_MAX;
+    for (size_t i = 0; i < count; i++) {
+        r->files[i].fd = -1;
+        r->files[i].start = r->files[i].scheduled = starts ? starts[i] : 0;
+    }
+    r->cur_offset = count ? r->files[0].start : 0;
+    for (int i = 0; i < SCT_IO_BUFFERS; i++) r->slots[i].file = SIZE_MAX;
+    r->uring = take_ring();
+    return r;
+}
+
+bool sct_io_next_chunk(sct_io_reader_t *r, sct_io_chunk_t *chunk) {
+    if (r->held >= 0) {
+        r->slots[r->held].file = SIZE_MAX;
+        r->held = -1;
+    }
+    return r->uring ? next_chunk_uring(r, chunk)
+        : next_chunk_syscalls(r, chunk);
+}
+
+void sct_io_skip_file(sct_io_reader_t *r) {
+    // nothing to do once the last chunk of the file is returned
+    if ((r->cur < r->count) && (r->cur == r->returned)) finish_file(r);
+}
+
+void sct_io_reader_close(sct_io_reader_t *r) {
+    if (!r) return;
+    if (r->uring) {
+        // opens and reads ahead may still be running
+        struct io_uring_cqe cqe;
+        r->cur = r->count;
+        while (ring_reap(&g_io.ring, &cqe, true)) handle_completion(r, &cqe);
+    }
+    for (size_t i = 0; i < r->count; i++)
+        if (r->files[i].fd >= 0) close(r->files[i].fd);
+    if (r->uring) release_ring();
+    free(r->files);
+    free(r->buffer);
+    free(r);
+}
+#pragma endregion
+
+#pragma region stat and copy
+//------------------------------------------------------------------------------
+//              stat and copy
+
+static void stat_batch_uring(int dirfd, char **names, size_t count, int flags,
+    struct stat *st, int *errors)
+{
+    struct statx stx[SCT_IO_STAT_WINDOW];
+    size_t slot_name[SCT_IO_STAT_WINDOW];
+    int free_slots[SCT_IO_STAT_WINDOW];
+    int free_count = SCT_IO_STAT_WINDOW;
+    bool pending[SCT_IO_STAT_WINDOW] = { false };
+    for (int i = 0; i < SCT_IO_STAT_WINDOW; i++) free_slots[i] = i;
+
+    size_t next = 0;
+    size_t done = 0;
+    while (done < count) {
+        struct io_uring_sqe *sqe;
+        while ((next < count) && free_count && (sqe = ring_sqe(&g_io.ring))) {
+            int slot = free_slots[--free_count];
+            slot_name[slot] = next;
+            pending[slot] = true;
+            prep_statx(sqe, dirfd, names[next], flags, &stx[slot],
+                UD(UD_STATX, slot));
+            next++;
+        }
+        struct io_uring_cqe cqe;
+        if (!ring_reap(&g_io.ring, &cqe, true)) break;
+        if (UD_KIND(cqe.user_data) != UD_STATX) continue;
+        int slot = UD_INDEX(cqe.user_data);
+        size_t i = slot_name[slot];
+        errors[i] = cqe.res < 0 ? -cqe.res : 0;
+        if (!errors[i]) stat_from_statx(&st[i], &stx[slot]);
+        pending[slot] = false;
+        free_slots[free_count++] = slot;
+        done++;
+    }
+    // only if the ring failed: the names not asked for yet are stated
+    // here, those asked for without a result fail
+    for (int slot = 0; slot < SCT_IO_STAT_WINDOW; slot++)
+        if (pending[slot]) errors[slot_name[slot]] = EIO;
+    for (; next < count; next++)
+        errors[next] = fstatat(dirfd, names[next], &st[next], flags) == 0
+            ? 0 : errno;
+}
+
+void sct_io_stat_batch(int dirfd, char **names, size_t count, bool follow,
+    struct stat *st, int *errors)
+{
+    int flags = follow ? 0 : AT_SYMLINK_NOFOLLOW;
+    if ((count > 1) && take_ring()) {
+        stat_batch_uring(dirfd, names, count, flags, st, errors);
+        release_ring();
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+        errors[i] = fstatat(dirfd, names[i], &st[i], flags) == 0 ? 0 : errno;
+}
+
+static int write_all(int fd, char *data, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int pwrite_all(int fd, char *data, size_t len, off_t offset) {
+    while (len) {
+        ssize_t n = pwrite(fd, data, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        data += n;
+        offset += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// copy_data_syscalls() copies from the current offsets to EOF
+static int copy_data_syscalls(int src_fd, int dst_fd) {
+    char *buffer = malloc(SCT_IO_BUFFER_SIZE);
+    if (!buffer) return ENOMEM;
+    int error = 0;
+    while (!error) {
+        ssize_t n = read(src_fd, buffer, SCT_IO_BUFFER_SIZE);
+        if (n < 0) {
+            if (errno != EINTR) error = errno;
+            continue;
+        }
+        if (n == 0) break;
+        error = write_all(dst_fd, buffer, n);
+    }
+    free(buffer);
+    return error;
+}
+
+static int copy_file_syscalls(char *src, char *dst) {
+    int src_fd = open(src, O_RDONLY | O_CLOEXEC);
+    if (src_fd < 0) return errno;
+    struct stat src_st;
+    struct stat dst_st;
+    int error = 0;
+    if (fstat(src_fd, &src_st) != 0) error = errno;
+    else if (S_ISDIR(src_st.st_mode)) error = EISDIR;
+    else if ((stat(dst, &dst_st) == 0) && (dst_st.st_dev == src_st.st_dev)
+        && (dst_st.st_ino == src_st.st_ino)) error = EEXIST;
+    int dst_fd = -1;
+    if (!error) {
+        dst_fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            src_st.st_mode & 0777);
+        if (dst_fd < 0) error = errno;
+    }
+    if (!error) error = copy_data_syscalls(src_fd, dst_fd);
+    close(src_fd);
+    if ((dst_fd >= 0) && (close(dst_fd) != 0) && !error) error = errno;
+    return error;
+}
+
+// reap_results() waits for count requests, storing their results by index
+static bool reap_results(int *results, int count) {
+    struct io_uring_cqe cqe;
+    for (int i = 0; i < count; i++) {
+        if (!ring_reap(&g_io.ring, &cqe, true)) return false;
+        uint64_t kind = UD_KIND(cqe.user_data);
+        if ((kind != UD_CLOSE) && (kind != UD_NOP))
+            results[UD_INDEX(cqe.user_data)] = cqe.res;
+        else i--;
+    }
+    return true;
+}
+
+typedef struct copy_slot_ {
+    bool busy;
+    bool writing;
+    off_t offset;
+    size_t len;
+    size_t written;
+} copy_slot_t;
+
+// copy_data_uring() keeps every buffer busy: a buffer is written as soon
+// as its read completes, and read again as soon as it is written.
+static int copy_data_uring(int src_fd, int dst_fd, off_t size) {
+    copy_slot_t slots[SCT_IO_BUFFERS];
+    memset(slots, 0, sizeof(slots));
+    off_t read_next = 0;
+    int busy = 0;
+    int error = 0;
+    while (true) {
+        for (int i = 0; !error && (read_next < size)
+            && (i < SCT_IO_BUFFERS); i++)
+        {
+            if (slots[i].busy) continue;
+            struct io_uring_sqe *sqe = ring_sqe(&g_io.ring);
+            if (!sqe) break;
+            size_t len = size - read_next;
+            if (len > SCT_IO_BUFFER_SIZE) len = SCT_IO_BUFFER_SIZE;
+            prep_rw(sqe, false, src_fd, i, 0, len, read_next, UD(UD_READ, i));
+            slots[i] = (copy_slot_t){ true, false, read_next, len, 0 };
+            read_next += len;
+            busy++;
+        }
+        if (!busy) break;
+
+        struct io_uring_cqe cqe;
+        if (!ring_reap(&g_io.ring, &cqe, true)) return EIO;
+        if ((UD_KIND(cqe.user_data) == UD_CLOSE)
+            || (UD_KIND(cqe.user_data) == UD_NOP)) continue;
+        copy_slot_t *s = &slots[UD_INDEX(cqe.user_data)];
+        int i = UD_INDEX(cqe.user_data);
+        if ((cqe.res < 0) || (s->writing && (cqe.res == 0))) {
+            if (!error) error = cqe.res < 0 ? -cqe.res : EIO;
+        }
+        else if (!s->writing) {
+            // the file has shrunk since statx: copy what there is
+            if ((size_t)cqe.res < s->len) {
+                s->len = cqe.res;
+                if (read_next > s->offset + s->len)
+                    read_next = size = s->offset + s->len;
+            }
+            s->writing = true;
+        }
+        else s->written += cqe.res;
+
+        if (!error && s->writing && (s->written < s->len)) {
+            struct io_uring_sqe *sqe = ring_sqe(&g_io.ring);
+            if (sqe) {
+                prep_rw(sqe, true, dst_fd, i, s->written,
+                    s->len - s->written, s->offset + s->written,
+                    UD(UD_WRITE, i));
+                continue;
+            }
+            // the ring could not be submitted to: written here
+            error = pwrite_all(dst_fd, slot_data(i) + s->written,
+                s->len - s->written, s->offset + s->written);
+        }
+        s->busy = false;
+        busy--;
+    }
+    // what the ring could not take is copied here
+    if (!error && (read_next < size)) {
+        if ((lseek(src_fd, read_next, SEEK_SET) < 0)
+            || (lseek(dst_fd, read_next, SEEK_SET) < 0)) error = errno;
+        else error = copy_data_syscalls(src_fd, dst_fd);
+    }
+    return error;
+}
+
+static int copy_file_uring(char *src, char *dst) {
+    struct statx stx[2];
+    int results[3];
+    struct io_uring_sqe *sqes[3];
+    int taken = 0;
+    while ((taken < 3) && (sqes[taken] = ring_sqe(&g_io.ring))) taken++;
+    if (taken < 3) {
+        // the ring could not be submitted to: those taken are no-ops,
+        // passed over by whoever reaps them
+        for (int i = 0; i < taken; i++) sqes[i]->user_data = UD(UD_NOP, i);
+        return copy_file_syscalls(src, dst);
+    }
+    prep_openat(sqes[0], src, O_RDONLY, 0, UD(UD_OPEN, 0));
+    prep_statx(sqes[1], AT_FDCWD, src, 0, &stx[0], UD(UD_STATX, 1));
+    prep_statx(sqes[2], AT_FDCWD, dst, 0, &stx[1], UD(UD_STATX, 2));
+    if (!reap_results(results, 3)) return EIO;
+
+    int src_fd = results[0];
+    if (src_fd < 0) return -src_fd;
+    int error = 0;
+    if (results[1] < 0) error = -results[1];
+    else if (S_ISDIR(stx[0].stx_mode)) error = EISDIR;
+    else if ((results[2] == 0)
+        && (stx[0].stx_dev_major == stx[1].stx_dev_major)
+        && (stx[0].stx_dev_minor == stx[1].stx_dev_minor)
+        && (stx[0].stx_ino == stx[1].stx_ino)) error = EEXIST;
+    int dst_fd = -1;
+    struct io_uring_sqe *sqe = error ? NULL : ring_sqe(&g_io.ring);
+    if (sqe) {
+        prep_openat(sqe, dst, O_WRONLY | O_CREAT | O_TRUNC,
+            stx[0].stx_mode & 0777, UD(UD_OPEN, 0));
+        if (!reap_results(results, 1)) error = EIO;
+        else if (results[0] < 0) error = -results[0];
+        else dst_fd = results[0];
+    }
+    else if (!error) {
+        dst_fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            stx[0].stx_mode & 0777);
+        if (dst_fd < 0) error = errno;
+    }
+    if (!error) {
+        // a file of unknown size is copied to its EOF
+        error = (S_ISREG(stx[0].stx_mode) && stx[0].stx_size)
+            ? copy_data_uring(src_fd, dst_fd, stx[0].stx_size)
+            : copy_data_syscalls(src_fd, dst_fd);
+    }
+
+    close_fd(src_fd);
+    if (dst_fd >= 0) {
+        // the result of closing the destination matters, e.g. on NFS
+        sqe = ring_sqe(&g_io.ring);
+        if (sqe) {
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = dst_fd;
+            sqe->user_data = UD(UD_WRITE, 0);
+            if (!reap_results(results, 1)) results[0] = -EIO;
+        }
+        else results[0] = close(dst_fd) == 0 ? 0 : -errno;
+        if ((results[0] < 0) && !error) error = -results[0];
+    }
+    ring_submit(&g_io.ring, 0);
+    return error;
+}
+
+int sct_io_copy_file(char *src, char *dst) {
+    if (!take_ring()) return copy_file_syscalls(src, dst);
+    int result = copy_file_uring(src, dst);
+    release_ring();
+    return result;
+}
+#pragma endregion
+
+#pragma region public io routines
+//------------------------------------------------------------------------------
+//              public io routines
+
+static bool setup_uring(void) {
+    if (!ring_setup(&g_io.ring, SCT_IO_RING_ENTRIES)) return false;
+    size_t sz = (size_t)SCT_IO_BUFFERS * SCT_IO_BUFFER_SIZE;
+    g_io.buffers = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (g_io.buffers == MAP_FAILED) {
+        g_io.buffers = NULL;
+        ring_teardown(&g_io.ring);
+        return false;
+    }
+    // unregistered buffers work too, at the cost of mapping them per request
+    struct iovec iov[SCT_IO_BUFFERS];
+    for (int i = 0; i < SCT_IO_BUFFERS; i++) {
+        iov[i].iov_base = slot_data(i);
+        iov[i].iov_len = SCT_IO_BUFFER_SIZE;
+    }
+    g_io.fixed = sys_io_uring_register(g_io.ring.fd, IORING_REGISTER_BUFFERS,
+        iov, SCT_IO_BUFFERS) == 0;
+    return true;
+}
+
+bool sct_io_initialize(sct_io_backend_t backend) {
+    sct_io_finalize();
+    if (backend == SCT_IO_SYSCALLS) return true;
+    if (setup_uring()) {
+        g_io.backend = SCT_IO_URING;
+        g_io.owner = pthread_self();
+        return true;
+    }
+    return backend == SCT_IO_AUTO;
+}
+
+void sct_io_finalize(void) {
+    // closing the ring unregisters the buffers
+    if (g_io.ring.fd >= 0) ring_teardown(&g_io.ring);
+    if (g_io.buffers) {
+        munmap(g_io.buffers, (size_t)SCT_IO_BUFFERS * SCT_IO_BUFFER_SIZE);
+        g_io.buffers = NULL;
+    }
+    g_io.backend = SCT_IO_SYSCALLS;
+    g_io.fixed = false;
+    g_io.busy = false;
+}
+
+char *sct_io_backend_name(void) {
+    if (g_io.backend != SCT_IO_URING) return "syscalls";
+    return g_io.fixed ? "io_uring, registered buffers" : "io_uring";
+}
+#pragma endregion
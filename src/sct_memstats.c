@@ -0,0 +1,251 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <malloc.h>
+#include "sct_memstats.h"
+
+/*
+    Allocation accounting by interposed malloc(), calloc(), realloc(),
+    free() and the aligned allocators (USE_MEMSTATS).
+    The interposers forward to glibc's __libc_* entry points and size every
+    block with malloc_usable_size(), so no header is added to blocks and
+    frees need no lookup. Counters are relaxed atomic adds into static
+    arrays; the hooks never allocate themselves.
+    A free is charged to the context freeing the block, not to the one
+    that allocated it. So "net" of a context is what it retained, and
+    allocs/frees per run show its churn.
+*/
+
+#define CTX_OTHER SCT_PHASE_COUNT    // outside of any hot path phase
+
+typedef struct mem_counters_ {
+    _Atomic uint64_t allocs;
+    _Atomic uint64_t frees;
+    _Atomic uint64_t bytes_allocated;
+    _Atomic uint64_t bytes_freed;
+    _Atomic int64_t net;
+    _Atomic int64_t peak;
+} mem_counters_t;
+
+typedef struct command_counters_ {
+    _Atomic uint64_t runs;
+    mem_counters_t mem;
+} command_counters_t;
+
+static mem_counters_t g_phase_mem[SCT_PHASE_COUNT + 1];
+static command_counters_t g_command_mem[SCT_METRICS_MAX_COMMANDS];
+static mem_counters_t g_total_mem;
+
+// context: phase in the high half, slot + 1 in the low one
+static __thread sct_memctx_t t_context = (sct_memctx_t)CTX_OTHER << 16;
+
+#pragma region context
+//------------------------------------------------------------------------------
+//              context
+
+sct_memctx_t sct_memstats_enter(sct_phase_t phase, int slot) {
+    sct_memctx_t prev = t_context;
+    t_context = ((sct_memctx_t)phase << 16) | (uint16_t)(slot + 1);
+#ifdef SCT_MEMSTATS
+    if ((phase == SCT_PHASE_EXEC) && (slot >= 0))
+        atomic_fetch_add_explicit(&g_command_mem[slot].runs, 1,
+            memory_order_relaxed);
+#endif
+    return prev;
+}
+
+void sct_memstats_leave(sct_memctx_t prev) {
+    t_context = prev;
+}
+
+sct_memctx_t sct_memstats_current(void) {
+    return t_context;
+}
+
+sct_memctx_t sct_memstats_adopt(sct_memctx_t ctx) {
+    sct_memctx_t prev = t_context;
+    t_context = ctx;
+    return prev;
+}
+
+bool sct_memstats_enabled(void) {
+#ifdef SCT_MEMSTATS
+    return true;
+#else
+    return false;
+#endif
+}
+#pragma endregion
+
+#ifdef SCT_MEMSTATS
+#pragma region accounting
+//------------------------------------------------------------------------------
+//              accounting
+
+static void count_alloc(mem_counters_t *c, size_t size) {
+    atomic_fetch_add_explicit(&c->allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->bytes_allocated, size, memory_order_relaxed);
+    int64_t net = atomic_fetch_add_explicit(&c->net, (int64_t)size,
+        memory_order_relaxed) + (int64_t)size;
+    int64_t peak = atomic_load_explicit(&c->peak, memory_order_relaxed);
+    while ((net > peak) && !atomic_compare_exchange_weak_explicit(&c->peak,
+        &peak, net, memory_order_relaxed, memory_order_relaxed));
+}
+
+static void count_free(mem_counters_t *c, size_t size) {
+    atomic_fetch_add_explicit(&c->frees, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->bytes_freed, size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&c->net, (int64_t)size, memory_order_relaxed);
+}
+
+static void account(size_t size, bool is_alloc) {
+    void (*count)(mem_counters_t *, size_t) = is_alloc ? count_alloc
+        : count_free;
+    sct_memctx_t ctx = t_context;
+    int slot = (int)(ctx & 0xFFFF) - 1;
+    count(&g_total_mem, size);
+    count(&g_phase_mem[ctx >> 16], size);
+    if (slot >= 0) count(&g_command_mem[slot].mem, size);
+}
+
+static void account_block(void *p, bool is_alloc) {
+    if (p) account(malloc_usable_size(p), is_alloc);
+}
+#pragma endregion
+
+#pragma region interposers
+//------------------------------------------------------------------------------
+//              interposers
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *p);
+
+void *malloc(size_t size) {
+    void *p = __libc_malloc(size);
+    account_block(p, true);
+    return p;
+}
+
+void *calloc(size_t n, size_t size) {
+    void *p = __libc_calloc(n, size);
+    account_block(p, true);
+    return p;
+}
+
+// a reallocation is a free of the old block and an allocation of the new
+void *realloc(void *old, size_t size) {
+    size_t old_size = old ? malloc_usable_size(old) : 0;
+    void *p = __libc_realloc(old, size);
+    if (!p && size) return NULL;    // the old block is intact
+    if (old) account(old_size, false);
+    account_block(p, true);
+    return p;
+}
+
+void free(void *p) {
+    account_block(p, false);
+    __libc_free(p);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    void *p = __libc_memalign(alignment, size);
+    account_block(p, true);
+    return p;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **pp, size_t alignment, size_t size) {
+    if ((alignment % sizeof(void *)) || (alignment & (alignment - 1)))
+        return EINVAL;
+    void *p = memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *pp = p;
+    return 0;
+}
+#pragma endregion
+#endif
+
+#pragma region report
+//------------------------------------------------------------------------------
+//              report
+
+static uint64_t load(_Atomic uint64_t *v) {
+    return atomic_load_explicit(v, memory_order_relaxed);
+}
+
+static void print_counters(char *title, mem_counters_t *c) {
+    printf("%-20s %10llu %10llu %12.1f %12.1f %10.1f %10.1f\n", title,
+        (unsigned long long)load(&c->allocs),
+        (unsigned long long)load(&c->frees),
+        load(&c->bytes_allocated) / 1024.0, load(&c->bytes_freed) / 1024.0,
+        atomic_load_explicit(&c->net, memory_order_relaxed) / 1024.0,
+        atomic_load_explicit(&c->peak, memory_order_relaxed) / 1024.0);
+}
+
+void sct_memstats_print(void) {
+    static char *phase_names[SCT_PHASE_COUNT + 1] = {
+        "parse", "validate", "exec", "complete", "other"
+    };
+    if (!sct_memstats_enabled()) {
+        printf("Allocation accounting is off, build with USE_MEMSTATS.\n");
+        return;
+    }
+
+    printf("Allocations by phase:\n%-20s %10s %10s %12s %12s %10s %10s\n",
+        "phase", "allocs", "frees", "alloc, KB", "freed, KB", "net, KB",
+        "peak, KB");
+    for (int i = 0; i <= SCT_PHASE_COUNT; i++)
+        print_counters(phase_names[i], &g_phase_mem[i]);
+    print_counters("total", &g_total_mem);
+
+    printf("\nAllocations by command (exec and validate):\n"
+        "%-20s %8s %12s %12s %12s %12s\n", "command", "runs", "allocs/run",
+        "bytes/run", "frees/run", "net, bytes");
+    int count = sct_metrics_command_count();
+    for (int i = 0; i < count; i++) {
+        command_counters_t *cc = &g_command_mem[i];
+        uint64_t runs = load(&cc->runs);
+        if (!runs) continue;
+        uint64_t allocs = load(&cc->mem.allocs);
+        printf("%-20s %8llu %12.1f %12.1f %12.1f %12lld%s\n",
+            sct_metrics_command_name(i), (unsigned long long)runs,
+            (double)allocs / runs,
+            (double)load(&cc->mem.bytes_allocated) / runs,
+            (double)load(&cc->mem.frees) / runs,
+            (long long)atomic_load_explicit(&cc->mem.net,
+                memory_order_relaxed),
+            allocs ? "" : "  allocation-free");
+    }
+}
+#pragma endregion
@@ -0,0 +1,307 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include "sct_metrics.h"
+
+/*
+    Always-on hot path metrics.
+    Per phase latency histograms plus per command counters and exec time
+    histograms. Updates are relaxed atomic adds into a shared memory
+    segment, so recording costs a few uncontended instructions and the
+    numbers are readable from outside the process at any time.
+    If shared memory is not available, the same layout is kept in private
+    memory and only the 'stats' command can show it.
+    The segment is removed however sctest ends: on exit, on the signals
+    ending it, and by the next sctest started if it crashed.
+*/
+
+static sct_metrics_shm_t *g_metrics = NULL;
+static bool g_metrics_shared = false;
+static char g_shm_name[64];
+
+#pragma region histograms
+//------------------------------------------------------------------------------
+//              histograms
+
+#define SUB_COUNT (1u << SCT_HIST_SUB_BITS)
+
+static int bucket_index(uint64_t v) {
+    if (v < SUB_COUNT) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    if (msb >= SCT_HIST_MAGNITUDES) return SCT_HIST_BUCKETS - 1;
+    int shift = msb - SCT_HIST_SUB_BITS;
+    int sub = (int)(v >> shift) & (SUB_COUNT - 1);
+    return ((msb - SCT_HIST_SUB_BITS + 1) << SCT_HIST_SUB_BITS) + sub;
+}
+
+// midpoint of the values range a bucket covers
+static uint64_t bucket_value(int idx) {
+    if (idx < SUB_COUNT) return idx;
+    int msb = (idx >> SCT_HIST_SUB_BITS) - 1 + SCT_HIST_SUB_BITS;
+    int shift = msb - SCT_HIST_SUB_BITS;
+    uint64_t low = (uint64_t)(SUB_COUNT + (idx & (SUB_COUNT - 1))) << shift;
+    return low + ((1ull << shift) >> 1);
+}
+
+static void histogram_record(sct_histogram_t *h, uint64_t ns) {
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->buckets[bucket_index(ns)], 1,
+        memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+    while ((ns > max) && !atomic_compare_exchange_weak_explicit(&h->max_ns,
+        &max, ns, memory_order_relaxed, memory_order_relaxed));
+}
+
+uint64_t sct_histogram_percentile(sct_histogram_t *h, double p) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (count == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * count + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < SCT_HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t v = bucket_value(i);
+            uint64_t max = atomic_load_explicit(&h->max_ns,
+                memory_order_relaxed);
+            return v < max ? v : max;
+        }
+    }
+    return atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+}
+#pragma endregion
+
+#pragma region recording
+//------------------------------------------------------------------------------
+//              recording
+
+int sct_metrics_register_command(char *name) {
+    if (!g_metrics) return -1;
+    uint32_t slot = atomic_load_explicit(&g_metrics->command_count,
+        memory_order_relaxed);
+    if (slot >= SCT_METRICS_MAX_COMMANDS) return SCT_METRICS_MAX_COMMANDS - 1;
+
+    sct_command_metrics_t *cm = &g_metrics->commands[slot];
+    if (slot == SCT_METRICS_MAX_COMMANDS - 1)
+        strncpy(cm->name, "(other)", SCT_METRICS_NAME_LEN - 1);
+    else strncpy(cm->name, name, SCT_METRICS_NAME_LEN - 1);
+    // publish the name before the slot becomes visible to a scraper
+    atomic_store_explicit(&g_metrics->command_count, slot + 1,
+        memory_order_release);
+    return slot;
+}
+
+void sct_metrics_record_phase(sct_phase_t phase, int slot, uint64_t ns) {
+    if (!g_metrics) return;
+    histogram_record(&g_metrics->phases[phase], ns);
+    if ((phase == SCT_PHASE_EXEC) && (slot >= 0))
+        histogram_record(&g_metrics->commands[slot].exec, ns);
+}
+
+void sct_metrics_record_run(int slot, int retval) {
+    if (!g_metrics || (slot < 0)) return;
+    sct_command_metrics_t *cm = &g_metrics->commands[slot];
+    atomic_fetch_add_explicit(&cm->runs, 1, memory_order_relaxed);
+    if (retval != 0)
+        atomic_fetch_add_explicit(&cm->failures, 1, memory_order_relaxed);
+}
+
+void sct_metrics_record_rejected(int slot) {
+    if (!g_metrics || (slot < 0)) return;
+    atomic_fetch_add_explicit(&g_metrics->commands[slot].rejected, 1,
+        memory_order_relaxed);
+}
+
+int sct_metrics_command_count(void) {
+    if (!g_metrics) return 0;
+    return (int)atomic_load_explicit(&g_metrics->command_count,
+        memory_order_acquire);
+}
+
+char *sct_metrics_command_name(int slot) {
+    return g_metrics ? g_metrics->commands[slot].name : "";
+}
+#pragma endregion
+
+#pragma region report
+//------------------------------------------------------------------------------
+//              report
+
+static void print_histogram(char *title, sct_histogram_t *h) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    uint64_t sum = atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+    printf("%-20s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", title,
+        (unsigned long long)count,
+        count ? (double)sum / count / 1e3 : 0.0,
+        sct_histogram_percentile(h, 50) / 1e3,
+        sct_histogram_percentile(h, 90) / 1e3,
+        sct_histogram_percentile(h, 99) / 1e3,
+        atomic_load_explicit(&h->max_ns, memory_order_relaxed) / 1e3);
+}
+
+void sct_metrics_print(void) {
+    static char *phase_names[SCT_PHASE_COUNT] = {
+        "parse", "validate", "exec", "complete"
+    };
+    if (!g_metrics) {
+        printf("Metrics are not available.\n");
+        return;
+    }
+
+    if (g_metrics_shared) printf("Metrics segment: %s\n", g_shm_name);
+    printf("\nLatencies, us:\n%-20s %8s %10s %10s %10s %10s %10s\n", "phase",
+        "count", "mean", "p50", "p90", "p99", "max");
+    for (int i = 0; i < SCT_PHASE_COUNT; i++)
+        print_histogram(phase_names[i], &g_metrics->phases[i]);
+
+    printf("\nCommands:\n%-20s %8s %8s %8s %10s %10s %10s\n", "command",
+        "runs", "failed", "rejected", "p50, us", "p99, us", "max, us");
+    uint32_t count = atomic_load_explicit(&g_metrics->command_count,
+        memory_order_acquire);
+    for (uint32_t i = 0; i < count; i++) {
+        sct_command_metrics_t *cm = &g_metrics->commands[i];
+        uint64_t runs = atomic_load_explicit(&cm->runs, memory_order_relaxed);
+        uint64_t rejected = atomic_load_explicit(&cm->rejected,
+            memory_order_relaxed);
+        if (!runs && !rejected) continue;
+        printf("%-20s %8llu %8llu %8llu %10.1f %10.1f %10.1f\n", cm->name,
+            (unsigned long long)runs,
+            (unsigned long long)atomic_load_explicit(&cm->failures,
+                memory_order_relaxed),
+            (unsigned long long)rejected,
+            sct_histogram_percentile(&cm->exec, 50) / 1e3,
+            sct_histogram_percentile(&cm->exec, 99) / 1e3,
+            atomic_load_explicit(&cm->exec.max_ns, memory_order_relaxed) / 1e3);
+    }
+}
+#pragma endregion
+
+#pragma region public metrics routines
+//------------------------------------------------------------------------------
+//              public metrics routines
+
+static void unlink_segment(void) {
+    if (g_metrics_shared) shm_unlink(g_shm_name);
+}
+
+// the handler is reset as it runs: the signal raised again ends sctest
+static void unlink_on_signal(int sig) {
+    unlink_segment();
+    raise(sig);
+}
+
+// sweep_stale_segments() removes the segments of sctest processes gone
+// without removing theirs; others' segments cannot be removed anyway
+static void sweep_stale_segments(void) {
+    DIR *d = opendir("/dev/shm");
+    if (!d) return;
+    char *prefix = SCT_METRICS_SHM_PREFIX + 1;
+    size_t len = strlen(prefix);
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (strncmp(de->d_name, prefix, len) != 0) continue;
+        char *end;
+        long pid = strtol(de->d_name + len, &end, 10);
+        if (*end || (pid <= 0) || (kill(pid, 0) == 0) || (errno != ESRCH))
+            continue;
+        char name[NAME_MAX + 2];
+        snprintf(name, sizeof(name), "/%s", de->d_name);
+        shm_unlink(name);
+    }
+    closedir(d);
+}
+
+static void unlink_at_exit(void) {
+    atexit(unlink_segment);
+    int signals[] = { SIGTERM, SIGHUP, SIGINT };
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        struct sigaction sa, old_sa;
+        // a signal ignored, as under nohup, stays so
+        if ((sigaction(signals[i], NULL, &old_sa) != 0)
+            || (old_sa.sa_handler != SIG_DFL)) continue;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = unlink_on_signal;
+        sa.sa_flags = SA_RESETHAND;
+        sigemptyset(&sa.sa_mask);
+        sigaction(signals[i], &sa, NULL);
+    }
+}
+
+static sct_metrics_shm_t *map_shared_segment(void) {
+    sweep_stale_segments();
+    snprintf(g_shm_name, sizeof(g_shm_name), "%s%d", SCT_METRICS_SHM_PREFIX,
+        (int)getpid());
+    int fd = shm_open(g_shm_name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd == -1) return NULL;
+
+    sct_metrics_shm_t *m = MAP_FAILED;
+    if (ftruncate(fd, sizeof(*m)) == 0)
+        m = mmap(NULL, sizeof(*m), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        shm_unlink(g_shm_name);
+        return NULL;
+    }
+    return m;
+}
+
+bool sct_metrics_initialize(void) {
+    g_metrics = map_shared_segment();
+    g_metrics_shared = g_metrics != NULL;
+    if (g_metrics_shared) unlink_at_exit();
+    if (!g_metrics) {
+        g_metrics = calloc(1, sizeof(*g_metrics));
+        if (!g_metrics) return false;
+    }
+    g_metrics->version = SCT_METRICS_VERSION;
+    g_metrics->hist_sub_bits = SCT_HIST_SUB_BITS;
+    g_metrics->hist_buckets = SCT_HIST_BUCKETS;
+    g_metrics->max_commands = SCT_METRICS_MAX_COMMANDS;
+    g_metrics->pid = getpid();
+    // a scraper must not trust the layout until the magic is set
+    atomic_thread_fence(memory_order_release);
+    g_metrics->magic = SCT_METRICS_MAGIC;
+    return true;
+}
+
+void sct_metrics_finalize(void) {
+    if (!g_metrics) return;
+    if (g_metrics_shared) {
+        munmap(g_metrics, sizeof(*g_metrics));
+        shm_unlink(g_shm_name);
+    }
+    else free(g_metrics);
+    g_metrics = NULL;
+    g_metrics_shared = false;
+}
+#pragma endregion
@@ -0,0 +1,290 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include "sct_plugins.h"
+#include "sct_core.h"
+#include "sct_utils.h"
+
+/*
+    Runtime plugins.
+    A plugin is a shared object accompanied by a small text manifest placed
+    in the plugin directory. At startup we read manifests only and register
+    the commands they declare with the Core as lazy commands. The shared
+    object itself is dlopen'ed the first time one of its commands runs,
+    so plugins that are installed but never used cost neither load time
+    nor resident memory.
+
+    Manifest format, one directive per line, '#' starts a comment:
+
+        library <path>      shared object, relative to the manifest's dir
+        init <symbol>       optional, int (*)(void) called once after dlopen;
+                            nonzero return rejects the library
+        command <name> <symbol> [<arg kind>[?] ...]
+
+    Argument kinds are: file, newfile, path, dir, text, inet.
+    A trailing '?' marks an optional argument.
+    Commands declared before any 'library' line are rejected.
+*/
+
+#define SCT_MANIFEST_MAX_LINE 1024
+#define SCT_MANIFEST_DELIMS " \t\r\n"
+
+typedef int (*sct_plugin_init_t)(void);
+
+typedef struct sct_plugin_lib_ {
+    struct sct_plugin_lib_ *next;
+    char *path;
+    char *init_symbol;
+    void *handle;
+    bool load_failed;
+} sct_plugin_lib_t;
+
+typedef struct sct_plugin_cmd_ {
+    struct sct_plugin_cmd_ *next;
+    sct_plugin_lib_t *lib;
+    char *symbol;
+} sct_plugin_cmd_t;
+
+static sct_plugin_lib_t *g_libs = NULL;
+static sct_plugin_cmd_t *g_cmds = NULL;
+
+#pragma region lazy loading
+//------------------------------------------------------------------------------
+//              lazy loading
+
+static bool load_library(sct_plugin_lib_t *lib) {
+    if (lib->handle) return true;
+    if (lib->load_failed) return false;
+
+    lib->handle = dlopen(lib->path, RTLD_NOW | RTLD_LOCAL);
+    if (!lib->handle) {
+        printf("Plugin load failed: %s\n", dlerror());
+        lib->load_failed = true;
+        return false;
+    }
+    if (lib->init_symbol) {
+        sct_plugin_init_t init_fn =
+            (sct_plugin_init_t)dlsym(lib->handle, lib->init_symbol);
+        if (!init_fn || init_fn() != 0) {
+            printf("Plugin initialization failed: %s\n", lib->path);
+            dlclose(lib->handle);
+            lib->handle = NULL;
+            lib->load_failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+// called by the Core upon the first run of a plugin command
+static sct_exec_cb_t resolve_plugin_command(char *name, void *ctx) {
+    sct_plugin_cmd_t *cmd = ctx;
+    if (!load_library(cmd->lib)) return NULL;
+
+    sct_exec_cb_t exec_fn = (sct_exec_cb_t)dlsym(cmd->lib->handle,
+        cmd->symbol);
+    if (!exec_fn)
+        printf("Plugin command \"%s\": %s\n", name, dlerror());
+    return exec_fn;
+}
+#pragma endregion
+
+#pragma region manifest parser
+//------------------------------------------------------------------------------
+//              manifest parser
+
+static bool arg_kind_from_str(char *s, sct_arg_t *arg) {
+    static const struct { char *name; sct_arg_kind_t kind; } kinds[] = {
+        { "file", SA_FILENAME },
+        { "newfile", SA_NEW_FILENAME },
+        { "path", SA_FILE_OR_DIR_NAME },
+        { "dir", SA_DIRNAME },
+        { "text", SA_TEXT },
+        { "inet", SA_INETNAME }
+    };
+
+    // manifests declare no variadic arguments
+    memset(arg, 0, sizeof(*arg));
+    size_t len = strlen(s);
+    arg->optional = (len > 1) && (s[len - 1] == '?');
+    if (arg->optional) len--;
+    for (int i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        if ((strlen(kinds[i].name) == len)
+            && (strncmp(kinds[i].name, s, len) == 0))
+        {
+            arg->kind = kinds[i].kind;
+            return true;
+        }
+    }
+    return false;
+}
+
+static sct_plugin_lib_t *add_library(char *dir, char *path) {
+    sct_plugin_lib_t *lib = malloc(sizeof(*lib));
+    if (!lib) return NULL;
+    memset(lib, 0, sizeof(*lib));
+    if (*path == '/') lib->path = scu_strdup(path);
+    else lib->path = scu_sprintf("%s/%s", dir, path);
+    lib->next = g_libs;
+    g_libs = lib;
+    return lib;
+}
+
+static bool add_plugin_command(sct_plugin_lib_t *lib, char *name,
+    char *symbol, char **kinds, int kind_count)
+{
+    sct_arg_t args[SCT_MAX_ARGS] = { 0 };
+    if (kind_count > SCT_MAX_ARGS) return false;
+    for (int i = 0; i < kind_count; i++)
+        if (!arg_kind_from_str(kinds[i], &args[i])) return false;
+
+    sct_plugin_cmd_t *cmd = malloc(sizeof(*cmd));
+    if (!cmd) return false;
+    cmd->lib = lib;
+    cmd->symbol = scu_strdup(symbol);
+    if (!sct_add_lazy_command(name, args, kind_count, resolve_plugin_command,
+        cmd))
+    {
+        free(cmd->symbol);
+        free(cmd);
+        return false;
+    }
+    cmd->next = g_cmds;
+    g_cmds = cmd;
+    return true;
+}
+
+// returns the number of commands registered from the manifest
+static int load_manifest(char *dir, char *fn) {
+    FILE *f = fopen(fn, "r");
+    if (!f) {
+        perror(fn);
+        return 0;
+    }
+
+    int count = 0;
+    int line_no = 0;
+    sct_plugin_lib_t *lib = NULL;
+    char line[SCT_MANIFEST_MAX_LINE];
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = 0;
+
+        char *words[SCT_MAX_ARGS + 3];
+        int word_count = 0;
+        char *save = NULL;
+        char *w = strtok_r(line, SCT_MANIFEST_DELIMS, &save);
+        while (w && (word_count < sizeof(words) / sizeof(words[0]))) {
+            words[word_count++] = w;
+            w = strtok_r(NULL, SCT_MANIFEST_DELIMS, &save);
+        }
+        if (word_count == 0) continue;
+
+        bool ok = false;
+        if ((strcmp(words[0], "library") == 0) && (word_count == 2)) {
+            lib = add_library(dir, words[1]);
+            ok = lib != NULL;
+        }
+        else if ((strcmp(words[0], "init") == 0) && (word_count == 2) && lib) {
+            free(lib->init_symbol);
+            lib->init_symbol = scu_strdup(words[1]);
+            ok = true;
+        }
+        else if ((strcmp(words[0], "command") == 0) && (word_count >= 3)
+            && !w && lib)
+        {
+            ok = add_plugin_command(lib, words[1], words[2], &words[3],
+                word_count - 3);
+            if (ok) count++;
+        }
+        if (!ok) printf("%s:%d: bad manifest entry.\n", fn, line_no);
+    }
+    fclose(f);
+    return count;
+}
+#pragma endregion
+
+#pragma region public plugin routines
+//------------------------------------------------------------------------------
+//              public plugin routines
+
+// The SCT_DEFAULT_PLUGIN_DIR next to the executable, NULL if the executable
+// cannot be located; the caller frees it.
+char *sct_default_plugin_dir(void) {
+    char exe[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0) return NULL;
+    exe[len] = 0;
+    char *slash = strrchr(exe, '/');
+    if (!slash) return NULL;
+    *slash = 0;
+    return scu_sprintf("%s/%s", exe, SCT_DEFAULT_PLUGIN_DIR);
+}
+
+// Registers commands of every manifest found in dir. No code is loaded here.
+// A missing plugin directory is not an error.
+int sct_load_plugin_manifests(char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+
+    int count = 0;
+    size_t ext_len = strlen(SCT_PLUGIN_MANIFEST_EXT);
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if ((len <= ext_len) || (strcmp(de->d_name + len - ext_len,
+            SCT_PLUGIN_MANIFEST_EXT) != 0)) continue;
+
+        char *fn = scu_sprintf("%s/%s", dir, de->d_name);
+        if (fn) {
+            count += load_manifest(dir, fn);
+            free(fn);
+        }
+    }
+    closedir(d);
+    return count;
+}
+
+void sct_unload_plugins(void) {
+    while (g_cmds) {
+        sct_plugin_cmd_t *cmd = g_cmds;
+        g_cmds = g_cmds->next;
+        free(cmd->symbol);
+        free(cmd);
+    }
+    while (g_libs) {
+        sct_plugin_lib_t *lib = g_libs;
+        g_libs = g_libs->next;
+        if (lib->handle) dlclose(lib->handle);
+        free(lib->path);
+        free(lib->init_symbol);
+        free(lib);
+    }
+}
+#pragma endregion
@@ -0,0 +1,348 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "sct_pool.h"
+#include "sct_memstats.h"
+#include "sct_trace.h"
+#include "sct_utils.h"
+
+/*
+    Worker pool for recursive jobs.
+    Worker threads are started on first use and kept until
+    sct_pool_finalize(), so a job costs no thread creation and the trace
+    shows the same worker tracks across commands. One job runs at a time;
+    the calling thread takes part in it as worker 0.
+    The initial tasks of a job are kept in a LIFO stack shared by the
+    workers. A task pushed by a worker goes to that worker's own deque:
+    the worker takes its newest task first, so a walk goes depth first,
+    and a worker with nothing left steals the oldest task of another one,
+    the top of a subtree, which is likely the most work. Each deque has
+    a lock of its own, taken by its owner and, rarely, by a thief.
+    The count of queued tasks and of busy workers are atomic; a worker
+    finding no task sleeps on the job's condition variable until a task
+    is pushed or no worker is busy any more, which means the job is done.
+    Every worker records one trace span covering its part of a job, and
+    charges its allocations to the memstats context of the caller.
+*/
+
+#define SCT_POOL_MAX_WORKERS 16
+
+// a worker's tasks, oldest at items[first], newest at items[last - 1]
+typedef struct pool_deque_ {
+    pthread_mutex_t lock;
+    void **items;
+    size_t first;
+    size_t last;
+    size_t capacity;
+} __attribute__((aligned(64))) pool_deque_t;
+
+struct sct_pool_ {
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    void **stack;       // the initial tasks, under lock
+    size_t count;
+    size_t capacity;
+    pool_deque_t deques[SCT_POOL_MAX_WORKERS];
+    size_t queued;      // tasks in the stack and the deques
+    int busy;           // workers running or looking for a task
+    int sleeping;       // workers waiting on wakeup
+    bool done;
+    int workers;        // workers allowed to join the job
+    bool failed;        // out of memory while pushing
+    sct_pool_fn_t fn;
+    void *ctx;
+    char *name;
+    sct_memctx_t memctx;    // the caller's, taken on by every worker
+};
+
+typedef struct pool_threads_ {
+    pthread_mutex_t run_lock;   // serializes jobs
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;      // a job was posted, or shutdown
+    pthread_cond_t left;        // a thread left a job
+    pthread_t threads[SCT_POOL_MAX_WORKERS];
+    int thread_count;
+    sct_pool_t *job;
+    uint64_t job_seq;
+    int joined;                 // threads working on the current job
+    bool shutdown;
+} pool_threads_t;
+
+static pool_threads_t g_threads = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER
+};
+
+int sct_pool_default_workers(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    return n < SCT_POOL_MAX_WORKERS ? (int)n : SCT_POOL_MAX_WORKERS;
+}
+
+#pragma region jobs
+//------------------------------------------------------------------------------
+//              jobs
+
+// the worker the running thread is in the current job, -1 if none
+static __thread int t_worker = -1;
+
+static bool grow(void ***items, size_t *capacity) {
+    size_t new_capacity = *capacity ? *capacity * 2 : 64;
+    void **grown = realloc(*items, new_capacity * sizeof(void *));
+    if (!grown) return false;
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+static bool deque_push(pool_deque_t *d, void *task) {
+    pthread_mutex_lock(&d->lock);
+    if ((d->last == d->capacity) && d->first) {
+        // reuse the room left by the thieves
+        memmove(d->items, d->items + d->first,
+            (d->last - d->first) * sizeof(void *));
+        d->last -= d->first;
+        d->first = 0;
+    }
+    bool pushed = (d->last < d->capacity) || grow(&d->items, &d->capacity);
+    if (pushed) d->items[d->last++] = task;
+    pthread_mutex_unlock(&d->lock);
+    return pushed;
+}
+
+// deque_take() takes the newest task of a deque, or the oldest one
+// for a thief; tasks may be NULL
+static bool deque_take(pool_deque_t *d, bool steal, void **task) {
+    pthread_mutex_lock(&d->lock);
+    bool taken = d->first < d->last;
+    if (taken) *task = steal ? d->items[d->first++] : d->items[--d->last];
+    if (d->first == d->last) d->first = d->last = 0;
+    pthread_mutex_unlock(&d->lock);
+    return taken;
+}
+
+static void wake_one(sct_pool_t *pool) {
+    if (!__atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST)) return;
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void sct_pool_push(sct_pool_t *pool, void *task) {
+    // counted first, so queued is never less than the tasks to take
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    bool pushed;
+    if (t_worker < 0) {
+        pthread_mutex_lock(&pool->lock);
+        pushed = (pool->count < pool->capacity)
+            || grow(&pool->stack, &pool->capacity);
+        if (pushed) pool->stack[pool->count++] = task;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    else pushed = deque_push(&pool->deques[t_worker], task);
+    if (!pushed) {
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&pool->failed, true, __ATOMIC_RELAXED);
+        return;
+    }
+    wake_one(pool);
+}
+
+// take() finds a task for a worker: its own newest, the newest initial
+// one, or the oldest of another worker
+static bool take(sct_pool_t *pool, int index, void **task) {
+    if (!__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST)) return false;
+    bool taken = deque_take(&pool->deques[index], false, task);
+    if (!taken && __atomic_load_n(&pool->count, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&pool->lock);
+        taken = pool->count > 0;
+        if (taken) *task = pool->stack[--pool->count];
+        pthread_mutex_unlock(&pool->lock);
+    }
+    for (int i = 1; !taken && (i < pool->workers); i++)
+        taken = deque_take(&pool->deques[(index + i) % pool->workers], true,
+            task);
+    if (taken) __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    return taken;
+}
+
+// idle() waits for a task to be queued; false once the job is done.
+// Only busy workers push, so with none busy and none queued, there will
+// be no more tasks.
+static bool idle(sct_pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+    while (!pool->done && !__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST)) {
+        if (!__atomic_load_n(&pool->busy, __ATOMIC_SEQ_CST)) {
+            pool->done = true;
+            pthread_cond_broadcast(&pool->wakeup);
+        }
+        else pthread_cond_wait(&pool->wakeup, &pool->lock);
+    }
+    __atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+    bool done = pool->done;
+    pthread_mutex_unlock(&pool->lock);
+    return !done;
+}
+
+// work() takes tasks until none is queued and no worker is busy
+static void work(sct_pool_t *pool, int index) {
+    uint64_t t0 = scu_now_ns();
+    sct_memctx_t memctx = sct_memstats_adopt(pool->memctx);
+    t_worker = index;
+    __atomic_add_fetch(&pool->busy, 1, __ATOMIC_SEQ_CST);
+    while (true) {
+        void *task;
+        if (take(pool, index, &task)) {
+            pool->fn(pool, task, index, pool->ctx);
+            continue;
+        }
+        // the last busy worker may leave nothing to do for anyone: the
+        // sleepers are woken to see it
+        if (!__atomic_sub_fetch(&pool->busy, 1, __ATOMIC_SEQ_CST)
+            && __atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST)) {
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_broadcast(&pool->wakeup);
+            pthread_mutex_unlock(&pool->lock);
+        }
+        if (!idle(pool)) break;
+        __atomic_add_fetch(&pool->busy, 1, __ATOMIC_SEQ_CST);
+    }
+    t_worker = -1;
+    sct_trace_span(pool->name, "pool", NULL, t0, scu_now_ns());
+    sct_memstats_leave(memctx);
+}
+#pragma endregion
+
+#pragma region worker threads
+//------------------------------------------------------------------------------
+//              worker threads
+
+static void *worker_main(void *arg) {
+    int index = (int)(intptr_t)arg;
+    uint64_t seen_seq = 0;
+    char name[32];
+    snprintf(name, sizeof(name), "pool worker %d", index);
+    sct_trace_thread_name(name);
+
+    pthread_mutex_lock(&g_threads.lock);
+    while (true) {
+        sct_pool_t *job = g_threads.job;
+        if (g_threads.shutdown) break;
+        if (!job || (g_threads.job_seq == seen_seq) || (index >= job->workers))
+        {
+            pthread_cond_wait(&g_threads.wakeup, &g_threads.lock);
+            continue;
+        }
+        seen_seq = g_threads.job_seq;
+        g_threads.joined++;
+        pthread_mutex_unlock(&g_threads.lock);
+        work(job, index);
+        pthread_mutex_lock(&g_threads.lock);
+        g_threads.joined--;
+        pthread_cond_signal(&g_threads.left);
+    }
+    pthread_mutex_unlock(&g_threads.lock);
+    return NULL;
+}
+
+// start_threads() makes sure there are workers - 1 threads besides
+// the caller; fewer if threads can not be created
+static void start_threads(int workers) {
+    pthread_mutex_lock(&g_threads.lock);
+    while (g_threads.thread_count < workers - 1) {
+        int index = g_threads.thread_count + 1;
+        if (scu_thread_create(&g_threads.threads[g_threads.thread_count],
+            worker_main, (void *)(intptr_t)index) != 0) break;
+        g_threads.thread_count++;
+    }
+    pthread_mutex_unlock(&g_threads.lock);
+}
+
+void sct_pool_start(int workers) {
+    if (workers > SCT_POOL_MAX_WORKERS) workers = SCT_POOL_MAX_WORKERS;
+    start_threads(workers);
+}
+
+bool sct_pool_run(char *name, int workers, sct_pool_fn_t fn, void *ctx,
+    void **tasks, size_t count)
+{
+    if (workers < 1) workers = 1;
+    if (workers > SCT_POOL_MAX_WORKERS) workers = SCT_POOL_MAX_WORKERS;
+
+    sct_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.wakeup, NULL);
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.name = name;
+    pool.memctx = sct_memstats_current();
+    pool.workers = workers;
+    for (int i = 0; i < workers; i++)
+        pthread_mutex_init(&pool.deques[i].lock, NULL);
+    for (size_t i = 0; i < count; i++) sct_pool_push(&pool, tasks[i]);
+
+    pthread_mutex_lock(&g_threads.run_lock);
+    if (workers > 1) start_threads(workers);
+    pthread_mutex_lock(&g_threads.lock);
+    g_threads.job = &pool;
+    g_threads.job_seq++;
+    pthread_cond_broadcast(&g_threads.wakeup);
+    pthread_mutex_unlock(&g_threads.lock);
+
+    work(&pool, 0);
+
+    // the pool lives on this stack: wait for every thread to leave it
+    pthread_mutex_lock(&g_threads.lock);
+    g_threads.job = NULL;
+    while (g_threads.joined) pthread_cond_wait(&g_threads.left, &g_threads.lock);
+    pthread_mutex_unlock(&g_threads.lock);
+    pthread_mutex_unlock(&g_threads.run_lock);
+
+    free(pool.stack);
+    for (int i = 0; i < workers; i++) {
+        free(pool.deques[i].items);
+        pthread_mutex_destroy(&pool.deques[i].lock);
+    }
+    pthread_cond_destroy(&pool.wakeup);
+    pthread_mutex_destroy(&pool.lock);
+    return !pool.failed;
+}
+
+void sct_pool_finalize(void) {
+    pthread_mutex_lock(&g_threads.lock);
+    g_threads.shutdown = true;
+    pthread_cond_broadcast(&g_threads.wakeup);
+    pthread_mutex_unlock(&g_threads.lock);
+    for (int i = 0; i < g_threads.thread_count; i++)
+        pthread_join(g_threads.threads[i], NULL);
+    g_threads.thread_count = 0;
+    g_threads.shutdown = false;
+}
+#pragma endregion
@@ -0,0 +1,494 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <linux/perf_event.h>
+#include "sct_profile.h"
+#include "sct_utils.h"
+
+/*
+    Sampling CPU profiler for a single command.
+    The preferred source is a perf_event_open() software cpu-clock event
+    per thread: the kernel walks the user stack on every sample (frame
+    pointers, hence -fno-omit-frame-pointer) and puts the call chain into
+    the event's ring buffer; a reader thread drains them all. Per-thread
+    events cannot share a ring, so each thread found at the start, the
+    persistent pool workers among them, gets its own. Inherited events
+    cannot be mapped: threads started while sampling are not sampled, and
+    those still running at the stop are counted as missed.
+    If perf events are not permitted (perf_event_paranoid, seccomp),
+    an ITIMER_PROF timer raises SIGPROF per millisecond of process CPU
+    time and the handler takes the stack with backtrace().
+    Either way the samples land in one preallocated store, so the signal
+    handler never allocates. Symbols are resolved with dladdr() when
+    sampling stops: exported functions by name, others as module+offset.
+*/
+
+#define SCT_PROFILE_PERIOD_NS 1000000       // 1 ms
+#define SCT_PROFILE_MAX_SAMPLES 20000
+#define SCT_PROFILE_MAX_DEPTH 64
+#define SCT_PROFILE_RING_PAGES 64           // a power of 2
+#define SCT_PROFILE_MAX_THREADS 64
+#define SCT_PROFILE_SIGNAL_SKIP 2           // handler and sigreturn frames
+
+typedef enum profile_method_ {
+    PM_NONE,
+    PM_PERF,
+    PM_SIGPROF
+} profile_method_t;
+
+typedef struct profile_sample_ {
+    int depth;
+    uintptr_t ips[SCT_PROFILE_MAX_DEPTH];   // leaf first
+} profile_sample_t;
+
+// the event of a thread and its ring buffer
+typedef struct profile_ring_ {
+    pid_t tid;
+    int fd;
+    struct perf_event_mmap_page *meta;
+} profile_ring_t;
+
+typedef struct profiler_ {
+    profile_method_t method;
+    profile_sample_t *samples;
+    _Atomic long sample_count;
+    _Atomic long dropped;
+
+    // perf_event state
+    profile_ring_t rings[SCT_PROFILE_MAX_THREADS];
+    int ring_count;
+    long missed;            // threads running but not sampled
+    pid_t missed_tids[SCT_PROFILE_MAX_THREADS];
+    size_t ring_size;
+    size_t page_size;
+    pthread_t reader;
+    pid_t reader_tid;
+    _Atomic bool stopping;
+
+    // SIGPROF state
+    struct sigaction old_action;
+} profiler_t;
+
+static profiler_t g_profiler = { PM_NONE };
+
+#pragma region sample store
+//------------------------------------------------------------------------------
+//              sample store
+
+// claims a slot in the store; safe to call from the signal handler
+static profile_sample_t *claim_sample(void) {
+    long idx = atomic_fetch_add_explicit(&g_profiler.sample_count, 1,
+        memory_order_relaxed);
+    if (idx < SCT_PROFILE_MAX_SAMPLES) return &g_profiler.samples[idx];
+    atomic_fetch_sub_explicit(&g_profiler.sample_count, 1,
+        memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_profiler.dropped, 1, memory_order_relaxed);
+    return NULL;
+}
+#pragma endregion
+
+#pragma region perf_event
+//------------------------------------------------------------------------------
+//              perf_event
+
+static void copy_from_ring(profile_ring_t *r, void *dst, uint64_t offset,
+    size_t len)
+{
+    char *data = (char *)r->meta + g_profiler.page_size;
+    size_t size = g_profiler.ring_size;
+    size_t pos = offset & (size - 1);
+    size_t first = len < size - pos ? len : size - pos;
+    memcpy(dst, data + pos, first);
+    memcpy((char *)dst + first, data, len - first);
+}
+
+// the callchain of PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN records
+static void add_callchain(uint64_t *chain, uint64_t nr) {
+    profile_sample_t *s = claim_sample();
+    if (!s) return;
+    s->depth = 0;
+    for (uint64_t i = 0; (i < nr) && (s->depth < SCT_PROFILE_MAX_DEPTH); i++)
+    {
+        if (chain[i] >= PERF_CONTEXT_MAX) continue;   // context markers
+        s->ips[s->depth++] = chain[i];
+    }
+}
+
+static void drain_ring(profile_ring_t *r) {
+    struct perf_event_mmap_page *meta = r->meta;
+    uint64_t head = atomic_load_explicit((_Atomic uint64_t *)&meta->data_head,
+        memory_order_acquire);
+    uint64_t tail = meta->data_tail;
+    uint64_t record[sizeof(struct perf_event_header) / 8 + 2
+        + PERF_MAX_STACK_DEPTH + 8];
+
+    while (tail < head) {
+        struct perf_event_header hdr;
+        copy_from_ring(r, &hdr, tail, sizeof(hdr));
+        if ((hdr.size > sizeof(record)) || (hdr.size < sizeof(hdr))) break;
+        copy_from_ring(r, record, tail, hdr.size);
+        if (hdr.type == PERF_RECORD_SAMPLE) {
+            // header, u32 pid, u32 tid, u64 nr, u64 ips[nr]
+            uint64_t nr = record[2];
+            if ((3 + nr) * 8 <= hdr.size) add_callchain(&record[3], nr);
+        }
+        else if (hdr.type == PERF_RECORD_LOST) {
+            // header, u64 id, u64 lost
+            atomic_fetch_add_explicit(&g_profiler.dropped, (long)record[2],
+                memory_order_relaxed);
+        }
+        tail += hdr.size;
+    }
+    atomic_store_explicit((_Atomic uint64_t *)&meta->data_tail, head,
+        memory_order_release);
+}
+
+static void *perf_reader(void *arg) {
+    struct pollfd pfds[SCT_PROFILE_MAX_THREADS];
+    g_profiler.reader_tid = (pid_t)syscall(SYS_gettid);
+    for (int i = 0; i < g_profiler.ring_count; i++) {
+        pfds[i].fd = g_profiler.rings[i].fd;
+        pfds[i].events = POLLIN;
+    }
+    while (!atomic_load(&g_profiler.stopping)) {
+        poll(pfds, g_profiler.ring_count, 10);
+        for (int i = 0; i < g_profiler.ring_count; i++)
+            drain_ring(&g_profiler.rings[i]);
+    }
+    return NULL;
+}
+
+static void close_rings(void) {
+    for (int i = 0; i < g_profiler.ring_count; i++) {
+        munmap(g_profiler.rings[i].meta,
+            g_profiler.page_size + g_profiler.ring_size);
+        close(g_profiler.rings[i].fd);
+    }
+    g_profiler.ring_count = 0;
+}
+
+// add_ring() opens the event of a thread
+static bool add_ring(pid_t tid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_CPU_CLOCK;
+    attr.sample_period = SCT_PROFILE_PERIOD_NS;
+    attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_callchain_kernel = 1;
+    attr.wakeup_events = 64;
+
+    if (g_profiler.ring_count == SCT_PROFILE_MAX_THREADS) return false;
+    int fd = (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1,
+        PERF_FLAG_FD_CLOEXEC);
+    if (fd == -1) return false;
+
+    void *ring = mmap(NULL, g_profiler.page_size + g_profiler.ring_size,
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    profile_ring_t *r = &g_profiler.rings[g_profiler.ring_count++];
+    r->tid = tid;
+    r->fd = fd;
+    r->meta = ring;
+    return true;
+}
+
+// known() tells whether a thread is sampled or counted as missed already
+static bool known(pid_t tid) {
+    for (int i = 0; i < g_profiler.ring_count; i++)
+        if (g_profiler.rings[i].tid == tid) return true;
+    for (long i = 0; (i < g_profiler.missed)
+        && (i < SCT_PROFILE_MAX_THREADS); i++)
+        if (g_profiler.missed_tids[i] == tid) return true;
+    return tid == g_profiler.reader_tid;
+}
+
+// io_uring's workers run in the kernel alone: there is no user stack
+static bool kernel_worker(pid_t tid) {
+    char fn[64], comm[32] = "";
+    snprintf(fn, sizeof(fn), "/proc/self/task/%d/comm", (int)tid);
+    FILE *f = fopen(fn, "r");
+    if (!f) return false;
+    if (!fgets(comm, sizeof(comm), f)) comm[0] = 0;
+    fclose(f);
+    return strncmp(comm, "iou-", 4) == 0;
+}
+
+// for_other_threads() calls fn for the running threads not known yet
+static void for_other_threads(void (*fn)(pid_t tid)) {
+    DIR *d = opendir("/proc/self/task");
+    if (!d) return;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        pid_t tid = (pid_t)atoi(de->d_name);
+        if ((tid > 0) && !known(tid) && !kernel_worker(tid)) fn(tid);
+    }
+    closedir(d);
+}
+
+static void count_missed(pid_t tid) {
+    if (g_profiler.missed < SCT_PROFILE_MAX_THREADS)
+        g_profiler.missed_tids[g_profiler.missed] = tid;
+    g_profiler.missed++;
+}
+
+// a thread gone meanwhile is not missed
+static void add_thread(pid_t tid) {
+    if (!add_ring(tid) && (errno != ESRCH)) count_missed(tid);
+}
+
+static bool start_perf(void) {
+    g_profiler.page_size = sysconf(_SC_PAGESIZE);
+    g_profiler.ring_size = SCT_PROFILE_RING_PAGES * g_profiler.page_size;
+    g_profiler.ring_count = 0;
+    g_profiler.missed = 0;
+    g_profiler.reader_tid = 0;
+    // the calling thread is the one that must be sampled
+    if (!add_ring((pid_t)syscall(SYS_gettid))) return false;
+    for_other_threads(add_thread);
+    atomic_store(&g_profiler.stopping, false);
+    if (scu_thread_create(&g_profiler.reader, perf_reader, NULL) != 0) {
+        close_rings();
+        return false;
+    }
+    for (int i = 0; i < g_profiler.ring_count; i++) {
+        ioctl(g_profiler.rings[i].fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(g_profiler.rings[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    return true;
+}
+
+static void stop_perf(void) {
+    for (int i = 0; i < g_profiler.ring_count; i++)
+        ioctl(g_profiler.rings[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+    atomic_store(&g_profiler.stopping, true);
+    pthread_join(g_profiler.reader, NULL);
+    for (int i = 0; i < g_profiler.ring_count; i++)
+        drain_ring(&g_profiler.rings[i]);
+    // the reader is gone: its tid may have been taken by a new thread
+    g_profiler.reader_tid = 0;
+    for_other_threads(count_missed);
+    close_rings();
+}
+#pragma endregion
+
+#pragma region SIGPROF
+//------------------------------------------------------------------------------
+//              SIGPROF
+
+static void sigprof_handler(int sig) {
+    int saved_errno = errno;
+    void *frames[SCT_PROFILE_MAX_DEPTH + SCT_PROFILE_SIGNAL_SKIP];
+    int n = backtrace(frames, SCT_PROFILE_MAX_DEPTH + SCT_PROFILE_SIGNAL_SKIP);
+    profile_sample_t *s = claim_sample();
+    if (s) {
+        s->depth = 0;
+        for (int i = SCT_PROFILE_SIGNAL_SKIP; i < n; i++)
+            s->ips[s->depth++] = (uintptr_t)frames[i];
+    }
+    errno = saved_errno;
+}
+
+static bool start_sigprof(void) {
+    // the first backtrace() loads the unwinder, never do it in the handler
+    void *warmup[4];
+    backtrace(warmup, 4);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigprof_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, &g_profiler.old_action) == -1) return false;
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = SCT_PROFILE_PERIOD_NS / 1000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) == -1) {
+        sigaction(SIGPROF, &g_profiler.old_action, NULL);
+        return false;
+    }
+    return true;
+}
+
+static void stop_sigprof(void) {
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sigaction(SIGPROF, &g_profiler.old_action, NULL);
+}
+#pragma endregion
+
+#pragma region folded output
+//------------------------------------------------------------------------------
+//              folded output
+
+// appends the symbol of ip to *buf as "name" or "module+0xoffset"
+static void append_symbol(char **buf, size_t *len, size_t *cap, uintptr_t ip)
+{
+    char sym[256];
+    Dl_info info;
+    if (!dladdr((void *)ip, &info)) memset(&info, 0, sizeof(info));
+    if (info.dli_sname)
+        snprintf(sym, sizeof(sym), "%s", info.dli_sname);
+    else if (info.dli_fname && info.dli_fname[0]) {
+        char *base = strrchr(info.dli_fname, '/');
+        snprintf(sym, sizeof(sym), "%s+0x%lx",
+            base ? base + 1 : info.dli_fname,
+            (unsigned long)(ip - (uintptr_t)info.dli_fbase));
+    }
+    else snprintf(sym, sizeof(sym), "0x%lx", (unsigned long)ip);
+
+    size_t n = strlen(sym);
+    if (*len + n + 2 > *cap) {
+        size_t new_cap = (*cap + n + 2) * 2;
+        char *p = realloc(*buf, new_cap);
+        if (!p) return;
+        *buf = p;
+        *cap = new_cap;
+    }
+    if (*len) (*buf)[(*len)++] = ';';
+    memcpy(*buf + *len, sym, n + 1);
+    *len += n;
+}
+
+static char *fold_sample(profile_sample_t *s) {
+    char *buf = NULL;
+    size_t len = 0, cap = 0;
+    // root first; return addresses point past the call, so step back
+    // into it to get the caller's symbol right
+    for (int i = s->depth - 1; i >= 0; i--)
+        append_symbol(&buf, &len, &cap, i ? s->ips[i] - 1 : s->ips[i]);
+    return buf;
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+static long write_folded(char *fn, long count) {
+    FILE *f = fopen(fn, "w");
+    if (!f) {
+        perror(fn);
+        return -1;
+    }
+    char **stacks = calloc(count ? count : 1, sizeof(*stacks));
+    if (!stacks) {
+        fclose(f);
+        return -1;
+    }
+    long n = 0;
+    for (long i = 0; i < count; i++) {
+        if (g_profiler.samples[i].depth == 0) continue;
+        stacks[n] = fold_sample(&g_profiler.samples[i]);
+        if (stacks[n]) n++;
+    }
+    qsort(stacks, n, sizeof(*stacks), compare_strings);
+    for (long i = 0; i < n; ) {
+        long j = i + 1;
+        while ((j < n) && (strcmp(stacks[i], stacks[j]) == 0)) j++;
+        fprintf(f, "%s %ld\n", stacks[i], j - i);
+        i = j;
+    }
+    for (long i = 0; i < n; i++) free(stacks[i]);
+    free(stacks);
+    fclose(f);
+    return n;
+}
+#pragma endregion
+
+#pragma region public profile routines
+//------------------------------------------------------------------------------
+//              public profile routines
+
+bool sct_profile_start(void) {
+    if (g_profiler.method != PM_NONE) {
+        printf("Profiling is already active.\n");
+        return false;
+    }
+    g_profiler.samples = malloc(SCT_PROFILE_MAX_SAMPLES
+        * sizeof(*g_profiler.samples));
+    if (!g_profiler.samples) {
+        printf("Out of memory.\n");
+        return false;
+    }
+    atomic_store(&g_profiler.sample_count, 0);
+    atomic_store(&g_profiler.dropped, 0);
+
+    if (start_perf()) g_profiler.method = PM_PERF;
+    else if (start_sigprof()) g_profiler.method = PM_SIGPROF;
+    else {
+        perror("profile");
+        free(g_profiler.samples);
+        g_profiler.samples = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool sct_profile_stop(char *fn, sct_profile_summary_t *summary) {
+    if (g_profiler.method == PM_NONE) return false;
+    summary->threads = 0;
+    summary->missed = 0;
+    if (g_profiler.method == PM_PERF) {
+        summary->threads = g_profiler.ring_count;
+        stop_perf();
+        summary->missed = g_profiler.missed;
+    }
+    else stop_sigprof();
+
+    summary->method = g_profiler.method == PM_PERF ? "perf_event" : "SIGPROF";
+    summary->dropped = atomic_load(&g_profiler.dropped);
+    summary->samples = write_folded(fn, atomic_load(&g_profiler.sample_count));
+
+    free(g_profiler.samples);
+    g_profiler.samples = NULL;
+    g_profiler.method = PM_NONE;
+    return summary->samples >= 0;
+}
+#pragma endregion
@@ -0,0 +1,334 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "sct_record.h"
+
+/*
+    Structured output.
+    A record is encoded field by field into a buffer of the caller's,
+    grown as needed and kept from one record to the next, then written
+    with a single fwrite() to a fully buffered stream, which commands
+    flush when they are done. So a record costs no system call, and a
+    reader never sees one cut by another write.
+    To keep records apart from all other output, sct_record_start() moves
+    the original standard output to a descriptor of its own and points
+    descriptor 1 at stderr: the banner, prompts, messages and external
+    programs' output can then not mix into the records.
+*/
+
+#define SCT_RECORD_BUFFER_SIZE (256 * 1024)
+
+static sct_output_t g_mode = SCT_OUTPUT_TEXT;
+static FILE *g_out = NULL;
+
+#pragma region output
+//------------------------------------------------------------------------------
+//              output
+
+bool sct_record_start(sct_output_t mode) {
+    if (mode == SCT_OUTPUT_TEXT) return true;
+    fflush(stdout);
+    int fd = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3);
+    FILE *out = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!out || (dup2(STDERR_FILENO, STDOUT_FILENO) < 0)) {
+        perror("output");
+        if (out) fclose(out);
+        else if (fd >= 0) close(fd);
+        return false;
+    }
+    setvbuf(out, NULL, _IOFBF, SCT_RECORD_BUFFER_SIZE);
+    sct_record_set_output(mode, out);
+    return true;
+}
+
+void sct_record_set_output(sct_output_t mode, FILE *out) {
+    g_mode = mode;
+    g_out = out;
+}
+
+bool sct_records(void) {
+    return g_mode != SCT_OUTPUT_TEXT;
+}
+
+void sct_record_flush(void) {
+    if (g_out) fflush(g_out);
+}
+
+void sct_record_finish(void) {
+    if (g_out) fclose(g_out);
+    g_out = NULL;
+    g_mode = SCT_OUTPUT_TEXT;
+}
+#pragma endregion
+
+#pragma region encoding
+//------------------------------------------------------------------------------
+//              encoding
+
+static bool reserve(sct_record_t *r, size_t len) {
+    if (r->failed) return false;
+    if (r->len + len <= r->capacity) return true;
+    size_t capacity = r->capacity ? r->capacity : 256;
+    while (capacity < r->len + len) capacity *= 2;
+    char *data = realloc(r->data, capacity);
+    if (!data) {
+        r->failed = true;
+        return false;
+    }
+    r->data = data;
+    r->capacity = capacity;
+    return true;
+}
+
+static void put(sct_record_t *r, const void *data, size_t len) {
+    if (!reserve(r, len)) return;
+    memcpy(r->data + r->len, data, len);
+    r->len += len;
+}
+
+static void put_u8(sct_record_t *r, uint8_t v) {
+    put(r, &v, 1);
+}
+
+// little-endian, as are the hosts this runs on
+static void put_u32(sct_record_t *r, uint32_t v) {
+    put(r, &v, sizeof(v));
+}
+
+// utf8_length() tells the length of the valid UTF-8 sequence at s, 0 if
+// there is none
+static size_t utf8_length(const unsigned char *s, size_t len) {
+    size_t n = s[0] >= 0xf0 ? 4 : s[0] >= 0xe0 ? 3 : s[0] >= 0xc2 ? 2 : 0;
+    if ((s[0] > 0xf4) || (n > len)) return 0;
+    for (size_t i = 1; i < n; i++)
+        if ((s[i] & 0xc0) != 0x80) return 0;
+    // overlong forms, surrogates and code points past U+10FFFF
+    if ((n == 3) && (s[0] == 0xe0) && (s[1] < 0xa0)) return 0;
+    if ((n == 3) && (s[0] == 0xed) && (s[1] >= 0xa0)) return 0;
+    if ((n == 4) && (s[0] == 0xf0) && (s[1] < 0x90)) return 0;
+    if ((n == 4) && (s[0] == 0xf4) && (s[1] >= 0x90)) return 0;
+    return n;
+}
+
+// utf8_valid() tells if JSON keeps all the bytes of s: control characters
+// are escaped as they are, bytes not in a valid sequence are not
+static bool utf8_valid(const char *s, size_t len) {
+    const unsigned char *p = (const unsigned char *)s;
+    const unsigned char *end = p + len;
+    while (p < end) {
+        size_t n = *p < 0x80 ? 1 : utf8_length(p, end - p);
+        if (!n) return false;
+        p += n;
+    }
+    return true;
+}
+
+static void put_base64(sct_record_t *r, const char *s, size_t len) {
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const unsigned char *p = (const unsigned char *)s;
+    put_u8(r, '"');
+    if (!reserve(r, (len + 2) / 3 * 4)) return;
+    char *out = r->data + r->len;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)p[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)p[i + 1] << 8;
+        if (i + 2 < len) v |= p[i + 2];
+        *out++ = digits[v >> 18];
+        *out++ = digits[(v >> 12) & 0x3f];
+        *out++ = i + 1 < len ? digits[(v >> 6) & 0x3f] : '=';
+        *out++ = i + 2 < len ? digits[v & 0x3f] : '=';
+    }
+    r->len = out - r->data;
+    put_u8(r, '"');
+}
+
+static void put_json_string(sct_record_t *r, const char *s, size_t len) {
+    const unsigned char *p = (const unsigned char *)s;
+    const unsigned char *end = p + len;
+    put_u8(r, '"');
+    while (p < end) {
+        // runs needing no escape are copied at once
+        const unsigned char *run = p;
+        while ((p < end) && (*p >= 0x20) && (*p < 0x80) && (*p != '"')
+            && (*p != '\\')) p++;
+        put(r, run, p - run);
+        if (p == end) break;
+        size_t n = *p >= 0x80 ? utf8_length(p, end - p) : 0;
+        if (n) {
+            put(r, p, n);
+            p += n;
+            continue;
+        }
+        char esc[8];
+        switch (*p)
+        {
+            case '"': strcpy(esc, "\\\""); break;
+            case '\\': strcpy(esc, "\\\\"); break;
+            case '\n': strcpy(esc, "\\n"); break;
+            case '\r': strcpy(esc, "\\r"); break;
+            case '\t': strcpy(esc, "\\t"); break;
+            default: snprintf(esc, sizeof(esc), "\\u%04x", *p); break;
+        }
+        put(r, esc, strlen(esc));
+        p++;
+    }
+    put_u8(r, '"');
+}
+
+static void put_binary_string(sct_record_t *r, const char *s, size_t len) {
+    put_u32(r, (uint32_t)len);
+    put(r, s, len);
+}
+
+// key() starts a field
+static void key(sct_record_t *r, const char *k, uint8_t kind) {
+    size_t len = strlen(k);
+    if (g_mode == SCT_OUTPUT_BINARY) {
+        put_u8(r, kind);
+        put_u8(r, (uint8_t)len);
+        put(r, k, len);
+        return;
+    }
+    put_u8(r, ',');
+    put_json_string(r, k, len);
+    put_u8(r, ':');
+}
+
+// key_b64() starts the field giving the bytes of the string field k
+static void key_b64(sct_record_t *r, const char *k, uint8_t kind) {
+    char b64[256 + 4];
+    snprintf(b64, sizeof(b64), "%s_b64", k);
+    key(r, b64, kind);
+}
+
+void sct_record_begin(sct_record_t *r, const char *type) {
+    r->len = 0;
+    r->failed = false;
+    size_t len = strlen(type);
+    if (g_mode == SCT_OUTPUT_BINARY) {
+        put_u32(r, 0);      // the length, once known
+        put_u8(r, (uint8_t)len);
+        put(r, type, len);
+        return;
+    }
+    put(r, "{\"type\":", 8);
+    put_json_string(r, type, len);
+}
+
+void sct_record_int(sct_record_t *r, const char *k, int64_t value) {
+    key(r, k, SCT_RECORD_INT);
+    if (g_mode == SCT_OUTPUT_BINARY) {
+        put(r, &value, sizeof(value));
+        return;
+    }
+    char s[24];
+    put(r, s, snprintf(s, sizeof(s), "%lld", (long long)value));
+}
+
+void sct_record_real(sct_record_t *r, const char *k, double value) {
+    key(r, k, SCT_RECORD_REAL);
+    if (g_mode == SCT_OUTPUT_BINARY) {
+        put(r, &value, sizeof(value));
+        return;
+    }
+    char s[32];
+    if (isfinite(value)) put(r, s, snprintf(s, sizeof(s), "%.15g", value));
+    else put(r, "null", 4);
+}
+
+void sct_record_bool(sct_record_t *r, const char *k, bool value) {
+    key(r, k, SCT_RECORD_BOOL);
+    if (g_mode == SCT_OUTPUT_BINARY) put_u8(r, value);
+    else if (value) put(r, "true", 4);
+    else put(r, "false", 5);
+}
+
+void sct_record_strn(sct_record_t *r, const char *k, const char *s,
+    size_t len)
+{
+    key(r, k, SCT_RECORD_STRING);
+    if (g_mode == SCT_OUTPUT_BINARY) put_binary_string(r, s, len);
+    else put_json_string(r, s, len);
+    if ((g_mode == SCT_OUTPUT_BINARY) || utf8_valid(s, len)) return;
+    key_b64(r, k, SCT_RECORD_STRING);
+    put_base64(r, s, len);
+}
+
+void sct_record_str(sct_record_t *r, const char *k, const char *s) {
+    sct_record_strn(r, k, s, strlen(s));
+}
+
+void sct_record_strs(sct_record_t *r, const char *k, char **strs,
+    int count)
+{
+    key(r, k, SCT_RECORD_STRINGS);
+    if (g_mode == SCT_OUTPUT_BINARY) put_u32(r, (uint32_t)count);
+    else put_u8(r, '[');
+    for (int i = 0; i < count; i++) {
+        if (g_mode == SCT_OUTPUT_BINARY)
+            put_binary_string(r, strs[i], strlen(strs[i]));
+        else {
+            if (i) put_u8(r, ',');
+            put_json_string(r, strs[i], strlen(strs[i]));
+        }
+    }
+    if (g_mode == SCT_OUTPUT_BINARY) return;
+    put_u8(r, ']');
+    bool valid = true;
+    for (int i = 0; valid && (i < count); i++)
+        valid = utf8_valid(strs[i], strlen(strs[i]));
+    if (valid) return;
+    key_b64(r, k, SCT_RECORD_STRINGS);
+    put_u8(r, '[');
+    for (int i = 0; i < count; i++) {
+        if (i) put_u8(r, ',');
+        put_base64(r, strs[i], strlen(strs[i]));
+    }
+    put_u8(r, ']');
+}
+
+void sct_record_end(sct_record_t *r) {
+    if (g_mode == SCT_OUTPUT_BINARY) {
+        uint32_t len = (uint32_t)(r->len - 4);
+        if (!r->failed) memcpy(r->data, &len, sizeof(len));
+    }
+    else put(r, "}\n", 2);
+    if (r->failed) {
+        fprintf(stderr, "output: record dropped for lack of memory\n");
+        return;
+    }
+    if (g_out) fwrite(r->data, 1, r->len, g_out);
+}
+
+void sct_record_free(sct_record_t *r) {
+    free(r->data);
+    memset(r, 0, sizeof(*r));
+}
+#pragma endregion
@@ -0,0 +1,1087 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <regex.h>
+#include "sct_regex.h"
+
+/*
+    Regular expressions for grep.
+    Patterns are POSIX basic regular expressions with the GNU extensions
+    regcomp() accepts (\| \+ \? \{,n\} \w \s). A pattern is parsed into a
+    Thompson NFA, and a DFA over byte classes is built from it lazily:
+    a state and its transition are made the first time a line needs them,
+    after which matching costs one table lookup per byte. DFA memory is
+    bounded; when it runs out, the states are dropped and built again.
+    A string every match must contain is taken from the pattern, and
+    only lines a vectorized search finds it in are run through the DFA.
+    Back-references, word anchors and anything else the parser does not
+    know go to regcomp(), which also reports the errors.
+    Compiled patterns, with the DFA states built so far, are kept in an
+    LRU cache keyed by pattern text. Commands run on the main thread, so
+    the cache takes no locks.
+*/
+
+#define SCT_REGEX_MAX_REPEAT 255        // larger \{m,n\} go to regexec()
+#define SCT_REGEX_MAX_NFA 8192          // NFA states
+#define SCT_REGEX_DFA_MEMORY (256 * 1024)
+#define SCT_REGEX_DFA_BUCKETS 1024      // a power of 2
+#define SCT_REGEX_MAX_LITERAL 32
+#define SCT_REGEX_MAX_LITERALS 8        // alternatives a prefilter looks for
+#define SCT_REGEX_CACHE_BUCKETS 1024    // a power of 2
+
+typedef struct byteset_ {
+    uint64_t bits[4];
+} byteset_t;
+
+typedef struct literal_ {
+    unsigned char s[SCT_REGEX_MAX_LITERAL];
+    size_t len;
+} literal_t;
+
+// strings every match contains one of
+typedef struct literal_set_ {
+    literal_t items[SCT_REGEX_MAX_LITERALS];
+    int count;
+} literal_set_t;
+
+enum { S_SET, S_SPLIT, S_BOL, S_EOL, S_MATCH };
+
+typedef struct nfa_state_ {
+    int kind;
+    int set;            // S_SET: index of the byte set
+    int out;
+    int out1;           // S_SPLIT: the other branch
+} nfa_state_t;
+
+typedef struct dfa_state_ {
+    struct dfa_state_ *hash_next;
+    uint32_t hash;
+    bool initial;       // the state at a line start
+    bool stop;          // matched, or nothing more can match in the line
+    bool eol_accept;    // the line matches if it ends here
+    int count;
+    int *ids;           // sorted NFA states: S_SET, S_EOL and S_MATCH ones
+    // per byte class, NULL until needed: transitions to states going on
+    // first, then to stopping ones, so that the matching loop tests the
+    // pointer it loads rather than the state it points to
+    struct dfa_state_ *next[];
+} dfa_state_t;
+
+struct sct_regex_ {
+    char *pattern;
+    uint32_t hash;
+    int refs;
+    struct sct_regex_ *hash_next;
+    struct sct_regex_ *lru_prev;
+    struct sct_regex_ *lru_next;
+
+    bool use_dfa;
+    regex_t posix;      // if not
+    literal_set_t literals;
+    bool literal_only;  // the pattern is just the one literal
+
+    nfa_state_t *nfa;
+    int nfa_count;
+    int nfa_capacity;
+    int start;
+    byteset_t *sets;
+    uint8_t classes[256];
+    uint8_t class_rep[256];     // a byte of every class
+    int class_count;
+
+    dfa_state_t *states[SCT_REGEX_DFA_BUCKETS];
+    dfa_state_t *init;
+    size_t dfa_memory;
+    unsigned flushes;
+
+    // closure computation
+    int *work;
+    int work_count;
+    int *stack;
+    uint32_t *marks;
+    uint32_t generation;
+};
+
+static sct_regex_t *g_cache[SCT_REGEX_CACHE_BUCKETS];
+static sct_regex_t *g_lru_head = NULL;     // most recently used
+static sct_regex_t *g_lru_tail = NULL;
+static int g_cached = 0;
+
+static void set_add(byteset_t *s, int c) {
+    s->bits[c >> 6] |= 1ull << (c & 63);
+}
+
+static bool set_has(const byteset_t *s, int c) {
+    return (s->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+#pragma region parser
+//------------------------------------------------------------------------------
+//              parser
+
+typedef enum node_kind_ {
+    N_EMPTY, N_SET, N_BOL, N_EOL, N_CAT, N_ALT, N_REPEAT
+} node_kind_t;
+
+typedef struct node_ {
+    node_kind_t kind;
+    int set;            // N_SET: index of the byte set
+    int c;              // N_SET: the only byte of the set, or -1
+    int min;            // N_REPEAT
+    int max;            // N_REPEAT: -1 if unbounded
+    struct node_ *left;
+    struct node_ *right;
+    struct node_ *all_next;     // all nodes of a parse, for freeing
+} node_t;
+
+typedef struct parser_ {
+    const unsigned char *p;
+    const unsigned char *end;
+    bool failed;        // an error, or a construct for regcomp()
+    bool anchors;       // the pattern has ^ or $ anchors
+    node_t *nodes;
+    byteset_t *sets;
+    int set_count;
+    int set_capacity;
+} parser_t;
+
+static node_t *fail(parser_t *ps) {
+    ps->failed = true;
+    return NULL;
+}
+
+static bool next_is(parser_t *ps, const unsigned char *p, const char *s) {
+    size_t n = strlen(s);
+    return ((size_t)(ps->end - p) >= n) && (memcmp(p, s, n) == 0);
+}
+
+static node_t *new_node(parser_t *ps, node_kind_t kind, node_t *left,
+    node_t *right)
+{
+    if (ps->failed) return NULL;
+    node_t *n = calloc(1, sizeof(*n));
+    if (!n) return fail(ps);
+    n->kind = kind;
+    n->c = -1;
+    n->left = left;
+    n->right = right;
+    n->all_next = ps->nodes;
+    ps->nodes = n;
+    return n;
+}
+
+static node_t *set_node(parser_t *ps, byteset_t *s) {
+    if (ps->failed) return NULL;
+    if (ps->set_count == ps->set_capacity) {
+        int capacity = ps->set_capacity ? ps->set_capacity * 2 : 16;
+        byteset_t *sets = realloc(ps->sets, capacity * sizeof(*sets));
+        if (!sets) return fail(ps);
+        ps->sets = sets;
+        ps->set_capacity = capacity;
+    }
+    node_t *n = new_node(ps, N_SET, NULL, NULL);
+    if (!n) return NULL;
+    int bytes = 0;
+    for (int i = 0; i < 4; i++) bytes += __builtin_popcountll(s->bits[i]);
+    for (int c = 0; (bytes == 1) && (c < 256); c++)
+        if (set_has(s, c)) n->c = c;
+    ps->sets[ps->set_count] = *s;
+    n->set = ps->set_count++;
+    return n;
+}
+
+static node_t *literal_node(parser_t *ps, int c) {
+    byteset_t s;
+    memset(&s, 0, sizeof(s));
+    set_add(&s, c);
+    return set_node(ps, &s);
+}
+
+static node_t *class_node(parser_t *ps, int (*fn)(int), bool underscore,
+    bool negated)
+{
+    byteset_t s;
+    memset(&s, 0, sizeof(s));
+    for (int c = 0; c < 256; c++)
+        if ((fn(c) || (underscore && (c == '_'))) != negated) set_add(&s, c);
+    return set_node(ps, &s);
+}
+
+static bool add_class(byteset_t *s, const unsigned char *name, size_t len) {
+    static const struct {
+        const char *name;
+        int (*fn)(int);
+    } classes[] = {
+        { "alpha", isalpha }, { "digit", isdigit }, { "alnum", isalnum },
+        { "upper", isupper }, { "lower", islower }, { "space", isspace },
+        { "blank", isblank }, { "punct", ispunct }, { "print", isprint },
+        { "graph", isgraph }, { "cntrl", iscntrl }, { "xdigit", isxdigit }
+    };
+    for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++) {
+        if ((strlen(classes[i].name) != len)
+            || (memcmp(classes[i].name, name, len) != 0)) continue;
+        for (int c = 0; c < 256; c++)
+            if (classes[i].fn(c)) set_add(s, c);
+        return true;
+    }
+    return false;
+}
+
+// parse_bracket() parses a [...] list, ps->p being past the '['
+static node_t *parse_bracket(parser_t *ps) {
+    byteset_t s;
+    memset(&s, 0, sizeof(s));
+    bool negated = (ps->p < ps->end) && (*ps->p == '^');
+    if (negated) ps->p++;
+    const unsigned char *first = ps->p;
+    for (;;) {
+        if (ps->p >= ps->end) return fail(ps);
+        int c = *ps->p;
+        if ((c == ']') && (ps->p != first)) {
+            ps->p++;
+            break;
+        }
+        bool has_next = ps->p + 1 < ps->end;
+        if ((c == '[') && has_next && ((ps->p[1] == ':') || (ps->p[1] == '=')
+            || (ps->p[1] == '.')))
+        {
+            // equivalence classes and collating symbols are left to regcomp()
+            if (ps->p[1] != ':') return fail(ps);
+            const unsigned char *name = ps->p + 2;
+            const unsigned char *close = memmem(name, ps->end - name, ":]", 2);
+            if (!close || !add_class(&s, name, close - name)) return fail(ps);
+            ps->p = close + 2;
+            // a class can not start a range
+            if (next_is(ps, ps->p, "-") && !next_is(ps, ps->p, "-]"))
+                return fail(ps);
+            continue;
+        }
+        // '-' is literal at either end only
+        if ((c == '-') && (ps->p != first) && has_next && (ps->p[1] != ']'))
+            return fail(ps);
+        ps->p++;
+        if (next_is(ps, ps->p, "-") && (ps->p + 1 < ps->end)
+            && (ps->p[1] != ']'))
+        {
+            int last = ps->p[1];
+            if ((last == '[') || (last < c)) return fail(ps);
+            for (int b = c; b <= last; b++) set_add(&s, b);
+            ps->p += 2;
+        }
+        else set_add(&s, c);
+    }
+    if (negated) for (int i = 0; i < 4; i++) s.bits[i] = ~s.bits[i];
+    return set_node(ps, &s);
+}
+
+// parse_interval() parses the bounds of \{m,n\}, ps->p being past the '\{'
+static bool parse_interval(parser_t *ps, int *min, int *max) {
+    int bounds[2] = { -1, -1 };
+    int k = 0;
+    for (;;) {
+        if (ps->p >= ps->end) return false;
+        int c = *ps->p;
+        if (isdigit(c)) {
+            bounds[k] = (bounds[k] < 0 ? 0 : bounds[k] * 10) + c - '0';
+            if (bounds[k] > SCT_REGEX_MAX_REPEAT) return false;
+            ps->p++;
+        }
+        else if ((c == ',') && (k == 0)) {
+            k = 1;
+            ps->p++;
+        }
+        else if (next_is(ps, ps->p, "\\}")) {
+            ps->p += 2;
+            break;
+        }
+        else return false;
+    }
+    if (k == 0) {
+        if (bounds[0] < 0) return false;
+        *min = *max = bounds[0];
+        return true;
+    }
+    if ((bounds[0] < 0) && (bounds[1] < 0)) return false;
+    *min = bounds[0] < 0 ? 0 : bounds[0];
+    *max = bounds[1];
+    return (*max < 0) || (*max >= *min);
+}
+
+// parse_repetition() parses *, \+, \?, or \{m,n\} applied to last
+static node_t *parse_repetition(parser_t *ps, node_t *last) {
+    node_t *n = new_node(ps, N_REPEAT, last, NULL);
+    if (!n) return NULL;
+    n->max = -1;
+    if (*ps->p == '*') ps->p++;
+    else {
+        char op = ps->p[1];
+        ps->p += 2;
+        if (op == '+') n->min = 1;
+        else if (op == '?') n->max = 1;
+        else if (!parse_interval(ps, &n->min, &n->max)) return fail(ps);
+    }
+    return n;
+}
+
+static node_t *parse_alt(parser_t *ps);
+
+// parse_atom() parses a single character, a list, or a group
+static node_t *parse_atom(parser_t *ps) {
+    int c = *ps->p++;
+    if (c == '.') {
+        // POSIX basic syntax: '.' does not match NUL
+        byteset_t s;
+        memset(s.bits, 0xFF, sizeof(s.bits));
+        s.bits[0] &= ~1ull;
+        return set_node(ps, &s);
+    }
+    if (c == '[') return parse_bracket(ps);
+    if (c == '\n') return fail(ps);
+    if (c != '\\') return literal_node(ps, c);
+
+    if (ps->p >= ps->end) return fail(ps);
+    c = *ps->p++;
+    switch (c) {
+    case '(': {
+        node_t *n = parse_alt(ps);
+        if (!next_is(ps, ps->p, "\\)")) return fail(ps);
+        ps->p += 2;
+        return n;
+    }
+    case 'w': return class_node(ps, isalnum, true, false);
+    case 'W': return class_node(ps, isalnum, true, true);
+    case 's': return class_node(ps, isspace, false, false);
+    case 'S': return class_node(ps, isspace, false, true);
+    }
+    // back-references, word and buffer anchors
+    if (strchr("123456789<>bB`'}", c)) return fail(ps);
+    return literal_node(ps, c);
+}
+
+// parse_cat() parses a sequence up to '\|', '\)', or the end
+static node_t *parse_cat(parser_t *ps) {
+    node_t *prefix = new_node(ps, N_EMPTY, NULL, NULL);
+    node_t *last = NULL;        // the atom a repetition applies to
+    bool first = true;          // '^' is an anchor only as the first token
+    bool repeated = false;      // last has a repetition operator
+    while (!ps->failed && (ps->p < ps->end) && !next_is(ps, ps->p, "\\|")
+        && !next_is(ps, ps->p, "\\)"))
+    {
+        int c = *ps->p;
+        if ((c == '*') || next_is(ps, ps->p, "\\+")
+            || next_is(ps, ps->p, "\\?") || next_is(ps, ps->p, "\\{"))
+        {
+            first = false;
+            // glibc takes some of the stacked repetitions only, leave them
+            if (last && repeated) return fail(ps);
+            if (last) {
+                last = parse_repetition(ps, last);
+                repeated = true;
+                continue;
+            }
+            // a leading '*' is literal; regcomp() rejects the others
+            if (c != '*') return fail(ps);
+        }
+
+        node_t *anchor = NULL;
+        if (first && (c == '^')) anchor = new_node(ps, N_BOL, NULL, NULL);
+        else if ((c == '$') && ((ps->p + 1 == ps->end)
+            || next_is(ps, ps->p + 1, "\\)") || next_is(ps, ps->p + 1, "\\|")))
+            anchor = new_node(ps, N_EOL, NULL, NULL);
+        first = false;
+        repeated = false;
+        if (last) prefix = new_node(ps, N_CAT, prefix, last);
+        if (anchor) {
+            ps->p++;
+            ps->anchors = true;
+            prefix = new_node(ps, N_CAT, prefix, anchor);
+            last = NULL;
+        }
+        else last = parse_atom(ps);
+    }
+    if (last) prefix = new_node(ps, N_CAT, prefix, last);
+    return prefix;
+}
+
+static node_t *parse_alt(parser_t *ps) {
+    node_t *n = parse_cat(ps);
+    while (!ps->failed && next_is(ps, ps->p, "\\|")) {
+        ps->p += 2;
+        node_t *right = parse_cat(ps);
+        n = new_node(ps, N_ALT, n, right);
+    }
+    return n;
+}
+#pragma endregion
+
+#pragma region literal prefilter
+//------------------------------------------------------------------------------
+//              literal prefilter
+
+typedef struct literal_info_ {
+    bool exact;         // the node matches just the string in prefix
+    literal_t prefix;   // every match starts with it
+    literal_t suffix;   // every match ends with it
+    literal_set_t required;
+} literal_info_t;
+
+// appends b to a, truncating; false if b did not fit
+static bool literal_append(literal_t *a, const literal_t *b) {
+    size_t n = b->len;
+    if (a->len + n > SCT_REGEX_MAX_LITERAL) n = SCT_REGEX_MAX_LITERAL - a->len;
+    memcpy(a->s + a->len, b->s, n);
+    a->len += n;
+    return n == b->len;
+}
+
+// prepends a to b, keeping the end of the result
+static void literal_prepend(const literal_t *a, literal_t *b) {
+    literal_t r = *a;
+    if (r.len + b->len > SCT_REGEX_MAX_LITERAL) {
+        size_t drop = r.len + b->len - SCT_REGEX_MAX_LITERAL;
+        memmove(r.s, r.s + drop, r.len - drop);
+        r.len -= drop;
+    }
+    literal_append(&r, b);
+    *b = r;
+}
+
+static size_t shortest_literal(const literal_set_t *set) {
+    size_t len = set->count ? SCT_REGEX_MAX_LITERAL : 0;
+    for (int i = 0; i < set->count; i++)
+        if (set->items[i].len < len) len = set->items[i].len;
+    return len;
+}
+
+// keeps the set with longer strings, or with fewer of them
+static void literals_consider(literal_set_t *best, const literal_set_t *set) {
+    size_t a = shortest_literal(best);
+    size_t b = shortest_literal(set);
+    if ((b > a) || ((b == a) && b && (set->count < best->count))) *best = *set;
+}
+
+static void literal_consider(literal_set_t *best, const literal_t *l) {
+    literal_set_t set;
+    set.count = l->len ? 1 : 0;
+    set.items[0] = *l;
+    literals_consider(best, &set);
+}
+
+// literal_info() describes the strings matches of n start and end with,
+// and the strings each of them contains one of
+static void literal_info(node_t *n, literal_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    switch (n->kind) {
+    case N_EMPTY:
+    case N_BOL:
+    case N_EOL:
+        info->exact = true;
+        return;
+    case N_SET:
+        if (n->c < 0) return;
+        info->exact = true;
+        info->prefix.s[0] = (unsigned char)n->c;
+        info->prefix.len = 1;
+        info->suffix = info->prefix;
+        literal_consider(&info->required, &info->prefix);
+        return;
+    case N_CAT: {
+        literal_info_t l, r;
+        literal_info(n->left, &l);
+        literal_info(n->right, &r);
+        info->required = l.required;
+        literals_consider(&info->required, &r.required);
+        literal_t middle = l.suffix;
+        literal_append(&middle, &r.prefix);
+        literal_consider(&info->required, &middle);
+        info->prefix = l.prefix;
+        bool whole = !l.exact || literal_append(&info->prefix, &r.prefix);
+        info->exact = l.exact && r.exact && whole;
+        info->suffix = r.suffix;
+        if (r.exact) literal_prepend(&l.suffix, &info->suffix);
+        return;
+    }
+    case N_REPEAT:
+        // nothing in an optional part is required
+        if (n->min == 0) return;
+        literal_info(n->left, info);
+        info->exact = info->exact && (n->max == 1);
+        return;
+    case N_ALT: {
+        literal_info_t l, r;
+        literal_info(n->left, &l);
+        literal_info(n->right, &r);
+        int count = l.required.count + r.required.count;
+        if (!l.required.count || !r.required.count
+            || (count > SCT_REGEX_MAX_LITERALS)) return;
+        info->required = l.required;
+        memcpy(&info->required.items[l.required.count], r.required.items,
+            r.required.count * sizeof(literal_t));
+        info->required.count = count;
+        return;
+    }
+    }
+}
+
+typedef const char *(*find_literals_fn_t)(const char *s, size_t len,
+    const literal_set_t *set);
+
+// the first position of any of the literals
+static const char *find_literals_scalar(const char *s, size_t len,
+    const literal_set_t *set)
+{
+    const char *found = NULL;
+    for (int i = 0; i < set->count; i++) {
+        const literal_t *l = &set->items[i];
+        // only a string starting before the one found is of interest
+        size_t window = len;
+        if (found && ((size_t)(found - s) + l->len - 1 < len))
+            window = found - s + l->len - 1;
+        const char *hit = l->len == 1 ? memchr(s, l->s[0], window)
+            : memmem(s, window, l->s, l->len);
+        if (hit) found = hit;
+    }
+    return found;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCT_HAVE_AVX2_FINDER
+
+// compares the first and the last bytes of every literal at 32 positions
+// at once, then the rest at the positions where both are equal
+__attribute__((target("avx2")))
+static const char *find_literals_avx2(const char *s, size_t len,
+    const literal_set_t *set)
+{
+    if ((set->count == 1) && (set->items[0].len == 1))
+        return memchr(s, set->items[0].s[0], len);
+    __m256i first[SCT_REGEX_MAX_LITERALS];
+    __m256i last[SCT_REGEX_MAX_LITERALS];
+    size_t longest = 0;
+    for (int k = 0; k < set->count; k++) {
+        const literal_t *l = &set->items[k];
+        first[k] = _mm256_set1_epi8((char)l->s[0]);
+        last[k] = _mm256_set1_epi8((char)l->s[l->len - 1]);
+        if (l->len > longest) longest = l->len;
+    }
+    size_t i = 0;
+    for (; i + longest - 1 + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(s + i));
+        uint32_t mask = 0;
+        for (int k = 0; k < set->count; k++) {
+            __m256i f = _mm256_cmpeq_epi8(first[k], block);
+            __m256i l = _mm256_cmpeq_epi8(last[k], _mm256_loadu_si256(
+                (const __m256i *)(s + i + set->items[k].len - 1)));
+            mask |= (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(f, l));
+        }
+        while (mask) {
+            const char *p = s + i + __builtin_ctz(mask);
+            for (int k = 0; k < set->count; k++)
+                if (memcmp(p, set->items[k].s, set->items[k].len) == 0)
+                    return p;
+            mask &= mask - 1;
+        }
+    }
+    return find_literals_scalar(s + i, len - i, set);
+}
+#endif
+
+static find_literals_fn_t g_find_literals = NULL;
+
+static void select_finder(void) {
+    g_find_literals = find_literals_scalar;
+#ifdef SCT_HAVE_AVX2_FINDER
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) g_find_literals = find_literals_avx2;
+#endif
+}
+#pragma endregion
+
+#pragma region NFA
+//------------------------------------------------------------------------------
+//              NFA
+
+static int nfa_add(sct_regex_t *re, int kind, int set, int out, int out1) {
+    if (out < 0) return -1;
+    if (re->nfa_count == re->nfa_capacity) {
+        if (re->nfa_count == SCT_REGEX_MAX_NFA) return -1;
+        int capacity = re->nfa_capacity ? re->nfa_capacity * 2 : 64;
+        nfa_state_t *nfa = realloc(re->nfa, capacity * sizeof(*nfa));
+        if (!nfa) return -1;
+        re->nfa = nfa;
+        re->nfa_capacity = capacity;
+    }
+    nfa_state_t *st = &re->nfa[re->nfa_count];
+    st->kind = kind;
+    st->set = set;
+    st->out = out;
+    st->out1 = out1;
+    return re->nfa_count++;
+}
+
+// compile_node() builds the states of n leading to next, returning the
+// first of them, or -1 if the NFA grows too big
+static int compile_node(sct_regex_t *re, node_t *n, int next) {
+    if (next < 0) return -1;
+    switch (n->kind) {
+    case N_EMPTY: return next;
+    case N_SET: return nfa_add(re, S_SET, n->set, next, -1);
+    case N_BOL: return nfa_add(re, S_BOL, -1, next, -1);
+    case N_EOL: return nfa_add(re, S_EOL, -1, next, -1);
+    case N_CAT:
+        return compile_node(re, n->left, compile_node(re, n->right, next));
+    case N_ALT: {
+        int left = compile_node(re, n->left, next);
+        int right = compile_node(re, n->right, next);
+        return right < 0 ? -1 : nfa_add(re, S_SPLIT, -1, left, right);
+    }
+    case N_REPEAT: {
+        int tail = next;
+        if (n->max < 0) {
+            int loop = nfa_add(re, S_SPLIT, -1, next, next);
+            int body = loop < 0 ? -1 : compile_node(re, n->left, loop);
+            if (body < 0) return -1;
+            re->nfa[loop].out = body;
+            tail = loop;
+        }
+        // x\{m,n\} is m copies of x followed by n - m nested optional ones
+        else for (int i = n->min; (i < n->max) && (tail >= 0); i++)
+            tail = nfa_add(re, S_SPLIT, -1, compile_node(re, n->left, tail),
+                next);
+        for (int i = 0; (i < n->min) && (tail >= 0); i++)
+            tail = compile_node(re, n->left, tail);
+        return tail;
+    }
+    }
+    return -1;
+}
+
+// make_classes() splits bytes into classes no set tells apart
+static void make_classes(sct_regex_t *re, int set_count) {
+    int classes[256] = { 0 };
+    int count = 1;
+    for (int k = 0; k < set_count; k++) {
+        int split[256];
+        memset(split, -1, sizeof(split));
+        for (int c = 0; c < 256; c++) {
+            if (!set_has(&re->sets[k], c)) continue;
+            if (split[classes[c]] < 0) split[classes[c]] = count++;
+            classes[c] = split[classes[c]];
+        }
+        // renumber densely, so that count stays within 256
+        int renumber[512];
+        memset(renumber, -1, sizeof(renumber));
+        count = 0;
+        for (int c = 0; c < 256; c++) {
+            if (renumber[classes[c]] < 0) renumber[classes[c]] = count++;
+            classes[c] = renumber[classes[c]];
+        }
+    }
+    for (int c = 255; c >= 0; c--) {
+        re->classes[c] = (uint8_t)classes[c];
+        re->class_rep[classes[c]] = (uint8_t)c;
+    }
+    re->class_count = count;
+}
+
+static bool build_nfa(sct_regex_t *re, node_t *root, int set_count) {
+    re->start = compile_node(re, root, nfa_add(re, S_MATCH, -1, 0, -1));
+    if (re->start < 0) return false;
+    make_classes(re, set_count);
+    re->work = malloc(2 * re->nfa_count * sizeof(int));
+    re->stack = malloc((2 * re->nfa_count + 2) * sizeof(int));
+    re->marks = calloc(re->nfa_count, sizeof(uint32_t));
+    return re->work && re->stack && re->marks;
+}
+#pragma endregion
+
+#pragma region DFA
+//------------------------------------------------------------------------------
+//              DFA
+
+static void new_generation(sct_regex_t *re) {
+    if (++re->generation == 0) {
+        memset(re->marks, 0, re->nfa_count * sizeof(uint32_t));
+        re->generation = 1;
+    }
+}
+
+// add_closure() appends the states reachable from id without consuming
+// a byte to the work set; at_bol and at_eol tell which anchors hold
+static void add_closure(sct_regex_t *re, int id, bool at_bol, bool at_eol) {
+    int top = 0;
+    re->stack[top++] = id;
+    while (top) {
+        id = re->stack[--top];
+        if (re->marks[id] == re->generation) continue;
+        re->marks[id] = re->generation;
+        nfa_state_t *st = &re->nfa[id];
+        switch (st->kind) {
+        case S_SPLIT:
+            re->stack[top++] = st->out1;
+            re->stack[top++] = st->out;
+            break;
+        case S_BOL:
+            if (at_bol) re->stack[top++] = st->out;
+            break;
+        case S_EOL:
+            if (at_eol) re->stack[top++] = st->out;
+            else re->work[re->work_count++] = id;
+            break;
+        default:
+            re->work[re->work_count++] = id;
+        }
+    }
+}
+
+// tells whether the line matches if it ends after the work set states
+static bool eol_accepts(sct_regex_t *re, bool at_bol) {
+    int count = re->work_count;
+    new_generation(re);
+    for (int i = 0; i < count; i++)
+        if (re->nfa[re->work[i]].kind == S_EOL)
+            add_closure(re, re->nfa[re->work[i]].out, at_bol, true);
+    bool accept = false;
+    for (int i = 0; i < re->work_count; i++)
+        accept = accept || (re->nfa[re->work[i]].kind == S_MATCH);
+    re->work_count = count;
+    return accept;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+static void dfa_flush(sct_regex_t *re) {
+    for (int i = 0; i < SCT_REGEX_DFA_BUCKETS; i++) {
+        dfa_state_t *s = re->states[i];
+        while (s) {
+            dfa_state_t *next = s->hash_next;
+            free(s);
+            s = next;
+        }
+        re->states[i] = NULL;
+    }
+    re->init = NULL;
+    re->dfa_memory = 0;
+    re->flushes++;
+}
+
+// dfa_state() returns the DFA state for the work set, making it if new
+static dfa_state_t *dfa_state(sct_regex_t *re, bool initial) {
+    qsort(re->work, re->work_count, sizeof(int), compare_ids);
+    uint32_t hash = initial ? 0x9E3779B9u : 2166136261u;
+    for (int i = 0; i < re->work_count; i++)
+        hash = (hash ^ (uint32_t)re->work[i]) * 16777619u;
+    dfa_state_t **bucket = &re->states[hash & (SCT_REGEX_DFA_BUCKETS - 1)];
+    size_t ids_size = re->work_count * sizeof(int);
+    for (dfa_state_t *s = *bucket; s; s = s->hash_next) {
+        if ((s->hash == hash) && (s->initial == initial)
+            && (s->count == re->work_count)
+            && (memcmp(s->ids, re->work, ids_size) == 0)) return s;
+    }
+
+    bool accept = false;
+    for (int i = 0; i < re->work_count; i++)
+        accept = accept || (re->nfa[re->work[i]].kind == S_MATCH);
+    bool eol_accept = accept || eol_accepts(re, initial);
+
+    size_t size = sizeof(dfa_state_t)
+        + 2 * re->class_count * sizeof(dfa_state_t *) + ids_size;
+    if (re->dfa_memory + size > SCT_REGEX_DFA_MEMORY) dfa_flush(re);
+    dfa_state_t *s = calloc(1, size);
+    if (!s) return NULL;
+    s->hash = hash;
+    s->initial = initial;
+    s->stop = accept || (re->work_count == 0);
+    s->eol_accept = eol_accept;
+    s->count = re->work_count;
+    s->ids = (int *)&s->next[2 * re->class_count];
+    memcpy(s->ids, re->work, ids_size);
+    s->hash_next = *bucket;
+    *bucket = s;
+    re->dfa_memory += size;
+    return s;
+}
+
+static dfa_state_t *dfa_initial(sct_regex_t *re) {
+    if (re->init) return re->init;
+    new_generation(re);
+    re->work_count = 0;
+    add_closure(re, re->start, true, false);
+    re->init = dfa_state(re, true);
+    return re->init;
+}
+
+// dfa_step() makes the transition of s for a byte class. s is not valid
+// anymore if making it has flushed the DFA.
+static dfa_state_t *dfa_step(sct_regex_t *re, dfa_state_t *s, int cls) {
+    int c = re->class_rep[cls];
+    new_generation(re);
+    re->work_count = 0;
+    for (int i = 0; i < s->count; i++) {
+        nfa_state_t *st = &re->nfa[s->ids[i]];
+        if ((st->kind == S_SET) && set_has(&re->sets[st->set], c))
+            add_closure(re, st->out, false, false);
+    }
+    // a match may start at any position
+    add_closure(re, re->start, false, false);
+    unsigned flushes = re->flushes;
+    dfa_state_t *next = dfa_state(re, false);
+    if (next && (re->flushes == flushes))
+        s->next[(next->stop ? re->class_count : 0) + cls] = next;
+    return next;
+}
+
+static bool dfa_match_line(sct_regex_t *re, const unsigned char *p,
+    const unsigned char *end)
+{
+    dfa_state_t *s = dfa_initial(re);
+    while (s && !s->stop) {
+        dfa_state_t *next;
+        while ((p < end) && (next = s->next[re->classes[*p]])) {
+            s = next;
+            p++;
+        }
+        if (p == end) break;
+        int cls = re->classes[*p++];
+        next = s->next[re->class_count + cls];
+        s = next ? next : dfa_step(re, s, cls);
+    }
+    return s && s->eol_accept;
+}
+#pragma endregion
+
+#pragma region compilation
+//------------------------------------------------------------------------------
+//              compilation
+
+static void free_regex(sct_regex_t *re) {
+    if (!re->use_dfa) regfree(&re->posix);
+    dfa_flush(re);
+    free(re->nfa);
+    free(re->sets);
+    free(re->work);
+    free(re->stack);
+    free(re->marks);
+    free(re->pattern);
+    free(re);
+}
+
+static void free_nodes(node_t *n) {
+    while (n) {
+        node_t *next = n->all_next;
+        free(n);
+        n = next;
+    }
+}
+
+// compile_dfa() prepares the NFA and the literal of a pattern, false if
+// the pattern is for regcomp()
+static bool compile_dfa(sct_regex_t *re) {
+    parser_t ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.p = (const unsigned char *)re->pattern;
+    ps.end = ps.p + strlen(re->pattern);
+    node_t *root = parse_alt(&ps);
+    bool succeeded = !ps.failed && (ps.p == ps.end);
+    re->sets = ps.sets;
+    if (succeeded) succeeded = build_nfa(re, root, ps.set_count);
+    if (succeeded) {
+        literal_info_t info;
+        literal_info(root, &info);
+        re->literals = info.required;
+        literal_consider(&re->literals, &info.prefix);
+        literal_consider(&re->literals, &info.suffix);
+        re->literal_only = info.exact && !ps.anchors && info.prefix.len
+            && (re->literals.count == 1)
+            && (re->literals.items[0].len == info.prefix.len);
+    }
+    free_nodes(ps.nodes);
+    return succeeded;
+}
+
+static sct_regex_t *compile_regex(char *pattern, uint32_t hash, char *err,
+    size_t err_size)
+{
+    sct_regex_t *re = calloc(1, sizeof(*re));
+    size_t len = strlen(pattern);
+    if (re) re->pattern = malloc(len + 1);
+    if (!re || !re->pattern) {
+        free(re);
+        snprintf(err, err_size, "Memory exhausted");
+        return NULL;
+    }
+    memcpy(re->pattern, pattern, len + 1);
+    re->hash = hash;
+    re->use_dfa = compile_dfa(re);
+    if (re->use_dfa) return re;
+
+    int e = regcomp(&re->posix, pattern, REG_NOSUB);
+    if (e) {
+        regerror(e, &re->posix, err, err_size);
+        re->use_dfa = true;     // nothing to regfree()
+        free_regex(re);
+        return NULL;
+    }
+    return re;
+}
+#pragma endregion
+
+#pragma region cache
+//------------------------------------------------------------------------------
+//              cache
+
+static uint32_t hash_pattern(char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+static void lru_unlink(sct_regex_t *re) {
+    if (re->lru_prev) re->lru_prev->lru_next = re->lru_next;
+    else g_lru_head = re->lru_next;
+    if (re->lru_next) re->lru_next->lru_prev = re->lru_prev;
+    else g_lru_tail = re->lru_prev;
+    re->lru_prev = re->lru_next = NULL;
+}
+
+static void lru_push_front(sct_regex_t *re) {
+    re->lru_next = g_lru_head;
+    if (g_lru_head) g_lru_head->lru_prev = re;
+    else g_lru_tail = re;
+    g_lru_head = re;
+}
+
+static void cache_remove(sct_regex_t *re) {
+    sct_regex_t **p = &g_cache[re->hash & (SCT_REGEX_CACHE_BUCKETS - 1)];
+    while (*p != re) p = &(*p)->hash_next;
+    *p = re->hash_next;
+    lru_unlink(re);
+    g_cached--;
+}
+
+// drops the least recently used patterns not in use
+static void cache_trim(void) {
+    sct_regex_t *re = g_lru_tail;
+    while (re && (g_cached > SCT_REGEX_CACHE_SIZE)) {
+        sct_regex_t *prev = re->lru_prev;
+        if (re->refs == 0) {
+            cache_remove(re);
+            free_regex(re);
+        }
+        re = prev;
+    }
+}
+#pragma endregion
+
+#pragma region public regex routines
+//------------------------------------------------------------------------------
+//              public regex routines
+
+sct_regex_t *sct_regex_get(char *pattern, char *err, size_t err_size) {
+    if (!g_find_literals) select_finder();
+    uint32_t hash = hash_pattern(pattern);
+    sct_regex_t **bucket = &g_cache[hash & (SCT_REGEX_CACHE_BUCKETS - 1)];
+    sct_regex_t *re = *bucket;
+    while (re && ((re->hash != hash) || (strcmp(re->pattern, pattern) != 0)))
+        re = re->hash_next;
+    if (re) lru_unlink(re);
+    else {
+        re = compile_regex(pattern, hash, err, err_size);
+        if (!re) return NULL;
+        re->hash_next = *bucket;
+        *bucket = re;
+        g_cached++;
+    }
+    lru_push_front(re);
+    re->refs++;
+    cache_trim();
+    return re;
+}
+
+void sct_regex_put(sct_regex_t *re) {
+    if (re) re->refs--;
+}
+
+bool sct_regex_find_line(sct_regex_t *re, char *data, size_t len,
+    size_t *line_start, size_t *line_end)
+{
+    char *p = data;
+    char *end = data + len;
+    while (p < end) {
+        char *line = p;
+        if (re->literals.count) {
+            const char *hit = g_find_literals(p, end - p, &re->literals);
+            if (!hit) return false;
+            line = memrchr(p, '\n', hit - p);
+            line = line ? line + 1 : p;
+        }
+        char *eol = memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+
+        bool matched;
+        if (re->literal_only) matched = true;
+        else if (re->use_dfa) matched = dfa_match_line(re,
+            (unsigned char *)line, (unsigned char *)eol);
+        else {
+            regmatch_t m;
+            m.rm_so = 0;
+            m.rm_eo = eol - line;
+            matched = regexec(&re->posix, line, 1, &m, REG_STARTEND) == 0;
+        }
+        if (matched) {
+            *line_start = line - data;
+            *line_end = eol - data;
+            return true;
+        }
+        p = eol + 1;
+    }
+    return false;
+}
+
+bool sct_regex_uses_dfa(sct_regex_t *re) {
+    return re->use_dfa;
+}
+
+bool sct_regex_literal(sct_regex_t *re, int i, const char **s, size_t *len) {
+    if ((i < 0) || (i >= re->literals.count)) return false;
+    *s = (const char *)re->literals.items[i].s;
+    *len = re->literals.items[i].len;
+    return true;
+}
+
+void sct_regex_finalize(void) {
+    while (g_lru_head) {
+        sct_regex_t *re = g_lru_head;
+        cache_remove(re);
+        free_regex(re);
+    }
+}
+#pragma endregion
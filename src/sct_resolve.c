@@ -0,0 +1,264 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include "sct_resolve.h"
+#include "sct_utils.h"
+
+/*
+    Host name resolution.
+    The host names of a command line are resolved before the command
+    runs, all of them together: those not cached are submitted at once to
+    getaddrinfo_a(), so their lookups run in parallel and the command
+    waits for the slowest of them rather than for their sum. Commands then
+    take the addresses from the cache, and ping is given an address, not
+    a name to look up once more.
+    getaddrinfo() does not tell the TTLs of the records, so entries live
+    for a fixed time, as nscd's do: addresses for a minute, names known
+    not to exist for less, and failures to get an answer only for a short
+    while, for commands repeated meanwhile not to wait for each of them.
+    A change of /etc/hosts or /etc/resolv.conf drops all entries.
+    Numeric addresses are not looked up, nor cached.
+*/
+
+#define SCT_RESOLVE_TTL_NS (60 * 1000000000ull)
+#define SCT_RESOLVE_NEGATIVE_TTL_NS (20 * 1000000000ull)
+#define SCT_RESOLVE_RETRY_TTL_NS (2 * 1000000000ull)
+#define SCT_RESOLVE_BUCKETS 256             // a power of 2
+#define SCT_RESOLVE_MAX_ENTRIES 1024
+
+typedef struct resolve_entry_ {
+    struct resolve_entry_ *next;
+    char *name;
+    int error;              // getaddrinfo()'s, 0 if resolved
+    char address[INET6_ADDRSTRLEN];
+    uint64_t expires_ns;
+} resolve_entry_t;
+
+// what the lookups depend on, as last seen
+static const char *g_resolve_files[] = { "/etc/hosts", "/etc/resolv.conf" };
+#define SCT_RESOLVE_FILES (sizeof(g_resolve_files) / sizeof(char *))
+
+typedef struct file_state_ {
+    ino_t ino;
+    off_t size;
+    int64_t mtime_ns;
+} file_state_t;
+
+static resolve_entry_t *g_entries[SCT_RESOLVE_BUCKETS];
+static size_t g_entry_count = 0;
+static file_state_t g_files[SCT_RESOLVE_FILES];
+
+#pragma region cache
+//------------------------------------------------------------------------------
+//              cache
+
+static resolve_entry_t **bucket_of(char *name) {
+    uint32_t h = 2166136261u;
+    for (char *p = name; *p; p++) h = (h ^ (unsigned char)*p) * 16777619u;
+    return &g_entries[h & (SCT_RESOLVE_BUCKETS - 1)];
+}
+
+static resolve_entry_t *find_entry(char *name) {
+    resolve_entry_t *e = *bucket_of(name);
+    while (e && strcmp(e->name, name)) e = e->next;
+    return e;
+}
+
+static void remove_entry(resolve_entry_t *e) {
+    resolve_entry_t **p = bucket_of(e->name);
+    while (*p != e) p = &(*p)->next;
+    *p = e->next;
+    free(e->name);
+    free(e);
+    g_entry_count--;
+}
+
+static void flush_entries(void) {
+    for (int i = 0; i < SCT_RESOLVE_BUCKETS; i++)
+        while (g_entries[i]) remove_entry(g_entries[i]);
+}
+
+// makes room for an entry, dropping expired ones, or else the one
+// expiring first
+static void make_room(uint64_t now) {
+    if (g_entry_count < SCT_RESOLVE_MAX_ENTRIES) return;
+    resolve_entry_t *first = NULL;
+    for (int i = 0; i < SCT_RESOLVE_BUCKETS; i++) {
+        resolve_entry_t *e = g_entries[i];
+        while (e) {
+            resolve_entry_t *next = e->next;
+            if (e->expires_ns <= now) remove_entry(e);
+            else if (!first || (e->expires_ns < first->expires_ns)) first = e;
+            e = next;
+        }
+    }
+    if (first && (g_entry_count >= SCT_RESOLVE_MAX_ENTRIES))
+        remove_entry(first);
+}
+
+static uint64_t ttl_of(int error) {
+    if (!error) return SCT_RESOLVE_TTL_NS;
+    // answers that the name does not exist, or has no address
+    if ((error == EAI_NONAME) || (error == EAI_NODATA)
+        || (error == EAI_ADDRFAMILY)) return SCT_RESOLVE_NEGATIVE_TTL_NS;
+    return SCT_RESOLVE_RETRY_TTL_NS;
+}
+
+static void store(char *name, int error, struct addrinfo *ai) {
+    uint64_t now = scu_now_ns();
+    resolve_entry_t *e = find_entry(name);
+    if (!e) {
+        make_room(now);
+        e = calloc(1, sizeof(*e));
+        if (e && !(e->name = scu_strdup(name))) {
+            free(e);
+            e = NULL;
+        }
+        if (!e) return;
+        resolve_entry_t **bucket = bucket_of(name);
+        e->next = *bucket;
+        *bucket = e;
+        g_entry_count++;
+    }
+    e->error = error;
+    e->address[0] = 0;
+    if (!error && ai && getnameinfo(ai->ai_addr, ai->ai_addrlen, e->address,
+        sizeof(e->address), NULL, 0, NI_NUMERICHOST) != 0) e->error = EAI_FAIL;
+    e->expires_ns = now + ttl_of(e->error);
+}
+
+// fresh_entry() is the entry of a name, if not expired
+static resolve_entry_t *fresh_entry(char *name) {
+    resolve_entry_t *e = find_entry(name);
+    return e && (e->expires_ns > scu_now_ns()) ? e : NULL;
+}
+
+// the entries are dropped once the files lookups depend on change
+static void check_files(void) {
+    bool changed = false;
+    for (size_t i = 0; i < SCT_RESOLVE_FILES; i++) {
+        struct stat st;
+        file_state_t now = { 0 };
+        if (stat(g_resolve_files[i], &st) == 0) {
+            now.ino = st.st_ino;
+            now.size = st.st_size;
+            now.mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000LL
+                + st.st_mtim.tv_nsec;
+        }
+        if (memcmp(&now, &g_files[i], sizeof(now))) changed = true;
+        g_files[i] = now;
+    }
+    if (changed) flush_entries();
+}
+
+static bool is_numeric(char *name) {
+    unsigned char buf[sizeof(struct in6_addr)];
+    return (inet_pton(AF_INET, name, buf) == 1)
+        || (inet_pton(AF_INET6, name, buf) == 1);
+}
+#pragma endregion
+
+#pragma region public resolve routines
+//------------------------------------------------------------------------------
+//              public resolve routines
+
+void sct_resolve_names(char **names, int count) {
+    check_files();
+    struct gaicb *requests = calloc(count ? count : 1, sizeof(*requests));
+    struct gaicb **list = calloc(count ? count : 1, sizeof(*list));
+    if (!requests || !list) {
+        free(requests);
+        free(list);
+        return;
+    }
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        if (!names[i] || is_numeric(names[i]) || fresh_entry(names[i]))
+            continue;
+        bool requested = false;
+        for (int k = 0; !requested && (k < n); k++)
+            requested = strcmp(requests[k].ar_name, names[i]) == 0;
+        if (requested) continue;
+        requests[n].ar_name = names[i];
+        requests[n].ar_request = &hints;
+        list[n] = &requests[n];
+        n++;
+    }
+    bool queued = !n || (getaddrinfo_a(GAI_WAIT, list, n, NULL) == 0);
+    // of requests not all queued, those queued are waited for
+    while (!queued) {
+        bool pending = false;
+        for (int k = 0; k < n; k++)
+            pending |= gai_error(list[k]) == EAI_INPROGRESS;
+        if (!pending) break;
+        gai_suspend((const struct gaicb *const *)list, n, NULL);
+    }
+    for (int k = 0; k < n; k++) {
+        int error = gai_error(list[k]);
+        // one never queued, with no result, is looked up here
+        if (!queued && !error && !requests[k].ar_result)
+            error = getaddrinfo(requests[k].ar_name, NULL, &hints,
+                &requests[k].ar_result);
+        store((char *)requests[k].ar_name, error, requests[k].ar_result);
+        if (requests[k].ar_result) freeaddrinfo(requests[k].ar_result);
+    }
+    free(requests);
+    free(list);
+}
+
+int sct_resolve_lookup(char *name, char *address, size_t size) {
+    if (is_numeric(name)) {
+        snprintf(address, size, "%s", name);
+        return 0;
+    }
+    resolve_entry_t *e = fresh_entry(name);
+    if (!e) {
+        sct_resolve_names(&name, 1);
+        e = find_entry(name);
+    }
+    if (!e) return EAI_MEMORY;
+    if (!e->error) snprintf(address, size, "%s", e->address);
+    return e->error;
+}
+
+bool sct_resolve_cached(char *name) {
+    check_files();
+    return fresh_entry(name) != NULL;
+}
+
+void sct_resolve_finalize(void) {
+    flush_entries();
+}
+#pragma endregion
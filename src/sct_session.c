@@ -0,0 +1,321 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <readline/readline.h>
+#include "sct_session.h"
+#include "sct_utils.h"
+
+/*
+    Session record and replay.
+    Recording wraps readline's getc hook and writes every keystroke with
+    its time since the session start, plus a marker per dispatched line:
+
+        # sctest session v1
+        k <t_ns> <key code>
+        c <t_ns> <command line>
+
+    Replaying feeds the recorded keystrokes back through the same hook,
+    as fast as readline takes them, with the terminal and all output
+    detached. So TAB completion, line editing and command dispatch run
+    exactly as they did for the operator. Measured are:
+      - keystroke latency: from handing a key to readline until readline
+        asks for the next one (or, for the key accepting a line, until
+        the line is dispatched);
+      - command latency: from the dispatch of a line until the Core
+        returns to readline.
+    The report with latency distributions is printed when replay ends.
+*/
+
+#define SCT_SESSION_HEADER "# sctest session v1"
+#define SCT_SESSION_MAX_LINE 4096
+#define SCT_SESSION_MAX_NAME 32
+
+typedef enum session_mode_ {
+    SM_NONE,
+    SM_RECORD,
+    SM_REPLAY
+} session_mode_t;
+
+typedef struct samples_ {
+    uint64_t *values;
+    size_t count;
+    size_t capacity;
+} samples_t;
+
+typedef struct command_samples_ {
+    struct command_samples_ *next;
+    char name[SCT_SESSION_MAX_NAME];
+    samples_t samples;
+} command_samples_t;
+
+typedef struct session_ {
+    session_mode_t mode;
+    FILE *f;
+    uint64_t start_ns;
+
+    // replay state
+    int *keys;
+    size_t key_count;
+    size_t next_key;
+    uint64_t key_given_ns;      // 0 if no key is being processed
+    uint64_t command_start_ns;
+    char command_name[SCT_SESSION_MAX_NAME];
+    samples_t key_latency;
+    samples_t command_latency;
+    command_samples_t *per_command;
+    int saved_stdout;
+    FILE *null_stream;
+} session_t;
+
+static session_t g_session = { SM_NONE };
+
+#pragma region samples
+//------------------------------------------------------------------------------
+//              samples
+
+static void add_sample(samples_t *s, uint64_t value) {
+    if (s->count == s->capacity) {
+        size_t capacity = s->capacity ? s->capacity * 2 : 256;
+        uint64_t *values = realloc(s->values, capacity * sizeof(*values));
+        if (!values) return;
+        s->values = values;
+        s->capacity = capacity;
+    }
+    s->values[s->count++] = value;
+}
+
+static samples_t *samples_of_command(char *name) {
+    command_samples_t *cs = g_session.per_command;
+    while (cs) {
+        if (strcmp(cs->name, name) == 0) return &cs->samples;
+        cs = cs->next;
+    }
+    cs = malloc(sizeof(*cs));
+    if (!cs) return NULL;
+    memset(cs, 0, sizeof(*cs));
+    strncpy(cs->name, name, SCT_SESSION_MAX_NAME - 1);
+    cs->next = g_session.per_command;
+    g_session.per_command = cs;
+    return &cs->samples;
+}
+
+static void print_distribution(FILE *out, char *title, samples_t *s) {
+    if (s->count == 0) {
+        fprintf(out, "%-24s      0\n", title);
+        return;
+    }
+    scu_sort_u64(s->values, s->count);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < s->count; i++) sum += s->values[i];
+    fprintf(out, "%-24s %6zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+        title, s->count,
+        s->values[0] / 1e3,
+        scu_percentile_u64(s->values, s->count, 50) / 1e3,
+        scu_percentile_u64(s->values, s->count, 90) / 1e3,
+        scu_percentile_u64(s->values, s->count, 99) / 1e3,
+        s->values[s->count - 1] / 1e3,
+        (double)sum / s->count / 1e3);
+}
+
+static void print_report(FILE *out) {
+    fprintf(out, "\nSession replay latencies, us:\n");
+    fprintf(out, "%-24s %6s %10s %10s %10s %10s %10s %10s\n", "", "count",
+        "min", "p50", "p90", "p99", "max", "mean");
+    print_distribution(out, "keystroke", &g_session.key_latency);
+    print_distribution(out, "command", &g_session.command_latency);
+    for (command_samples_t *cs = g_session.per_command; cs; cs = cs->next) {
+        char title[SCT_SESSION_MAX_NAME + 4];
+        snprintf(title, sizeof(title), "  %s", cs->name);
+        print_distribution(out, title, &cs->samples);
+    }
+}
+#pragma endregion
+
+#pragma region readline hooks
+//------------------------------------------------------------------------------
+//              readline hooks
+
+static uint64_t session_time(void) {
+    return scu_now_ns() - g_session.start_ns;
+}
+
+static int record_getc(FILE *stream) {
+    int c = rl_getc(stream);
+    if (c >= 0) fprintf(g_session.f, "k %llu %d\n",
+        (unsigned long long)session_time(), c);
+    return c;
+}
+
+static int replay_getc(FILE *stream) {
+    uint64_t now = scu_now_ns();
+    if (g_session.key_given_ns)
+        add_sample(&g_session.key_latency, now - g_session.key_given_ns);
+
+    if (g_session.next_key >= g_session.key_count) {
+        g_session.key_given_ns = 0;
+        return EOF;
+    }
+    g_session.key_given_ns = scu_now_ns();
+    return g_session.keys[g_session.next_key++];
+}
+
+// replay is headless: the terminal is never touched
+static void replay_prep_term(int meta_flag) {
+}
+
+static void replay_deprep_term(void) {
+}
+#pragma endregion
+
+#pragma region public session routines
+//------------------------------------------------------------------------------
+//              public session routines
+
+bool sct_session_start_recording(char *fn) {
+    g_session.f = fopen(fn, "w");
+    if (!g_session.f) {
+        perror(fn);
+        return false;
+    }
+    fprintf(g_session.f, "%s\n", SCT_SESSION_HEADER);
+    g_session.mode = SM_RECORD;
+    g_session.start_ns = scu_now_ns();
+    rl_getc_function = record_getc;
+    return true;
+}
+
+static bool load_keys(FILE *f) {
+    char line[SCT_SESSION_MAX_LINE];
+    size_t capacity = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long t;
+        int code;
+        if ((line[0] != 'k') || (sscanf(line, "k %llu %d", &t, &code) != 2))
+            continue;
+        if (g_session.key_count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            int *keys = realloc(g_session.keys, capacity * sizeof(*keys));
+            if (!keys) return false;
+            g_session.keys = keys;
+        }
+        g_session.keys[g_session.key_count++] = code;
+    }
+    return true;
+}
+
+bool sct_session_start_replay(char *fn) {
+    FILE *f = fopen(fn, "r");
+    if (!f) {
+        perror(fn);
+        return false;
+    }
+    bool loaded = load_keys(f);
+    fclose(f);
+    if (!loaded) return false;
+
+    // detach the terminal: readline draws into /dev/null, and so do commands
+    g_session.null_stream = fopen("/dev/null", "r+");
+    if (!g_session.null_stream) return false;
+    fflush(stdout);
+    g_session.saved_stdout = dup(STDOUT_FILENO);
+    dup2(fileno(g_session.null_stream), STDOUT_FILENO);
+
+    rl_instream = g_session.null_stream;
+    rl_outstream = g_session.null_stream;
+    rl_prep_term_function = replay_prep_term;
+    rl_deprep_term_function = replay_deprep_term;
+    rl_getc_function = replay_getc;
+    g_session.mode = SM_REPLAY;
+    g_session.start_ns = scu_now_ns();
+    return true;
+}
+
+void sct_session_command_begin(char *line) {
+    switch (g_session.mode)
+    {
+        case SM_RECORD:
+        {
+            fprintf(g_session.f, "c %llu %s\n",
+                (unsigned long long)session_time(), line);
+            break;
+        }
+        case SM_REPLAY:
+        {
+            uint64_t now = scu_now_ns();
+            // the key accepting the line is done once the line is dispatched
+            if (g_session.key_given_ns) {
+                add_sample(&g_session.key_latency,
+                    now - g_session.key_given_ns);
+                g_session.key_given_ns = 0;
+            }
+            g_session.command_start_ns = now;
+            sscanf(line, "%31s", g_session.command_name);
+            break;
+        }
+        default: break;
+    }
+}
+
+void sct_session_command_end(void) {
+    if (g_session.mode != SM_REPLAY) return;
+    uint64_t latency = scu_now_ns() - g_session.command_start_ns;
+    add_sample(&g_session.command_latency, latency);
+    samples_t *s = samples_of_command(g_session.command_name);
+    if (s) add_sample(s, latency);
+}
+
+void sct_session_finish(void) {
+    switch (g_session.mode)
+    {
+        case SM_RECORD:
+        {
+            fclose(g_session.f);
+            break;
+        }
+        case SM_REPLAY:
+        {
+            fflush(stdout);
+            dup2(g_session.saved_stdout, STDOUT_FILENO);
+            close(g_session.saved_stdout);
+            fclose(g_session.null_stream);
+            print_report(stdout);
+            free(g_session.keys);
+            free(g_session.key_latency.values);
+            free(g_session.command_latency.values);
+            while (g_session.per_command) {
+                command_samples_t *cs = g_session.per_command;
+                g_session.per_command = cs->next;
+                free(cs->samples.values);
+                free(cs);
+            }
+            break;
+        }
+        default: break;
+    }
+    memset(&g_session, 0, sizeof(g_session));
+}
+#pragma endregion
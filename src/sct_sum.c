@@ -0,0 +1,522 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sct_sum.h"
+#include "sct_pool.h"
+
+/*
+    Checksums of files.
+    A file is cut in chunks of SCT_SUM_CHUNK bytes, hashed on the pool's
+    workers in any order, the chunks of all files given being tasks of one
+    job; the file's sum is the hash of its size and of its chunks' hashes
+    in order, a two level Merkle tree. Hashing is thus as parallel as the
+    cores and the storage allow, and a file's sum does not depend on how
+    many workers computed it. Sums are those of sctest: neither xxhsum's
+    nor sha256sum's, a file's content being hashed in chunks.
+    Chunks are mapped rather than read, pages populated by the kernel in
+    one go, so data is not copied. A file shrinking while mapped makes
+    reading past its new end raise SIGBUS: the worker hashing the chunk
+    jumps out of the handler, and the file is reported as changed.
+    XXH3 (64 bit) and SHA-256 are implemented here, as their reference
+    specifications tell, so that sums do not depend on the libraries
+    installed.
+*/
+
+#define SCT_SUM_CHUNK (4u << 20)
+
+#pragma region xxh3
+//------------------------------------------------------------------------------
+//              xxh3
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+#define XXH_SECRET_SIZE 192
+#define XXH_SECRET_SIZE_MIN 136
+#define XXH_STRIPE_LEN 64
+#define XXH_STRIPES_PER_BLOCK ((XXH_SECRET_SIZE - XXH_STRIPE_LEN) / 8)
+#define XXH_BLOCK_LEN (XXH_STRIPE_LEN * XXH_STRIPES_PER_BLOCK)
+
+static const uint8_t g_secret[XXH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// x86 and arm64 are little endian, as XXH3 reads its input
+static uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+    __uint128_t p = (__uint128_t)a * b;
+    return (uint64_t)p ^ (uint64_t)(p >> 64);
+}
+
+static uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+static uint64_t xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= XXH_PRIME_MX1;
+    return h ^ (h >> 32);
+}
+
+static uint64_t rrmxmx(uint64_t h, uint64_t len) {
+    h ^= ((h << 49) | (h >> 15)) ^ ((h << 24) | (h >> 40));
+    h *= XXH_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= XXH_PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static uint64_t mix16(const uint8_t *p, const uint8_t *secret) {
+    return mul128_fold64(read64(p) ^ read64(secret),
+        read64(p + 8) ^ read64(secret + 8));
+}
+
+static uint64_t xxh3_short(const uint8_t *p, size_t len) {
+    const uint8_t *s = g_secret;
+    if (len > 8) {
+        uint64_t lo = read64(p) ^ (read64(s + 24) ^ read64(s + 32));
+        uint64_t hi = read64(p + len - 8) ^ (read64(s + 40) ^ read64(s + 48));
+        return xxh3_avalanche(len + __builtin_bswap64(lo) + hi
+            + mul128_fold64(lo, hi));
+    }
+    if (len >= 4) {
+        uint64_t v = read32(p + len - 4) + ((uint64_t)read32(p) << 32);
+        return rrmxmx(v ^ (read64(s + 8) ^ read64(s + 16)), len);
+    }
+    if (len) {
+        uint32_t combined = ((uint32_t)p[0] << 16) | ((uint32_t)p[len >> 1] << 24)
+            | p[len - 1] | ((uint32_t)len << 8);
+        return xxh64_avalanche(combined ^ (uint64_t)(read32(s) ^ read32(s + 4)));
+    }
+    return xxh64_avalanche(read64(s + 56) ^ read64(s + 64));
+}
+
+static uint64_t xxh3_medium(const uint8_t *p, size_t len) {
+    const uint8_t *s = g_secret;
+    uint64_t acc = len * XXH_PRIME64_1;
+    if (len <= 128) {
+        if (len > 32) {
+            if (len > 64) {
+                if (len > 96) {
+                    acc += mix16(p + 48, s + 96);
+                    acc += mix16(p + len - 64, s + 112);
+                }
+                acc += mix16(p + 32, s + 64);
+                acc += mix16(p + len - 48, s + 80);
+            }
+            acc += mix16(p + 16, s + 32);
+            acc += mix16(p + len - 32, s + 48);
+        }
+        acc += mix16(p, s);
+        acc += mix16(p + len - 16, s + 16);
+        return xxh3_avalanche(acc);
+    }
+    for (int i = 0; i < 8; i++) acc += mix16(p + 16 * i, s + 16 * i);
+    acc = xxh3_avalanche(acc);
+    for (size_t i = 8; i < len / 16; i++)
+        acc += mix16(p + 16 * i, s + 16 * (i - 8) + 3);
+    acc += mix16(p + len - 16, s + XXH_SECRET_SIZE_MIN - 17);
+    return xxh3_avalanche(acc);
+}
+
+static void accumulate512(uint64_t acc[8], const uint8_t *p,
+    const uint8_t *secret)
+{
+    for (int i = 0; i < 8; i++) {
+        uint64_t v = read64(p + 8 * i);
+        uint64_t key = v ^ read64(secret + 8 * i);
+        acc[i ^ 1] += v;
+        acc[i] += (uint64_t)(uint32_t)key * (key >> 32);
+    }
+}
+
+static void scramble(uint64_t acc[8], const uint8_t *secret) {
+    for (int i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(secret + 8 * i);
+        acc[i] = a * XXH_PRIME32_1;
+    }
+}
+
+static uint64_t xxh3_long(const uint8_t *p, size_t len) {
+    uint64_t acc[8] = { XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2,
+        XXH_PRIME64_3, XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5,
+        XXH_PRIME32_1 };
+    size_t blocks = (len - 1) / XXH_BLOCK_LEN;
+    for (size_t n = 0; n < blocks; n++) {
+        const uint8_t *block = p + n * XXH_BLOCK_LEN;
+        for (int s = 0; s < XXH_STRIPES_PER_BLOCK; s++)
+            accumulate512(acc, block + s * XXH_STRIPE_LEN, g_secret + s * 8);
+        scramble(acc, g_secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN);
+    }
+    size_t stripes = ((len - 1) - blocks * XXH_BLOCK_LEN) / XXH_STRIPE_LEN;
+    const uint8_t *block = p + blocks * XXH_BLOCK_LEN;
+    for (size_t s = 0; s < stripes; s++)
+        accumulate512(acc, block + s * XXH_STRIPE_LEN, g_secret + s * 8);
+    accumulate512(acc, p + len - XXH_STRIPE_LEN,
+        g_secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN - 7);
+    uint64_t h = len * XXH_PRIME64_1;
+    for (int i = 0; i < 4; i++)
+        h += mul128_fold64(acc[2 * i] ^ read64(g_secret + 11 + 16 * i),
+            acc[2 * i + 1] ^ read64(g_secret + 11 + 16 * i + 8));
+    return xxh3_avalanche(h);
+}
+
+uint64_t sct_xxh3(const void *data, size_t len) {
+    const uint8_t *p = data;
+    if (len <= 16) return xxh3_short(p, len);
+    if (len <= 240) return xxh3_medium(p, len);
+    return xxh3_long(p, len);
+}
+#pragma endregion
+
+#pragma region sha256
+//------------------------------------------------------------------------------
+//              sha256
+
+static const uint32_t g_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(uint32_t h[8], const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = __builtin_bswap32(read32(p + 4 * i));
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18)
+            ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19)
+            ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25))
+            + ((e & f) ^ (~e & g)) + g_k[i] + w[i];
+        uint32_t t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22))
+            + ((a & b) ^ (a & c) ^ (b & c));
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void sct_sha256(const void *data, size_t len, uint8_t digest[SCT_SHA256_SIZE])
+{
+    uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    const uint8_t *p = data;
+    size_t full = len & ~(size_t)63;
+    for (size_t i = 0; i < full; i += 64) sha256_block(h, p + i);
+    // the padding: 0x80, zeroes, and the length in bits, big endian
+    uint8_t last[128];
+    size_t rest = len - full;
+    memcpy(last, p + full, rest);
+    memset(last + rest, 0, sizeof(last) - rest);
+    last[rest] = 0x80;
+    size_t tail = rest < 56 ? 64 : 128;
+    uint64_t bits = __builtin_bswap64((uint64_t)len * 8);
+    memcpy(last + tail - 8, &bits, sizeof(bits));
+    for (size_t i = 0; i < tail; i += 64) sha256_block(h, last + i);
+    for (int i = 0; i < 8; i++) {
+        uint32_t v = __builtin_bswap32(h[i]);
+        memcpy(digest + 4 * i, &v, sizeof(v));
+    }
+}
+#pragma endregion
+
+#pragma region sum
+//------------------------------------------------------------------------------
+//              sum
+
+typedef struct sum_file_ {
+    char *path;
+    int fd;
+    off_t size;
+    size_t chunk_count;
+    uint8_t *hashes;        // of the chunks, in order
+    int error;              // errno, set by any worker
+    bool changed;           // shrunk while read
+} sum_file_t;
+
+typedef struct sum_task_ {
+    sum_file_t *file;
+    size_t chunk;
+} sum_task_t;
+
+typedef struct sum_job_ {
+    sct_sum_kind_t kind;
+    size_t hash_size;
+} sum_job_t;
+
+// where a worker reading a mapped chunk goes on SIGBUS
+static __thread sigjmp_buf *t_bus_jump = NULL;
+
+static void on_sigbus(int sig) {
+    if (t_bus_jump) siglongjmp(*t_bus_jump, 1);
+    // not from reading a chunk
+    signal(SIGBUS, SIG_DFL);
+    raise(SIGBUS);
+}
+
+static void hash_chunk(sum_job_t *job, const void *data, size_t len,
+    uint8_t *hash)
+{
+    if (job->kind == SCT_SUM_SHA256) sct_sha256(data, len, hash);
+    else {
+        uint64_t h = sct_xxh3(data, len);
+        memcpy(hash, &h, sizeof(h));
+    }
+}
+
+static void sum_task(sct_pool_t *pool, void *arg, int worker, void *ctx) {
+    sum_job_t *job = ctx;
+    sum_task_t *task = arg;
+    sum_file_t *f = task->file;
+    off_t offset = (off_t)task->chunk * SCT_SUM_CHUNK;
+    size_t len = f->size - offset < SCT_SUM_CHUNK ? f->size - offset
+        : SCT_SUM_CHUNK;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+        f->fd, offset);
+    if (map == MAP_FAILED) {
+        __atomic_store_n(&f->error, errno, __ATOMIC_RELAXED);
+        return;
+    }
+    sigjmp_buf jump;
+    if (sigsetjmp(jump, 1)) {
+        t_bus_jump = NULL;
+        __atomic_store_n(&f->changed, true, __ATOMIC_RELAXED);
+    }
+    else {
+        t_bus_jump = &jump;
+        hash_chunk(job, map, len, f->hashes + task->chunk * job->hash_size);
+        t_bus_jump = NULL;
+    }
+    munmap(map, len);
+}
+
+// open_file() opens a file to sum and counts its chunks
+static bool open_file(sum_file_t *f, char *path, size_t hash_size) {
+    f->path = path;
+    f->fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if ((f->fd == -1) || (fstat(f->fd, &st) != 0)) {
+        f->error = errno;
+        return false;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        f->error = EINVAL;
+        return false;
+    }
+    f->size = st.st_size;
+    f->chunk_count = (f->size + SCT_SUM_CHUNK - 1) / SCT_SUM_CHUNK;
+    f->hashes = malloc((f->chunk_count ? f->chunk_count : 1) * hash_size);
+    if (!f->hashes) f->error = ENOMEM;
+    return f->hashes != NULL;
+}
+
+// file_sum() hashes the size and the chunks' hashes of a file into
+// its sum
+static bool file_sum(sum_job_t *job, sum_file_t *f, uint8_t *sum) {
+    size_t len = 8 + f->chunk_count * job->hash_size;
+    uint8_t *tree = malloc(len);
+    if (!tree) return false;
+    uint64_t size = f->size;
+    memcpy(tree, &size, sizeof(size));
+    memcpy(tree + 8, f->hashes, len - 8);
+    hash_chunk(job, tree, len, sum);
+    free(tree);
+    return true;
+}
+
+static void print_sum(sum_job_t *job, sum_file_t *f) {
+    uint8_t sum[SCT_SHA256_SIZE];
+    if (!file_sum(job, f, sum)) {
+        fprintf(stderr, "sum: %s: %s\n", f->path, strerror(ENOMEM));
+        return;
+    }
+    char hex[2 * SCT_SHA256_SIZE + 1];
+    if (job->kind == SCT_SUM_SHA256) {
+        for (int i = 0; i < SCT_SHA256_SIZE; i++)
+            sprintf(hex + 2 * i, "%02x", sum[i]);
+    }
+    else {
+        uint64_t h;
+        memcpy(&h, sum, sizeof(h));
+        sprintf(hex, "%016llx", (unsigned long long)h);
+    }
+    printf("%s  %s\n", hex, f->path);
+}
+
+// sum_files() opens files and hashes their chunks; false for lack of
+// memory
+static bool sum_files(sum_job_t *job, sum_file_t *files, char **paths,
+    size_t count)
+{
+    size_t task_count = 0;
+    for (size_t i = 0; i < count; i++)
+        if (open_file(&files[i], paths[i], job->hash_size))
+            task_count += files[i].chunk_count;
+    sum_task_t *tasks = malloc((task_count ? task_count : 1) * sizeof(*tasks));
+    void **list = malloc((task_count ? task_count : 1) * sizeof(void *));
+    bool succeeded = tasks && list;
+    // the pool takes the last task first: the chunks are listed backwards
+    // for the files to be read forwards
+    size_t n = task_count;
+    for (size_t i = 0; succeeded && (i < count); i++) {
+        for (size_t c = 0; !files[i].error && (c < files[i].chunk_count);
+            c++) {
+            tasks[--n] = (sum_task_t){ &files[i], c };
+            list[n] = &tasks[n];
+        }
+    }
+    if (succeeded && task_count) {
+        struct sigaction sa, old_sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_sigbus;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGBUS, &sa, &old_sa);
+        succeeded = sct_pool_run("sum", sct_pool_default_workers(), sum_task,
+            job, list + n, task_count - n);
+        sigaction(SIGBUS, &old_sa, NULL);
+    }
+    free(tasks);
+    free(list);
+    return succeeded;
+}
+
+static void close_files(sum_file_t *files, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (files[i].fd >= 0) close(files[i].fd);
+        free(files[i].hashes);
+    }
+    free(files);
+}
+
+bool sct_sum_files(char **paths, size_t count, sct_sum_kind_t kind,
+    uint8_t *sums, int *errors)
+{
+    sum_job_t job = { kind, kind == SCT_SUM_SHA256 ? SCT_SHA256_SIZE : 8 };
+    sum_file_t *files = calloc(count ? count : 1, sizeof(*files));
+    bool succeeded = files && sum_files(&job, files, paths, count);
+    for (size_t i = 0; succeeded && (i < count); i++) {
+        sum_file_t *f = &files[i];
+        errors[i] = f->error ? f->error : f->changed ? SCT_SUM_CHANGED : 0;
+        if (!errors[i] && !file_sum(&job, f, sums + i * job.hash_size))
+            succeeded = false;
+    }
+    if (files) close_files(files, count);
+    return succeeded;
+}
+
+int sct_sum(char **paths, int count, sct_sum_kind_t kind) {
+    sum_job_t job = { kind, kind == SCT_SUM_SHA256 ? SCT_SHA256_SIZE : 8 };
+    char *name = kind == SCT_SUM_SHA256 ? "sum256" : "sum";
+    sum_file_t *files = calloc(count ? count : 1, sizeof(*files));
+    bool succeeded = files && sum_files(&job, files, paths, count);
+    if (!succeeded) fprintf(stderr, "%s: %s\n", name, strerror(ENOMEM));
+    if (!files) return 1;
+    int retval = succeeded ? 0 : 1;
+    for (int i = 0; i < count; i++) {
+        sum_file_t *f = &files[i];
+        if (f->error || f->changed) {
+            fprintf(stderr, "%s: %s: %s\n", name, f->path,
+                f->error ? strerror(f->error) : "file changed while read");
+            retval = 1;
+        }
+        else if (succeeded) print_sum(&job, f);
+    }
+    fflush(stdout);
+    close_files(files, count);
+    return retval;
+}
+#pragma endregion
@@ -0,0 +1,227 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "sct_trace.h"
+#include "sct_utils.h"
+
+/*
+    Chrome Trace Event Format output ('--trace file.json').
+    Every thread records its spans into its own ring buffer; the thread is
+    the only producer and the flushing (main) thread the only consumer,
+    so recording takes no locks: an event is written, then the head index
+    is published with a release store. Buffers are linked into a global
+    list with a CAS the first time a thread records anything.
+    The main thread drains all buffers after every command line and when
+    tracing stops. A full ring drops events rather than blocking; drops
+    are counted and reported in the trace's metadata.
+    The resulting file opens in Perfetto or chrome://tracing.
+*/
+
+#define SCT_TRACE_RING_SIZE 8192     // events per thread, a power of 2
+#define SCT_TRACE_THREAD_NAME_LEN 32
+
+typedef struct trace_event_ {
+    const char *name;
+    const char *cat;
+    const char *detail;
+    uint64_t start_ns;
+    uint64_t end_ns;
+} trace_event_t;
+
+typedef struct trace_buffer_ {
+    struct trace_buffer_ *next;
+    int tid;
+    char thread_name[SCT_TRACE_THREAD_NAME_LEN];
+    _Atomic bool name_pending;
+    _Atomic uint64_t head;      // written by the owning thread
+    _Atomic uint64_t tail;      // written by the flushing thread
+    _Atomic uint64_t dropped;
+    trace_event_t events[SCT_TRACE_RING_SIZE];
+} trace_buffer_t;
+
+static _Atomic bool g_trace_enabled = false;
+static _Atomic(trace_buffer_t *) g_buffers = NULL;
+static FILE *g_trace_file = NULL;
+static bool g_first_event = true;
+static uint64_t g_start_ns = 0;
+static int g_pid = 0;
+static __thread trace_buffer_t *t_buffer = NULL;
+
+#pragma region recording
+//------------------------------------------------------------------------------
+//              recording
+
+static trace_buffer_t *thread_buffer(void) {
+    if (t_buffer) return t_buffer;
+    trace_buffer_t *b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->tid = (int)syscall(SYS_gettid);
+    trace_buffer_t *head = atomic_load(&g_buffers);
+    do {
+        b->next = head;
+    } while (!atomic_compare_exchange_weak(&g_buffers, &head, b));
+    t_buffer = b;
+    return b;
+}
+
+bool sct_trace_enabled(void) {
+    return atomic_load_explicit(&g_trace_enabled, memory_order_relaxed);
+}
+
+void sct_trace_span(const char *name, const char *cat, const char *detail,
+    uint64_t start_ns, uint64_t end_ns)
+{
+    if (!sct_trace_enabled()) return;
+    trace_buffer_t *b = thread_buffer();
+    if (!b) return;
+
+    uint64_t head = atomic_load_explicit(&b->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&b->tail, memory_order_acquire);
+    if (head - tail >= SCT_TRACE_RING_SIZE) {
+        atomic_fetch_add_explicit(&b->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    trace_event_t *e = &b->events[head & (SCT_TRACE_RING_SIZE - 1)];
+    e->name = name;
+    e->cat = cat;
+    e->detail = detail;
+    e->start_ns = start_ns;
+    e->end_ns = end_ns;
+    atomic_store_explicit(&b->head, head + 1, memory_order_release);
+}
+
+void sct_trace_thread_name(const char *name) {
+    if (!sct_trace_enabled()) return;
+    trace_buffer_t *b = thread_buffer();
+    if (!b) return;
+    strncpy(b->thread_name, name, SCT_TRACE_THREAD_NAME_LEN - 1);
+    atomic_store_explicit(&b->name_pending, true, memory_order_release);
+}
+#pragma endregion
+
+#pragma region output
+//------------------------------------------------------------------------------
+//              output
+
+static void write_string(const char *s) {
+    fputc('"', g_trace_file);
+    for (; *s; s++) {
+        if ((*s == '"') || (*s == '\\')) fputc('\\', g_trace_file);
+        if ((unsigned char)*s >= ' ') fputc(*s, g_trace_file);
+    }
+    fputc('"', g_trace_file);
+}
+
+static void begin_event(void) {
+    fputs(g_first_event ? "\n" : ",\n", g_trace_file);
+    g_first_event = false;
+}
+
+static void write_event(trace_buffer_t *b, trace_event_t *e) {
+    begin_event();
+    fprintf(g_trace_file, "{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+        "\"ts\":%.3f,\"dur\":%.3f,\"name\":", g_pid, b->tid,
+        (e->start_ns - g_start_ns) / 1e3, (e->end_ns - e->start_ns) / 1e3);
+    write_string(e->name);
+    fputs(",\"cat\":", g_trace_file);
+    write_string(e->cat);
+    if (e->detail) {
+        fputs(",\"args\":{\"detail\":", g_trace_file);
+        write_string(e->detail);
+        fputc('}', g_trace_file);
+    }
+    fputc('}', g_trace_file);
+}
+
+static void write_thread_name(trace_buffer_t *b) {
+    begin_event();
+    fprintf(g_trace_file, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+        "\"name\":\"thread_name\",\"args\":{\"name\":", g_pid, b->tid);
+    write_string(b->thread_name);
+    fputs("}}", g_trace_file);
+}
+
+void sct_trace_flush(void) {
+    if (!g_trace_file) return;
+    trace_buffer_t *b = atomic_load(&g_buffers);
+    for (; b; b = b->next) {
+        if (atomic_exchange_explicit(&b->name_pending, false,
+            memory_order_acquire)) write_thread_name(b);
+
+        uint64_t tail = atomic_load_explicit(&b->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&b->head, memory_order_acquire);
+        while (tail != head) {
+            write_event(b, &b->events[tail & (SCT_TRACE_RING_SIZE - 1)]);
+            tail++;
+        }
+        atomic_store_explicit(&b->tail, tail, memory_order_release);
+    }
+    fflush(g_trace_file);
+}
+#pragma endregion
+
+#pragma region public trace routines
+//------------------------------------------------------------------------------
+//              public trace routines
+
+bool sct_trace_start(char *fn) {
+    g_trace_file = fopen(fn, "w");
+    if (!g_trace_file) {
+        perror(fn);
+        return false;
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", g_trace_file);
+    g_first_event = true;
+    g_pid = getpid();
+    g_start_ns = scu_now_ns();
+    atomic_store(&g_trace_enabled, true);
+    sct_trace_thread_name("main");
+    return true;
+}
+
+// Must be called after worker threads are joined: their buffers are freed.
+void sct_trace_stop(void) {
+    if (!g_trace_file) return;
+    atomic_store(&g_trace_enabled, false);
+    sct_trace_flush();
+
+    uint64_t dropped = 0;
+    trace_buffer_t *b = atomic_exchange(&g_buffers, NULL);
+    while (b) {
+        trace_buffer_t *next = b->next;
+        dropped += atomic_load(&b->dropped);
+        free(b);
+        b = next;
+    }
+    t_buffer = NULL;
+    fprintf(g_trace_file, "\n],\"metadata\":{\"dropped_events\":%llu}}\n",
+        (unsigned long long)dropped);
+    fclose(g_trace_file);
+    g_trace_file = NULL;
+}
+#pragma endregion
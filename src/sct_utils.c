@@ -1,267 +1,405 @@
-// The MIT License (MIT)
-//
-//  Copyright (c) 2024 Maxim Kryukov
-//
-//  Permission is hereby granted, free of charge, to any person obtaining a copy 
-//  of this software and associated documentation files (the “Software”), 
-//  to deal in the Software without restriction, including without limitation 
-//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
-//  and/or sell copies of the Software, and to permit persons to whom the 
-//  Software is furnished to do so, subject to the following conditions:
-//
-//  The above copyright notice and this permission notice shall be included 
-//  in all copies or substantial portions of the Software.
-//
-//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
-//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
-//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
-//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
-//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
-//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
-//  DEALINGS IN THE SOFTWARE.
-
-#include <stdlib.h>
-#include <string.h>
-#include <stdarg.h>
-#include <stdio.h>
-#include <ctype.h>
-#include <sys/stat.h>
-#include "sct_utils.h"
-
-#define EMPTY_STRING(x)  ((x == NULL) || (*x == 0)) 
-
-inline static bool is_regular_file(struct stat *finfo) {
-    return  S_ISREG(finfo->st_mode);
-}
-
-inline static bool is_directory(struct stat *finfo) {
-    return  S_ISDIR(finfo->st_mode);
-}
-
-bool scu_file_exists(char *fn, bool *err_printed) {
-    char *rfn = scu_dequote(fn);
-    if (!rfn) {
-        *err_printed = true;
-        printf("Empty name.\n");
-        return false;
-    } 
-
-    struct stat finfo;
-    bool result = stat(rfn, &finfo) == 0;
-    if (!result) {
-        *err_printed = true;
-        perror("");
-    }
-    else result = is_regular_file(&finfo);
-
-    free(rfn);
-    return result;
-}
-
-bool scu_file_or_dir_exists(char *fn, bool *err_printed) {
-    char *rfn = scu_dequote(fn);
-    if (!rfn) {
-        *err_printed = true;
-        printf("Empty name.\n");
-        return false;
-    } 
-
-    struct stat finfo;
-    bool result = stat(rfn, &finfo) == 0;
-    if (!result) {
-        *err_printed = true;
-        perror("");
-    }
-    else result = (is_regular_file(&finfo) || is_directory(&finfo));
-
-    free(rfn);
-    return result;
-}
-
-bool scu_directory_exists(char *fn, bool *err_printed) {
-    char *rfn = scu_dequote(fn);
-    if (!rfn) {
-        *err_printed = true;
-        printf("Empty name.\n");
-        return false;
-    } 
-
-    struct stat finfo;
-    bool result = stat(rfn, &finfo) == 0;
-    if (!result) {
-        *err_printed = true;
-        perror("");
-    }
-    else result = is_directory(&finfo);
-
-    free(rfn);
-    return result;
-}
-
-static char *build_match_mask(bool allow_all, bool allow_alpha, 
-    bool allow_numeric, char *allow_chars, char *disallow_chars)
-{
-    char *result = malloc(256);
-    if (!result) return NULL;
-    if (allow_all) memset(result, 1, 256);
-    else {
-        memset(result, 0, sizeof(*result));
-
-        if (allow_numeric) {
-            result['0'] = 1;
-            result['1'] = 1;
-            result['2'] = 1;
-            result['3'] = 1;
-            result['4'] = 1;
-            result['5'] = 1;
-            result['6'] = 1;
-            result['7'] = 1;
-            result['8'] = 1;
-            result['9'] = 1;        
-        }
-        if (allow_alpha) {
-            for (int i = 0; i < 256; i++)
-                if (isalpha((char)i)) result[i] = 1;
-        }
-        if (allow_chars) {
-            size_t len = strlen(allow_chars);
-            for (int i = 0; i < len; i++) result[allow_chars[i]] = 1;
-        }
-    }
-    if (disallow_chars) {
-        size_t len = strlen(disallow_chars);
-            for (int i = 0; i < len; i++) result[disallow_chars[i]] = 0;
-    }
-
-    return result;
-}    
-
-// returns true if every char in s is checked in mask
-static bool match_mask(char *s, char *mask) {
-    size_t len = strlen(s);
-    for (int i = 0; i < len; i++)
-        if (!mask[s[i]]) return false; 
-    return true;
-}
-
-static char *g_ip4_mask = NULL;
-static char *g_hostname_mask = NULL;
-static char *g_ip6_mask = NULL;
-static char *g_filename_mask = NULL;
-
-bool scu_initialize_utils(void) {
-    g_ip4_mask = build_match_mask(false, false, true, ".", "");
-    g_hostname_mask = build_match_mask(false, true, true, "-_.", "");
-    g_ip6_mask = build_match_mask(false, false, true, ":abcdefABCDEF", "");
-    g_filename_mask = build_match_mask(true, true, true, "", "<>|&");
-
-    if (!g_ip4_mask || !g_hostname_mask || !g_ip6_mask || !g_filename_mask) 
-        return false;
-
-    return true;
-}
-
-void scu_finalize_utils(void) {
-    free(g_ip4_mask);
-    g_ip4_mask = NULL;
-    free(g_hostname_mask);
-    g_hostname_mask = NULL;    
-    free(g_ip6_mask);
-    g_ip6_mask = NULL;
-    free(g_filename_mask);
-    g_filename_mask = NULL;    
-}
-
-bool scu_validate_filename(char *s) {
-    return !scu_is_empty_str(s) && match_mask(s, g_filename_mask);
-}
-
-static bool scu_is_hostname(char *s) {
-    return !scu_is_empty_str(s) && match_mask(s, g_hostname_mask);
-}
-
-static bool scu_is_ip4_name(char *s) {
-    return !scu_is_empty_str(s) && match_mask(s, g_ip4_mask);
-}
-
-static bool scu_is_ip6_name(char *s) {
-    return !scu_is_empty_str(s) && match_mask(s, g_ip6_mask);
-}
-
-// We do not actually check a name semantics, just check if all characters
-// in a string are valid for a certain name type.
-// So addresses like '.1023.15.2' or '_mysite..com' will pass this test.
-bool scu_validate_hostname_or_ip(char *s) {
-    return scu_is_hostname(s) || scu_is_ip4_name(s) || scu_is_ip6_name(s);
-}
-
-bool scu_is_empty_str(char *s) {
-    if (EMPTY_STRING(s)) return true;
-    size_t len = strlen(s);
-    while (s) {
-        if ((*s != ' ') && (*s != '\t')) return false;
-        s++;
-    }
-    return true;
-}
-
-char *scu_strdup(char *s) {
-	if (EMPTY_STRING(s))
-		return NULL;
-	size_t len = strlen(s);
-	char *result = (char*)malloc(len + 1);
-	if (result)
-	{
-		strcpy(result, s);
-	}
-	return result;
-}
-
-char *scu_strndup(char *s, size_t n)
-{
-	if (EMPTY_STRING(s) || (n == 0))
-		return NULL;
-	char *result = malloc(n + 1);
-    if (result) {
-        strncpy(result, s, n);
-        result[n] = 0;
-    }
-	return result;
-}
-
-char *scu_sprintf(char *fmt, ...) {
-	va_list arglist;
-	va_start(arglist, fmt);
-	va_list arglist2;
-	va_copy(arglist2, arglist);
-	size_t new_sz = vsnprintf(NULL, 0, fmt, arglist);
-	char *result = NULL;
-	if (new_sz) {
-		result = malloc(new_sz + 1);
-		if (result) {
-			if (0 >= vsnprintf(result, new_sz + 1, fmt, arglist2)) {
-				free(result);
-				result = NULL;
-			}
-			else result[new_sz] = 0;
-		}
-	}
-	va_end(arglist);
-	va_end(arglist2);
-	return result;
-}
-
-inline static bool is_quote_char(char c) {
-    return (c == '\'') || (c == '"');
-}
-
-char *scu_dequote(char *s) {
-    if (EMPTY_STRING(s)) return NULL;
-    size_t len = strlen(s);
-    if ((len > 1) && is_quote_char(*s) && (*s == s[len - 1])) {
-        len -= 2;
-        s++;
-        return len ? scu_strndup(s, len) : NULL;
-    }
-    else return scu_strdup(s);
-}
\ No newline at end of file
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "sct_utils.h"
+
+#define EMPTY_STRING(x)  ((x == NULL) || (*x == 0)) 
+
+inline static bool is_regular_file(struct stat *finfo) {
+    return  S_ISREG(finfo->st_mode);
+}
+
+inline static bool is_directory(struct stat *finfo) {
+    return  S_ISDIR(finfo->st_mode);
+}
+
+bool scu_file_exists(char *fn, bool *err_printed) {
+    char *rfn = scu_dequote(fn);
+    if (!rfn) {
+        *err_printed = true;
+        printf("Empty name.\n");
+        return false;
+    } 
+
+    struct stat finfo;
+    bool result = stat(rfn, &finfo) == 0;
+    if (!result) {
+        *err_printed = true;
+        perror("");
+    }
+    else result = is_regular_file(&finfo);
+
+    free(rfn);
+    return result;
+}
+
+bool scu_file_or_dir_exists(char *fn, bool *err_printed) {
+    char *rfn = scu_dequote(fn);
+    if (!rfn) {
+        *err_printed = true;
+        printf("Empty name.\n");
+        return false;
+    } 
+
+    struct stat finfo;
+    bool result = stat(rfn, &finfo) == 0;
+    if (!result) {
+        *err_printed = true;
+        perror("");
+    }
+    else result = (is_regular_file(&finfo) || is_directory(&finfo));
+
+    free(rfn);
+    return result;
+}
+
+bool scu_directory_exists(char *fn, bool *err_printed) {
+    char *rfn = scu_dequote(fn);
+    if (!rfn) {
+        *err_printed = true;
+        printf("Empty name.\n");
+        return false;
+    } 
+
+    struct stat finfo;
+    bool result = stat(rfn, &finfo) == 0;
+    if (!result) {
+        *err_printed = true;
+        perror("");
+    }
+    else result = is_directory(&finfo);
+
+    free(rfn);
+    return result;
+}
+
+/*
+    Character class validation.
+    Every byte is classified with two 16-entry tables indexed by its low
+    and high nibble; the AND of both entries is the set of CB_* groups
+    the byte belongs to (the pshufb nibble lookup technique). A string
+    belongs to a class if each of its bytes is in one of the class's
+    groups, so all classes are decided in a single pass. With SSSE3
+    16 bytes are looked up at once; otherwise the same tables are used
+    byte by byte.
+*/
+#define CB_DIGIT        0x01    // 0-9
+#define CB_DOT          0x02    // .
+#define CB_DASH         0x04    // -
+#define CB_HEX_ALPHA    0x08    // a-f A-F
+#define CB_COLON        0x10    // :
+#define CB_ALPHA_A_O    0x20    // a-o A-O
+#define CB_ALPHA_P_Z    0x40    // p-z P-Z
+#define CB_UNDERSCORE   0x80    // _
+
+#define HOSTNAME_GROUPS (CB_DIGIT | CB_DOT | CB_DASH | CB_ALPHA_A_O \
+    | CB_ALPHA_P_Z | CB_UNDERSCORE)
+#define IP4_GROUPS (CB_DIGIT | CB_DOT)
+#define IP6_GROUPS (CB_DIGIT | CB_HEX_ALPHA | CB_COLON)
+
+#define ALL_CLASSES (SCU_CLASS_HOSTNAME | SCU_CLASS_IP4 | SCU_CLASS_IP6 \
+    | SCU_CLASS_FILENAME)
+
+static const uint8_t g_class_lo[16] __attribute__((aligned(16))) = {
+    CB_DIGIT | CB_ALPHA_P_Z,                                        // 0
+    CB_DIGIT | CB_HEX_ALPHA | CB_ALPHA_A_O | CB_ALPHA_P_Z,          // 1
+    CB_DIGIT | CB_HEX_ALPHA | CB_ALPHA_A_O | CB_ALPHA_P_Z,          // 2
+    CB_DIGIT | CB_HEX_ALPHA | CB_ALPHA_A_O | CB_ALPHA_P_Z,          // 3
+    CB_DIGIT | CB_HEX_ALPHA | CB_ALPHA_A_O | CB_ALPHA_P_Z,          // 4
+    CB_DIGIT | CB_HEX_ALPHA | CB_ALPHA_A_O | CB_ALPHA_P_Z,          // 5
+    CB_DIGIT | CB_HEX_ALPHA | CB_ALPHA_A_O | CB_ALPHA_P_Z,          // 6
+    CB_DIGIT | CB_ALPHA_A_O | CB_ALPHA_P_Z,                         // 7
+    CB_DIGIT | CB_ALPHA_A_O | CB_ALPHA_P_Z,                         // 8
+    CB_DIGIT | CB_ALPHA_A_O | CB_ALPHA_P_Z,                         // 9
+    CB_COLON | CB_ALPHA_A_O | CB_ALPHA_P_Z,                         // A
+    CB_ALPHA_A_O,                                                   // B
+    CB_ALPHA_A_O,                                                   // C
+    CB_DASH | CB_ALPHA_A_O,                                         // D
+    CB_DOT | CB_ALPHA_A_O,                                          // E
+    CB_ALPHA_A_O | CB_UNDERSCORE                                    // F
+};
+
+static const uint8_t g_class_hi[16] __attribute__((aligned(16))) = {
+    0, 0,
+    CB_DOT | CB_DASH,                                               // 2x
+    CB_DIGIT | CB_COLON,                                            // 3x
+    CB_HEX_ALPHA | CB_ALPHA_A_O,                                    // 4x
+    CB_ALPHA_P_Z | CB_UNDERSCORE,                                   // 5x
+    CB_HEX_ALPHA | CB_ALPHA_A_O,                                    // 6x
+    CB_ALPHA_P_Z,                                                   // 7x
+    0, 0, 0, 0, 0, 0, 0, 0                  // no class but filename above
+};
+
+inline static bool is_filename_forbidden(unsigned char c) {
+    return (c == '<') || (c == '>') || (c == '|') || (c == '&');
+}
+
+// returns SCU_CLASS_* bits of the classes s[0..len) is NOT in
+static unsigned classify_failures_scalar(const unsigned char *s, size_t len) {
+    unsigned failures = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned groups = g_class_lo[s[i] & 0x0F] & g_class_hi[s[i] >> 4];
+        if (!(groups & HOSTNAME_GROUPS)) failures |= SCU_CLASS_HOSTNAME;
+        if (!(groups & IP4_GROUPS)) failures |= SCU_CLASS_IP4;
+        if (!(groups & IP6_GROUPS)) failures |= SCU_CLASS_IP6;
+        if (is_filename_forbidden(s[i])) failures |= SCU_CLASS_FILENAME;
+    }
+    return failures;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCU_HAVE_SSSE3_CLASSIFIER
+
+static const uint8_t g_keep_mask[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+// loads len < 16 bytes of s with the rest of a block filled by '0'
+__attribute__((target("ssse3")))
+static __m128i load_padded_ssse3(const unsigned char *s, size_t len) {
+    __m128i v;
+    // reading past the end is harmless unless it crosses into the next page,
+    // but sanitizers would report it
+#ifndef __SANITIZE_ADDRESS__
+    if (((uintptr_t)s & 4095) <= 4096 - 16)
+        v = _mm_loadu_si128((const __m128i *)s);
+    else
+#endif
+    {
+        uint8_t block[16];
+        memcpy(block, s, len);
+        v = _mm_loadu_si128((const __m128i *)block);
+    }
+    __m128i keep = _mm_loadu_si128((const __m128i *)(g_keep_mask + 16 - len));
+    return _mm_or_si128(_mm_and_si128(keep, v),
+        _mm_andnot_si128(keep, _mm_set1_epi8('0')));
+}
+
+__attribute__((target("ssse3")))
+static unsigned classify_failures_ssse3(const unsigned char *s, size_t len) {
+    const __m128i lo_table = _mm_load_si128((const __m128i *)g_class_lo);
+    const __m128i hi_table = _mm_load_si128((const __m128i *)g_class_hi);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i hostname = _mm_set1_epi8((char)HOSTNAME_GROUPS);
+    const __m128i ip4 = _mm_set1_epi8(IP4_GROUPS);
+    const __m128i ip6 = _mm_set1_epi8(IP6_GROUPS);
+    __m128i not_hostname = zero, not_ip4 = zero, not_ip6 = zero;
+    __m128i forbidden = zero;
+
+    // a block is 16 bytes at s + i; the last one overlaps the previous,
+    // or, for a short string, is padded with '0', a member of every class
+    size_t last = len >= 16 ? len - 16 : 0;
+    for (size_t i = 0; ; i = i + 16 < last ? i + 16 : last) {
+        __m128i v;
+        if (len >= 16) v = _mm_loadu_si128((const __m128i *)(s + i));
+        else v = load_padded_ssse3(s, len);
+        __m128i lo = _mm_shuffle_epi8(lo_table, _mm_and_si128(v, nibble));
+        __m128i hi = _mm_shuffle_epi8(hi_table,
+            _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        __m128i groups = _mm_and_si128(lo, hi);
+        not_hostname = _mm_or_si128(not_hostname,
+            _mm_cmpeq_epi8(_mm_and_si128(groups, hostname), zero));
+        not_ip4 = _mm_or_si128(not_ip4,
+            _mm_cmpeq_epi8(_mm_and_si128(groups, ip4), zero));
+        not_ip6 = _mm_or_si128(not_ip6,
+            _mm_cmpeq_epi8(_mm_and_si128(groups, ip6), zero));
+        forbidden = _mm_or_si128(forbidden, _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('<')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('>'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('|')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('&')))));
+        if (i == last) break;
+    }
+
+    unsigned failures = 0;
+    if (_mm_movemask_epi8(not_hostname)) failures |= SCU_CLASS_HOSTNAME;
+    if (_mm_movemask_epi8(not_ip4)) failures |= SCU_CLASS_IP4;
+    if (_mm_movemask_epi8(not_ip6)) failures |= SCU_CLASS_IP6;
+    if (_mm_movemask_epi8(forbidden)) failures |= SCU_CLASS_FILENAME;
+    return failures;
+}
+#endif
+
+typedef unsigned (*classify_fn_t)(const unsigned char *s, size_t len);
+static classify_fn_t g_classify_failures = classify_failures_scalar;
+
+bool scu_initialize_utils(void) {
+#ifdef SCU_HAVE_SSSE3_CLASSIFIER
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+        g_classify_failures = classify_failures_ssse3;
+#endif
+    return true;
+}
+
+void scu_finalize_utils(void) {
+    g_classify_failures = classify_failures_scalar;
+}
+
+unsigned scu_classify(char *s, size_t len) {
+    if (!s || !len) return 0;
+    return ALL_CLASSES & ~g_classify_failures((const unsigned char *)s, len);
+}
+
+void scu_classify_bulk(char **strs, size_t count, unsigned *classes) {
+    classify_fn_t classify_failures = g_classify_failures;
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strs[i] ? strlen(strs[i]) : 0;
+        classes[i] = len ? ALL_CLASSES & ~classify_failures(
+            (const unsigned char *)strs[i], len) : 0;
+    }
+}
+
+bool scu_validate_filename(char *s) {
+    return !scu_is_empty_str(s)
+        && (scu_classify(s, strlen(s)) & SCU_CLASS_FILENAME);
+}
+
+// We do not actually check a name semantics, just check if all characters
+// in a string are valid for a certain name type.
+// So addresses like '.1023.15.2' or '_mysite..com' will pass this test.
+bool scu_validate_hostname_or_ip(char *s) {
+    return !scu_is_empty_str(s) && (scu_classify(s, strlen(s))
+        & (SCU_CLASS_HOSTNAME | SCU_CLASS_IP4 | SCU_CLASS_IP6));
+}
+
+bool scu_is_empty_str(char *s) {
+    if (EMPTY_STRING(s)) return true;
+    size_t len = strlen(s);
+    while (s) {
+        if ((*s != ' ') && (*s != '\t')) return false;
+        s++;
+    }
+    return true;
+}
+
+char *scu_strdup(char *s) {
+	if (EMPTY_STRING(s))
+		return NULL;
+	size_t len = strlen(s);
+	char *result = (char*)malloc(len + 1);
+	if (result)
+	{
+		strcpy(result, s);
+	}
+	return result;
+}
+
+char *scu_strndup(char *s, size_t n)
+{
+	if (EMPTY_STRING(s) || (n == 0))
+		return NULL;
+	char *result = malloc(n + 1);
+    if (result) {
+        strncpy(result, s, n);
+        result[n] = 0;
+    }
+	return result;
+}
+
+char *scu_sprintf(char *fmt, ...) {
+	va_list arglist;
+	va_start(arglist, fmt);
+	va_list arglist2;
+	va_copy(arglist2, arglist);
+	size_t new_sz = vsnprintf(NULL, 0, fmt, arglist);
+	char *result = NULL;
+	if (new_sz) {
+		result = malloc(new_sz + 1);
+		if (result) {
+			if (0 >= vsnprintf(result, new_sz + 1, fmt, arglist2)) {
+				free(result);
+				result = NULL;
+			}
+			else result[new_sz] = 0;
+		}
+	}
+	va_end(arglist);
+	va_end(arglist2);
+	return result;
+}
+
+inline static bool is_quote_char(char c) {
+    return (c == '\'') || (c == '"');
+}
+
+char *scu_dequote(char *s) {
+    if (EMPTY_STRING(s)) return NULL;
+    size_t len = strlen(s);
+    if ((len > 1) && is_quote_char(*s) && (*s == s[len - 1])) {
+        len -= 2;
+        s++;
+        return len ? scu_strndup(s, len) : NULL;
+    }
+    else return scu_strdup(s);
+}
+
+// monotonic time for measurements, in nanoseconds
+uint64_t scu_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(uint64_t*)a;
+    uint64_t y = *(uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+void scu_sort_u64(uint64_t *values, size_t n) {
+    qsort(values, n, sizeof(*values), cmp_u64);
+}
+
+// nearest-rank percentile of sorted values, p in [0, 100]
+uint64_t scu_percentile_u64(uint64_t *sorted, size_t n, double p) {
+    if (n == 0) return 0;
+    size_t rank = (size_t)(p / 100.0 * n + 0.5);
+    if (rank > 0) rank--;
+    if (rank >= n) rank = n - 1;
+    return sorted[rank];
+}
+
+// Signals sent to sctest (SIGINT for follow to end, SIGTERM for metrics
+// to clean up) go to a thread not blocking them, so helper threads block
+// them all, leaving them to the command thread. SIGPROF stays open for
+// the profiler's timer to sample whichever thread is running.
+int scu_thread_create(pthread_t *thread, void *(*fn)(void *), void *arg) {
+    sigset_t all, old;
+    sigfillset(&all);
+    sigdelset(&all, SIGPROF);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int result = pthread_create(thread, NULL, fn, arg);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return result;
+}
@@ -0,0 +1,252 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include "sct_walk.h"
+#include "sct_pool.h"
+
+/*
+    Parallel directory walker.
+    Every directory is a task of a worker pool job. A worker opens it
+    with openat() relative to its parent, whose descriptor is kept open
+    until all of its child directories are, so no path is looked up whole
+    and trees of any depth are walked; it reads it with getdents64() into a buffer of its own,
+    and, when the type of an entry is needed and not given by the file
+    system, stats it with fstatat() relative to the directory, so each
+    inode is stated once, with no path lookup beyond its name. Child
+    directories are pushed as tasks to the worker's own deque: the worker
+    goes on depth first, idle workers steal the directories left nearest
+    the roots.
+    Paths are built in a per worker buffer; nothing is allocated per
+    entry, only per directory.
+*/
+
+#define SCT_WALK_DENTS_SIZE (64 * 1024)
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// a directory open for its children to be opened relative to it, closed
+// by the last of them or by itself if it has none
+typedef struct walk_dir_ {
+    int fd;
+    int refs;
+} walk_dir_t;
+
+typedef struct walk_task_ {
+    walk_dir_t *parent;     // NULL for a root, opened by its path
+    int root;
+    int depth;
+    size_t name_at;         // of its name in path
+    char path[];
+} walk_task_t;
+
+typedef struct walk_worker_ {
+    char *dents;
+    char *path;
+    size_t path_capacity;
+} walk_worker_t;
+
+typedef struct walk_job_ {
+    int flags;
+    sct_walk_fn_t fn;
+    void *ctx;
+    walk_worker_t *workers;
+    bool failed;            // set by any worker
+} walk_job_t;
+
+static walk_task_t *new_task(char *path, walk_dir_t *parent, size_t name_at,
+    int root, int depth)
+{
+    size_t len = strlen(path);
+    walk_task_t *task = malloc(sizeof(*task) + len + 1);
+    if (!task) return NULL;
+    task->parent = parent;
+    task->root = root;
+    task->depth = depth;
+    task->name_at = name_at;
+    memcpy(task->path, path, len + 1);
+    if (parent) __atomic_add_fetch(&parent->refs, 1, __ATOMIC_RELAXED);
+    return task;
+}
+
+static void put_dir(walk_dir_t *dir) {
+    if (!dir || __atomic_sub_fetch(&dir->refs, 1, __ATOMIC_ACQ_REL)) return;
+    close(dir->fd);
+    free(dir);
+}
+
+// join() puts dir/name in the worker's path buffer
+static char *join(walk_worker_t *w, char *dir, size_t dir_len, char *name) {
+    size_t name_len = strlen(name);
+    size_t len = dir_len + name_len + 2;
+    if (len > w->path_capacity) {
+        size_t capacity = w->path_capacity ? w->path_capacity : 256;
+        while (capacity < len) capacity *= 2;
+        char *path = realloc(w->path, capacity);
+        if (!path) return NULL;
+        w->path = path;
+        w->path_capacity = capacity;
+    }
+    memcpy(w->path, dir, dir_len);
+    if (dir_len && (dir[dir_len - 1] != '/')) w->path[dir_len++] = '/';
+    memcpy(w->path + dir_len, name, name_len + 1);
+    return w->path;
+}
+
+// visit() reports an entry of the directory open as dir
+static void visit(sct_pool_t *pool, walk_job_t *job, walk_worker_t *w,
+    walk_task_t *task, walk_dir_t *dir, struct linux_dirent64 *d, int worker)
+{
+    char *path = join(w, task->path, strlen(task->path), d->d_name);
+    if (!path) {
+        __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+        return;
+    }
+    sct_walk_entry_t e = { path, path + strlen(path) - strlen(d->d_name),
+        task->root, task->depth + 1, d->d_type, NULL, 0 };
+    struct stat st;
+    if ((job->flags & SCT_WALK_STAT) || (d->d_type == DT_UNKNOWN)) {
+        if (fstatat(dir->fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            e.st = &st;
+            e.type = IFTODT(st.st_mode);
+        }
+        else if (errno == ENOENT) return;   // gone meanwhile
+        else e.error = errno;
+    }
+    job->fn(&e, worker, job->ctx);
+    if (e.type == DT_DIR) {
+        walk_task_t *child = new_task(path, dir, e.name - path, task->root,
+            task->depth + 1);
+        if (child) sct_pool_push(pool, child);
+        else __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+    }
+}
+
+static void walk_task(sct_pool_t *pool, void *arg, int worker, void *ctx) {
+    walk_job_t *job = ctx;
+    walk_task_t *task = arg;
+    walk_worker_t *w = &job->workers[worker];
+    if (!w->dents && !(w->dents = malloc(SCT_WALK_DENTS_SIZE))) {
+        __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+        put_dir(task->parent);
+        free(task);
+        return;
+    }
+    // a root's name is its path
+    int fd = openat(task->parent ? task->parent->fd : AT_FDCWD,
+        task->path + task->name_at,
+        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    int err = errno;
+    put_dir(task->parent);
+    // the task's own reference, dropped once its entries are visited
+    walk_dir_t *dir = fd >= 0 ? malloc(sizeof(*dir)) : NULL;
+    if (dir) {
+        dir->fd = fd;
+        dir->refs = 1;
+    }
+    else if (fd >= 0) {
+        __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+        close(fd);
+        free(task);
+        return;
+    }
+    long n = fd < 0 ? -1 : 0;
+    while (dir
+        && ((n = syscall(SYS_getdents64, fd, w->dents, SCT_WALK_DENTS_SIZE))
+        > 0)) {
+        for (long at = 0; at < n; ) {
+            struct linux_dirent64 *d = (void *)(w->dents + at);
+            at += d->d_reclen;
+            if ((strcmp(d->d_name, ".") != 0) && (strcmp(d->d_name, "..") != 0))
+                visit(pool, job, w, task, dir, d, worker);
+        }
+    }
+    if (n < 0) {
+        if (dir) err = errno;
+        char *name = strrchr(task->path, '/');
+        sct_walk_entry_t e = { task->path, name && name[1] ? name + 1
+            : task->path, task->root, task->depth, DT_DIR, NULL, err };
+        job->fn(&e, worker, job->ctx);
+    }
+    put_dir(dir);
+    free(task);
+}
+
+bool sct_walk(char **roots, int count, int flags, int workers,
+    sct_walk_fn_t fn, void *ctx)
+{
+    walk_job_t job = { flags, fn, ctx, calloc(workers, sizeof(walk_worker_t)),
+        false };
+    walk_task_t **tasks = malloc((count ? count : 1) * sizeof(*tasks));
+    if (!job.workers || !tasks) {
+        free(job.workers);
+        free(tasks);
+        return false;
+    }
+    size_t task_count = 0;
+    for (int i = 0; i < count; i++) {
+        char *name = strrchr(roots[i], '/');
+        sct_walk_entry_t e = { roots[i], name && name[1] ? name + 1 : roots[i],
+            i, 0, DT_UNKNOWN, NULL, 0 };
+        struct stat st;
+        if (fstatat(AT_FDCWD, roots[i], &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            e.st = &st;
+            e.type = IFTODT(st.st_mode);
+        }
+        else e.error = errno;
+        fn(&e, 0, ctx);
+        if (e.type != DT_DIR) continue;
+        // the pool takes the last task first: the roots are listed
+        // backwards for the first to be walked first
+        if ((tasks[task_count] = new_task(roots[i], NULL, 0, i, 0))) task_count++;
+        else job.failed = true;
+    }
+    for (size_t i = 0; i < task_count / 2; i++) {
+        walk_task_t *t = tasks[i];
+        tasks[i] = tasks[task_count - 1 - i];
+        tasks[task_count - 1 - i] = t;
+    }
+    if (task_count && !sct_pool_run("walk", workers, walk_task, &job,
+        (void **)tasks, task_count)) job.failed = true;
+    for (int i = 0; i < workers; i++) {
+        free(job.workers[i].dents);
+        free(job.workers[i].path);
+    }
+    free(job.workers);
+    free(tasks);
+    return !job.failed;
+}
@@ -1,58 +1,180 @@
-// The MIT License (MIT)
-//
-//  Copyright (c) 2024 Maxim Kryukov
-//
-//  Permission is hereby granted, free of charge, to any person obtaining a copy 
-//  of this software and associated documentation files (the “Software”), 
-//  to deal in the Software without restriction, including without limitation 
-//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
-//  and/or sell copies of the Software, and to permit persons to whom the 
-//  Software is furnished to do so, subject to the following conditions:
-//
-//  The above copyright notice and this permission notice shall be included 
-//  in all copies or substantial portions of the Software.
-//
-//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
-//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
-//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
-//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
-//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
-//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
-//  DEALINGS IN THE SOFTWARE.
-
-#include <stdio.h>
-#include "sctest_build_config.h"
-#include "sct_core.h"
-#include "sct_utils.h"
-#include "sct_commands.h"
-#include "sct_example_plugin.h"
-
-#define SCT_PROG_TITLE "SCTest"
-#define STRINGIZE(x) STRINGIZE2(x)
-#define STRINGIZE2(x) #x
-
-static void print_welcome(void) {
-    char *build_config = STRINGIZE(SCTEST_BUILD_CONFIG);
-    if (scu_is_empty_str(build_config)) build_config = "default";
-    printf("\n%s v.%s; build_config: %s; built: %s\n", SCT_PROG_TITLE,
-        SCTEST_VERSION, build_config, SCTEST_BUILD_DATE);
-}
-
-int main(int argc, char** argv) {    
-    if (!scu_initialize_utils() || !sct_initialize()) {
-        printf("Unexpected error.\n");
-        return 1;
-    }
-
-    print_welcome();
-
-    sct_init_builtin_commands();
-    // put additional plugin commands' initialization here
-    init_example_plugin();
-
-    sct_run();
-    sct_finalize();
-    scu_finalize_utils();
-    return 0;
-}
-
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sctest_build_config.h"
+#include "sct_core.h"
+#include "sct_utils.h"
+#include "sct_commands.h"
+#include "sct_example_plugin.h"
+#include "sct_plugins.h"
+#include "sct_exec.h"
+#include "sct_fileops.h"
+#include "sct_io.h"
+#include "sct_session.h"
+#include "sct_history.h"
+#include "sct_pool.h"
+#include "sct_record.h"
+#include "sct_regex.h"
+#include "sct_resolve.h"
+#include "sct_trace.h"
+
+#define SCT_PROG_TITLE "SCTest"
+#define STRINGIZE(x) STRINGIZE2(x)
+#define STRINGIZE2(x) #x
+
+static void print_welcome(void) {
+    char *build_config = STRINGIZE(SCTEST_BUILD_CONFIG);
+    if (scu_is_empty_str(build_config)) build_config = "default";
+    printf("\n%s v.%s; build_config: %s; built: %s\n", SCT_PROG_TITLE,
+        SCTEST_VERSION, build_config, SCTEST_BUILD_DATE);
+}
+
+static void print_usage(void) {
+    printf("Usage: sctest [--plugin-dir <dir>] [--record <file> | "
+        "--replay <file>] [--fixture <dir>]\n"
+        "              [--trace <file.json>] [--history <file>]\n"
+        "              [--io <auto | uring | syscalls>] "
+        "[--output <text | json | binary>]\n");
+}
+
+// command line options
+typedef struct sct_options_ {
+    char *plugin_dir;   // given explicitly, or NULL for the default one
+    char *record_fn;    // record keystrokes of this session
+    char *replay_fn;    // replay a recorded session headless
+    char *fixture_dir;  // directory to run the session in
+    char *trace_fn;     // Chrome trace events output
+    char *history_fn;   // persistent history, $HOME's one if interactive
+    sct_io_backend_t io_backend;
+    sct_output_t output;    // of the commands: text or records
+} sct_options_t;
+
+static bool parse_options(int argc, char **argv, sct_options_t *options) {
+    memset(options, 0, sizeof(*options));
+    options->plugin_dir = getenv(SCT_PLUGIN_DIR_ENV);
+    if (scu_is_empty_str(options->plugin_dir)) options->plugin_dir = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--plugin-dir") == 0) && (i + 1 < argc))
+            options->plugin_dir = argv[++i];
+        else if ((strcmp(argv[i], "--record") == 0) && (i + 1 < argc))
+            options->record_fn = argv[++i];
+        else if ((strcmp(argv[i], "--replay") == 0) && (i + 1 < argc))
+            options->replay_fn = argv[++i];
+        else if ((strcmp(argv[i], "--fixture") == 0) && (i + 1 < argc))
+            options->fixture_dir = argv[++i];
+        else if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc))
+            options->trace_fn = argv[++i];
+        else if ((strcmp(argv[i], "--history") == 0) && (i + 1 < argc))
+            options->history_fn = argv[++i];
+        else if ((strcmp(argv[i], "--io") == 0) && (i + 1 < argc)) {
+            char *backend = argv[++i];
+            if (strcmp(backend, "uring") == 0)
+                options->io_backend = SCT_IO_URING;
+            else if (strcmp(backend, "syscalls") == 0)
+                options->io_backend = SCT_IO_SYSCALLS;
+            else if (strcmp(backend, "auto") != 0) return false;
+        }
+        else if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc)) {
+            char *output = argv[++i];
+            if (strcmp(output, "json") == 0)
+                options->output = SCT_OUTPUT_JSON;
+            else if (strcmp(output, "binary") == 0)
+                options->output = SCT_OUTPUT_BINARY;
+            else if (strcmp(output, "text") != 0) return false;
+        }
+        else return false;
+    }
+    return !(options->record_fn && options->replay_fn);
+}
+
+int main(int argc, char** argv) {    
+    sct_options_t options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage();
+        return 1;
+    }
+
+    if (!scu_initialize_utils() || !sct_initialize()) {
+        printf("Unexpected error.\n");
+        return 1;
+    }
+    if (!sct_io_initialize(options.io_backend)) {
+        printf("io_uring is not available.\n");
+        return 1;
+    }
+    // before anything is printed, for records alone to reach stdout
+    if (!sct_record_start(options.output)) return 1;
+
+    print_welcome();
+
+    sct_init_builtin_commands();
+    // put additional plugin commands' initialization here
+    init_example_plugin();
+    // runtime plugins are registered from their manifests and loaded on demand
+    char *default_dir = options.plugin_dir ? NULL : sct_default_plugin_dir();
+    if (options.plugin_dir || default_dir)
+        sct_load_plugin_manifests(options.plugin_dir ? options.plugin_dir
+            : default_dir);
+    free(default_dir);
+
+    // a replayed session must not depend on the operator's history
+    if (!options.replay_fn) {
+        char *history_fn = options.history_fn;
+        char *default_fn = NULL;
+        if (!history_fn && isatty(STDIN_FILENO))
+            history_fn = default_fn = sct_history_default_path();
+        if (history_fn) sct_history_open(history_fn);
+        free(default_fn);
+    }
+
+    if (options.fixture_dir && (chdir(options.fixture_dir) == -1)) {
+        perror(options.fixture_dir);
+        return 1;
+    }
+    if (options.trace_fn && !sct_trace_start(options.trace_fn)) return 1;
+    if (options.record_fn && !sct_session_start_recording(options.record_fn))
+        return 1;
+    if (options.replay_fn && !sct_session_start_replay(options.replay_fn))
+        return 1;
+
+    sct_run();
+    sct_session_finish();
+    sct_history_close();
+    sct_pool_finalize();
+    sct_trace_stop();
+    sct_finalize();
+    sct_unload_plugins();
+    sct_exec_finalize();
+    sct_io_finalize();
+    sct_record_finish();
+    sct_grep_finalize();
+    sct_resolve_finalize();
+    sct_regex_finalize();
+    scu_finalize_utils();
+    return 0;
+}
+
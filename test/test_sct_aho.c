@@ -0,0 +1,130 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_sct_aho.h"
+#include "sct_aho.h"
+
+static char *random_string(int min, int max, int letters) {
+    int len = min + rand() % (max - min + 1);
+    char *s = malloc(len + 1);
+    for (int i = 0; s && (i < len); i++) s[i] = 'a' + rand() % letters;
+    if (s) s[len] = 0;
+    return s;
+}
+
+// check_lines() compares the strings found in every line of data with
+// the ones strstr() finds
+static bool check_lines(sct_aho_t *ac, char **patterns, int count,
+    char *data, size_t len)
+{
+    char *p = data;
+    char *end = data + len;
+    bool *expected = malloc(count);
+    while (p < end) {
+        size_t start, stop;
+        int *found;
+        int found_count;
+        bool hit = sct_aho_find_line(ac, p, end - p, &start, &stop, &found,
+            &found_count);
+        // every line before the one found has none of the strings
+        char *line = p;
+        char *limit = hit ? p + start : end;
+        while (line < limit) {
+            char *eol = memchr(line, '\n', end - line);
+            // past the end, data still has the last '\n'
+            if (!eol) eol = end;
+            *eol = 0;
+            for (int i = 0; i < count; i++) {
+                if (!strstr(line, patterns[i])) continue;
+                printf("\t \"%s\" missed in \"%s\".\n", patterns[i], line);
+                *eol = '\n';
+                free(expected);
+                return false;
+            }
+            *eol = '\n';
+            line = eol + 1;
+        }
+        if (!hit) break;
+
+        char saved = p[stop];
+        p[stop] = 0;
+        int expected_count = 0;
+        for (int i = 0; i < count; i++) {
+            expected[i] = strstr(p + start, patterns[i]) != NULL;
+            // of equal strings, the first one is reported
+            for (int j = 0; expected[i] && (j < i); j++)
+                if (strcmp(patterns[i], patterns[j]) == 0) expected[i] = false;
+            expected_count += expected[i];
+        }
+        bool ok = found_count == expected_count;
+        for (int i = 0; ok && (i < found_count); i++) ok = expected[found[i]];
+        if (!ok) printf("\t wrong strings found in \"%s\".\n", p + start);
+        p[stop] = saved;
+        if (!ok) {
+            free(expected);
+            return false;
+        }
+        p += stop + 1;
+    }
+    free(expected);
+    return true;
+}
+
+// a set of count strings, max long, over letters, on lines of text
+static bool test_set(int count, int max, int letters) {
+    char **patterns = malloc(count * sizeof(char *));
+    for (int i = 0; i < count; i++) patterns[i] = random_string(1, max, letters);
+    size_t len = 0;
+    char *data = malloc(200 * 82);
+    for (int i = 0; i < 200; i++) {
+        char *line = random_string(0, 80, letters + 1);
+        len += sprintf(data + len, "%s\n", line);
+        free(line);
+    }
+
+    sct_aho_t *ac = sct_aho_build(patterns, count);
+    bool succeeded = ac && check_lines(ac, patterns, count, data, len)
+        // and without the last '\n'
+        && check_lines(ac, patterns, count, data, len - 1);
+    sct_aho_free(ac);
+    free(data);
+    for (int i = 0; i < count; i++) free(patterns[i]);
+    free(patterns);
+    if (!succeeded) printf("\t %d strings up to %d long FAILED.\n", count, max);
+    return succeeded;
+}
+
+bool perform_test_sct_aho(void) {
+    printf("testing sct_aho...\n");
+    srand(1);
+    bool succeeded = true;
+    // small sets make a DFA, big ones stay packed
+    for (int i = 0; succeeded && (i < 20); i++)
+        succeeded = test_set(1 + i % 5, 4, 3) && test_set(20, 6, 4)
+            && ((i % 5) || test_set(3000, 12, 20));
+    if (succeeded)
+        printf("All sct_aho succeeded.\n");
+    return succeeded;
+}
@@ -0,0 +1,195 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "test_sct_decomp.h"
+#include "sct_decomp.h"
+
+// The compressed files are made here of stored blocks, gzip's and zstd's
+// alike, so no compressor is needed: decompressing them takes the same
+// paths as any other through the framing, buffers and thread.
+
+static char g_path[] = "/tmp/test_sct_decomp_XXXXXX";
+
+typedef struct out_ {
+    unsigned char *data;
+    size_t len;
+} out_t;
+
+static void put(out_t *o, const void *p, size_t len) {
+    memcpy(o->data + o->len, p, len);
+    o->len += len;
+}
+
+static void put_le(out_t *o, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) o->data[o->len++] = (v >> (8 * i)) & 0xff;
+}
+
+static uint32_t crc32(const unsigned char *p, size_t len) {
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+    }
+    return ~crc;
+}
+
+// a gzip member of stored deflate blocks
+static void put_gzip(out_t *o, const unsigned char *p, size_t len) {
+    static const unsigned char header[] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0,
+        0, 0xff };
+    put(o, header, sizeof(header));
+    size_t pos = 0;
+    do {
+        size_t n = len - pos < 65535 ? len - pos : 65535;
+        o->data[o->len++] = pos + n == len;
+        put_le(o, n, 2);
+        put_le(o, ~n & 0xffff, 2);
+        put(o, p + pos, n);
+        pos += n;
+    } while (pos < len);
+    put_le(o, crc32(p, len), 4);
+    put_le(o, len, 4);
+}
+
+// a zstd frame of raw blocks, with a window of 128KB
+static void put_zstd(out_t *o, const unsigned char *p, size_t len) {
+    static const unsigned char header[] = { 0x28, 0xb5, 0x2f, 0xfd, 0, 0x38 };
+    put(o, header, sizeof(header));
+    size_t pos = 0;
+    do {
+        size_t n = len - pos < 100000 ? len - pos : 100000;
+        put_le(o, (uint32_t)(n << 3) | (pos + n == len), 3);
+        put(o, p + pos, n);
+        pos += n;
+    } while (pos < len);
+}
+
+static bool write_file(out_t *o) {
+    FILE *f = fopen(g_path, "w");
+    if (!f) return false;
+    bool written = fwrite(o->data, 1, o->len, f) == o->len;
+    return (fclose(f) == 0) && written;
+}
+
+// check_file() decompresses the file, comparing what comes out with
+// expected, and tells whether it ended in an error; false if the
+// library is missing
+static bool check_file(sct_decomp_format_t format, unsigned char *expected,
+    size_t len, bool error_expected, bool *available)
+{
+    char msg[128];
+    sct_decomp_t *d = sct_decomp_open(g_path, format, msg, sizeof(msg));
+    if (!d) {
+        printf("\t %s, skipped.\n", msg);
+        *available = false;
+        return true;
+    }
+    size_t pos = 0;
+    bool same = true;
+    char *data;
+    size_t n;
+    while (same && sct_decomp_next(d, &data, &n)) {
+        same = (pos + n <= len) && (memcmp(expected + pos, data, n) == 0);
+        pos += n;
+    }
+    bool error = sct_decomp_error(d) != NULL;
+    sct_decomp_close(d);
+    if (!same || (!error_expected && (pos != len))) {
+        printf("\t wrong data decompressed at %zu.\n", pos);
+        return false;
+    }
+    if (error != error_expected) {
+        printf("\t error %sexpected.\n", error ? "un" : "");
+        return false;
+    }
+    return true;
+}
+
+// check_format() decompresses a file of two members or frames, then the
+// file cut short, then stops reading it early
+static bool check_format(sct_decomp_format_t format, out_t *o,
+    unsigned char *data, size_t len)
+{
+    void (*put_part)(out_t *, const unsigned char *, size_t) =
+        format == SCT_DECOMP_GZIP ? put_gzip : put_zstd;
+    o->len = 0;
+    put_part(o, data, len / 3);
+    put_part(o, data + len / 3, len - len / 3);
+    if (sct_decomp_detect((char *)o->data, o->len) != format) {
+        printf("\t format not detected.\n");
+        return false;
+    }
+    bool available = true;
+    if (!write_file(o) || !check_file(format, data, len, false, &available))
+        return false;
+    if (!available) return true;
+    o->len -= 5;
+    if (!write_file(o) || !check_file(format, data, len, true, &available))
+        return false;
+
+    char msg[128];
+    sct_decomp_t *d = sct_decomp_open(g_path, format, msg, sizeof(msg));
+    char *p;
+    size_t n;
+    bool read = d && sct_decomp_next(d, &p, &n);
+    // the thread is stopped while it waits for a free buffer
+    sct_decomp_close(d);
+    if (!read) printf("\t nothing decompressed.\n");
+    return read;
+}
+
+bool perform_test_sct_decomp(void) {
+    printf("testing sct_decomp...\n");
+    srand(1);
+    // lines of text, long enough for all buffers
+    size_t len = 3 << 20;
+    unsigned char *data = malloc(len);
+    out_t o = { malloc(len + len / 8), 0 };
+    bool succeeded = data && o.data && (mkstemp(g_path) != -1);
+    for (size_t i = 0; succeeded && (i < len); i++)
+        data[i] = rand() % 60 ? 'a' + rand() % 26 : '\n';
+    if (succeeded) {
+        succeeded = (sct_decomp_detect("plain text\n", 11) == SCT_DECOMP_NONE)
+            && (sct_decomp_detect("\x1f\x8b", 2) == SCT_DECOMP_NONE);
+        if (!succeeded) printf("\t plain text taken for compressed.\n");
+    }
+    if (succeeded) {
+        succeeded = check_format(SCT_DECOMP_GZIP, &o, data, len);
+        if (!succeeded) printf("\t gzip FAILED.\n");
+    }
+    if (succeeded) {
+        succeeded = check_format(SCT_DECOMP_ZSTD, &o, data, len);
+        if (!succeeded) printf("\t zstd FAILED.\n");
+    }
+    unlink(g_path);
+    free(data);
+    free(o.data);
+    if (succeeded)
+        printf("All sct_decomp succeeded.\n");
+    return succeeded;
+}
@@ -0,0 +1,574 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "test_sct_fileops.h"
+#include "sct_fileops.h"
+
+static char g_dir[] = "/tmp/test_sct_sync_XXXXXX";
+static char g_src[64];
+static char g_dst[64];
+static char g_link[64];
+static char g_out[64];
+
+// the source: 48 blocks of 64KB and a partial one, blocks 40 to 47 zero
+#define BLOCK (64 * 1024)
+#define SRC_SIZE (48 * BLOCK + 10000)
+#define SRC_BLOCKS 49
+#define ZERO_FIRST 40
+#define ZERO_LAST 47
+
+static char *g_data;
+
+static bool write_all(char *path, char *data, size_t len, int flags) {
+    int fd = open(path, O_WRONLY | O_CREAT | flags, 0644);
+    if (fd < 0) return false;
+    bool succeeded = write(fd, data, len) == (ssize_t)len;
+    return (close(fd) == 0) && succeeded;
+}
+
+// the output of the calls between capture_start() and capture_end(),
+// stdout and stderr, goes to the file g_out
+typedef struct capture_ {
+    int fd;
+    int saved_out;
+    int saved_err;
+} capture_t;
+
+static bool capture_start(capture_t *c) {
+    fflush(stdout);
+    fflush(stderr);
+    c->fd = open(g_out, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    c->saved_out = dup(STDOUT_FILENO);
+    c->saved_err = dup(STDERR_FILENO);
+    if ((c->fd >= 0) && (c->saved_out >= 0) && (c->saved_err >= 0)) {
+        dup2(c->fd, STDOUT_FILENO);
+        dup2(c->fd, STDERR_FILENO);
+        return true;
+    }
+    if (c->fd >= 0) close(c->fd);
+    if (c->saved_out >= 0) close(c->saved_out);
+    if (c->saved_err >= 0) close(c->saved_err);
+    return false;
+}
+
+// capture_end() returns the output, NUL-terminated, for the caller to free
+static char *capture_end(capture_t *c) {
+    fflush(stdout);
+    fflush(stderr);
+    dup2(c->saved_out, STDOUT_FILENO);
+    dup2(c->saved_err, STDERR_FILENO);
+    close(c->saved_out);
+    close(c->saved_err);
+    off_t size = lseek(c->fd, 0, SEEK_END);
+    char *out = size >= 0 ? malloc(size + 1) : NULL;
+    if (out && (pread(c->fd, out, size, 0) != size)) {
+        free(out);
+        out = NULL;
+    }
+    if (out) out[size] = 0;
+    close(c->fd);
+    return out;
+}
+
+// run_sync() calls sct_sync() with its output in out, NUL-terminated
+static int run_sync(char *dst, bool durable, char *out, size_t size) {
+    capture_t c;
+    if (!capture_start(&c)) return -1;
+    int retval = sct_sync(g_src, dst, durable);
+    char *text = capture_end(&c);
+    snprintf(out, size, "%s", text ? text : "");
+    free(text);
+    return retval;
+}
+
+// check_sync() syncs the source to the destination, expecting written
+// blocks of it to be written and both files to be equal after
+static bool check_sync(char *what, bool durable, size_t written) {
+    char out[256];
+    char expected[128];
+    snprintf(expected, sizeof(expected), "%s: %zu of %d blocks written\n",
+        g_dst, written, SRC_BLOCKS);
+    int retval = run_sync(g_dst, durable, out, sizeof(out));
+    if ((retval != 0) || (strcmp(out, expected) != 0)) {
+        printf("\t %s: returned %d, printed '%s'.\n", what, retval, out);
+        return false;
+    }
+    char *data = malloc(SRC_SIZE + 1);
+    int fd = open(g_dst, O_RDONLY);
+    ssize_t n = (data && (fd >= 0)) ? read(fd, data, SRC_SIZE + 1) : -1;
+    bool equal = (n == SRC_SIZE) && (memcmp(data, g_data, SRC_SIZE) == 0);
+    if (fd >= 0) close(fd);
+    free(data);
+    if (!equal) printf("\t %s: destination differs.\n", what);
+    return equal;
+}
+
+// damage() changes a byte of each of the destination blocks listed
+static bool damage(int *blocks, size_t count) {
+    int fd = open(g_dst, O_WRONLY);
+    if (fd < 0) return false;
+    bool succeeded = true;
+    for (size_t i = 0; succeeded && (i < count); i++) {
+        off_t at = (off_t)blocks[i] * BLOCK + 100;
+        char c = g_data[at] ^ 0x55;
+        succeeded = pwrite(fd, &c, 1, at) == 1;
+    }
+    close(fd);
+    return succeeded;
+}
+
+// check_same() expects the sync of the source onto itself refused
+static bool check_same(char *what, char *dst) {
+    char out[256];
+    int retval = run_sync(dst, false, out, sizeof(out));
+    if ((retval == 1) && strstr(out, "are the same file")) return true;
+    printf("\t %s: returned %d, printed '%s'.\n", what, retval, out);
+    return false;
+}
+
+// check_refused() expects the sync refused with the message naming path
+static bool check_refused(char *what, char *src, char *dst, char *message,
+    char *path)
+{
+    char expected[256];
+    snprintf(expected, sizeof(expected), "sync: %s '%s'\n", message, path);
+    capture_t c;
+    if (!capture_start(&c)) return false;
+    int retval = sct_sync(src, dst, false);
+    char *out = capture_end(&c);
+    if (!out) return false;
+    bool refused = (retval == 1) && (strcmp(out, expected) == 0);
+    if (!refused)
+        printf("\t %s: returned %d, printed '%s'.\n", what, retval, out);
+    free(out);
+    return refused;
+}
+
+bool perform_test_sct_sync(void) {
+    printf("testing sct_sync...\n");
+    if (!mkdtemp(g_dir)) return false;
+    snprintf(g_src, sizeof(g_src), "%s/src", g_dir);
+    snprintf(g_dst, sizeof(g_dst), "%s/dst", g_dir);
+    snprintf(g_link, sizeof(g_link), "%s/link", g_dir);
+    snprintf(g_out, sizeof(g_out), "%s/out", g_dir);
+    g_data = malloc(SRC_SIZE);
+    bool succeeded = g_data != NULL;
+    for (size_t i = 0; succeeded && (i < SRC_SIZE); i++) {
+        size_t block = i / BLOCK;
+        g_data[i] = (block >= ZERO_FIRST) && (block <= ZERO_LAST) ? 0
+            : (char)((i * 7 + block) % 251 + 1);
+    }
+    succeeded = succeeded && write_all(g_src, g_data, SRC_SIZE, O_TRUNC);
+
+    // a missing destination gets all but the zero blocks, which stay holes
+    int zero_blocks = ZERO_LAST - ZERO_FIRST + 1;
+    struct stat st;
+    succeeded = succeeded
+        && check_sync("missing", false, SRC_BLOCKS - zero_blocks)
+        && (stat(g_dst, &st) == 0);
+    if (succeeded && (st.st_blocks * 512 > (SRC_BLOCKS - zero_blocks) * BLOCK)) {
+        printf("\t missing: %lld bytes allocated.\n",
+            (long long)st.st_blocks * 512);
+        succeeded = false;
+    }
+    // an identical one gets nothing, a differing one its differing blocks:
+    // a run, single ones and the partial last block
+    int blocks[] = { 0, 1, 20, 39, SRC_BLOCKS - 1 };
+    size_t count = sizeof(blocks) / sizeof(blocks[0]);
+    succeeded = succeeded && check_sync("identical", false, 0)
+        && damage(blocks, count) && check_sync("differing", false, count)
+        && check_sync("fsync identical", true, 0)
+        && damage(blocks, count) && check_sync("fsync differing", true, count);
+    // a larger one is cut to the source's size
+    succeeded = succeeded && write_all(g_dst, g_data, BLOCK, O_APPEND)
+        && check_sync("larger", false, 0);
+    // a smaller one gets its missing blocks but the zero ones; the block
+    // cut short differs
+    succeeded = succeeded && (truncate(g_dst, 16 * BLOCK + 5) == 0)
+        && check_sync("smaller", true,
+            SRC_BLOCKS - 16 - zero_blocks);
+    // the source itself is refused, by its name, a link or the directory
+    succeeded = succeeded && (link(g_src, g_link) == 0)
+        && check_same("same name", g_src) && check_same("link", g_link)
+        && check_same("directory", g_dir);
+    // a directory is refused by the name of whichever side it is
+    char sub[80];
+    snprintf(sub, sizeof(sub), "%s/sub", g_dir);
+    char sub_src[96];
+    snprintf(sub_src, sizeof(sub_src), "%s/src", sub);
+    succeeded = succeeded && (mkdir(sub, 0755) == 0)
+        && check_refused("source directory", sub, g_dst,
+            "omitting directory", sub)
+        && (mkdir(sub_src, 0755) == 0)
+        && check_refused("destination directory", g_src, sub,
+            "cannot overwrite directory", sub_src);
+
+    free(g_data);
+    unlink(g_src);
+    unlink(g_dst);
+    unlink(g_link);
+    unlink(g_out);
+    rmdir(sub_src);
+    rmdir(sub);
+    rmdir(g_dir);
+    if (succeeded)
+        printf("All sct_sync succeeded.\n");
+    return succeeded;
+}
+
+static char g_grep_dir[] = "/tmp/test_sct_grep_XXXXXX";
+
+// the files of the LRU case: more results than the cache keeps
+#define LRU_FILES 24
+#define LRU_LINES 30000         // of 50 bytes, about 1.5MB per file
+
+// put_file() writes text to a file of the grep directory, dated an hour
+// back if old, for its results to be trusted
+static bool put_file(char *name, char *text, size_t len, int flags, bool old)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", g_grep_dir, name);
+    if (!write_all(path, text, len, flags)) return false;
+    struct timespec times[2] = { { time(NULL) - 3600, 0 },
+        { time(NULL) - 3600, 0 } };
+    return !old || (utimensat(AT_FDCWD, path, times, 0) == 0);
+}
+
+// patch() overwrites bytes of a file in place, keeping its size and mtime:
+// only a search reading it sees the change
+static bool patch(char *name, off_t offset, char *text) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", g_grep_dir, name);
+    struct stat st;
+    int fd = open(path, O_WRONLY);
+    if ((fd < 0) || (fstat(fd, &st) != 0)) return false;
+    size_t len = strlen(text);
+    bool succeeded = pwrite(fd, text, len, offset) == (ssize_t)len;
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    succeeded = succeeded && (futimens(fd, times) == 0);
+    return (close(fd) == 0) && succeeded;
+}
+
+// check_grep() searches a file, expecting the output and return value;
+// expected NULL checks the output starts with first
+static bool check_grep(char *what, char *pattern, char *name, int expected_rc,
+    char *expected, char *first)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", g_grep_dir, name);
+    char *paths[] = { path };
+    capture_t c;
+    if (!capture_start(&c)) return false;
+    int retval = sct_grep(pattern, paths, 1);
+    char *out = capture_end(&c);
+    if (!out) return false;
+    bool same = expected ? strcmp(out, expected) == 0
+        : strncmp(out, first, strlen(first)) == 0;
+    if ((retval != expected_rc) || !same) {
+        printf("\t %s: returned %d, printed '%.60s'.\n", what, retval, out);
+        same = false;
+    }
+    free(out);
+    return same;
+}
+
+bool perform_test_sct_grep_memo(void) {
+    printf("testing sct_grep results cache...\n");
+    if (!mkdtemp(g_grep_dir)) return false;
+    snprintf(g_out, sizeof(g_out), "%s/out", g_grep_dir);
+    char binary_expected[128];
+    snprintf(binary_expected, sizeof(binary_expected),
+        "grep: %s/b: binary file matches\n", g_grep_dir);
+
+    // an unchanged file is not read again: a change keeping its size and
+    // mtime is not seen; the change is before the last bytes compared
+    // for an append
+    char *text = "one foo\n"
+        "two, a line long enough to keep the first out of the tail\n"
+        "three foo\n";
+    bool succeeded = put_file("a", text, strlen(text), O_TRUNC, true)
+        && check_grep("first", "foo", "a", 0, "one foo\nthree foo\n", NULL)
+        && patch("a", 0, "ONE")
+        && check_grep("unchanged", "foo", "a", 0, "one foo\nthree foo\n",
+            NULL);
+    // an appended one is read from its last line searched on
+    succeeded = succeeded && put_file("a", "four foo\n", 9, O_APPEND, true)
+        && check_grep("appended", "foo", "a", 0,
+            "one foo\nthree foo\nfour foo\n", NULL);
+    // a rewritten one, its old last bytes gone, is read again
+    text = "foo rewritten\nand longer than before, foo\n";
+    succeeded = succeeded && put_file("a", text, strlen(text), O_TRUNC, true)
+        && check_grep("rewritten", "foo", "a", 0, text, NULL);
+    // the match of an unterminated last line is not resumed from, nor is
+    // its NUL byte
+    succeeded = succeeded && put_file("u", "x\nfoo", 5, O_TRUNC, true)
+        && check_grep("unterminated", "^foo$", "u", 0, "foo\n", NULL)
+        && put_file("u", "bar\n", 4, O_APPEND, true)
+        && check_grep("terminated", "^foo$", "u", 1, "", NULL)
+        && put_file("b", "abc\n\0foo", 8, O_TRUNC, true)
+        && check_grep("binary", "foo", "b", 0, binary_expected, NULL)
+        && put_file("b", "x\nabc\n", 6, O_APPEND, true)
+        && check_grep("binary appended", "abc", "b", 0, binary_expected,
+            NULL);
+    // a file changed within the second of a search is read again, even if
+    // its size and mtime are the same
+    succeeded = succeeded && put_file("r", "a foo\n", 6, O_TRUNC, false)
+        && check_grep("racy", "foo", "r", 0, "a foo\n", NULL)
+        && patch("r", 0, "b")
+        && check_grep("racy again", "foo", "r", 0, "b foo\n", NULL);
+
+    // the least recently searched results go first
+    char line[51];
+    snprintf(line, sizeof(line), "%-49s\n", "Xfoo");
+    size_t size = LRU_LINES * 50;
+    char *lines = malloc(size);
+    for (size_t i = 0; lines && (i < LRU_LINES); i++)
+        memcpy(lines + i * 50, line, 50);
+    succeeded = succeeded && lines;
+    char names[LRU_FILES][8];
+    for (int i = 0; succeeded && (i < LRU_FILES); i++) {
+        snprintf(names[i], sizeof(names[i]), "l%d", i);
+        succeeded = put_file(names[i], lines, size, O_TRUNC, true)
+            && check_grep("lru", "foo", names[i], 0, NULL, "Xfoo");
+    }
+    free(lines);
+    succeeded = succeeded && patch(names[0], 0, "Y")
+        && patch(names[LRU_FILES - 1], 0, "Y")
+        && check_grep("evicted", "foo", names[0], 0, NULL, "Yfoo")
+        && check_grep("kept", "foo", names[LRU_FILES - 1], 0, NULL, "Xfoo");
+
+    sct_grep_finalize();
+    char *removed[] = { "a", "u", "b", "r", "out" };
+    char path[128];
+    for (size_t i = 0; i < sizeof(removed) / sizeof(removed[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", g_grep_dir, removed[i]);
+        unlink(path);
+    }
+    for (int i = 0; i < LRU_FILES; i++) {
+        snprintf(path, sizeof(path), "%s/l%d", g_grep_dir, i);
+        unlink(path);
+    }
+    rmdir(g_grep_dir);
+    if (succeeded)
+        printf("All sct_grep results cache succeeded.\n");
+    return succeeded;
+}
+
+static char g_follow_dir[] = "/tmp/test_sct_follow_XXXXXX";
+
+// append() adds text to a file of the follow directory
+static bool append(char *name, char *text, int flags) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", g_follow_dir, name);
+    return write_all(path, text, strlen(text), O_APPEND | flags);
+}
+
+// check_step() takes the changes to the files, expecting the lines
+// printed, and note among follow's messages if not NULL
+static bool check_step(char *what, sct_follow_t *f, char *expected,
+    char *note)
+{
+    capture_t c;
+    if (!capture_start(&c)) return false;
+    bool following = sct_follow_step(f, 0);
+    char *out = capture_end(&c);
+    if (!out) return false;
+    // the messages go to stderr, unordered with the lines
+    bool noted = !note;
+    char *lines = calloc(1, strlen(out) + 1);
+    for (char *line = out, *eol; lines && *line; line = eol) {
+        eol = strchr(line, '\n');
+        eol = eol ? eol + 1 : line + strlen(line);
+        if (strncmp(line, "follow: ", 8) != 0)
+            strncat(lines, line, eol - line);
+        else if (note && strstr(line, note) && (strstr(line, note) < eol))
+            noted = true;
+    }
+    bool same = following && lines && noted && (strcmp(lines, expected) == 0);
+    if (!same)
+        printf("\t %s: printed '%.80s'.\n", what, out);
+    free(lines);
+    free(out);
+    return same;
+}
+
+bool perform_test_sct_follow(void) {
+    printf("testing sct_follow...\n");
+    if (!mkdtemp(g_follow_dir)) return false;
+    snprintf(g_out, sizeof(g_out), "%s/out", g_follow_dir);
+    char path[128];
+    snprintf(path, sizeof(path), "%s/log", g_follow_dir);
+    char rotated[128];
+    snprintf(rotated, sizeof(rotated), "%s/log.1", g_follow_dir);
+    char *paths[] = { path };
+
+    // the file is followed from its last line, unterminated or not
+    bool succeeded = append("log", "old foo\npartial", O_CREAT);
+    sct_follow_t *f = succeeded ? sct_follow_start("foo", paths, 1) : NULL;
+    succeeded = f
+        && check_step("unchanged", f, "", NULL)
+        && append("log", " foo\nbar\nnew foo\n", 0)
+        && check_step("appended", f, "partial foo\nnew foo\n", NULL);
+    // a truncated one is read again from its start
+    succeeded = succeeded && append("log", "again foo\n", O_TRUNC)
+        && check_step("truncated", f, "again foo\n", "file truncated");
+    // a rotated one is read through, its last line ending with it, and
+    // the new one is followed from its start; the old one is not
+    succeeded = succeeded && append("log", "last foo", 0)
+        && (rename(path, rotated) == 0)
+        && append("log", "first foo\n", O_CREAT | O_EXCL)
+        && check_step("rotated", f, "last foo\nfirst foo\n",
+            "file replaced")
+        && append("log.1", "stale foo\n", 0)
+        && append("log", "more foo\nmore bar\n", 0)
+        && check_step("after rotation", f, "more foo\n", NULL);
+    if (f && (sct_follow_end(f) != 0)) succeeded = false;
+
+    unlink(path);
+    unlink(rotated);
+    unlink(g_out);
+    rmdir(g_follow_dir);
+    if (succeeded)
+        printf("All sct_follow succeeded.\n");
+    return succeeded;
+}
+
+static char g_dupes_dir[] = "/tmp/test_sct_dupes_XXXXXX";
+
+// the dupes tree: files of DUPES_SIZE bytes, larger than the edges hashed,
+// some differing from the others by a byte at an offset
+#define DUPES_SIZE 20000
+
+typedef struct dupe_fixture_ {
+    char *name;
+    char *link;         // a hard link to it, if not NULL
+    size_t size;
+    off_t changed;      // the byte differing, -1 for none
+} dupe_fixture_t;
+
+static dupe_fixture_t g_dupes[] = {
+    { "a/one", "a/one_link", DUPES_SIZE, -1 },
+    { "b/one_copy", NULL, DUPES_SIZE, -1 },
+    { "b/linked", "b/linked_too", DUPES_SIZE, 0 },
+    { "head", NULL, DUPES_SIZE + 1, -1 },
+    { "head_changed", NULL, DUPES_SIZE + 1, 10 },
+    { "tail", NULL, DUPES_SIZE + 2, -1 },
+    { "tail_changed", NULL, DUPES_SIZE + 2, DUPES_SIZE + 1 },
+    { "middle", NULL, DUPES_SIZE + 3, -1 },
+    { "middle_changed", NULL, DUPES_SIZE + 3, DUPES_SIZE / 2 },
+    { "a/small", NULL, 6, -1 },
+    { "small_copy", NULL, 6, -1 },
+    { "empty", NULL, 0, -1 },
+    { "empty_too", NULL, 0, -1 },
+};
+#define DUPES_COUNT (sizeof(g_dupes) / sizeof(g_dupes[0]))
+
+// check_dupes() expects the groups of files in dir, by their names
+static bool check_dupes(char *what, char *dir, int expected_rc,
+    char **groups, size_t count)
+{
+    char expected[512] = "";
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strlen(expected);
+        if (groups[i]) snprintf(expected + len, sizeof(expected) - len,
+            "%s/%s\n", g_dupes_dir, groups[i]);
+        else snprintf(expected + len, sizeof(expected) - len, "\n");
+    }
+    capture_t c;
+    if (!capture_start(&c)) return false;
+    int retval = sct_dupes(dir);
+    char *out = capture_end(&c);
+    if (!out) return false;
+    // the errors go to stderr: only the groups are compared
+    char *errors = strstr(out, "dupes: ");
+    if (errors) *errors = 0;
+    bool same = (retval == expected_rc) && (strcmp(out, expected) == 0);
+    if (!same)
+        printf("\t %s: returned %d, printed '%.200s'.\n", what, retval, out);
+    free(out);
+    return same;
+}
+
+bool perform_test_sct_dupes(void) {
+    printf("testing sct_dupes...\n");
+    if (!mkdtemp(g_dupes_dir)) return false;
+    snprintf(g_out, sizeof(g_out), "%s.out", g_dupes_dir);
+    char path[128];
+    char link_path[128];
+    char *dirs[] = { "a", "b" };
+    bool succeeded = true;
+    for (size_t i = 0; succeeded && (i < 2); i++) {
+        snprintf(path, sizeof(path), "%s/%s", g_dupes_dir, dirs[i]);
+        succeeded = mkdir(path, 0755) == 0;
+    }
+    char *data = malloc(DUPES_SIZE + 3);
+    for (size_t i = 0; data && (i < DUPES_SIZE + 3); i++)
+        data[i] = (char)(i * 13 % 251);
+    succeeded = succeeded && data;
+    for (size_t i = 0; succeeded && (i < DUPES_COUNT); i++) {
+        dupe_fixture_t *d = &g_dupes[i];
+        snprintf(path, sizeof(path), "%s/%s", g_dupes_dir, d->name);
+        if (d->changed >= 0) data[d->changed] ^= 0x55;
+        succeeded = write_all(path, data, d->size, O_TRUNC);
+        if (d->changed >= 0) data[d->changed] ^= 0x55;
+        if (!succeeded || !d->link) continue;
+        snprintf(link_path, sizeof(link_path), "%s/%s", g_dupes_dir, d->link);
+        succeeded = link(path, link_path) == 0;
+    }
+    free(data);
+
+    // links to one inode are one file, reported by its first path; files
+    // differing in their edges or middle are not alike, nor are empty ones
+    char *groups[] = { "a/one", "b/one_copy", NULL, "a/small", "small_copy",
+        NULL };
+    succeeded = succeeded && check_dupes("tree", g_dupes_dir, 0, groups,
+        sizeof(groups) / sizeof(groups[0]));
+    // a directory which cannot be read fails it
+    snprintf(path, sizeof(path), "%s/missing", g_dupes_dir);
+    succeeded = succeeded && check_dupes("missing", path, 1, NULL, 0);
+
+    for (size_t i = 0; i < DUPES_COUNT; i++) {
+        snprintf(path, sizeof(path), "%s/%s", g_dupes_dir, g_dupes[i].name);
+        unlink(path);
+        if (!g_dupes[i].link) continue;
+        snprintf(path, sizeof(path), "%s/%s", g_dupes_dir, g_dupes[i].link);
+        unlink(path);
+    }
+    for (size_t i = 0; i < 2; i++) {
+        snprintf(path, sizeof(path), "%s/%s", g_dupes_dir, dirs[i]);
+        rmdir(path);
+    }
+    rmdir(g_dupes_dir);
+    unlink(g_out);
+    if (succeeded)
+        printf("All sct_dupes succeeded.\n");
+    return succeeded;
+}
@@ -0,0 +1,177 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "test_sct_glob.h"
+#include "sct_glob.h"
+#include "sct_utils.h"
+
+bool perform_test_sct_glob_match(void) {
+    printf("testing sct_glob_match()...\n");
+    bool succeeded = true;
+
+    struct { char *pattern; char *name; bool expected; } cases[] = {
+        { "*", "a.txt", true },
+        { "*.txt", "a.txt", true },
+        { "*.txt", "a.txt.bak", false },
+        { "a*b*c", "axxbyyc", true },
+        { "a*b*c", "axxbyy", false },
+        { "?.c", "x.c", true },
+        { "?.c", "xy.c", false },
+        { "[ab]*", "beta", true },
+        { "[!ab]*", "beta", false },
+        { "[^ab]*", "gamma", true },
+        { "file[0-9]", "file7", true },
+        { "file[0-9]", "filex", false },
+        { "[]]", "]", true },
+        { "[a", "[a", true },
+        { "*", ".hidden", false },
+        { ".*", ".hidden", true },
+        { "", "", true },
+        { "**", "abc", true },
+    };
+    for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (sct_glob_match(cases[i].pattern, cases[i].name)
+            != cases[i].expected)
+        {
+            printf("\t sct_glob_match(\"%s\", \"%s\") FAILED.\n",
+                cases[i].pattern, cases[i].name);
+            succeeded = false;
+        }
+    }
+
+    if (succeeded)
+        printf("All sct_glob_match succeeded.\n");
+    return succeeded;
+}
+
+static char g_dir[] = "/tmp/test_sct_glob_XXXXXX";
+static char *g_files[] = { "a.txt", "b.log", "d1/c.txt", "d1/d2/e.txt",
+    "d1/.f.txt", ".g/h.txt" };
+static char *g_dirs[] = { "d1", "d1/d2", ".g" };
+
+static bool create_tree(void) {
+    if (!mkdtemp(g_dir)) return false;
+    bool result = true;
+    for (int i = 0; i < sizeof(g_dirs) / sizeof(g_dirs[0]); i++) {
+        char *fn = scu_sprintf("%s/%s", g_dir, g_dirs[i]);
+        result = result && (mkdir(fn, 0755) == 0);
+        free(fn);
+    }
+    for (int i = 0; i < sizeof(g_files) / sizeof(g_files[0]); i++) {
+        char *fn = scu_sprintf("%s/%s", g_dir, g_files[i]);
+        int fd = open(fn, O_CREAT | O_WRONLY, 0644);
+        if (fd >= 0) close(fd);
+        result = result && (fd >= 0);
+        free(fn);
+    }
+    return result;
+}
+
+static void remove_tree(void) {
+    for (int i = 0; i < sizeof(g_files) / sizeof(g_files[0]); i++) {
+        char *fn = scu_sprintf("%s/%s", g_dir, g_files[i]);
+        unlink(fn);
+        free(fn);
+    }
+    for (int i = sizeof(g_dirs) / sizeof(g_dirs[0]) - 1; i >= 0; i--) {
+        char *fn = scu_sprintf("%s/%s", g_dir, g_dirs[i]);
+        rmdir(fn);
+        free(fn);
+    }
+    rmdir(g_dir);
+}
+
+// expansion of pattern, relative to the tree, joined with spaces
+static char *expand(char *pattern, int kinds) {
+    char **paths;
+    size_t count;
+    if (!sct_glob(pattern, kinds, &paths, &count)) return NULL;
+    char *result = calloc(1, 1);
+    for (size_t i = 0; i < count; i++) {
+        char *s = scu_sprintf("%s%s%s", result, i ? " " : "", paths[i]);
+        free(result);
+        result = s;
+    }
+    sct_glob_free(paths, count);
+    return result;
+}
+
+bool perform_test_sct_glob(void) {
+    printf("testing sct_glob()...\n");
+    char *cwd = getcwd(NULL, 0);
+    if (!cwd || !create_tree() || (chdir(g_dir) == -1)) {
+        printf("\t sct_glob() fixture FAILED.\n");
+        free(cwd);
+        return false;
+    }
+    bool succeeded = true;
+
+    int all = SCT_GLOB_FILES | SCT_GLOB_DIRS;
+    struct { char *pattern; int kinds; char *expected; } cases[] = {
+        { "*.txt", SCT_GLOB_FILES, "a.txt" },
+        { "*", SCT_GLOB_FILES, "a.txt b.log" },
+        { "*", SCT_GLOB_DIRS, "d1" },
+        { "*/", all, "d1" },
+        { "**/*.txt", SCT_GLOB_FILES, "a.txt d1/c.txt d1/d2/e.txt" },
+        { "**", all, "a.txt b.log d1 d1/c.txt d1/d2 d1/d2/e.txt" },
+        { "d1/**/e.txt", SCT_GLOB_FILES, "d1/d2/e.txt" },
+        { "**/**/c.txt", SCT_GLOB_FILES, "d1/c.txt" },
+        { "d?/*", all, "d1/c.txt d1/d2" },
+        { "d1/.*", SCT_GLOB_FILES, "d1/.f.txt" },
+        { "*.none", all, "" },
+    };
+    for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char *got = expand(cases[i].pattern, cases[i].kinds);
+        if (!got || (strcmp(got, cases[i].expected) != 0)) {
+            printf("\t sct_glob(\"%s\") FAILED: \"%s\", expected \"%s\"\n",
+                cases[i].pattern, got ? got : "(error)",
+                cases[i].expected);
+            succeeded = false;
+        }
+        free(got);
+    }
+
+    // absolute patterns keep their root
+    char *pattern = scu_sprintf("%s/d1/*.txt", g_dir);
+    char *expected = scu_sprintf("%s/d1/c.txt", g_dir);
+    char *got = expand(pattern, SCT_GLOB_FILES);
+    if (!got || (strcmp(got, expected) != 0)) {
+        printf("\t sct_glob(\"%s\") FAILED.\n", pattern);
+        succeeded = false;
+    }
+    free(got);
+    free(expected);
+    free(pattern);
+
+    if (chdir(cwd) == -1) succeeded = false;
+    free(cwd);
+    remove_tree();
+    if (succeeded)
+        printf("All sct_glob succeeded.\n");
+    return succeeded;
+}
@@ -0,0 +1,161 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "test_sct_history.h"
+#include "sct_history.h"
+
+static char g_dir[] = "/tmp/test_sct_history_XXXXXX";
+static char g_fn[64];
+static char g_idx_fn[64];
+static char g_tri_fn[64];
+
+static bool write_text(char *text, char *mode) {
+    FILE *f = fopen(g_fn, mode);
+    if (!f) return false;
+    fputs(text, f);
+    return fclose(f) == 0;
+}
+
+static bool check_text(char *expected) {
+    char buf[256];
+    FILE *f = fopen(g_fn, "r");
+    size_t len = f ? fread(buf, 1, sizeof(buf) - 1, f) : 0;
+    if (f) fclose(f);
+    buf[len] = 0;
+    bool ok = strcmp(buf, expected) == 0;
+    if (!ok) printf("\t history file \"%s\" FAILED.\n", buf);
+    return ok;
+}
+
+// check_entries() checks the entries, oldest first, NULL ended
+static bool check_entries(char **expected) {
+    int64_t count = 0;
+    while (expected[count]) count++;
+    bool ok = sct_history_count() == count;
+    if (!ok) printf("\t %lld entries instead of %lld FAILED.\n",
+        (long long)sct_history_count(), (long long)count);
+    for (int64_t i = 0; ok && (i < count); i++) {
+        char buf[64];
+        ok = sct_history_entry(i, buf, sizeof(buf))
+            && (strcmp(buf, expected[i]) == 0);
+        if (!ok) printf("\t entry %lld \"%s\" FAILED.\n", (long long)i,
+            expected[i]);
+    }
+    return ok;
+}
+
+static bool check_search(char *q, int64_t before, int64_t expected) {
+    int64_t found = sct_history_search(q, before);
+    if (found != expected) printf("\t search \"%s\" before %lld: %lld "
+        "FAILED.\n", q, (long long)before, (long long)found);
+    return found == expected;
+}
+
+static int64_t mtime_ns(char *fn) {
+    struct stat st;
+    if (stat(fn, &st) != 0) return -1;
+    return (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+// reopen() opens the history again, telling whether its indexes were
+// rebuilt: the rebuild truncates fn.idx
+static bool reopen(bool *rebuilt) {
+    sct_history_close();
+    int64_t before = mtime_ns(g_idx_fn);
+    // a rebuild within the same clock tick would go unnoticed
+    usleep(10000);
+    bool ok = sct_history_open(g_fn);
+    *rebuilt = mtime_ns(g_idx_fn) != before;
+    if (!ok) printf("\t sct_history_open() FAILED.\n");
+    return ok;
+}
+
+bool perform_test_sct_history(void) {
+    printf("testing sct_history...\n");
+    if (!mkdtemp(g_dir)) return false;
+    snprintf(g_fn, sizeof(g_fn), "%s/history", g_dir);
+    snprintf(g_idx_fn, sizeof(g_idx_fn), "%s.idx", g_fn);
+    snprintf(g_tri_fn, sizeof(g_tri_fn), "%s.tri", g_fn);
+    bool rebuilt;
+
+    // add: a repeated line is kept once, empty ones not at all
+    bool succeeded = sct_history_open(g_fn)
+        && sct_history_add("ls /tmp")
+        && sct_history_add("grep foo bar")
+        && sct_history_add("grep foo bar")
+        && sct_history_add("")
+        && sct_history_add("cd /tmp")
+        && check_entries((char *[]){ "ls /tmp", "grep foo bar", "cd /tmp",
+            NULL })
+        && check_search("foo", 3, 1)
+        && check_search("tmp", 3, 2)
+        && check_search("tmp", 2, 0)
+        && check_search("cd", 3, 2)
+        && check_search("zzz", 3, -1)
+        && check_text("ls /tmp\ngrep foo bar\ncd /tmp\n");
+    // reopen: the indexes are used as they are
+    succeeded = succeeded && reopen(&rebuilt) && !rebuilt
+        && check_entries((char *[]){ "ls /tmp", "grep foo bar", "cd /tmp",
+            NULL })
+        && check_search("foo", 3, 1);
+    // rebuild: fn changed by hand
+    succeeded = succeeded && write_text("alpha one\nbeta two\n", "w")
+        && reopen(&rebuilt) && rebuilt
+        && check_entries((char *[]){ "alpha one", "beta two", NULL })
+        && check_search("two", 2, 1)
+        && check_search("foo", 2, -1);
+    // a truncated last line is ended, once
+    succeeded = succeeded && write_text("gamma thr", "a")
+        && reopen(&rebuilt) && rebuilt
+        && check_entries((char *[]){ "alpha one", "beta two", "gamma thr",
+            NULL })
+        && check_text("alpha one\nbeta two\ngamma thr\n")
+        && reopen(&rebuilt) && !rebuilt
+        && sct_history_add("delta")
+        && check_entries((char *[]){ "alpha one", "beta two", "gamma thr",
+            "delta", NULL })
+        && check_search("thr", 4, 2)
+        && check_text("alpha one\nbeta two\ngamma thr\ndelta\n");
+    // what an append left uncommitted is dropped by the next one
+    succeeded = succeeded && write_text("a longer uncommitted line\n", "a")
+        && sct_history_add("eps")
+        && check_text("alpha one\nbeta two\ngamma thr\ndelta\neps\n")
+        && reopen(&rebuilt) && !rebuilt
+        && check_entries((char *[]){ "alpha one", "beta two", "gamma thr",
+            "delta", "eps", NULL });
+    sct_history_close();
+
+    unlink(g_fn);
+    unlink(g_idx_fn);
+    unlink(g_tri_fn);
+    rmdir(g_dir);
+    if (succeeded)
+        printf("All sct_history succeeded.\n");
+    return succeeded;
+}
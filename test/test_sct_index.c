@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "test_sct_index.h"
+#include "sct_index.h"
+#include "sct_regex.h"
+
+static char g_dir[] = "/tmp/test_sct_index_XXXXXX";
+
+// the files, the index and a missing one
+static char *g_names[] = { "a.txt", "sub/b.txt", "sub/c.txt", ".hidden",
+    "missing" };
+static char *g_texts[] = { "hello world\n", "zebra stripes\n",
+    "nothing here\n", "zebra\n", NULL };
+#define FILE_COUNT (sizeof(g_names) / sizeof(g_names[0]))
+
+static char g_paths[FILE_COUNT][64];
+
+// files are written an hour back, or an index built now would not trust them
+static bool write_file(char *path, char *text) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    fputs(text, f);
+    fclose(f);
+    struct timespec times[2] = { { time(NULL) - 3600, 0 },
+        { time(NULL) - 3600, 0 } };
+    return utimensat(AT_FDCWD, path, times, 0) == 0;
+}
+
+// check_filter() compares the files kept for a pattern with expected,
+// a string of '1' and '0' per file
+static bool check_filter(char *pattern, char *expected) {
+    char msg[128];
+    sct_regex_t *re = sct_regex_get(pattern, msg, sizeof(msg));
+    if (!re) return false;
+    char *paths[FILE_COUNT];
+    struct stat st[FILE_COUNT];
+    int errors[FILE_COUNT];
+    bool keep[FILE_COUNT];
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        paths[i] = g_paths[i];
+        errors[i] = stat(paths[i], &st[i]) == 0 ? 0 : errno;
+    }
+    sct_index_filter(re, paths, st, errors, FILE_COUNT, keep);
+    sct_regex_put(re);
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        if (keep[i] == (expected[i] == '1')) continue;
+        printf("\t '%s': %s %s.\n", pattern, g_names[i],
+            keep[i] ? "kept" : "dropped");
+        return false;
+    }
+    return true;
+}
+
+// damage_index() points every posting of the index at a file it lacks
+static bool damage_index(char *index) {
+    int fd = open(index, O_RDWR);
+    if (fd < 0) return false;
+    uint64_t counts[3];
+    bool succeeded = pread(fd, counts, sizeof(counts), 16) == sizeof(counts);
+    off_t postings = 48 + counts[0] * 24 + counts[1] * 16;
+    uint32_t bad = 0xffffffff;
+    for (uint64_t i = 0; succeeded && (i < counts[2]); i++)
+        succeeded = pwrite(fd, &bad, sizeof(bad), postings + i * 4) == 4;
+    close(fd);
+    return succeeded && counts[2];
+}
+
+bool perform_test_sct_index(void) {
+    printf("testing sct_index...\n");
+    if (!mkdtemp(g_dir)) return false;
+    char sub[64];
+    snprintf(sub, sizeof(sub), "%s/sub", g_dir);
+    bool succeeded = mkdir(sub, 0755) == 0;
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        snprintf(g_paths[i], sizeof(g_paths[i]), "%s/%s", g_dir, g_names[i]);
+        if (succeeded && g_texts[i])
+            succeeded = write_file(g_paths[i], g_texts[i]);
+    }
+
+    // no index: all kept
+    succeeded = succeeded && check_filter("zebra", "11111")
+        && (sct_index_build(g_dir) == 0)
+        // hidden files are not indexed, missing ones are left to grep
+        && check_filter("zebra", "01011")
+        && check_filter("hello\\|stripes", "11011")
+        // strings too short for a trigram narrow nothing
+        && check_filter("w.r", "11111")
+        && check_filter("nothing", "00111")
+        && check_filter("absent", "00011");
+    // a changed file is searched until indexed again
+    succeeded = succeeded && write_file(g_paths[2], "a zebra is here\n")
+        && check_filter("zebra", "01111")
+        && (sct_index_build(g_dir) == 0)
+        && check_filter("zebra", "01111")
+        && check_filter("nothing", "00011");
+    // a file changed within the second of a build is not trusted
+    succeeded = succeeded && (sct_index_build(g_dir) == 0);
+    FILE *f = succeeded ? fopen(g_paths[0], "w") : NULL;
+    if (f) {
+        fputs("hello there\n", f);
+        fclose(f);
+    }
+    succeeded = succeeded && f && (sct_index_build(g_dir) == 0)
+        && check_filter("absent", "10011");
+    // a damaged index is not reused, all files are read again
+    char index[64];
+    snprintf(index, sizeof(index), "%s/%s", g_dir, SCT_INDEX_NAME);
+    succeeded = succeeded && write_file(g_paths[0], "hello world\n")
+        && (sct_index_build(g_dir) == 0) && damage_index(index)
+        && (sct_index_build(g_dir) == 0)
+        && check_filter("zebra", "01111")
+        && check_filter("hello", "10011");
+
+    for (size_t i = 0; i < FILE_COUNT; i++) unlink(g_paths[i]);
+    unlink(index);
+    rmdir(sub);
+    rmdir(g_dir);
+    if (succeeded)
+        printf("All sct_index succeeded.\n");
+    return succeeded;
+}
@@ -0,0 +1,184 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "test_sct_io.h"
+#include "sct_io.h"
+#include "sct_utils.h"
+
+// sizes around the I/O buffer size and a few buffers long
+static size_t g_sizes[] = { 0, 1, 4095, 131071, 131072, 131073, 1000000 };
+#define SIZE_COUNT (sizeof(g_sizes) / sizeof(g_sizes[0]))
+
+static char g_dir[] = "/tmp/test_sct_io_XXXXXX";
+
+static char pattern_byte(size_t i, size_t file) {
+    return (char)((i * 31 + file * 7) % 251);
+}
+
+static bool write_file(char *fn, size_t size, size_t file) {
+    int fd = open(fn, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    char *data = malloc(size + 1);
+    for (size_t i = 0; data && (i < size); i++) data[i] = pattern_byte(i, file);
+    bool result = data && (write(fd, data, size) == (ssize_t)size);
+    free(data);
+    close(fd);
+    return result;
+}
+
+// read_and_check() reads all files plus a missing one and a directory,
+// from starts[] if given
+static bool read_and_check(char **paths, off_t *starts, size_t count) {
+    sct_io_reader_t *reader = starts
+        ? sct_io_read_files_at(paths, starts, count)
+        : sct_io_read_files(paths, count);
+    if (!reader) return false;
+    bool succeeded = true;
+    size_t expected_index = 0;
+    size_t pos = starts ? starts[0] : 0;
+    sct_io_chunk_t chunk;
+    while (sct_io_next_chunk(reader, &chunk)) {
+        if ((chunk.index != expected_index) || (chunk.offset != pos)) {
+            printf("\t chunk of file %zu at %lld out of order.\n",
+                chunk.index, (long long)chunk.offset);
+            succeeded = false;
+            break;
+        }
+        if (chunk.index < SIZE_COUNT) {
+            for (size_t i = 0; i < chunk.len; i++) {
+                if (chunk.data[i] != pattern_byte(pos + i, chunk.index)) {
+                    printf("\t file %zu differs at %zu.\n", chunk.index,
+                        pos + i);
+                    succeeded = false;
+                    break;
+                }
+            }
+            if (chunk.error) succeeded = false;
+        }
+        else if (!chunk.error || !chunk.last) succeeded = false;
+        pos += chunk.len;
+        if (chunk.last) {
+            if ((chunk.index < SIZE_COUNT) && (pos != g_sizes[chunk.index])) {
+                printf("\t file %zu: %zu bytes read, %zu expected.\n",
+                    chunk.index, pos, g_sizes[chunk.index]);
+                succeeded = false;
+            }
+            expected_index++;
+            pos = starts && (expected_index < count) ? starts[expected_index]
+                : 0;
+        }
+    }
+    sct_io_reader_close(reader);
+    if (expected_index != count) {
+        printf("\t %zu files of %zu read.\n", expected_index, count);
+        succeeded = false;
+    }
+    return succeeded;
+}
+
+static bool files_equal(char *a, char *b) {
+    char *cmd = scu_sprintf("cmp -s '%s' '%s'", a, b);
+    bool result = cmd && (system(cmd) == 0);
+    free(cmd);
+    return result;
+}
+
+static bool check_backend(char *name, char **paths, size_t count) {
+    bool succeeded = read_and_check(paths, NULL, count);
+
+    // the same, from the middle of the files
+    off_t starts[SIZE_COUNT + 2] = { 0 };
+    for (size_t i = 0; i < SIZE_COUNT; i++) starts[i] = g_sizes[i] / 2;
+    if (succeeded) succeeded = read_and_check(paths, starts, count);
+
+    // a batch stat of the same files
+    struct stat st[SIZE_COUNT + 2];
+    int errors[SIZE_COUNT + 2];
+    sct_io_stat_batch(AT_FDCWD, paths, count, false, st, errors);
+    for (size_t i = 0; i < SIZE_COUNT; i++) {
+        if (errors[i] || (st[i].st_size != (off_t)g_sizes[i])) {
+            printf("\t sct_io_stat_batch() of %s FAILED.\n", paths[i]);
+            succeeded = false;
+        }
+    }
+    if (errors[SIZE_COUNT] != ENOENT) succeeded = false;
+
+    // copies, and a copy onto itself
+    char *dst = scu_sprintf("%s/copy", g_dir);
+    for (size_t i = 0; i < SIZE_COUNT; i++) {
+        if ((sct_io_copy_file(paths[i], dst) != 0)
+            || !files_equal(paths[i], dst))
+        {
+            printf("\t sct_io_copy_file() of %s FAILED.\n", paths[i]);
+            succeeded = false;
+        }
+    }
+    if (sct_io_copy_file(dst, dst) != EEXIST) {
+        printf("\t sct_io_copy_file() onto itself FAILED.\n");
+        succeeded = false;
+    }
+    unlink(dst);
+    free(dst);
+
+    if (!succeeded) printf("\t backend %s FAILED.\n", name);
+    return succeeded;
+}
+
+bool perform_test_sct_io(void) {
+    printf("testing sct_io...\n");
+    if (!mkdtemp(g_dir)) return false;
+    char *paths[SIZE_COUNT + 2];
+    bool succeeded = true;
+    for (size_t i = 0; i < SIZE_COUNT; i++) {
+        paths[i] = scu_sprintf("%s/f%zu", g_dir, i);
+        succeeded = succeeded && write_file(paths[i], g_sizes[i], i);
+    }
+    paths[SIZE_COUNT] = scu_sprintf("%s/missing", g_dir);
+    paths[SIZE_COUNT + 1] = scu_sprintf("%s", g_dir);
+    size_t count = SIZE_COUNT + 2;
+
+    if (succeeded) succeeded = sct_io_initialize(SCT_IO_SYSCALLS)
+        && check_backend("syscalls", paths, count);
+    // io_uring may be unavailable, e.g. in a container
+    if (succeeded && sct_io_initialize(SCT_IO_URING))
+        succeeded = check_backend(sct_io_backend_name(), paths, count);
+    else printf("\t io_uring is not available, skipped.\n");
+    sct_io_finalize();
+
+    for (size_t i = 0; i < SIZE_COUNT; i++) {
+        unlink(paths[i]);
+        free(paths[i]);
+    }
+    free(paths[SIZE_COUNT]);
+    free(paths[SIZE_COUNT + 1]);
+    rmdir(g_dir);
+    if (succeeded)
+        printf("All sct_io succeeded.\n");
+    return succeeded;
+}
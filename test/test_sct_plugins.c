@@ -0,0 +1,153 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include "test_sct_plugins.h"
+#include "sct_plugins.h"
+#include "sct_core_internal.h"
+#include "sct_utils.h"
+
+#define EXAMPLE_LIB "libsct_example_dl_plugin.so"
+
+static char g_dir[] = "/tmp/test_sct_plugins_XXXXXX";
+
+// the good manifest's library is the example plugin built next to the test
+static char *g_good =
+    "# comment lines and blank ones are skipped\n"
+    "\n"
+    "library %s\n"
+    "init hello_plugin_init   # a trailing comment\n"
+    "command t_hello hello_exec text?\n"
+    "command t_two hello_exec file dir?\n";
+// a relative library is the manifest directory's one
+static char *g_bad =
+    "command t_early hello_exec\n"
+    "library missing.so\n"
+    "command t_kind hello_exec color\n"
+    "command t_many hello_exec text text text\n"
+    "command t_order hello_exec text? text\n"
+    "command t_missing hello_exec\n";
+static char *g_names[] = { "good.manifest", "bad.manifest", "other.txt" };
+#define NAME_COUNT (sizeof(g_names) / sizeof(g_names[0]))
+
+static bool write_manifest(char *name, char *format, char *lib) {
+    char *fn = scu_sprintf("%s/%s", g_dir, name);
+    FILE *f = fn ? fopen(fn, "w") : NULL;
+    free(fn);
+    if (!f) return false;
+    fprintf(f, format, lib);
+    return fclose(f) == 0;
+}
+
+// check_args() compares the arguments a command was registered with
+static bool check_args(char *name, int argc, sct_arg_kind_t kind0,
+    bool optional0, sct_arg_kind_t kind1, bool optional1)
+{
+    sct_command_t *cmd = get_command_by_name(name);
+    bool succeeded = cmd && (cmd->argc == argc) && !cmd->exec_fn
+        && cmd->resolve_fn;
+    if (succeeded && (argc > 0))
+        succeeded = (cmd->args[0].kind == kind0)
+            && (cmd->args[0].optional == optional0)
+            && !cmd->args[0].variadic;
+    if (succeeded && (argc > 1))
+        succeeded = (cmd->args[1].kind == kind1)
+            && (cmd->args[1].optional == optional1)
+            && !cmd->args[1].variadic;
+    if (!succeeded) printf("\t command '%s' registered wrong.\n", name);
+    return succeeded;
+}
+
+// loaded() tells whether the library is mapped, without loading it
+static bool loaded(char *lib) {
+    void *handle = dlopen(lib, RTLD_NOW | RTLD_NOLOAD);
+    if (handle) dlclose(handle);
+    return handle != NULL;
+}
+
+bool perform_test_sct_plugins(void) {
+    printf("testing sct_plugins...\n");
+    // the default directory is the executable's, where the example is built
+    char *dir = sct_default_plugin_dir();
+    char *lib = dir ? scu_sprintf("%s/%s", dir, EXAMPLE_LIB) : NULL;
+    bool succeeded = lib && (*dir == '/') && (access(lib, R_OK) == 0);
+    if (!succeeded) printf("\t no example plugin in '%s'.\n", dir);
+    free(dir);
+    succeeded = succeeded && mkdtemp(g_dir) && sct_initialize()
+        && write_manifest(g_names[0], g_good, lib)
+        && write_manifest(g_names[1], g_bad, NULL)
+        && write_manifest(g_names[2], g_good, lib);
+
+    // the other file is no manifest; of the bad one, only the last entry
+    // is right, and the core rejects a mandatory argument after an optional
+    int count = succeeded ? sct_load_plugin_manifests(g_dir) : 0;
+    if (succeeded && (count != 3)) {
+        printf("\t %d commands registered instead of 3.\n", count);
+        succeeded = false;
+    }
+    char *rejected[] = { "t_early", "t_kind", "t_many", "t_order" };
+    for (size_t i = 0; succeeded && (i < 4); i++) {
+        if (!get_command_by_name(rejected[i])) continue;
+        printf("\t bad command '%s' registered.\n", rejected[i]);
+        succeeded = false;
+    }
+    succeeded = succeeded && check_args("t_hello", 1, SA_TEXT, true, 0, false)
+        && check_args("t_two", 2, SA_FILENAME, false, SA_DIRNAME, true)
+        && check_args("t_missing", 0, 0, false, 0, false);
+
+    // registering loads nothing, the first run does
+    if (succeeded && loaded(lib)) {
+        printf("\t library loaded before its command runs.\n");
+        succeeded = false;
+    }
+    sct_command_t *cmd = succeeded ? get_command_by_name("t_hello") : NULL;
+    sct_exec_cb_t exec_fn = cmd ? cmd->resolve_fn(cmd->name,
+        cmd->resolve_ctx) : NULL;
+    succeeded = succeeded && exec_fn && loaded(lib)
+        && (exec_fn(cmd->args, cmd->argc) == 0);
+    // a library that cannot be loaded leaves its commands unavailable
+    cmd = succeeded ? get_command_by_name("t_missing") : NULL;
+    succeeded = succeeded && cmd && !cmd->resolve_fn(cmd->name,
+        cmd->resolve_ctx);
+
+    sct_unload_plugins();
+    if (succeeded && loaded(lib)) {
+        printf("\t library still loaded after unloading.\n");
+        succeeded = false;
+    }
+    sct_finalize();
+    for (size_t i = 0; i < NAME_COUNT; i++) {
+        char *fn = scu_sprintf("%s/%s", g_dir, g_names[i]);
+        if (fn) unlink(fn);
+        free(fn);
+    }
+    rmdir(g_dir);
+    free(lib);
+    if (succeeded)
+        printf("All sct_plugins succeeded.\n");
+    return succeeded;
+}
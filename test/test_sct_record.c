@@ -0,0 +1,112 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "test_sct_record.h"
+#include "sct_record.h"
+
+// write_records() writes the records of the tests in the mode, returning
+// what was written
+static char *write_records(sct_output_t mode, size_t *len) {
+    char *data = NULL;
+    FILE *out = open_memstream(&data, len);
+    if (!out) return NULL;
+    sct_record_set_output(mode, out);
+    sct_record_t r = { 0 };
+    sct_record_begin(&r, "match");
+    sct_record_str(&r, "file", "a \"b\"\\c");
+    sct_record_int(&r, "line", -3);
+    sct_record_real(&r, "rtt", 0.25);
+    sct_record_bool(&r, "ok", true);
+    sct_record_end(&r);
+    // r is reused
+    char *strings[] = { "x", "\xc3\xa9", "\xff" };
+    sct_record_begin(&r, "s");
+    sct_record_strn(&r, "text", "\t\x01\xff\xc3\xa9\xed\xa0\x80\n", 9);
+    sct_record_strs(&r, "strings", strings, 3);
+    sct_record_real(&r, "nan", NAN);
+    sct_record_end(&r);
+    sct_record_free(&r);
+    sct_record_set_output(SCT_OUTPUT_TEXT, NULL);
+    fclose(out);
+    return data;
+}
+
+static bool check_json(void) {
+    size_t len;
+    char *data = write_records(SCT_OUTPUT_JSON, &len);
+    char *expected =
+        "{\"type\":\"match\",\"file\":\"a \\\"b\\\"\\\\c\",\"line\":-3,"
+        "\"rtt\":0.25,\"ok\":true}\n"
+        // invalid UTF-8 bytes are escaped one by one, valid sequences kept;
+        // the bytes follow in base64
+        "{\"type\":\"s\",\"text\":\"\\t\\u0001\\u00ff\xc3\xa9\\u00ed\\u00a0"
+        "\\u0080\\n\",\"text_b64\":\"CQH/w6ntoIAK\","
+        "\"strings\":[\"x\",\"\xc3\xa9\",\"\\u00ff\"],"
+        "\"strings_b64\":[\"eA==\",\"w6k=\",\"/w==\"],\"nan\":null}\n";
+    bool ok = data && (strcmp(data, expected) == 0);
+    if (!ok) printf("\t json: %s FAILED.\n", data ? data : "(none)");
+    free(data);
+    return ok;
+}
+
+static bool check_binary(void) {
+    size_t len;
+    char *data = write_records(SCT_OUTPUT_BINARY, &len);
+    char expected[] =
+        "\x37\x00\x00\x00" "\x05" "match"
+        "\x03" "\x04" "file" "\x07\x00\x00\x00" "a \"b\"\\c"
+        "\x01" "\x04" "line" "\xfd\xff\xff\xff\xff\xff\xff\xff"
+        "\x02" "\x03" "rtt" "\x00\x00\x00\x00\x00\x00\xd0\x3f"
+        "\x04" "\x02" "ok" "\x01"
+        "\x3f\x00\x00\x00" "\x01" "s"
+        // strings are written as they are
+        "\x03" "\x04" "text" "\x09\x00\x00\x00"
+            "\t\x01\xff\xc3\xa9\xed\xa0\x80\n"
+        "\x05" "\x07" "strings" "\x03\x00\x00\x00"
+            "\x01\x00\x00\x00" "x" "\x02\x00\x00\x00" "\xc3\xa9"
+            "\x01\x00\x00\x00" "\xff"
+        "\x02" "\x03" "nan";
+    size_t expected_len = sizeof(expected) - 1;
+    double nan_value;
+    bool ok = data && (len == expected_len + sizeof(double))
+        && (memcmp(data, expected, expected_len) == 0);
+    if (ok) {
+        memcpy(&nan_value, data + expected_len, sizeof(double));
+        ok = isnan(nan_value);
+    }
+    if (!ok) printf("\t binary: %zu bytes FAILED.\n", data ? len : 0);
+    free(data);
+    return ok;
+}
+
+bool perform_test_sct_record(void) {
+    printf("testing sct_record...\n");
+    bool succeeded = check_json() && check_binary() && !sct_records();
+    if (succeeded)
+        printf("All sct_record succeeded.\n");
+    return succeeded;
+}
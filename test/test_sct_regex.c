@@ -0,0 +1,155 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+#include "test_sct_regex.h"
+#include "sct_regex.h"
+
+// every pattern is matched against every line, expecting regexec()'s result
+static char *g_patterns[] = {
+    "", "abc", "a.c", "^abc", "abc$", "^$", "^abc$", "a*", "ab*c", "a\\+b",
+    "ab\\?c", "a\\{2\\}", "a\\{1,2\\}b", "a\\{2,\\}", "x\\{,1\\}y",
+    "\\(ab\\)*c", "\\(ab\\)\\{2\\}", "abc\\|xyz", "^a\\|c$", "\\(^a\\|b\\)c",
+    "[abc]", "[^abc]", "[a-c]x", "[]a]", "[^]a]", "[a-]", "[[:digit:]]\\+",
+    "[[:upper:][:space:]]", "[.]", "*a", "^*", "a^b", "a$b", "\\(*a\\)",
+    "\\w\\+", "\\W", "\\s", "\\S\\S", "\\.", "\\*", "x\\|", "\\(\\)",
+    "a.*b.*c", "\\(a\\|b\\)*abb", "hello world", ".", "a\\{0\\}b",
+    "\\(ab\\|cd\\)\\(ef\\|gh\\)", "[0-9][0-9]*\\.[0-9]",
+    // beyond the DFA, for regexec()
+    "\\(a\\)\\1", "\\<abc\\>", "\\bab",
+};
+
+static char *g_lines[] = {
+    "", "abc", "xabcx", "ac", "abbbc", "aab", "aaa", "b", "xyz", "ab",
+    "ababc", "abab", "y", "xy", "xxy", "c", "bc", "]", "a-", "123", "A b",
+    "a.c", "*a", "a^b", "a$b", "hello world", "say hello world!", "aabb",
+    "babb", "cdgh", "3.14", "a a", "abc def", "\t", "a\x01" "b",
+};
+
+static bool test_lines(void) {
+    bool succeeded = true;
+    int patterns = sizeof(g_patterns) / sizeof(g_patterns[0]);
+    int lines = sizeof(g_lines) / sizeof(g_lines[0]);
+    for (int i = 0; i < patterns; i++) {
+        char err[128];
+        sct_regex_t *re = sct_regex_get(g_patterns[i], err, sizeof(err));
+        regex_t posix;
+        if (!re || regcomp(&posix, g_patterns[i], REG_NOSUB)) {
+            printf("\t compiling \"%s\" FAILED.\n", g_patterns[i]);
+            sct_regex_put(re);
+            succeeded = false;
+            continue;
+        }
+        for (int j = 0; j < lines; j++) {
+            size_t start, end;
+            bool got = sct_regex_find_line(re, g_lines[j],
+                strlen(g_lines[j]), &start, &end);
+            // an empty buffer has no lines, check one with the '\n'
+            if (!g_lines[j][0])
+                got = sct_regex_find_line(re, "\n", 1, &start, &end);
+            bool expected = regexec(&posix, g_lines[j], 0, NULL, 0) == 0;
+            if (got != expected) {
+                printf("\t \"%s\" on \"%s\" FAILED.\n", g_patterns[i],
+                    g_lines[j]);
+                succeeded = false;
+            }
+        }
+        regfree(&posix);
+        sct_regex_put(re);
+    }
+    return succeeded;
+}
+
+static bool test_buffer(void) {
+    char err[128];
+    char *data = "first line\nsecond match\n\nthird\nlast match";
+    size_t len = strlen(data);
+    sct_regex_t *re = sct_regex_get("mat*ch$", err, sizeof(err));
+    size_t start, end;
+    bool succeeded = re && sct_regex_uses_dfa(re)
+        && sct_regex_find_line(re, data, len, &start, &end)
+        && (start == 11) && (end == 23);
+    // the next search starts past the line found
+    succeeded = succeeded
+        && sct_regex_find_line(re, data + end + 1, len - end - 1, &start, &end)
+        && (strncmp(data + 24 + start, "last match", end - start) == 0);
+    sct_regex_put(re);
+
+    re = sct_regex_get("^$", err, sizeof(err));
+    succeeded = succeeded && re
+        && sct_regex_find_line(re, data, len, &start, &end)
+        && (start == 24) && (end == 24);
+    sct_regex_put(re);
+    if (!succeeded) printf("\t sct_regex_find_line() FAILED.\n");
+    return succeeded;
+}
+
+static bool test_cache(void) {
+    char err[128];
+    bool succeeded = true;
+    sct_regex_t *a = sct_regex_get("cached\\|pattern", err, sizeof(err));
+    sct_regex_t *b = sct_regex_get("cached\\|pattern", err, sizeof(err));
+    if (!a || (a != b)) {
+        printf("\t pattern was not cached, FAILED.\n");
+        succeeded = false;
+    }
+    sct_regex_put(b);
+    if (!sct_regex_uses_dfa(a) || sct_regex_uses_dfa(
+        b = sct_regex_get("\\(x\\)\\1", err, sizeof(err))))
+    {
+        printf("\t choice of the matcher FAILED.\n");
+        succeeded = false;
+    }
+    sct_regex_put(b);
+    // errors come from regcomp()
+    if (sct_regex_get("a\\{1", err, sizeof(err)) || !err[0]) {
+        printf("\t invalid pattern FAILED.\n");
+        succeeded = false;
+    }
+    // a pattern in use survives eviction
+    char pattern[16];
+    for (int i = 0; i <= SCT_REGEX_CACHE_SIZE; i++) {
+        snprintf(pattern, sizeof(pattern), "p%d", i);
+        sct_regex_put(sct_regex_get(pattern, err, sizeof(err)));
+    }
+    size_t start, end;
+    if (!sct_regex_find_line(a, "a pattern", 9, &start, &end)) {
+        printf("\t pattern in use FAILED.\n");
+        succeeded = false;
+    }
+    sct_regex_put(a);
+    return succeeded;
+}
+
+bool perform_test_sct_regex(void) {
+    printf("testing sct_regex...\n");
+    bool succeeded = test_lines();
+    succeeded = test_buffer() && succeeded;
+    succeeded = test_cache() && succeeded;
+    sct_regex_finalize();
+    if (succeeded)
+        printf("All sct_regex succeeded.\n");
+    return succeeded;
+}
@@ -0,0 +1,68 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <string.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include "test_sct_resolve.h"
+#include "sct_resolve.h"
+
+// Only names of /etc/hosts resolve here: a missing name fails whether
+// or not there is a name server to ask.
+
+static bool check(char *name, int expected_error, char *expected_address) {
+    char address[INET6_ADDRSTRLEN];
+    int error = sct_resolve_lookup(name, address, sizeof(address));
+    bool ok = expected_error ? error != 0 : error == 0;
+    if (ok && !error && expected_address)
+        ok = strcmp(address, expected_address) == 0;
+    if (!ok) printf("\t %s: %s FAILED.\n", name,
+        error ? gai_strerror(error) : address);
+    return ok;
+}
+
+bool perform_test_sct_resolve(void) {
+    printf("testing sct_resolve...\n");
+    char *names[] = { "localhost", "no-such-host.invalid", "127.0.0.1",
+        "localhost" };
+    sct_resolve_names(names, 4);
+    bool succeeded = sct_resolve_cached("localhost")
+        // failures are cached too
+        && sct_resolve_cached("no-such-host.invalid")
+        // numbers are not looked up
+        && !sct_resolve_cached("127.0.0.1");
+    if (!succeeded) printf("\t names resolved not cached FAILED.\n");
+    succeeded = succeeded && check("localhost", 0, NULL)
+        && check("no-such-host.invalid", EAI_NONAME, NULL)
+        && check("127.0.0.1", 0, "127.0.0.1")
+        && check("::1", 0, "::1");
+    // a name looked up alone is cached as well
+    succeeded = succeeded && !sct_resolve_cached("other.invalid")
+        && check("other.invalid", EAI_NONAME, NULL)
+        && sct_resolve_cached("other.invalid");
+    sct_resolve_finalize();
+    succeeded = succeeded && !sct_resolve_cached("localhost");
+    if (succeeded)
+        printf("All sct_resolve succeeded.\n");
+    return succeeded;
+}
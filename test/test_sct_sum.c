@@ -0,0 +1,168 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include "test_sct_sum.h"
+#include "sct_sum.h"
+
+// known hashes: every path of XXH3 by the input length, and the FIPS 180
+// examples of SHA-256
+static bool check_vectors(void) {
+    static const struct { char c; size_t len; uint64_t h; } xxh3[] = {
+        { 0, 0, 0x2d06800538d394c2ull }, { 'x', 100, 0xc90984ffdf50ce42ull },
+        { 'y', 200, 0x78c5ae5cf7b1237eull }, { 'z', 1000, 0xcd3a574700eddf41ull }
+    };
+    static const struct { char *s; uint64_t h; } xxh3_strings[] = {
+        { "a", 0xe6c632b61e964e1full }, { "abc", 0x78af5f94892f3950ull },
+        { "abcdefgh", 0x6f45a76842a96483ull },
+        { "hello world!!", 0x93868c6e5c5f88ceull }
+    };
+    static const struct { char *s; size_t repeat; char *hex; } sha[] = {
+        { "", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+        { "abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+        { "a", 1000000,
+            "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" }
+    };
+    char buf[1000];
+    for (size_t i = 0; i < sizeof(xxh3) / sizeof(xxh3[0]); i++) {
+        memset(buf, xxh3[i].c, xxh3[i].len);
+        if (sct_xxh3(buf, xxh3[i].len) == xxh3[i].h) continue;
+        printf("\t xxh3 of %zu bytes FAILED.\n", xxh3[i].len);
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(xxh3_strings) / sizeof(xxh3_strings[0]);
+        i++) {
+        char *s = xxh3_strings[i].s;
+        if (sct_xxh3(s, strlen(s)) == xxh3_strings[i].h) continue;
+        printf("\t xxh3 of \"%s\" FAILED.\n", s);
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(sha) / sizeof(sha[0]); i++) {
+        size_t len = strlen(sha[i].s);
+        char *data = malloc(len * sha[i].repeat + 1);
+        if (!data) return false;
+        for (size_t r = 0; r < sha[i].repeat; r++)
+            memcpy(data + r * len, sha[i].s, len);
+        uint8_t digest[SCT_SHA256_SIZE];
+        sct_sha256(data, len * sha[i].repeat, digest);
+        free(data);
+        char hex[2 * SCT_SHA256_SIZE + 1];
+        for (int k = 0; k < SCT_SHA256_SIZE; k++)
+            sprintf(hex + 2 * k, "%02x", digest[k]);
+        if (strcmp(hex, sha[i].hex) == 0) continue;
+        printf("\t sha256 of \"%.10s\" x %zu FAILED.\n", sha[i].s,
+            sha[i].repeat);
+        return false;
+    }
+    return true;
+}
+
+// random data of every length up to a few blocks, compared with the
+// xxhash library, where installed
+static bool check_library(void) {
+    void *lib = dlopen("libxxhash.so.0", RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        printf("\t libxxhash.so.0 not found, comparison skipped.\n");
+        return true;
+    }
+    uint64_t (*xxh3)(const void *, size_t) = (uint64_t (*)(const void *,
+        size_t))dlsym(lib, "XXH3_64bits");
+    size_t size = 5000;
+    unsigned char *data = malloc(size);
+    bool succeeded = xxh3 && data;
+    srand(1);
+    for (size_t i = 0; succeeded && (i < size); i++) data[i] = rand();
+    for (size_t len = 0; succeeded && (len <= size); len++) {
+        succeeded = sct_xxh3(data, len) == xxh3(data, len);
+        if (!succeeded) printf("\t xxh3 of %zu bytes FAILED.\n", len);
+    }
+    free(data);
+    dlclose(lib);
+    return succeeded;
+}
+
+// check_files() sums files of several chunks, the same and with their
+// last byte changed, a file of one chunk, and a missing one
+static bool check_files(void) {
+    char paths[4][64];
+    size_t sizes[] = { 10 << 20, 10 << 20, 10 << 20, 1000 };
+    char *data = malloc(sizes[0]);
+    if (!data) return false;
+    for (size_t i = 0; i < sizes[0]; i++) data[i] = (char)(i * 7 + i / 4093);
+    bool succeeded = true;
+    // the last file is not written
+    for (int i = 0; i < 4; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "/tmp/test_sct_sum_%d_%d",
+            (int)getpid(), i);
+        if (i == 3) break;
+        if (i == 2) data[sizes[i] - 1] ^= 1;
+        FILE *f = fopen(paths[i], "wb");
+        succeeded = succeeded && f && (fwrite(data, 1, sizes[i], f)
+            == sizes[i]);
+        if (f) fclose(f);
+    }
+    char *list[] = { paths[0], paths[1], paths[2], paths[3] };
+    uint64_t sums[4];
+    int errors[4];
+    succeeded = succeeded && sct_sum_files(list, 4, SCT_SUM_XXH3,
+        (uint8_t *)sums, errors);
+    if (succeeded && (errors[0] || errors[1] || errors[2]
+        || (errors[3] != ENOENT) || (sums[0] != sums[1])
+        || (sums[0] == sums[2]))) {
+        printf("\t sct_sum_files() FAILED.\n");
+        succeeded = false;
+    }
+    // one chunk: the hash of the size and of the chunk's hash
+    data[sizes[0] - 1] ^= 1;
+    FILE *f = succeeded ? fopen(paths[0], "wb") : NULL;
+    succeeded = succeeded && f && (fwrite(data, 1, sizes[3], f) == sizes[3]);
+    if (f) fclose(f);
+    uint8_t tree[16];
+    uint64_t size = sizes[3];
+    uint64_t leaf = sct_xxh3(data, sizes[3]);
+    memcpy(tree, &size, 8);
+    memcpy(tree + 8, &leaf, 8);
+    succeeded = succeeded && sct_sum_files(list, 1, SCT_SUM_XXH3,
+        (uint8_t *)sums, errors);
+    if (succeeded && (errors[0] || (sums[0] != sct_xxh3(tree, 16)))) {
+        printf("\t sct_sum_files() of one chunk FAILED.\n");
+        succeeded = false;
+    }
+    for (int i = 0; i < 3; i++) unlink(paths[i]);
+    free(data);
+    return succeeded;
+}
+
+bool perform_test_sct_sum(void) {
+    printf("testing sct_sum...\n");
+    bool succeeded = check_vectors() && check_library() && check_files();
+    if (succeeded)
+        printf("All sct_sum succeeded.\n");
+    return succeeded;
+}
@@ -1,53 +1,128 @@
-// The MIT License (MIT)
-//
-//  Copyright (c) 2024 Maxim Kryukov
-//
-//  Permission is hereby granted, free of charge, to any person obtaining a copy 
-//  of this software and associated documentation files (the “Software”), 
-//  to deal in the Software without restriction, including without limitation 
-//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
-//  and/or sell copies of the Software, and to permit persons to whom the 
-//  Software is furnished to do so, subject to the following conditions:
-//
-//  The above copyright notice and this permission notice shall be included 
-//  in all copies or substantial portions of the Software.
-//
-//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
-//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
-//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
-//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
-//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
-//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
-//  DEALINGS IN THE SOFTWARE.
-
-#include <stdio.h>
-#include "test_sct_utils.h"
-#include "sct_utils.h"
-
-bool perform_test_sct_utils(void) {
-    printf("testing scu_validate_hostname_or_ip()...\n");
-    bool succeeded = true;
-
-    if (!scu_validate_hostname_or_ip("8.8.8.8")) {
-        printf("\t scu_validate_hostname_or_ip(\"8.8.8.8\") FAILED.\n");
-        succeeded = false;
-    }
-    if (scu_validate_hostname_or_ip("8.$8.8.8")) {
-        printf("\t scu_validate_hostname_or_ip(\"8.a8.8.8\") FAILED -- ." \
-            "false positive\n");
-        succeeded = false;
-    }
-    if (!scu_validate_hostname_or_ip("ya.ru")) {
-        printf("\t scu_validate_hostname_or_ip(\"ya.ru\") FAILED.\n");
-        succeeded = false;
-    }
-    if (scu_validate_hostname_or_ip("ya?.ru")) {
-        printf("\t scu_validate_hostname_or_ip(\"ya?.ru\") FAILED -- ." \
-            "false positive\n");
-        succeeded = false;
-    }
-
-    if (succeeded)
-        printf("All sct_utils succeeded.\n");
-    return succeeded;
-}
\ No newline at end of file
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <string.h>
+#include "test_sct_utils.h"
+#include "sct_utils.h"
+
+bool perform_test_sct_utils(void) {
+    printf("testing scu_validate_hostname_or_ip()...\n");
+    bool succeeded = true;
+
+    if (!scu_validate_hostname_or_ip("8.8.8.8")) {
+        printf("\t scu_validate_hostname_or_ip(\"8.8.8.8\") FAILED.\n");
+        succeeded = false;
+    }
+    if (scu_validate_hostname_or_ip("8.$8.8.8")) {
+        printf("\t scu_validate_hostname_or_ip(\"8.a8.8.8\") FAILED -- ." \
+            "false positive\n");
+        succeeded = false;
+    }
+    if (!scu_validate_hostname_or_ip("ya.ru")) {
+        printf("\t scu_validate_hostname_or_ip(\"ya.ru\") FAILED.\n");
+        succeeded = false;
+    }
+    if (scu_validate_hostname_or_ip("ya?.ru")) {
+        printf("\t scu_validate_hostname_or_ip(\"ya?.ru\") FAILED -- ." \
+            "false positive\n");
+        succeeded = false;
+    }
+
+    if (succeeded)
+        printf("All sct_utils succeeded.\n");
+    return succeeded;
+}
+
+// reference classification of a single character
+static unsigned expected_class(unsigned char c) {
+    bool digit = (c >= '0') && (c <= '9');
+    bool alpha = ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'));
+    bool hex = ((c >= 'a') && (c <= 'f')) || ((c >= 'A') && (c <= 'F'));
+    unsigned result = 0;
+    if (digit || alpha || (c == '-') || (c == '_') || (c == '.'))
+        result |= SCU_CLASS_HOSTNAME;
+    if (digit || (c == '.')) result |= SCU_CLASS_IP4;
+    if (digit || hex || (c == ':')) result |= SCU_CLASS_IP6;
+    if ((c != '<') && (c != '>') && (c != '|') && (c != '&'))
+        result |= SCU_CLASS_FILENAME;
+    return result;
+}
+
+bool perform_test_scu_classify(void) {
+    printf("testing scu_classify()...\n");
+    bool succeeded = true;
+
+    // every character, alone and at every position of a string long
+    // enough for the vectorized path and its scalar tail
+    char s[40];
+    for (int c = 1; c < 256; c++) {
+        for (int pos = 0; pos < sizeof(s) - 1; pos++) {
+            memset(s, '7', sizeof(s) - 1);
+            s[sizeof(s) - 1] = 0;
+            s[pos] = (char)c;
+            unsigned expected = expected_class(c) & expected_class('7');
+            unsigned got = scu_classify(s, strlen(s));
+            if (got != expected) {
+                printf("\t scu_classify() of char 0x%02x at %d FAILED: "
+                    "0x%x, expected 0x%x\n", c, pos, got, expected);
+                succeeded = false;
+                break;
+            }
+        }
+        char one[2] = { (char)c, 0 };
+        if (scu_classify(one, 1) != expected_class(c)) {
+            printf("\t scu_classify() of char 0x%02x FAILED.\n", c);
+            succeeded = false;
+        }
+    }
+    if (scu_classify("", 0) != 0) {
+        printf("\t scu_classify(\"\") FAILED.\n");
+        succeeded = false;
+    }
+
+    char *names[] = { "8.8.8.8", "fe80::1", "my_host-1.example.com",
+        "/tmp/a file", "ya?.ru", "a|b", NULL };
+    unsigned expected[] = {
+        SCU_CLASS_HOSTNAME | SCU_CLASS_IP4 | SCU_CLASS_FILENAME,
+        SCU_CLASS_IP6 | SCU_CLASS_FILENAME,
+        SCU_CLASS_HOSTNAME | SCU_CLASS_FILENAME,
+        SCU_CLASS_FILENAME,
+        SCU_CLASS_FILENAME,
+        0,
+        0
+    };
+    unsigned classes[7];
+    scu_classify_bulk(names, 7, classes);
+    for (int i = 0; i < 7; i++) {
+        if (classes[i] != expected[i]) {
+            printf("\t scu_classify_bulk() of \"%s\" FAILED: 0x%x, "
+                "expected 0x%x\n", names[i] ? names[i] : "(null)",
+                classes[i], expected[i]);
+            succeeded = false;
+        }
+    }
+
+    if (succeeded)
+        printf("All scu_classify succeeded.\n");
+    return succeeded;
+}
@@ -0,0 +1,231 @@
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "test_sct_walk.h"
+#include "sct_pool.h"
+#include "sct_walk.h"
+
+#define TEST_WORKERS 8
+#define TEST_TREE_DEPTH 12
+
+typedef struct tree_job_ {
+    size_t done[TEST_WORKERS];
+} tree_job_t;
+
+// every task below the depth pushes two more
+static void tree_task(sct_pool_t *pool, void *task, int worker, void *ctx) {
+    tree_job_t *job = ctx;
+    uintptr_t depth = (uintptr_t)task;
+    job->done[worker]++;
+    if (depth == TEST_TREE_DEPTH) return;
+    sct_pool_push(pool, (void *)(depth + 1));
+    sct_pool_push(pool, (void *)(depth + 1));
+}
+
+bool perform_test_sct_pool(void) {
+    printf("testing sct_pool...\n");
+    bool succeeded = true;
+    // the threads are kept from a job to the next
+    for (int run = 0; succeeded && (run < 3); run++) {
+        tree_job_t job;
+        memset(&job, 0, sizeof(job));
+        void *roots[] = { (void *)(uintptr_t)1, (void *)(uintptr_t)0 };
+        succeeded = sct_pool_run("test", TEST_WORKERS, tree_task, &job,
+            roots, 2);
+        size_t total = 0;
+        for (int i = 0; i < TEST_WORKERS; i++) total += job.done[i];
+        size_t expected = ((size_t)2 << TEST_TREE_DEPTH) - 1
+            + ((size_t)2 << (TEST_TREE_DEPTH - 1)) - 1;
+        if (total != expected) {
+            printf("\t %zu tasks done instead of %zu.\n", total, expected);
+            succeeded = false;
+        }
+    }
+    if (succeeded)
+        printf("All sct_pool succeeded.\n");
+    return succeeded;
+}
+
+static char g_dir[] = "/tmp/test_sct_walk_XXXXXX";
+
+// the tree under g_dir, directories ending with '/'
+static char *g_names[] = { "a/", "a/b/", "a/b/c/", "a/b/c/f3", "a/b/f2",
+    "a/f1", "f0", "d/", "d/e/" };
+#define NAME_COUNT (sizeof(g_names) / sizeof(g_names[0]))
+
+typedef struct walk_result_ {
+    int seen[NAME_COUNT + 2];   // the link and the root last
+    int errors;
+    bool wrong;
+} walk_result_t;
+
+static void walk_entry(const sct_walk_entry_t *e, int worker, void *ctx) {
+    walk_result_t *r = ctx;
+    if (e->error) {
+        __atomic_add_fetch(&r->errors, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (!e->st || (strcmp(e->name, strrchr(e->path, '/') + 1) != 0))
+        r->wrong = true;
+    if (e->depth == 0) {
+        __atomic_add_fetch(&r->seen[NAME_COUNT + 1], 1, __ATOMIC_RELAXED);
+        return;
+    }
+    char *rel = e->path + strlen(g_dir) + 1;
+    if (strcmp(rel, "link") == 0) {
+        if (e->type != DT_LNK) r->wrong = true;
+        __atomic_add_fetch(&r->seen[NAME_COUNT], 1, __ATOMIC_RELAXED);
+        return;
+    }
+    for (size_t i = 0; i < NAME_COUNT; i++) {
+        size_t len = strlen(g_names[i]);
+        bool dir = g_names[i][len - 1] == '/';
+        if (dir) len--;
+        if ((strncmp(rel, g_names[i], len) != 0) || rel[len]) continue;
+        int depth = 1;
+        for (char *s = rel; *s; s++) depth += *s == '/';
+        if ((e->type != (dir ? DT_DIR : DT_REG)) || (e->depth != depth))
+            r->wrong = true;
+        __atomic_add_fetch(&r->seen[i], 1, __ATOMIC_RELAXED);
+        return;
+    }
+    r->wrong = true;
+}
+
+// the deep tree: levels of long names, their paths longer than PATH_MAX
+#define DEEP_LEVELS 40
+#define DEEP_NAME_LEN 200
+
+typedef struct deep_result_ {
+    int entries;
+    int errors;
+    int depth;
+    bool leaf;
+} deep_result_t;
+
+static void deep_entry(const sct_walk_entry_t *e, int worker, void *ctx) {
+    deep_result_t *r = ctx;
+    __atomic_add_fetch(&r->entries, 1, __ATOMIC_RELAXED);
+    if (e->error) __atomic_add_fetch(&r->errors, 1, __ATOMIC_RELAXED);
+    if (e->type == DT_REG) r->leaf = strcmp(e->name, "leaf") == 0;
+    if (e->depth > r->depth) r->depth = e->depth;
+}
+
+// check_deep() walks a tree too deep for its paths to be opened whole;
+// it is made and removed level by level, relative to the level above
+static bool check_deep(void) {
+    char name[DEEP_NAME_LEN + 1];
+    memset(name, 'x', DEEP_NAME_LEN);
+    name[DEEP_NAME_LEN] = 0;
+    int fds[DEEP_LEVELS + 1];
+    fds[0] = open(g_dir, O_RDONLY | O_DIRECTORY);
+    int levels = 0;
+    while ((fds[levels] >= 0) && (levels < DEEP_LEVELS)
+        && (mkdirat(fds[levels], name, 0755) == 0)) {
+        fds[levels + 1] = openat(fds[levels], name, O_RDONLY | O_DIRECTORY);
+        levels++;
+    }
+    bool succeeded = (levels == DEEP_LEVELS) && (fds[levels] >= 0);
+    int leaf = succeeded ? openat(fds[levels], "leaf", O_WRONLY | O_CREAT,
+        0644) : -1;
+    succeeded = succeeded && (leaf >= 0);
+    if (leaf >= 0) close(leaf);
+
+    deep_result_t r;
+    memset(&r, 0, sizeof(r));
+    char root[sizeof(g_dir) + DEEP_NAME_LEN + 1];
+    snprintf(root, sizeof(root), "%s/%s", g_dir, name);
+    char *roots[] = { root };
+    succeeded = succeeded && sct_walk(roots, 1, 0, TEST_WORKERS, deep_entry,
+        &r);
+    if (succeeded && ((r.entries != DEEP_LEVELS + 1) || r.errors || !r.leaf
+        || (r.depth != DEEP_LEVELS))) {
+        printf("\t deep: %d entries, %d errors, depth %d.\n", r.entries,
+            r.errors, r.depth);
+        succeeded = false;
+    }
+
+    if (levels && (fds[levels] >= 0)) unlinkat(fds[levels], "leaf", 0);
+    for (int i = levels; i > 0; i--) {
+        if (fds[i] >= 0) close(fds[i]);
+        unlinkat(fds[i - 1], name, AT_REMOVEDIR);
+    }
+    if (fds[0] >= 0) close(fds[0]);
+    return succeeded;
+}
+
+bool perform_test_sct_walk(void) {
+    printf("testing sct_walk...\n");
+    if (!mkdtemp(g_dir)) return false;
+    char path[128];
+    bool succeeded = true;
+    for (size_t i = 0; succeeded && (i < NAME_COUNT); i++) {
+        snprintf(path, sizeof(path), "%s/%s", g_dir, g_names[i]);
+        if (path[strlen(path) - 1] == '/') succeeded = mkdir(path, 0755) == 0;
+        else {
+            FILE *f = fopen(path, "w");
+            succeeded = f != NULL;
+            if (f) fclose(f);
+        }
+    }
+    // a link to a directory is an entry, not followed
+    snprintf(path, sizeof(path), "%s/link", g_dir);
+    succeeded = succeeded && (symlink("a", path) == 0);
+
+    walk_result_t r;
+    memset(&r, 0, sizeof(r));
+    char missing[128];
+    snprintf(missing, sizeof(missing), "%s/missing", g_dir);
+    char *roots[] = { g_dir, missing };
+    succeeded = succeeded && sct_walk(roots, 2, SCT_WALK_STAT, TEST_WORKERS,
+        walk_entry, &r);
+    for (size_t i = 0; succeeded && (i < NAME_COUNT + 2); i++) {
+        if (r.seen[i] == 1) continue;
+        printf("\t entry %zu seen %d times.\n", i, r.seen[i]);
+        succeeded = false;
+    }
+    if (succeeded && (r.wrong || (r.errors != 1))) {
+        printf("\t wrong entries, %d errors.\n", r.errors);
+        succeeded = false;
+    }
+    succeeded = succeeded && check_deep();
+
+    unlink(path);
+    for (size_t i = NAME_COUNT; i > 0; i--) {
+        snprintf(path, sizeof(path), "%s/%s", g_dir, g_names[i - 1]);
+        if (path[strlen(path) - 1] == '/') rmdir(path);
+        else unlink(path);
+    }
+    rmdir(g_dir);
+    if (succeeded)
+        printf("All sct_walk succeeded.\n");
+    return succeeded;
+}
@@ -1,37 +1,69 @@
-// The MIT License (MIT)
-//
-//  Copyright (c) 2024 Maxim Kryukov
-//
-//  Permission is hereby granted, free of charge, to any person obtaining a copy 
-//  of this software and associated documentation files (the “Software”), 
-//  to deal in the Software without restriction, including without limitation 
-//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
-//  and/or sell copies of the Software, and to permit persons to whom the 
-//  Software is furnished to do so, subject to the following conditions:
-//
-//  The above copyright notice and this permission notice shall be included 
-//  in all copies or substantial portions of the Software.
-//
-//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
-//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
-//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
-//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
-//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
-//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
-//  DEALINGS IN THE SOFTWARE.
-
-#include <stdio.h>
-#include "sct_utils.h"
-#include "test_sct_utils.h"
-
-int main(int argc, char** argv) {  
-    bool succeded = scu_initialize_utils()
-        && perform_test_sct_utils();
-    int retval = succeded ? 0 : 1;
-    if (retval)
-        printf("Tests FAILED.\n");
-    else printf("Tests SUCCEEDED OK.\n");
-
-    scu_finalize_utils();
-    return retval;
+// The MIT License (MIT)
+//
+//  Copyright (c) 2024 Maxim Kryukov
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy 
+//  of this software and associated documentation files (the “Software”), 
+//  to deal in the Software without restriction, including without limitation 
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//  and/or sell copies of the Software, and to permit persons to whom the 
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included 
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL 
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//  DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include "sct_utils.h"
+#include "test_sct_utils.h"
+#include "test_sct_glob.h"
+#include "test_sct_io.h"
+#include "test_sct_regex.h"
+#include "test_sct_aho.h"
+#include "test_sct_index.h"
+#include "test_sct_decomp.h"
+#include "test_sct_resolve.h"
+#include "test_sct_sum.h"
+#include "test_sct_walk.h"
+#include "test_sct_record.h"
+#include "test_sct_history.h"
+#include "test_sct_fileops.h"
+#include "test_sct_plugins.h"
+
+int main(int argc, char** argv) {  
+    bool succeded = scu_initialize_utils()
+        && perform_test_sct_utils()
+        && perform_test_scu_classify()
+        && perform_test_sct_glob_match()
+        && perform_test_sct_glob()
+        && perform_test_sct_io()
+        && perform_test_sct_regex()
+        && perform_test_sct_aho()
+        && perform_test_sct_index()
+        && perform_test_sct_decomp()
+        && perform_test_sct_resolve()
+        && perform_test_sct_sum()
+        && perform_test_sct_pool()
+        && perform_test_sct_walk()
+        && perform_test_sct_record()
+        && perform_test_sct_history()
+        && perform_test_sct_sync()
+        && perform_test_sct_grep_memo()
+        && perform_test_sct_follow()
+        && perform_test_sct_dupes()
+        && perform_test_sct_plugins();
+    int retval = succeded ? 0 : 1;
+    if (retval)
+        printf("Tests FAILED.\n");
+    else printf("Tests SUCCEEDED OK.\n");
+
+    scu_finalize_utils();
+    return retval;
 }
\ No newline at end of file